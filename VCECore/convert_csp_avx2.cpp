@@ -36,6 +36,7 @@
 #include <stdint.h>
 #include <string.h>
 #include "convert_csp.h"
+#include "convert_csp_c.h"
 
 #if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
 static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
@@ -879,6 +880,400 @@ void convert_yuv444_09_to_yuv444_avx2(void **dst, const void **src, int width, i
     convert_yuv444_high_to_yuv444_avx2_base<9>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
 }
 
+//Tin x16 を読み込み、16bit x16 に拡張する
+template<typename Tin>
+static RGY_FORCEINLINE __m256i load_cvt_epi16_avx2(const Tin *ptr) {
+    if (sizeof(Tin) == 1) {
+        return _mm256_cvtepu8_epi16(_mm_loadu_si128((const __m128i *)ptr));
+    }
+    return _mm256_loadu_si256((const __m256i *)ptr);
+}
+
+//Tin x8 を読み込み、32bit x8 に拡張する
+template<typename Tin>
+static RGY_FORCEINLINE __m256i load_cvt_epi32_avx2(const Tin *ptr) {
+    if (sizeof(Tin) == 1) {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)ptr));
+    }
+    return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)ptr));
+}
+
+//conv_bit_depth_c の32bit x8版
+template<int in_bit_depth, int out_bit_depth, int offset>
+static RGY_FORCEINLINE __m256i conv_bit_depth_epi32_avx2(__m256i y0) {
+    if (out_bit_depth > in_bit_depth + offset) {
+        return _mm256_slli_epi32(y0, std::max(out_bit_depth - in_bit_depth - offset, 0));
+    } else if (out_bit_depth < in_bit_depth + offset) {
+        return _mm256_srli_epi32(y0, std::max(in_bit_depth + offset - out_bit_depth, 0));
+    }
+    return y0;
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void convert_bit_depth_line_avx2(Tout *dst, const Tin *src, int width) {
+    if (in_bit_depth == out_bit_depth && sizeof(Tin) == sizeof(Tout)) {
+        avx2_memcpy<false>((uint8_t *)dst, (const uint8_t *)src, width * (int)sizeof(Tin));
+        return;
+    }
+    int x = 0;
+    for (; x <= width - 32; x += 32) {
+        __m256i y0 = load_cvt_epi16_avx2(src + x +  0);
+        __m256i y1 = load_cvt_epi16_avx2(src + x + 16);
+        if (out_bit_depth > in_bit_depth) {
+            y0 = _mm256_slli_epi16(y0, std::max(out_bit_depth - in_bit_depth, 0));
+            y1 = _mm256_slli_epi16(y1, std::max(out_bit_depth - in_bit_depth, 0));
+        } else if (out_bit_depth < in_bit_depth) {
+            y0 = _mm256_srli_epi16(y0, std::max(in_bit_depth - out_bit_depth, 0));
+            y1 = _mm256_srli_epi16(y1, std::max(in_bit_depth - out_bit_depth, 0));
+        }
+        if (sizeof(Tout) == 1) {
+            _mm256_storeu_si256((__m256i *)(dst + x), _mm256_permute4x64_epi64(_mm256_packus_epi16(y0, y1), _MM_SHUFFLE(3,1,2,0)));
+        } else {
+            _mm256_storeu_si256((__m256i *)(dst + x +  0), y0);
+            _mm256_storeu_si256((__m256i *)(dst + x + 16), y1);
+        }
+    }
+    convert_bit_depth_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dst, src, x, width);
+}
+
+//yuv444の偶数列の色差を32bit x8に取り出す
+template<typename Tin>
+static RGY_FORCEINLINE __m256i load_even_epi32_avx2(const Tin *ptr) {
+    return _mm256_and_si256(load_cvt_epi16_avx2(ptr), _mm256_set1_epi32(0x0000ffff));
+}
+
+//U, Vを32bit単位で U | (V << 出力のbit数) の形にまとめる
+template<typename Tout>
+static RGY_FORCEINLINE __m256i merge_uv_epi32_avx2(__m256i yU, __m256i yV) {
+    return _mm256_or_si256(yU, _mm256_slli_epi32(yV, sizeof(Tout) * 8));
+}
+
+template<typename Tout>
+static RGY_FORCEINLINE void store_uv_epi32_avx2(Tout *dst, __m256i y0, __m256i y1) {
+    if (sizeof(Tout) == 1) {
+        _mm256_storeu_si256((__m256i *)dst, _mm256_permute4x64_epi64(_mm256_packus_epi32(y0, y1), _MM_SHUFFLE(3,1,2,0)));
+    } else {
+        _mm256_storeu_si256((__m256i *)(dst +  0), y0);
+        _mm256_storeu_si256((__m256i *)(dst + 16), y1);
+    }
+}
+
+//16画素分の色差を縦2行の平均で8組のUVにする
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE __m256i yuv444_to_nv12_p_uv_avx2(const Tin *srcU, const Tin *srcV, int src_uv_pitch) {
+    const __m256i yOne = _mm256_set1_epi32(1);
+    __m256i yU = _mm256_add_epi32(load_even_epi32_avx2(srcU), load_even_epi32_avx2(srcU + src_uv_pitch));
+    __m256i yV = _mm256_add_epi32(load_even_epi32_avx2(srcV), load_even_epi32_avx2(srcV + src_uv_pitch));
+    yU = conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 1>(_mm256_add_epi32(yU, yOne));
+    yV = conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 1>(_mm256_add_epi32(yV, yOne));
+    return merge_uv_epi32_avx2<Tout>(yU, yV);
+}
+
+//3:1で重みづけした縦方向の補間 (r0 * 3 + r1 + 2)
+static RGY_FORCEINLINE __m256i interpolate_31_epi32_avx2(__m256i r0, __m256i r1) {
+    return _mm256_add_epi32(_mm256_add_epi32(r0, _mm256_slli_epi32(r0, 1)), _mm256_add_epi32(r1, _mm256_set1_epi32(2)));
+}
+
+//16画素分の色差を縦4行から補間し、2行分の8組のUVにする
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void yuv444_to_nv12_i_uv_avx2(__m256i& yY0, __m256i& yY1, const Tin *srcU, const Tin *srcV, int src_uv_pitch) {
+    __m256i yU0 = interpolate_31_epi32_avx2(load_even_epi32_avx2(srcU + 0*src_uv_pitch), load_even_epi32_avx2(srcU + 2*src_uv_pitch));
+    __m256i yU1 = interpolate_31_epi32_avx2(load_even_epi32_avx2(srcU + 3*src_uv_pitch), load_even_epi32_avx2(srcU + 1*src_uv_pitch));
+    __m256i yV0 = interpolate_31_epi32_avx2(load_even_epi32_avx2(srcV + 0*src_uv_pitch), load_even_epi32_avx2(srcV + 2*src_uv_pitch));
+    __m256i yV1 = interpolate_31_epi32_avx2(load_even_epi32_avx2(srcV + 3*src_uv_pitch), load_even_epi32_avx2(srcV + 1*src_uv_pitch));
+    yY0 = merge_uv_epi32_avx2<Tout>(conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 2>(yU0), conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 2>(yV0));
+    yY1 = merge_uv_epi32_avx2<Tout>(conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 2>(yU1), conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 2>(yV1));
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth, bool interlaced>
+static void RGY_FORCEINLINE convert_yuv444_to_nv12_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert((sizeof(Tin)  == 1 && in_bit_depth  == 8) || (sizeof(Tin)  == 2 && 8 < in_bit_depth  && in_bit_depth  <= 16), "invalid input bit depth.");
+    static_assert((sizeof(Tout) == 1 && out_bit_depth == 8) || (sizeof(Tout) == 2 && 8 < out_bit_depth && out_bit_depth <= 16), "invalid output bit depth.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte / sizeof(Tin);
+    const int dst_y_pitch = dst_y_pitch_byte / sizeof(Tout);
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const int x_fin = width - crop_right - crop_left;
+    //Y成分のコピー
+    Tin *srcYLine = (Tin *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    Tout *dstYLine = (Tout *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstYLine += dst_y_pitch) {
+        convert_bit_depth_line_avx2<Tin, in_bit_depth, Tout, out_bit_depth>(dstYLine, srcYLine, x_fin);
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte / sizeof(Tin);
+    Tin *srcULine = (Tin *)src[1] + ((src_uv_pitch * y_range.start_src) + crop_left);
+    Tin *srcVLine = (Tin *)src[2] + ((src_uv_pitch * y_range.start_src) + crop_left);
+    Tout *dstLine = (Tout *)dst[1] + (dst_y_pitch >> 1) * y_range.start_dst;
+    if (interlaced) {
+        for (int y = 0; y < y_range.len; y += 4, srcULine += src_uv_pitch * 4, srcVLine += src_uv_pitch * 4, dstLine += dst_y_pitch * 2) {
+            int x = 0;
+            for (; x <= x_fin - 32; x += 32) {
+                __m256i y0, y1, y2, y3;
+                yuv444_to_nv12_i_uv_avx2<Tin, in_bit_depth, Tout, out_bit_depth>(y0, y1, srcULine + x +  0, srcVLine + x +  0, src_uv_pitch);
+                yuv444_to_nv12_i_uv_avx2<Tin, in_bit_depth, Tout, out_bit_depth>(y2, y3, srcULine + x + 16, srcVLine + x + 16, src_uv_pitch);
+                store_uv_epi32_avx2(dstLine + x, y0, y2);
+                store_uv_epi32_avx2(dstLine + dst_y_pitch + x, y1, y3);
+            }
+            convert_yuv444_to_nv12_i_uv_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dstLine, dst_y_pitch, srcULine, srcVLine, src_uv_pitch, x, x_fin);
+        }
+    } else {
+        for (int y = 0; y < y_range.len; y += 2, srcULine += src_uv_pitch * 2, srcVLine += src_uv_pitch * 2, dstLine += dst_y_pitch) {
+            int x = 0;
+            for (; x <= x_fin - 32; x += 32) {
+                __m256i y0 = yuv444_to_nv12_p_uv_avx2<Tin, in_bit_depth, Tout, out_bit_depth>(srcULine + x +  0, srcVLine + x +  0, src_uv_pitch);
+                __m256i y1 = yuv444_to_nv12_p_uv_avx2<Tin, in_bit_depth, Tout, out_bit_depth>(srcULine + x + 16, srcVLine + x + 16, src_uv_pitch);
+                store_uv_epi32_avx2(dstLine + x, y0, y1);
+            }
+            convert_yuv444_to_nv12_p_uv_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dstLine, srcULine, srcVLine, src_uv_pitch, x, x_fin);
+        }
+    }
+}
+
+//yv12の色差8画素分を縦方向に補間し、上の行(1:3)と下の行(3:1)を作る
+template<typename Tin, int in_bit_depth, int out_bit_depth>
+static RGY_FORCEINLINE void yv12_p_to_yuv444_v_avx2(__m256i& yY1, __m256i& yY3, const Tin *srcP, int src_uv_pitch, int y_m, int y_p) {
+    const __m256i y0 = load_cvt_epi32_avx2(srcP + y_m * src_uv_pitch);
+    const __m256i y2 = load_cvt_epi32_avx2(srcP);
+    const __m256i y4 = load_cvt_epi32_avx2(srcP + y_p * src_uv_pitch);
+    yY1 = conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 2>(interpolate_31_epi32_avx2(y2, y0));
+    yY3 = conv_bit_depth_epi32_avx2<in_bit_depth, out_bit_depth, 2>(interpolate_31_epi32_avx2(y2, y4));
+}
+
+//補間済みの色差 a(ix), b(ix+1) から、横方向に2画素 a, (a+b+1)>>1 を作る
+template<typename Tout>
+static RGY_FORCEINLINE __m256i yv12_p_to_yuv444_h_avx2(__m256i a, __m256i b) {
+    __m256i y1 = _mm256_srli_epi32(_mm256_add_epi32(_mm256_add_epi32(a, b), _mm256_set1_epi32(1)), 1);
+    return _mm256_or_si256(a, _mm256_slli_epi32(y1, sizeof(Tout) * 8));
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static void RGY_FORCEINLINE convert_yv12_p_to_yuv444_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert((sizeof(Tin)  == 1 && in_bit_depth  == 8) || (sizeof(Tin)  == 2 && 8 < in_bit_depth  && in_bit_depth  <= 16), "invalid input bit depth.");
+    static_assert((sizeof(Tout) == 1 && out_bit_depth == 8) || (sizeof(Tout) == 2 && 8 < out_bit_depth && out_bit_depth <= 16), "invalid output bit depth.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte / sizeof(Tin);
+    const int dst_y_pitch = dst_y_pitch_byte / sizeof(Tout);
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const int x_fin = width - crop_right - crop_left;
+    //Y成分のコピー
+    Tin *srcYLine = (Tin *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    Tout *dstYLine = (Tout *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstYLine += dst_y_pitch) {
+        convert_bit_depth_line_avx2<Tin, in_bit_depth, Tout, out_bit_depth>(dstYLine, srcYLine, x_fin);
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte / sizeof(Tin);
+    for (int ic = 1; ic < 3; ic++) {
+        Tin *srcCLine = (Tin *)src[ic] + (((src_uv_pitch * y_range.start_src) + crop_left) >> 1);
+        Tout *dstLine = (Tout *)dst[ic] + dst_y_pitch * y_range.start_dst;
+        for (int y = 0; y < y_range.len; y += 2, srcCLine += src_uv_pitch, dstLine += dst_y_pitch * 2) {
+            const int y_m = (y == 0) ? 0 : -1;
+            const int y_p = (y != 0 && y_range.start_dst + y >= height-2) ? 0 : 1;
+            int x = 0;
+            //ブロック内の最後の画素まで右隣の色差を参照できる範囲をSIMDで処理する
+            for (; x + 32 < x_fin; x += 32) {
+                const Tin *srcP = srcCLine + (x >> 1);
+                __m256i yA1_0, yA3_0, yA1_1, yA3_1, yB1_0, yB3_0, yB1_1, yB3_1;
+                yv12_p_to_yuv444_v_avx2<Tin, in_bit_depth, out_bit_depth>(yA1_0, yA3_0, srcP + 0, src_uv_pitch, y_m, y_p);
+                yv12_p_to_yuv444_v_avx2<Tin, in_bit_depth, out_bit_depth>(yA1_1, yA3_1, srcP + 8, src_uv_pitch, y_m, y_p);
+                yv12_p_to_yuv444_v_avx2<Tin, in_bit_depth, out_bit_depth>(yB1_0, yB3_0, srcP + 1, src_uv_pitch, y_m, y_p);
+                yv12_p_to_yuv444_v_avx2<Tin, in_bit_depth, out_bit_depth>(yB1_1, yB3_1, srcP + 9, src_uv_pitch, y_m, y_p);
+                store_uv_epi32_avx2(dstLine + x,               yv12_p_to_yuv444_h_avx2<Tout>(yA1_0, yB1_0), yv12_p_to_yuv444_h_avx2<Tout>(yA1_1, yB1_1));
+                store_uv_epi32_avx2(dstLine + dst_y_pitch + x, yv12_p_to_yuv444_h_avx2<Tout>(yA3_0, yB3_0), yv12_p_to_yuv444_h_avx2<Tout>(yA3_1, yB3_1));
+            }
+            convert_yv12_p_to_yuv444_uv_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dstLine, dst_y_pitch, srcCLine, src_uv_pitch, y_m, y_p, x, x_fin);
+        }
+    }
+}
+
+static void RGY_FORCEINLINE convert_yuv422_to_yuv444_avx2_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const int x_fin = width - crop_right - crop_left;
+    //Y成分のコピー
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstYLine += dst_y_pitch_byte) {
+        avx2_memcpy<false>(dstYLine, srcYLine, x_fin);
+    }
+    //UV成分のコピー
+    for (int ic = 1; ic < 3; ic++) {
+        uint8_t *srcCLine = (uint8_t *)src[ic] + src_uv_pitch_byte * y_range.start_src + (crop_left >> 1);
+        uint8_t *dstLine = (uint8_t *)dst[ic] + dst_y_pitch_byte * y_range.start_dst;
+        for (int y = 0; y < y_range.len; y++, srcCLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+            int x = 0;
+            for (; x + 64 < x_fin; x += 64) {
+                __m256i y0 = _mm256_loadu_si256((const __m256i *)(srcCLine + (x >> 1) + 0));
+                __m256i y1 = _mm256_loadu_si256((const __m256i *)(srcCLine + (x >> 1) + 1));
+                y1 = _mm256_avg_epu8(y0, y1);
+                __m256i y2 = _mm256_unpacklo_epi8(y0, y1);
+                __m256i y3 = _mm256_unpackhi_epi8(y0, y1);
+                _mm256_storeu_si256((__m256i *)(dstLine + x +  0), _mm256_permute2x128_si256(y2, y3, (2<<4) | 0));
+                _mm256_storeu_si256((__m256i *)(dstLine + x + 32), _mm256_permute2x128_si256(y2, y3, (3<<4) | 1));
+            }
+            convert_yuv422_to_yuv444_uv_line_c(dstLine, srcCLine, x, x_fin);
+        }
+    }
+}
+
+void convert_yuv444_to_nv12_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint8_t, 8, uint8_t, 8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint8_t, 8, uint8_t, 8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_to_p010_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint8_t, 8, uint16_t, 16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_to_p010_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint8_t, 8, uint16_t, 16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_16_to_nv12_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 16, uint8_t, 8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_16_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 16, uint8_t, 8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_nv12_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 14, uint8_t, 8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 14, uint8_t, 8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_nv12_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 12, uint8_t, 8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 12, uint8_t, 8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_nv12_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 10, uint8_t, 8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 10, uint8_t, 8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_nv12_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 9, uint8_t, 8, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_nv12_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 9, uint8_t, 8, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_16_to_p010_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 16, uint16_t, 16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_16_to_p010_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 16, uint16_t, 16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_p010_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 14, uint16_t, 16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_14_to_p010_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 14, uint16_t, 16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_p010_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 12, uint16_t, 16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_12_to_p010_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 12, uint16_t, 16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_p010_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 10, uint16_t, 16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_10_to_p010_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 10, uint16_t, 16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_p010_p_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 9, uint16_t, 16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv444_09_to_p010_i_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv444_to_nv12_avx2_base<uint16_t, 9, uint16_t, 16, true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_p_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint8_t, 8, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_p_to_yuv444_16bit_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint8_t, 8, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_16_p_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 16, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_p_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 14, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_p_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 12, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_p_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 10, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_p_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 9, uint8_t, 8>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_16_p_to_yuv444_16bit_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 16, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_p_to_yuv444_16bit_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 14, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_p_to_yuv444_16bit_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 12, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_p_to_yuv444_16bit_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 10, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_p_to_yuv444_16bit_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_p_to_yuv444_avx2_base<uint16_t, 9, uint16_t, 16>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yuv422_to_yuv444_avx2(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yuv422_to_yuv444_avx2_base(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
 #include "convert_const.h"
 
 static RGY_FORCEINLINE void gather_y_uv_from_yc48(__m256i& y0, __m256i& y1, __m256i y2) {
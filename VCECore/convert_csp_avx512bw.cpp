@@ -0,0 +1,512 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include <stdint.h>
+#include <string.h>
+#include "convert_csp.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX512BW__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX512 for this file.");
+#endif
+
+#if defined(_MSC_VER) || (defined(__AVX512BW__) && defined(__AVX512VL__))
+
+//AVX-512ではマスク付きのload/storeが使えるので、行末の端数もマスクで処理し、
+//AVX2版のようにピッチの余白に書き込んだり、読み込んだりしない
+static RGY_FORCEINLINE __mmask64 mask_epi8(int n) {
+    return (n >= 64) ? ~0ULL : ((n <= 0) ? 0ULL : ((1ULL << n) - 1));
+}
+static RGY_FORCEINLINE __mmask32 mask_epi16(int n) {
+    return (n >= 32) ? ~0U : ((n <= 0) ? 0U : ((1U << n) - 1));
+}
+
+static void RGY_FORCEINLINE avx512_memcpy(uint8_t *dst, const uint8_t *src, int size) {
+    for (; size >= 256; size -= 256, dst += 256, src += 256) {
+        __m512i z0 = _mm512_loadu_si512((const __m512i *)(src +   0));
+        __m512i z1 = _mm512_loadu_si512((const __m512i *)(src +  64));
+        __m512i z2 = _mm512_loadu_si512((const __m512i *)(src + 128));
+        __m512i z3 = _mm512_loadu_si512((const __m512i *)(src + 192));
+        _mm512_storeu_si512((__m512i *)(dst +   0), z0);
+        _mm512_storeu_si512((__m512i *)(dst +  64), z1);
+        _mm512_storeu_si512((__m512i *)(dst + 128), z2);
+        _mm512_storeu_si512((__m512i *)(dst + 192), z3);
+    }
+    for (; size > 0; size -= 64, dst += 64, src += 64) {
+        const __mmask64 mask = mask_epi8(size);
+        _mm512_mask_storeu_epi8(dst, mask, _mm512_maskz_loadu_epi8(mask, src));
+    }
+}
+
+//packus_epi16などレーン内で処理される命令の結果を、64bit単位で並べなおす
+#define ZMM_PERM_PACK        _mm512_set_epi64(7, 5, 3, 1, 6, 4, 2, 0)
+//unpacklo/unpackhiの結果から、連続した前半/後半を取り出す
+#define ZMM_PERM_UNPACK_LO   _mm512_set_epi64(11, 10, 3, 2,  9,  8, 1, 0)
+#define ZMM_PERM_UNPACK_HI   _mm512_set_epi64(15, 14, 7, 6, 13, 12, 5, 4)
+
+alignas(64) static const uint8_t  Array_INTERLACE_WEIGHT_512[2][64] = {
+    {1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3,
+     1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3},
+    {3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1,
+     3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1, 3, 1}
+};
+#define zC_INTERLACE_WEIGHT(i) _mm512_load_si512((const __m512i *)Array_INTERLACE_WEIGHT_512[i])
+
+//YUY2の128byteをY(64byte)とUV(64byte)に分離する
+static RGY_FORCEINLINE void separate_low_up_avx512(__m512i& z0_return_lower, __m512i& z1_return_upper) {
+    const __m512i zMaskLowByte = _mm512_set1_epi16(0x00ff);
+    __m512i z4 = _mm512_srli_epi16(z0_return_lower, 8);
+    __m512i z5 = _mm512_srli_epi16(z1_return_upper, 8);
+
+    z0_return_lower = _mm512_and_si512(z0_return_lower, zMaskLowByte);
+    z1_return_upper = _mm512_and_si512(z1_return_upper, zMaskLowByte);
+
+    z0_return_lower = _mm512_permutexvar_epi64(ZMM_PERM_PACK, _mm512_packus_epi16(z0_return_lower, z1_return_upper));
+    z1_return_upper = _mm512_permutexvar_epi64(ZMM_PERM_PACK, _mm512_packus_epi16(z4, z5));
+}
+
+static RGY_FORCEINLINE void load_yuy2_avx512(__m512i& z0, __m512i& z1, const uint8_t *p, int remain_byte) {
+    z0 = _mm512_maskz_loadu_epi8(mask_epi8(remain_byte),      p +  0);
+    z1 = _mm512_maskz_loadu_epi8(mask_epi8(remain_byte - 64), p + 64);
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+void convert_yuy2_to_nv12_avx512bw(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const void *src = src_array[0];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst_array[0] + dst_y_pitch_byte * y_range.start_dst;
+    uint8_t *dstCLine = (uint8_t *)dst_array[1] + dst_y_pitch_byte * (y_range.start_dst >> 1);
+    for (int y = 0; y < y_range.len; y += 2) {
+        uint8_t *p = srcLine;
+        uint8_t *pw = p + src_y_pitch_byte;
+        const int x_fin = width - crop_right - crop_left;
+        __m512i z0, z1, z3;
+        for (int x = 0; x < x_fin; x += 64, p += 128, pw += 128) {
+            const __mmask64 mask = mask_epi8(x_fin - x);
+            //-----------1行目---------------
+            load_yuy2_avx512(z0, z1, p, (x_fin - x) * 2);
+            separate_low_up_avx512(z0, z1);
+            z3 = z1;
+            _mm512_mask_storeu_epi8(dstYLine + x, mask, z0);
+            //-----------1行目終了---------------
+
+            //-----------2行目---------------
+            load_yuy2_avx512(z0, z1, pw, (x_fin - x) * 2);
+            separate_low_up_avx512(z0, z1);
+            _mm512_mask_storeu_epi8(dstYLine + dst_y_pitch_byte + x, mask, z0);
+            //-----------2行目終了---------------
+
+            z1 = _mm512_avg_epu8(z1, z3);  //VUVUVUVUVUVUVUVU
+            _mm512_mask_storeu_epi8(dstCLine + x, mask, z1);
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+        dstCLine += dst_y_pitch_byte;
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+static RGY_FORCEINLINE __m512i yuv422_to_420_i_interpolate_avx512(__m512i z_up, __m512i z_down, int i) {
+    __m512i z0, z1;
+    z0 = _mm512_unpacklo_epi8(z_down, z_up);
+    z1 = _mm512_unpackhi_epi8(z_down, z_up);
+    z0 = _mm512_maddubs_epi16(z0, zC_INTERLACE_WEIGHT(i));
+    z1 = _mm512_maddubs_epi16(z1, zC_INTERLACE_WEIGHT(i));
+    z0 = _mm512_add_epi16(z0, _mm512_set1_epi16(2));
+    z1 = _mm512_add_epi16(z1, _mm512_set1_epi16(2));
+    z0 = _mm512_srai_epi16(z0, 2);
+    z1 = _mm512_srai_epi16(z1, 2);
+    z0 = _mm512_packus_epi16(z0, z1);
+    return z0;
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4127)
+#pragma warning (disable: 4100)
+void convert_yuy2_to_nv12_i_avx512bw(void **dst_array, const void **src_array, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const void *src = src_array[0];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    uint8_t *srcLine = (uint8_t *)src + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst_array[0] + dst_y_pitch_byte * y_range.start_dst;
+    uint8_t *dstCLine = (uint8_t *)dst_array[1] + dst_y_pitch_byte * (y_range.start_dst >> 1);
+    for (int y = 0; y < y_range.len; y += 4) {
+        for (int i = 0; i < 2; i++) {
+            uint8_t *p = srcLine;
+            uint8_t *pw = p + (src_y_pitch_byte<<1);
+            __m512i z0, z1, z3;
+            const int x_fin = width - crop_right - crop_left;
+            for (int x = 0; x < x_fin; x += 64, p += 128, pw += 128) {
+                const __mmask64 mask = mask_epi8(x_fin - x);
+                //-----------    1+i行目   ---------------
+                load_yuy2_avx512(z0, z1, p, (x_fin - x) * 2);
+                separate_low_up_avx512(z0, z1);
+                z3 = z1;
+                _mm512_mask_storeu_epi8(dstYLine + x, mask, z0);
+                //-----------1+i行目終了---------------
+
+                //-----------3+i行目---------------
+                load_yuy2_avx512(z0, z1, pw, (x_fin - x) * 2);
+                separate_low_up_avx512(z0, z1);
+                _mm512_mask_storeu_epi8(dstYLine + (dst_y_pitch_byte<<1) + x, mask, z0);
+                //-----------3+i行目終了---------------
+                z0 = yuv422_to_420_i_interpolate_avx512(z3, z1, i);
+
+                _mm512_mask_storeu_epi8(dstCLine + x, mask, z0);
+            }
+            srcLine  += src_y_pitch_byte;
+            dstYLine += dst_y_pitch_byte;
+            dstCLine += dst_y_pitch_byte;
+        }
+        srcLine  += src_y_pitch_byte << 1;
+        dstYLine += dst_y_pitch_byte << 1;
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+#pragma warning (push)
+#pragma warning (disable: 4127)
+#pragma warning (disable: 4100)
+template<bool uv_only>
+static void RGY_FORCEINLINE convert_yv12_to_nv12_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint8_t *dstLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            avx512_memcpy(dstLine, srcYLine, y_width);
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *dstLine = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    const int uv_width = (width - crop_right - crop_left + 1) >> 1;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        uint8_t *src_u_ptr = srcULine;
+        uint8_t *src_v_ptr = srcVLine;
+        uint8_t *dst_ptr = dstLine;
+        __m512i z0, z1, z2, z3;
+        for (int x = 0; x < uv_width; x += 64, src_u_ptr += 64, src_v_ptr += 64, dst_ptr += 128) {
+            const int remain = (uv_width - x) * 2;
+            const __mmask64 mask = mask_epi8(uv_width - x);
+            z0 = _mm512_maskz_loadu_epi8(mask, src_u_ptr);
+            z1 = _mm512_maskz_loadu_epi8(mask, src_v_ptr);
+
+            z2 = _mm512_unpacklo_epi8(z0, z1);
+            z3 = _mm512_unpackhi_epi8(z0, z1);
+
+            z0 = _mm512_permutex2var_epi64(z2, ZMM_PERM_UNPACK_LO, z3);
+            z1 = _mm512_permutex2var_epi64(z2, ZMM_PERM_UNPACK_HI, z3);
+
+            _mm512_mask_storeu_epi8(dst_ptr +  0, mask_epi8(remain),      z0);
+            _mm512_mask_storeu_epi8(dst_ptr + 64, mask_epi8(remain - 64), z1);
+        }
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yv12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_avx512bw_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_uv_yv12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_nv12_avx512bw_base<true>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+//8bit -> 10bit(P010, 上位詰め) の変換
+static RGY_FORCEINLINE __m512i cvt_8_to_p010_avx512(__m256i y0) {
+    __m512i z0 = _mm512_cvtepu8_epi16(y0);
+    z0 = _mm512_slli_epi16(z0, 8);
+    return _mm512_add_epi16(z0, _mm512_set1_epi16(2 << 6));
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4127)
+#pragma warning (disable: 4100)
+template<bool uv_only>
+static void convert_yv12_to_p010_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+        uint8_t *dstLine  = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstLine += dst_y_pitch_byte) {
+            uint16_t *dst_ptr = (uint16_t *)dstLine;
+            uint8_t *src_ptr = srcYLine;
+            for (int x = 0; x < y_width; x += 64, dst_ptr += 64, src_ptr += 64) {
+                const __m512i z = _mm512_maskz_loadu_epi8(mask_epi8(y_width - x), src_ptr);
+                const __m512i z0 = cvt_8_to_p010_avx512(_mm512_castsi512_si256(z));
+                const __m512i z1 = cvt_8_to_p010_avx512(_mm512_extracti64x4_epi64(z, 1));
+                _mm512_mask_storeu_epi16(dst_ptr +  0, mask_epi16(y_width - x),      z0);
+                _mm512_mask_storeu_epi16(dst_ptr + 32, mask_epi16(y_width - x - 32), z1);
+            }
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    uint8_t *srcULine = (uint8_t *)src[1] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *srcVLine = (uint8_t *)src[2] + ((src_uv_pitch_byte * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *dstLine  = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    const int uv_width = (width - crop_right - crop_left + 1) >> 1;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch_byte, srcVLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+        uint8_t *src_u_ptr = srcULine;
+        uint8_t *src_v_ptr = srcVLine;
+        uint16_t *dst_ptr = (uint16_t *)dstLine;
+        __m512i z0, z1, z2, z3;
+        for (int x = 0; x < uv_width; x += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 64) {
+            const int remain = (uv_width - x) * 2;
+            const __mmask32 mask = mask_epi16(uv_width - x);
+            z0 = cvt_8_to_p010_avx512(_mm256_maskz_loadu_epi8(mask, src_u_ptr));
+            z1 = cvt_8_to_p010_avx512(_mm256_maskz_loadu_epi8(mask, src_v_ptr));
+
+            z2 = _mm512_unpacklo_epi16(z0, z1);
+            z3 = _mm512_unpackhi_epi16(z0, z1);
+
+            z0 = _mm512_permutex2var_epi64(z2, ZMM_PERM_UNPACK_LO, z3);
+            z1 = _mm512_permutex2var_epi64(z2, ZMM_PERM_UNPACK_HI, z3);
+
+            _mm512_mask_storeu_epi16(dst_ptr +  0, mask_epi16(remain),      z0);
+            _mm512_mask_storeu_epi16(dst_ptr + 32, mask_epi16(remain - 32), z1);
+        }
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yv12_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_to_p010_avx512bw_base<false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4127)
+#pragma warning (disable: 4100)
+template<int in_bit_depth, bool uv_only>
+static void convert_yv12_high_to_nv12_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+        uint8_t *dstLine  = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch_byte) {
+            uint8_t *dst_ptr = dstLine;
+            uint16_t *src_ptr = srcYLine;
+            for (int x = 0; x < y_width; x += 64, dst_ptr += 64, src_ptr += 64) {
+                const __mmask32 mask0 = mask_epi16(y_width - x);
+                const __mmask32 mask1 = mask_epi16(y_width - x - 32);
+                __m512i z0 = _mm512_maskz_loadu_epi16(mask0, src_ptr +  0);
+                __m512i z1 = _mm512_maskz_loadu_epi16(mask1, src_ptr + 32);
+
+                z0 = _mm512_srli_epi16(z0, in_bit_depth - 8);
+                z1 = _mm512_srli_epi16(z1, in_bit_depth - 8);
+
+                //シフト後は8bitに収まるので、vpmovwbで切り詰めるだけでよい
+                _mm256_mask_storeu_epi8(dst_ptr +  0, mask0, _mm512_cvtepi16_epi8(z0));
+                _mm256_mask_storeu_epi8(dst_ptr + 32, mask1, _mm512_cvtepi16_epi8(z1));
+            }
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint8_t *dstLine  = (uint8_t *)dst[1] + dst_y_pitch_byte * uv_range.start_dst;
+    const int uv_width = (width - crop_right - crop_left + 1) >> 1;
+    const __m512i zMaskHighByte = _mm512_set1_epi16((short)0xff00);
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch_byte) {
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint16_t *dst_ptr = (uint16_t *)dstLine;
+        __m512i z0, z1;
+        for (int x = 0; x < uv_width; x += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 32) {
+            const __mmask32 mask = mask_epi16(uv_width - x);
+            z0 = _mm512_maskz_loadu_epi16(mask, src_u_ptr);
+            z1 = _mm512_maskz_loadu_epi16(mask, src_v_ptr);
+
+            z0 = _mm512_srli_epi16(z0, in_bit_depth - 8);
+            z1 = _mm512_slli_epi16(z1, 16 - in_bit_depth);
+            z1 = _mm512_and_si512(z1, zMaskHighByte);
+
+            z0 = _mm512_or_si512(z0, z1);
+
+            _mm512_mask_storeu_epi16(dst_ptr, mask, z0);
+        }
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yv12_16_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<14, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<12, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<10, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_to_nv12_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_nv12_avx512bw_base<9, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+#pragma warning (push)
+#pragma warning (disable: 4100)
+#pragma warning (disable: 4127)
+template<int in_bit_depth, bool uv_only>
+static void RGY_FORCEINLINE convert_yv12_high_to_p010_avx512bw_base(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert(8 < in_bit_depth && in_bit_depth <= 16, "in_bit_depth must be 9-16.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte >> 1;
+    const int dst_y_pitch = dst_y_pitch_byte >> 1;
+    //Y成分のコピー
+    if (!uv_only) {
+        const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+        uint16_t *srcYLine = (uint16_t *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+        uint16_t *dstLine = (uint16_t *)dst[0] + dst_y_pitch * y_range.start_dst;
+        const int y_width = width - crop_right - crop_left;
+        for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstLine += dst_y_pitch) {
+            if (in_bit_depth == 16) {
+                avx512_memcpy((uint8_t *)dstLine, (uint8_t *)srcYLine, y_width * (int)sizeof(uint16_t));
+            } else {
+                uint16_t *src_ptr = srcYLine;
+                uint16_t *dst_ptr = dstLine;
+                for (int x = 0; x < y_width; x += 32, dst_ptr += 32, src_ptr += 32) {
+                    const __mmask32 mask = mask_epi16(y_width - x);
+                    __m512i z0 = _mm512_maskz_loadu_epi16(mask, src_ptr);
+                    z0 = _mm512_slli_epi16(z0, 16 - in_bit_depth);
+                    _mm512_mask_storeu_epi16(dst_ptr, mask, z0);
+                }
+            }
+        }
+    }
+    //UV成分のコピー
+    const auto uv_range = thread_y_range(crop_up >> 1, (height - crop_bottom) >> 1, thread_id, thread_n);
+    const int src_uv_pitch = src_uv_pitch_byte >> 1;
+    uint16_t *srcULine = (uint16_t *)src[1] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *srcVLine = (uint16_t *)src[2] + ((src_uv_pitch * uv_range.start_src) + (crop_left >> 1));
+    uint16_t *dstLine = (uint16_t *)dst[1] + dst_y_pitch * uv_range.start_dst;
+    const int uv_width = (width - crop_right - crop_left + 1) >> 1;
+    for (int y = 0; y < uv_range.len; y++, srcULine += src_uv_pitch, srcVLine += src_uv_pitch, dstLine += dst_y_pitch) {
+        uint16_t *src_u_ptr = srcULine;
+        uint16_t *src_v_ptr = srcVLine;
+        uint16_t *dst_ptr = dstLine;
+        __m512i z0, z1, z2, z3;
+        for (int x = 0; x < uv_width; x += 32, src_u_ptr += 32, src_v_ptr += 32, dst_ptr += 64) {
+            const int remain = (uv_width - x) * 2;
+            const __mmask32 mask = mask_epi16(uv_width - x);
+            z0 = _mm512_maskz_loadu_epi16(mask, src_u_ptr);
+            z1 = _mm512_maskz_loadu_epi16(mask, src_v_ptr);
+
+            if (in_bit_depth < 16) {
+                z0 = _mm512_slli_epi16(z0, 16 - in_bit_depth);
+                z1 = _mm512_slli_epi16(z1, 16 - in_bit_depth);
+            }
+
+            z2 = _mm512_unpacklo_epi16(z0, z1);
+            z3 = _mm512_unpackhi_epi16(z0, z1);
+
+            z0 = _mm512_permutex2var_epi64(z2, ZMM_PERM_UNPACK_LO, z3);
+            z1 = _mm512_permutex2var_epi64(z2, ZMM_PERM_UNPACK_HI, z3);
+
+            _mm512_mask_storeu_epi16(dst_ptr +  0, mask_epi16(remain),      z0);
+            _mm512_mask_storeu_epi16(dst_ptr + 32, mask_epi16(remain - 32), z1);
+        }
+    }
+    _mm256_zeroupper();
+}
+#pragma warning (pop)
+
+void convert_yv12_16_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<16, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_14_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<14, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_12_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<12, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_10_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<10, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+void convert_yv12_09_to_p010_avx512bw(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    convert_yv12_high_to_p010_avx512bw_base<9, false>(dst, src, width, src_y_pitch_byte, src_uv_pitch_byte, dst_y_pitch_byte, height, dst_height, thread_id, thread_n, crop);
+}
+
+#endif //#if defined(_MSC_VER) || (defined(__AVX512BW__) && defined(__AVX512VL__))
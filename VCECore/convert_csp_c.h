@@ -0,0 +1,121 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+#pragma once
+#ifndef _CONVERT_CSP_C_H_
+#define _CONVERT_CSP_C_H_
+
+#include <cstdint>
+#include <algorithm>
+#include "convert_csp.h"
+
+//convert_csp.cpp のC版と、SIMD版の端数処理で共通に使用する1行分の変換処理
+//SIMD版はこれらとbit単位で一致する結果を返す必要がある
+
+//in_bit_depth + offset bit の値を out_bit_depth bit に変換する
+template<int in_bit_depth, int out_bit_depth, int offset>
+static RGY_FORCEINLINE int conv_bit_depth_c(int c) {
+    if (out_bit_depth > in_bit_depth + offset) {
+        return c << std::max(out_bit_depth - in_bit_depth - offset, 0);
+    } else if (out_bit_depth < in_bit_depth + offset) {
+        return c >> std::max(in_bit_depth + offset - out_bit_depth, 0);
+    }
+    return c;
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void convert_bit_depth_line_c(Tout *dst, const Tin *src, int x_start, int x_fin) {
+    for (int x = x_start; x < x_fin; x++) {
+        dst[x] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 0>((int)src[x]);
+    }
+}
+
+//yuv444 -> nv12 (progressive) の色差1行分 (入力2行から出力1行)
+//x_start, x_fin は輝度の画素単位 (x_startは偶数)
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void convert_yuv444_to_nv12_p_uv_line_c(Tout *dstC, const Tin *srcU, const Tin *srcV, int src_uv_pitch, int x_start, int x_fin) {
+    for (int x = x_start; x < x_fin; x += 2) {
+        int cu = srcU[0*src_uv_pitch + x] + srcU[1*src_uv_pitch + x] + 1;
+        int cv = srcV[0*src_uv_pitch + x] + srcV[1*src_uv_pitch + x] + 1;
+        dstC[x + 0] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 1>(cu);
+        dstC[x + 1] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 1>(cv);
+    }
+}
+
+//yuv444 -> nv12 (interlaced) の色差2行分 (入力4行から出力2行)
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void convert_yuv444_to_nv12_i_uv_line_c(Tout *dstC, int dst_y_pitch, const Tin *srcU, const Tin *srcV, int src_uv_pitch, int x_start, int x_fin) {
+    for (int x = x_start; x < x_fin; x += 2) {
+        int cu_y0 = srcU[0*src_uv_pitch + x] * 3 + srcU[2*src_uv_pitch + x] * 1 + 2;
+        int cu_y1 = srcU[1*src_uv_pitch + x] * 1 + srcU[3*src_uv_pitch + x] * 3 + 2;
+        int cv_y0 = srcV[0*src_uv_pitch + x] * 3 + srcV[2*src_uv_pitch + x] * 1 + 2;
+        int cv_y1 = srcV[1*src_uv_pitch + x] * 1 + srcV[3*src_uv_pitch + x] * 3 + 2;
+        dstC[0*dst_y_pitch + x + 0] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cu_y0);
+        dstC[0*dst_y_pitch + x + 1] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cv_y0);
+        dstC[1*dst_y_pitch + x + 0] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cu_y1);
+        dstC[1*dst_y_pitch + x + 1] = (Tout)conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cv_y1);
+    }
+}
+
+//yv12 -> yuv444 (progressive) の色差2行分 (入力1行から出力2行)
+//y_m, y_p は上下の参照行の相対位置 (画面端では0)
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void convert_yv12_p_to_yuv444_uv_line_c(Tout *dstC, int dst_y_pitch, const Tin *srcP, int src_uv_pitch, int y_m, int y_p, int x_start, int x_fin) {
+    for (int x = x_start; x < x_fin; x += 2) {
+        const int ix = x >> 1;
+        const int cxplus = (x + 2 < x_fin);
+        int cy0x0 = srcP[y_m*src_uv_pitch + ix];
+        int cy2x0 = srcP[  0*src_uv_pitch + ix];
+        int cy4x0 = srcP[y_p*src_uv_pitch + ix];
+        int cy0x1 = srcP[y_m*src_uv_pitch + ix + cxplus];
+        int cy2x1 = srcP[  0*src_uv_pitch + ix + cxplus];
+        int cy4x1 = srcP[y_p*src_uv_pitch + ix + cxplus];
+
+        int cy1x0 = conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cy0x0 * 1 + cy2x0 * 3 + 2);
+        int cy3x0 = conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cy2x0 * 3 + cy4x0 * 1 + 2);
+        int cy1x1 = conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cy0x1 * 1 + cy2x1 * 3 + 2);
+        int cy3x1 = conv_bit_depth_c<in_bit_depth, out_bit_depth, 2>(cy2x1 * 3 + cy4x1 * 1 + 2);
+
+        dstC[0*dst_y_pitch + x + 0] = (Tout)cy1x0;
+        dstC[0*dst_y_pitch + x + 1] = (Tout)((cy1x0 + cy1x1 + 1) >> 1);
+        dstC[1*dst_y_pitch + x + 0] = (Tout)cy3x0;
+        dstC[1*dst_y_pitch + x + 1] = (Tout)((cy3x0 + cy3x1 + 1) >> 1);
+    }
+}
+
+//yuv422 -> yuv444 の色差1行分
+static RGY_FORCEINLINE void convert_yuv422_to_yuv444_uv_line_c(uint8_t *dstC, const uint8_t *srcP, int x_start, int x_fin) {
+    for (int x = x_start; x < x_fin; x += 2) {
+        const int ix = x >> 1;
+        const int cxplus = (x + 2 < x_fin);
+        int cy1x0 = srcP[ix + 0];
+        int cy1x1 = srcP[ix + cxplus];
+        dstC[x + 0] = (uint8_t)cy1x0;
+        dstC[x + 1] = (uint8_t)((cy1x0 + cy1x1 + 1) >> 1);
+    }
+}
+
+#endif //_CONVERT_CSP_C_H_
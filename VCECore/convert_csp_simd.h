@@ -38,6 +38,7 @@
 #include <smmintrin.h> //イントリンシック命令 SSE4.1
 #endif
 #include "convert_csp.h"
+#include "convert_csp_c.h"
 #include "convert_const.h"
 #include <utility>
 
@@ -1305,6 +1306,253 @@ static void RGY_FORCEINLINE convert_yuv444_high_to_yuv444_simd(void **dst, const
     }
 }
 
+#if USE_SSE41
+//Tin x8 を読み込み、16bit x8 に拡張する
+template<typename Tin>
+static RGY_FORCEINLINE __m128i load_cvt_epi16_simd(const Tin *ptr) {
+    if (sizeof(Tin) == 1) {
+        return _mm_cvtepu8_epi16(_mm_loadl_epi64((const __m128i *)ptr));
+    }
+    return _mm_loadu_si128((const __m128i *)ptr);
+}
+
+//Tin x4 を読み込み、32bit x4 に拡張する
+template<typename Tin>
+static RGY_FORCEINLINE __m128i load_cvt_epi32_simd(const Tin *ptr) {
+    if (sizeof(Tin) == 1) {
+        return _mm_cvtepu8_epi32(_mm_cvtsi32_si128(*(const int *)ptr));
+    }
+    return _mm_cvtepu16_epi32(_mm_loadl_epi64((const __m128i *)ptr));
+}
+
+//conv_bit_depth_c の32bit x4版
+template<int in_bit_depth, int out_bit_depth, int offset>
+static RGY_FORCEINLINE __m128i conv_bit_depth_epi32_simd(__m128i x0) {
+    if (out_bit_depth > in_bit_depth + offset) {
+        return _mm_slli_epi32(x0, std::max(out_bit_depth - in_bit_depth - offset, 0));
+    } else if (out_bit_depth < in_bit_depth + offset) {
+        return _mm_srli_epi32(x0, std::max(in_bit_depth + offset - out_bit_depth, 0));
+    }
+    return x0;
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void convert_bit_depth_line_simd(Tout *dst, const Tin *src, int width) {
+    if (in_bit_depth == out_bit_depth && sizeof(Tin) == sizeof(Tout)) {
+        memcpy_sse((uint8_t *)dst, (const uint8_t *)src, width * (int)sizeof(Tin));
+        return;
+    }
+    int x = 0;
+    for (; x <= width - 16; x += 16) {
+        __m128i x0 = load_cvt_epi16_simd(src + x + 0);
+        __m128i x1 = load_cvt_epi16_simd(src + x + 8);
+        if (out_bit_depth > in_bit_depth) {
+            x0 = _mm_slli_epi16(x0, std::max(out_bit_depth - in_bit_depth, 0));
+            x1 = _mm_slli_epi16(x1, std::max(out_bit_depth - in_bit_depth, 0));
+        } else if (out_bit_depth < in_bit_depth) {
+            x0 = _mm_srli_epi16(x0, std::max(in_bit_depth - out_bit_depth, 0));
+            x1 = _mm_srli_epi16(x1, std::max(in_bit_depth - out_bit_depth, 0));
+        }
+        if (sizeof(Tout) == 1) {
+            _mm_storeu_si128((__m128i *)(dst + x), _mm_packus_epi16(x0, x1));
+        } else {
+            _mm_storeu_si128((__m128i *)(dst + x + 0), x0);
+            _mm_storeu_si128((__m128i *)(dst + x + 8), x1);
+        }
+    }
+    convert_bit_depth_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dst, src, x, width);
+}
+
+//yuv444の偶数列の色差を32bit x4に取り出す
+template<typename Tin>
+static RGY_FORCEINLINE __m128i load_even_epi32_simd(const Tin *ptr) {
+    return _mm_and_si128(load_cvt_epi16_simd(ptr), _mm_set1_epi32(0x0000ffff));
+}
+
+//U, Vを32bit単位で U | (V << 出力のbit数) の形にまとめる
+//8bit出力ならpackus_epi32で、16bit出力ならそのまま、UVが交互に並んだ形になる
+template<typename Tout>
+static RGY_FORCEINLINE __m128i merge_uv_epi32_simd(__m128i xU, __m128i xV) {
+    return _mm_or_si128(xU, _mm_slli_epi32(xV, sizeof(Tout) * 8));
+}
+
+template<typename Tout>
+static RGY_FORCEINLINE void store_uv_epi32_simd(Tout *dst, __m128i x0, __m128i x1) {
+    if (sizeof(Tout) == 1) {
+        _mm_storeu_si128((__m128i *)dst, _mm_packus_epi32(x0, x1));
+    } else {
+        _mm_storeu_si128((__m128i *)(dst + 0), x0);
+        _mm_storeu_si128((__m128i *)(dst + 8), x1);
+    }
+}
+
+//8画素分の色差を縦2行の平均で4組のUVにする
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE __m128i yuv444_to_nv12_p_uv_simd(const Tin *srcU, const Tin *srcV, int src_uv_pitch) {
+    const __m128i xOne = _mm_set1_epi32(1);
+    __m128i xU = _mm_add_epi32(load_even_epi32_simd(srcU), load_even_epi32_simd(srcU + src_uv_pitch));
+    __m128i xV = _mm_add_epi32(load_even_epi32_simd(srcV), load_even_epi32_simd(srcV + src_uv_pitch));
+    xU = conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 1>(_mm_add_epi32(xU, xOne));
+    xV = conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 1>(_mm_add_epi32(xV, xOne));
+    return merge_uv_epi32_simd<Tout>(xU, xV);
+}
+
+//3:1で重みづけした縦方向の補間 (r0 * 3 + r1 + 2)
+static RGY_FORCEINLINE __m128i interpolate_31_epi32_simd(__m128i r0, __m128i r1) {
+    return _mm_add_epi32(_mm_add_epi32(r0, _mm_slli_epi32(r0, 1)), _mm_add_epi32(r1, _mm_set1_epi32(2)));
+}
+
+//8画素分の色差を縦4行から補間し、2行分の4組のUVにする
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static RGY_FORCEINLINE void yuv444_to_nv12_i_uv_simd(__m128i& xY0, __m128i& xY1, const Tin *srcU, const Tin *srcV, int src_uv_pitch) {
+    __m128i xU0 = interpolate_31_epi32_simd(load_even_epi32_simd(srcU + 0*src_uv_pitch), load_even_epi32_simd(srcU + 2*src_uv_pitch));
+    __m128i xU1 = interpolate_31_epi32_simd(load_even_epi32_simd(srcU + 3*src_uv_pitch), load_even_epi32_simd(srcU + 1*src_uv_pitch));
+    __m128i xV0 = interpolate_31_epi32_simd(load_even_epi32_simd(srcV + 0*src_uv_pitch), load_even_epi32_simd(srcV + 2*src_uv_pitch));
+    __m128i xV1 = interpolate_31_epi32_simd(load_even_epi32_simd(srcV + 3*src_uv_pitch), load_even_epi32_simd(srcV + 1*src_uv_pitch));
+    xY0 = merge_uv_epi32_simd<Tout>(conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 2>(xU0), conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 2>(xV0));
+    xY1 = merge_uv_epi32_simd<Tout>(conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 2>(xU1), conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 2>(xV1));
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth, bool interlaced>
+static void RGY_FORCEINLINE convert_yuv444_to_nv12_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert((sizeof(Tin)  == 1 && in_bit_depth  == 8) || (sizeof(Tin)  == 2 && 8 < in_bit_depth  && in_bit_depth  <= 16), "invalid input bit depth.");
+    static_assert((sizeof(Tout) == 1 && out_bit_depth == 8) || (sizeof(Tout) == 2 && 8 < out_bit_depth && out_bit_depth <= 16), "invalid output bit depth.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte / sizeof(Tin);
+    const int dst_y_pitch = dst_y_pitch_byte / sizeof(Tout);
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const int x_fin = width - crop_right - crop_left;
+    //Y成分のコピー
+    Tin *srcYLine = (Tin *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    Tout *dstYLine = (Tout *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstYLine += dst_y_pitch) {
+        convert_bit_depth_line_simd<Tin, in_bit_depth, Tout, out_bit_depth>(dstYLine, srcYLine, x_fin);
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte / sizeof(Tin);
+    Tin *srcULine = (Tin *)src[1] + ((src_uv_pitch * y_range.start_src) + crop_left);
+    Tin *srcVLine = (Tin *)src[2] + ((src_uv_pitch * y_range.start_src) + crop_left);
+    Tout *dstLine = (Tout *)dst[1] + (dst_y_pitch >> 1) * y_range.start_dst;
+    if (interlaced) {
+        for (int y = 0; y < y_range.len; y += 4, srcULine += src_uv_pitch * 4, srcVLine += src_uv_pitch * 4, dstLine += dst_y_pitch * 2) {
+            int x = 0;
+            for (; x <= x_fin - 16; x += 16) {
+                __m128i x0, x1, x2, x3;
+                yuv444_to_nv12_i_uv_simd<Tin, in_bit_depth, Tout, out_bit_depth>(x0, x1, srcULine + x + 0, srcVLine + x + 0, src_uv_pitch);
+                yuv444_to_nv12_i_uv_simd<Tin, in_bit_depth, Tout, out_bit_depth>(x2, x3, srcULine + x + 8, srcVLine + x + 8, src_uv_pitch);
+                store_uv_epi32_simd(dstLine + x, x0, x2);
+                store_uv_epi32_simd(dstLine + dst_y_pitch + x, x1, x3);
+            }
+            convert_yuv444_to_nv12_i_uv_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dstLine, dst_y_pitch, srcULine, srcVLine, src_uv_pitch, x, x_fin);
+        }
+    } else {
+        for (int y = 0; y < y_range.len; y += 2, srcULine += src_uv_pitch * 2, srcVLine += src_uv_pitch * 2, dstLine += dst_y_pitch) {
+            int x = 0;
+            for (; x <= x_fin - 16; x += 16) {
+                __m128i x0 = yuv444_to_nv12_p_uv_simd<Tin, in_bit_depth, Tout, out_bit_depth>(srcULine + x + 0, srcVLine + x + 0, src_uv_pitch);
+                __m128i x1 = yuv444_to_nv12_p_uv_simd<Tin, in_bit_depth, Tout, out_bit_depth>(srcULine + x + 8, srcVLine + x + 8, src_uv_pitch);
+                store_uv_epi32_simd(dstLine + x, x0, x1);
+            }
+            convert_yuv444_to_nv12_p_uv_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dstLine, srcULine, srcVLine, src_uv_pitch, x, x_fin);
+        }
+    }
+}
+
+//yv12の色差4画素分を縦方向に補間し、上の行(1:3)と下の行(3:1)を作る
+template<typename Tin, int in_bit_depth, int out_bit_depth>
+static RGY_FORCEINLINE void yv12_p_to_yuv444_v_simd(__m128i& xY1, __m128i& xY3, const Tin *srcP, int src_uv_pitch, int y_m, int y_p) {
+    const __m128i x0 = load_cvt_epi32_simd(srcP + y_m * src_uv_pitch);
+    const __m128i x2 = load_cvt_epi32_simd(srcP);
+    const __m128i x4 = load_cvt_epi32_simd(srcP + y_p * src_uv_pitch);
+    xY1 = conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 2>(interpolate_31_epi32_simd(x2, x0));
+    xY3 = conv_bit_depth_epi32_simd<in_bit_depth, out_bit_depth, 2>(interpolate_31_epi32_simd(x2, x4));
+}
+
+//補間済みの色差 a(ix), b(ix+1) から、横方向に2画素 a, (a+b+1)>>1 を作る
+template<typename Tout>
+static RGY_FORCEINLINE __m128i yv12_p_to_yuv444_h_simd(__m128i a, __m128i b) {
+    __m128i x1 = _mm_srli_epi32(_mm_add_epi32(_mm_add_epi32(a, b), _mm_set1_epi32(1)), 1);
+    return _mm_or_si128(a, _mm_slli_epi32(x1, sizeof(Tout) * 8));
+}
+
+template<typename Tin, int in_bit_depth, typename Tout, int out_bit_depth>
+static void RGY_FORCEINLINE convert_yv12_p_to_yuv444_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    static_assert((sizeof(Tin)  == 1 && in_bit_depth  == 8) || (sizeof(Tin)  == 2 && 8 < in_bit_depth  && in_bit_depth  <= 16), "invalid input bit depth.");
+    static_assert((sizeof(Tout) == 1 && out_bit_depth == 8) || (sizeof(Tout) == 2 && 8 < out_bit_depth && out_bit_depth <= 16), "invalid output bit depth.");
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const int src_y_pitch = src_y_pitch_byte / sizeof(Tin);
+    const int dst_y_pitch = dst_y_pitch_byte / sizeof(Tout);
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const int x_fin = width - crop_right - crop_left;
+    //Y成分のコピー
+    Tin *srcYLine = (Tin *)src[0] + src_y_pitch * y_range.start_src + crop_left;
+    Tout *dstYLine = (Tout *)dst[0] + dst_y_pitch * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch, dstYLine += dst_y_pitch) {
+        convert_bit_depth_line_simd<Tin, in_bit_depth, Tout, out_bit_depth>(dstYLine, srcYLine, x_fin);
+    }
+    //UV成分のコピー
+    const int src_uv_pitch = src_uv_pitch_byte / sizeof(Tin);
+    for (int ic = 1; ic < 3; ic++) {
+        Tin *srcCLine = (Tin *)src[ic] + (((src_uv_pitch * y_range.start_src) + crop_left) >> 1);
+        Tout *dstLine = (Tout *)dst[ic] + dst_y_pitch * y_range.start_dst;
+        for (int y = 0; y < y_range.len; y += 2, srcCLine += src_uv_pitch, dstLine += dst_y_pitch * 2) {
+            const int y_m = (y == 0) ? 0 : -1;
+            const int y_p = (y != 0 && y_range.start_dst + y >= height-2) ? 0 : 1;
+            int x = 0;
+            //ブロック内の最後の画素まで右隣の色差を参照できる範囲をSIMDで処理する
+            for (; x + 16 < x_fin; x += 16) {
+                const Tin *srcP = srcCLine + (x >> 1);
+                __m128i xA1_0, xA3_0, xA1_1, xA3_1, xB1_0, xB3_0, xB1_1, xB3_1;
+                yv12_p_to_yuv444_v_simd<Tin, in_bit_depth, out_bit_depth>(xA1_0, xA3_0, srcP + 0, src_uv_pitch, y_m, y_p);
+                yv12_p_to_yuv444_v_simd<Tin, in_bit_depth, out_bit_depth>(xA1_1, xA3_1, srcP + 4, src_uv_pitch, y_m, y_p);
+                yv12_p_to_yuv444_v_simd<Tin, in_bit_depth, out_bit_depth>(xB1_0, xB3_0, srcP + 1, src_uv_pitch, y_m, y_p);
+                yv12_p_to_yuv444_v_simd<Tin, in_bit_depth, out_bit_depth>(xB1_1, xB3_1, srcP + 5, src_uv_pitch, y_m, y_p);
+                store_uv_epi32_simd(dstLine + x,               yv12_p_to_yuv444_h_simd<Tout>(xA1_0, xB1_0), yv12_p_to_yuv444_h_simd<Tout>(xA1_1, xB1_1));
+                store_uv_epi32_simd(dstLine + dst_y_pitch + x, yv12_p_to_yuv444_h_simd<Tout>(xA3_0, xB3_0), yv12_p_to_yuv444_h_simd<Tout>(xA3_1, xB3_1));
+            }
+            convert_yv12_p_to_yuv444_uv_line_c<Tin, in_bit_depth, Tout, out_bit_depth>(dstLine, dst_y_pitch, srcCLine, src_uv_pitch, y_m, y_p, x, x_fin);
+        }
+    }
+}
+
+static void RGY_FORCEINLINE convert_yuv422_to_yuv444_simd(void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int thread_id, int thread_n, int *crop) {
+    const int crop_left   = crop[0];
+    const int crop_up     = crop[1];
+    const int crop_right  = crop[2];
+    const int crop_bottom = crop[3];
+    const auto y_range = thread_y_range(crop_up, height - crop_bottom, thread_id, thread_n);
+    const int x_fin = width - crop_right - crop_left;
+    //Y成分のコピー
+    uint8_t *srcYLine = (uint8_t *)src[0] + src_y_pitch_byte * y_range.start_src + crop_left;
+    uint8_t *dstYLine = (uint8_t *)dst[0] + dst_y_pitch_byte * y_range.start_dst;
+    for (int y = 0; y < y_range.len; y++, srcYLine += src_y_pitch_byte, dstYLine += dst_y_pitch_byte) {
+        memcpy_sse(dstYLine, srcYLine, x_fin);
+    }
+    //UV成分のコピー
+    for (int ic = 1; ic < 3; ic++) {
+        uint8_t *srcCLine = (uint8_t *)src[ic] + src_uv_pitch_byte * y_range.start_src + (crop_left >> 1);
+        uint8_t *dstLine = (uint8_t *)dst[ic] + dst_y_pitch_byte * y_range.start_dst;
+        for (int y = 0; y < y_range.len; y++, srcCLine += src_uv_pitch_byte, dstLine += dst_y_pitch_byte) {
+            int x = 0;
+            for (; x + 32 < x_fin; x += 32) {
+                __m128i x0 = _mm_loadu_si128((const __m128i *)(srcCLine + (x >> 1) + 0));
+                __m128i x1 = _mm_loadu_si128((const __m128i *)(srcCLine + (x >> 1) + 1));
+                x1 = _mm_avg_epu8(x0, x1);
+                _mm_storeu_si128((__m128i *)(dstLine + x +  0), _mm_unpacklo_epi8(x0, x1));
+                _mm_storeu_si128((__m128i *)(dstLine + x + 16), _mm_unpackhi_epi8(x0, x1));
+            }
+            convert_yuv422_to_yuv444_uv_line_c(dstLine, srcCLine, x, x_fin);
+        }
+    }
+}
+#endif //#if USE_SSE41
+
 typedef    struct {
     short    y;                    //    画素(輝度    )データ (     0 ～ 4096 )
     short    cb;                    //    画素(色差(青))データ ( -2048 ～ 2048 )
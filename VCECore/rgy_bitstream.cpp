@@ -26,25 +26,119 @@
 // --------------------------------------------------------------------------------------------
 
 #include <regex>
+#include <emmintrin.h>
 #include "rgy_util.h"
+#include "rgy_simd.h"
 #include "rgy_bitstream.h"
 #include "rgy_util.h"
 
-std::vector<uint8_t> unnal(const uint8_t *ptr, size_t len) {
-    std::vector<uint8_t> data;
-    data.reserve(len);
-    data.push_back(ptr[0]);
-    data.push_back(ptr[1]);
-    for (size_t i = 2; i < len; i++) {
-        if (ptr[i-2] == 0x00 && ptr[i-1] == 0x00 && ptr[i] == 0x03) {
-            //skip
-        } else {
-            data.push_back(ptr[i]);
+size_t find_nal_pattern_avx2(const uint8_t *data, size_t start, size_t fin, uint8_t third);
+
+static RGY_FORCEINLINE int ctz32(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+static size_t find_nal_pattern_c(const uint8_t *data, size_t start, size_t fin, uint8_t third) {
+    for (size_t i = start; i < fin; i++) {
+        if (data[i+0] == 0 && data[i+1] == 0 && data[i+2] == third) {
+            return i;
         }
     }
+    return fin;
+}
+
+//SSE2は常に使用可能なので、AVX2が使えない場合はこちらを使用する
+static size_t find_nal_pattern_sse2(const uint8_t *data, size_t start, size_t fin, uint8_t third) {
+    const __m128i xZero = _mm_setzero_si128();
+    const __m128i xThird = _mm_set1_epi8((char)third);
+    size_t i = start;
+    for (; i + 16 <= fin; i += 16) {
+        const __m128i x0 = _mm_loadu_si128((const __m128i *)(data + i + 0));
+        const __m128i x1 = _mm_loadu_si128((const __m128i *)(data + i + 1));
+        const __m128i x2 = _mm_loadu_si128((const __m128i *)(data + i + 2));
+        const __m128i xMatch = _mm_and_si128(_mm_and_si128(_mm_cmpeq_epi8(x0, xZero), _mm_cmpeq_epi8(x1, xZero)), _mm_cmpeq_epi8(x2, xThird));
+        const uint32_t mask = (uint32_t)_mm_movemask_epi8(xMatch);
+        if (mask) {
+            return i + ctz32(mask);
+        }
+    }
+    return find_nal_pattern_c(data, i, fin, third);
+}
+
+typedef size_t (*funcFindNalPattern)(const uint8_t *data, size_t start, size_t fin, uint8_t third);
+
+static funcFindNalPattern get_find_nal_pattern_func() {
+#if defined(_MSC_VER) || defined(__AVX2__)
+    if ((get_availableSIMD() & AVX2) == AVX2) {
+        return find_nal_pattern_avx2;
+    }
+#endif
+    return find_nal_pattern_sse2;
+}
+
+size_t find_nal_pattern(const uint8_t *data, size_t start, size_t fin, uint8_t third) {
+    static const auto func = get_find_nal_pattern_func();
+    return func(data, start, fin, third);
+}
+
+size_t unnal(uint8_t *dst, const uint8_t *ptr, size_t len) {
+    if (len < 3) {
+        memmove(dst, ptr, len);
+        return len;
+    }
+    uint8_t *const dst_start = dst;
+    //00 00 03 を探し、03を除いた範囲をまとめてコピーする
+    //(00 00 03 は互いに重ならないので、見つかった位置の3byte後から探せばよい)
+    size_t copied = 0;
+    const size_t fin = len - 2;
+    for (size_t i = find_nal_pattern(ptr, 0, fin, 0x03); i < fin; i = find_nal_pattern(ptr, i + 3, fin, 0x03)) {
+        memmove(dst, ptr + copied, i + 2 - copied);
+        dst += i + 2 - copied;
+        copied = i + 3;
+    }
+    memmove(dst, ptr + copied, len - copied);
+    dst += len - copied;
+    return dst - dst_start;
+}
+
+std::vector<uint8_t> unnal(const uint8_t *ptr, size_t len) {
+    std::vector<uint8_t> data(len);
+    data.resize(unnal(data.data(), ptr, len));
     return data;
 }
 
+static void parse_nal_unit(RGYNalList& nal_list, const uint8_t *data, size_t size, bool hevc) {
+    nal_list.clear();
+    if (size > 3) {
+        const auto i_fin = size - 3;
+        for (size_t i = find_nal_pattern(data, 0, i_fin, 0x01); i < i_fin; i = find_nal_pattern(data, i + 4, i_fin, 0x01)) {
+            nal_info nal_start;
+            nal_start.ptr = data + i - (i > 0 && data[i-1] == 0);
+            nal_start.type = (hevc) ? (data[i+3] & 0x7f) >> 1 : data[i+3] & 0x1f;
+            nal_start.size = data + size - nal_start.ptr;
+            if (nal_list.size()) {
+                auto& prev = nal_list[nal_list.size()-1];
+                prev.size = nal_start.ptr - prev.ptr;
+            }
+            nal_list.push_back(nal_start);
+        }
+    }
+}
+
+void parse_nal_unit_h264(RGYNalList& nal_list, const uint8_t *data, size_t size) {
+    parse_nal_unit(nal_list, data, size, false);
+}
+
+void parse_nal_unit_hevc(RGYNalList& nal_list, const uint8_t *data, size_t size) {
+    parse_nal_unit(nal_list, data, size, true);
+}
+
 HEVCHDRSeiPrm::HEVCHDRSeiPrm() : maxcll(-1), maxfall(-1), contentlight_set(false), masterdisplay(), masterdisplay_set(false) {
     memset(&masterdisplay, 0, sizeof(masterdisplay));
 }
@@ -117,62 +117,56 @@ enum PayloadType {
     REGIONAL_NESTING                     = 157,
 };
 
-std::vector<uint8_t> unnal(const uint8_t *ptr, size_t len);
+//NALの一覧
+//1フレームに含まれる程度の数であれば内部の固定長の領域に格納し、ヒープ確保を行わない
+class RGYNalList {
+public:
+    static const size_t INLINE_COUNT = 32;
 
-static std::vector<nal_info> parse_nal_unit_h264(const uint8_t *data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size > 3) {
-        nal_info nal_start = { nullptr, 0, 0 };
-        const auto i_fin = size - 3;
-        for (size_t i = 0; i < i_fin; i++) {
-            if (data[i+0] == 0 && data[i+1] == 0 && data[i+2] == 1) {
-                if (nal_start.ptr) {
-                    nal_list.push_back(nal_start);
-                }
-                nal_start.ptr = data + i - (i > 0 && data[i-1] == 0);
-                nal_start.type = data[i+3] & 0x1f;
-                nal_start.size = data + size - nal_start.ptr;
-                if (nal_list.size()) {
-                    auto prev = nal_list.end()-1;
-                    prev->size = nal_start.ptr - prev->ptr;
-                }
-                i += 3;
-            }
-        }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
-        }
+    RGYNalList() : m_inline(), m_heap(), m_size(0) {};
+    size_t size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    void clear() {
+        m_size = 0;
+        m_heap.clear();
     }
-    return nal_list;
-}
-
-static std::vector<nal_info> parse_nal_unit_hevc(const uint8_t *data, size_t size) {
-    std::vector<nal_info> nal_list;
-    if (size > 3) {
-        nal_info nal_start = { nullptr, 0, 0 };
-        const auto i_fin = size - 3;
-
-        for (size_t i = 0; i < i_fin; i++) {
-            if (data[i+0] == 0 && data[i+1] == 0 && data[i+2] == 1) {
-                if (nal_start.ptr) {
-                    nal_list.push_back(nal_start);
-                }
-                nal_start.ptr = data + i - (i > 0 && data[i-1] == 0);
-                nal_start.type = (data[i+3] & 0x7f) >> 1;
-                nal_start.size = data + size - nal_start.ptr;
-                if (nal_list.size()) {
-                    auto prev = nal_list.end()-1;
-                    prev->size = nal_start.ptr - prev->ptr;
-                }
-                i += 3;
+    void push_back(const nal_info& nal) {
+        if (m_size < INLINE_COUNT) {
+            m_inline[m_size] = nal;
+        } else {
+            if (m_size == INLINE_COUNT) {
+                m_heap.assign(m_inline, m_inline + INLINE_COUNT);
             }
+            m_heap.push_back(nal);
         }
-        if (nal_start.ptr) {
-            nal_list.push_back(nal_start);
-        }
+        m_size++;
     }
-    return nal_list;
-}
+    nal_info *data() { return (m_size > INLINE_COUNT) ? m_heap.data() : m_inline; }
+    const nal_info *data() const { return (m_size > INLINE_COUNT) ? m_heap.data() : m_inline; }
+    nal_info *begin() { return data(); }
+    nal_info *end() { return data() + m_size; }
+    const nal_info *begin() const { return data(); }
+    const nal_info *end() const { return data() + m_size; }
+    nal_info& operator[](size_t i) { return data()[i]; }
+    const nal_info& operator[](size_t i) const { return data()[i]; }
+private:
+    nal_info m_inline[INLINE_COUNT];
+    std::vector<nal_info> m_heap; //INLINE_COUNTを超えた場合のみ使用する
+    size_t m_size;
+};
+
+//data[start, fin)の範囲で、00 00 <third> が始まる最初の位置を返す (見つからなければfinを返す)
+//data[fin+1]までを読み込む
+//third = 0x01: スタートコード, third = 0x03: emulation prevention byte
+size_t find_nal_pattern(const uint8_t *data, size_t start, size_t fin, uint8_t third);
+
+//emulation prevention byteを取り除き、dstに書き込んだサイズを返す (dstにはlenバイト必要)
+size_t unnal(uint8_t *dst, const uint8_t *ptr, size_t len);
+std::vector<uint8_t> unnal(const uint8_t *ptr, size_t len);
+
+//Annex-B形式のdataをNALごとに分割し、nal_listに格納する
+void parse_nal_unit_h264(RGYNalList& nal_list, const uint8_t *data, size_t size);
+void parse_nal_unit_hevc(RGYNalList& nal_list, const uint8_t *data, size_t size);
 
 struct HEVCHDRSeiPrm {
     int maxcll;
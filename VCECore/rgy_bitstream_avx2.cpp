@@ -0,0 +1,96 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+
+#include <immintrin.h>
+#include "rgy_osdep.h"
+#include "rgy_simd.h"
+#include "rgy_bitstream.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
+#endif
+
+#if defined(_MSC_VER) || defined(__AVX2__)
+
+static RGY_FORCEINLINE int ctz32(uint32_t x) {
+#if defined(_MSC_VER)
+    unsigned long index = 0;
+    _BitScanForward(&index, x);
+    return (int)index;
+#else
+    return __builtin_ctz(x);
+#endif
+}
+
+size_t find_nal_pattern_avx2(const uint8_t *data, size_t start, size_t fin, uint8_t third) {
+    const __m256i yZero = _mm256_setzero_si256();
+    const __m256i yThird = _mm256_set1_epi8((char)third);
+    size_t i = start;
+    for (; i + 64 <= fin; i += 64) {
+        //ほとんどの区間には一致がないので、64byteずつまとめて判定する
+        const __m256i y0 = _mm256_loadu_si256((const __m256i *)(data + i + 0));
+        const __m256i y1 = _mm256_loadu_si256((const __m256i *)(data + i + 1));
+        const __m256i y2 = _mm256_loadu_si256((const __m256i *)(data + i + 2));
+        const __m256i y3 = _mm256_loadu_si256((const __m256i *)(data + i + 32));
+        const __m256i y4 = _mm256_loadu_si256((const __m256i *)(data + i + 33));
+        const __m256i y5 = _mm256_loadu_si256((const __m256i *)(data + i + 34));
+        const __m256i yMatch0 = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(y0, yZero), _mm256_cmpeq_epi8(y1, yZero)), _mm256_cmpeq_epi8(y2, yThird));
+        const __m256i yMatch1 = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(y3, yZero), _mm256_cmpeq_epi8(y4, yZero)), _mm256_cmpeq_epi8(y5, yThird));
+        if (!_mm256_testz_si256(_mm256_or_si256(yMatch0, yMatch1), _mm256_or_si256(yMatch0, yMatch1))) {
+            const uint32_t mask0 = (uint32_t)_mm256_movemask_epi8(yMatch0);
+            if (mask0) {
+                return i + ctz32(mask0);
+            }
+            return i + 32 + ctz32((uint32_t)_mm256_movemask_epi8(yMatch1));
+        }
+    }
+    for (; i + 32 <= fin; i += 32) {
+        const __m256i y0 = _mm256_loadu_si256((const __m256i *)(data + i + 0));
+        const __m256i y1 = _mm256_loadu_si256((const __m256i *)(data + i + 1));
+        const __m256i y2 = _mm256_loadu_si256((const __m256i *)(data + i + 2));
+        const __m256i yMatch = _mm256_and_si256(_mm256_and_si256(_mm256_cmpeq_epi8(y0, yZero), _mm256_cmpeq_epi8(y1, yZero)), _mm256_cmpeq_epi8(y2, yThird));
+        const uint32_t mask = (uint32_t)_mm256_movemask_epi8(yMatch);
+        if (mask) {
+            return i + ctz32(mask);
+        }
+    }
+    for (; i < fin; i++) {
+        if (data[i+0] == 0 && data[i+1] == 0 && data[i+2] == third) {
+            return i;
+        }
+    }
+    return fin;
+}
+
+#endif //#if defined(_MSC_VER) || defined(__AVX2__)
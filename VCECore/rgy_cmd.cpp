@@ -33,6 +33,7 @@
 #include "rgy_prm.h"
 #include "rgy_cmd.h"
 #include "rgy_perf_monitor.h"
+#include "rgy_waiter.h"
 
 #if !FOR_AUO
 #if ENABLE_CPP_REGEX
@@ -615,6 +616,14 @@ int parse_one_common_option(const TCHAR *option_name, const TCHAR *strInput[], i
         common->seekSec = sec + mm * 60;
         return 0;
     }
+    if (IS_OPTION("input-index")) {
+        common->inputIndex = true;
+        if (i+1 < nArgNum && strInput[i+1][0] != _T('-')) {
+            i++;
+            common->inputIndexFile = strInput[i];
+        }
+        return 0;
+    }
 #if ENABLE_AVSW_READER && !FOR_AUO
     if (IS_OPTION("audio-source")) {
         i++;
@@ -1763,6 +1772,27 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
         ctrl->lowLatency = true;
         return 0;
     }
+    if (IS_OPTION("wait-mode")) {
+        i++;
+        int value = 0;
+        if (get_list_value(list_wait_mode, strInput[i], &value)) {
+            ctrl->waitMode = value;
+        } else {
+            print_cmd_error_invalid_value(option_name, strInput[i], list_wait_mode);
+            return 1;
+        }
+        return 0;
+    }
+    if (IS_OPTION("wait-block-max")) {
+        i++;
+        int value = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &value) || value < 1) {
+            print_cmd_error_invalid_value(option_name, strInput[i], _T("wait-block-max should be 1 or more.\n"));
+            return 1;
+        }
+        ctrl->waitBlockMaxMs = value;
+        return 0;
+    }
     if (IS_OPTION("input-thread") || IS_OPTION("thread-input")) {
         i++;
         int value = 0;
@@ -1777,6 +1807,20 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
         ctrl->threadInput = value;
         return 0;
     }
+    if (IS_OPTION("input-read-ahead")) {
+        i++;
+        int value = 0;
+        if (1 != _stscanf_s(strInput[i], _T("%d"), &value)) {
+            print_cmd_error_invalid_value(option_name, strInput[i]);
+            return 1;
+        }
+        if (value < -1 || value > RGY_INPUT_READ_AHEAD_MAX) {
+            print_cmd_error_invalid_value(option_name, strInput[i], strsprintf(_T("should be -1 (auto), 0 (disable) or 1 - %d"), RGY_INPUT_READ_AHEAD_MAX).c_str());
+            return 1;
+        }
+        ctrl->inputReadAhead = value;
+        return 0;
+    }
     if (IS_OPTION("no-output-thread")) {
         ctrl->threadOutput = 0;
         return 0;
@@ -1866,6 +1910,30 @@ int parse_one_ctrl_option(const TCHAR *option_name, const TCHAR *strInput[], int
         ctrl->perfMonitorInterval = std::max(50, v);
         return 0;
     }
+    if (IS_OPTION("metrics")) {
+        i++;
+        ctrl->metricsOutput = strInput[i];
+        return 0;
+    }
+    if (IS_OPTION("metrics-format")) {
+        i++;
+        int value = 0;
+        if (get_list_value(list_metrics_format, strInput[i], &value)) {
+            ctrl->metricsFormat = value;
+        } else {
+            print_cmd_error_invalid_value(option_name, strInput[i], list_metrics_format);
+            return 1;
+        }
+        return 0;
+    }
+    if (IS_OPTION("vpp-profile")) {
+        ctrl->vppProfile = true;
+        if (i+1 < nArgNum && strInput[i+1][0] != _T('-')) {
+            i++;
+            ctrl->vppProfileFile = strInput[i];
+        }
+        return 0;
+    }
     if (IS_OPTION("parent-pid")) {
         i++;
         try {
@@ -2014,6 +2082,12 @@ tstring gen_cmd(const RGYParamCommon *param, const RGYParamCommon *defaultPrm, b
         }
     }
     OPT_FLOAT(_T("--seek"), seekSec, 2);
+    if (param->inputIndex != defaultPrm->inputIndex || param->inputIndexFile != defaultPrm->inputIndexFile) {
+        cmd << _T(" --input-index");
+        if (param->inputIndexFile.length() > 0) {
+            cmd << _T(" \"") << param->inputIndexFile << _T("\"");
+        }
+    }
     OPT_TCHAR(_T("--input-format"), AVInputFormat);
     OPT_TSTR(_T("--output-format"), muxOutputFormat);
     OPT_STR(_T("--video-tag"), videoCodecTag);
@@ -2309,11 +2383,14 @@ tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm,
     std::basic_stringstream<TCHAR> cmd;
     OPT_NUM(_T("--thread-output"), threadOutput);
     OPT_NUM(_T("--thread-input"), threadInput);
+    OPT_NUM(_T("--input-read-ahead"), inputReadAhead);
     OPT_NUM(_T("--thread-audio"), threadAudio);
     OPT_NUM(_T("--thread-csp"), threadCsp);
     OPT_LST(_T("--simd-csp"), simdCsp, list_simd);
     OPT_NUM(_T("--max-procfps"), procSpeedLimit);
     OPT_BOOL(_T("--lowlatency"), _T(""), lowLatency);
+    OPT_LST(_T("--wait-mode"), waitMode, list_wait_mode);
+    OPT_NUM(_T("--wait-block-max"), waitBlockMaxMs);
     OPT_STR_PATH(_T("--log"), logfile);
     OPT_LST(_T("--log-level"), loglevel, list_log_level);
     OPT_BOOL(_T("--log-framelist"), _T(""), logFramePosList);
@@ -2337,6 +2414,14 @@ tstring gen_cmd(const RGYParamControl *param, const RGYParamControl *defaultPrm,
         }
     }
     OPT_NUM(_T("--perf-monitor-interval"), perfMonitorInterval);
+    OPT_STR_PATH(_T("--metrics"), metricsOutput);
+    OPT_LST(_T("--metrics-format"), metricsFormat, list_metrics_format);
+    if (param->vppProfile != defaultPrm->vppProfile || param->vppProfileFile != defaultPrm->vppProfileFile) {
+        cmd << _T(" --vpp-profile");
+        if (param->vppProfileFile.length() > 0) {
+            cmd << _T(" \"") << param->vppProfileFile << _T("\"");
+        }
+    }
     OPT_NUM(_T("--parent-pid"), parentProcessID);
     if (param->gpuSelect != defaultPrm->gpuSelect) {
         std::basic_stringstream<TCHAR> tmp;
@@ -2461,6 +2546,10 @@ tstring gen_cmd_help_common() {
         _T("   --seek [<int>:][<int>:]<int>[.<int>] (hh:mm:ss.ms)\n")
         _T("                                skip video for the time specified,\n")
         _T("                                 seek will be inaccurate but fast.\n")
+        _T("   --input-index [<string>]     use frame index file for avhw/avsw reader.\n")
+        _T("                                 index is created on first run and used to\n")
+        _T("                                 jump to the key frame near --trim/--seek.\n")
+        _T("                                 default: <input file>.rgyidx\n")
         _T("   --input-format <string>      set input format of input file.\n")
         _T("                                 this requires use of avhw/avsw reader.\n")
         _T("-f,--output-format <string>     set output format of output file.\n")
@@ -2595,7 +2684,17 @@ tstring gen_cmd_help_ctrl() {
     str += strsprintf(_T("")
         _T("   --max-procfps <int>         limit encoding speed for lower utilization.\n")
         _T("                                 default:0 (no limit)\n")
-        _T("   --lowlatency                minimize latency (might have lower throughput).\n"));
+        _T("   --lowlatency                minimize latency (might have lower throughput).\n")
+        _T("   --wait-mode <string>        how to wait for encoder/decoder completion.\n")
+        _T("                                 sleep (default) ... poll every 1ms.\n")
+        _T("                                 adaptive ... spin, yield, then block until\n")
+        _T("                                   woken by the other thread.\n")
+        _T("   --wait-block-max <int>      max block time (ms) for --wait-mode adaptive.\n")
+        _T("                                 default:%d\n")
+        _T("   --input-read-ahead <int>    frames to read ahead in a separate thread\n")
+        _T("                                 for raw/y4m/avi reader.\n")
+        _T("                                 -1: auto (= default, %d frames)\n")
+        _T("                                  0: disable\n"), RGY_WAIT_BLOCK_MAX_MS_DEFAULT, RGY_INPUT_READ_AHEAD_DEFAULT);
 #if ENABLE_AVCODEC_OUT_THREAD
     str += strsprintf(_T("")
         _T("   --output-thread <int>        set output thread num\n")
@@ -2640,6 +2739,7 @@ tstring gen_cmd_help_ctrl() {
 #endif
         _T("                                 gpu         ... monitor all gpu info\n")
         _T("                                 queue       ... queue usage\n")
+        _T("                                 queue_stall ... queue stall count / time (ms)\n")
         _T("                                 mem_private ... private memory (MB)\n")
         _T("                                 mem_virtual ... virtual memory (MB)\n")
         _T("                                 mem         ... monitor all memory info\n")
@@ -2653,6 +2753,14 @@ tstring gen_cmd_help_ctrl() {
         _T("                                 frame_out   ... written_frames\n")
         _T("                                 \n")
         _T("   --perf-monitor-interval <int> set perf monitor check interval (millisec)\n")
-        _T("                                 default 500, must be 50 or more\n"));
+        _T("                                 default 500, must be 50 or more\n")
+        _T("   --metrics <string>           output metrics (fps, bitrate, queue, cpu,\n")
+        _T("                                 frame types, encode latency) every\n")
+        _T("                                 perf monitor interval to a file, or to\n")
+        _T("                                 a unix domain socket by \"unix:<path>\".\n")
+        _T("   --metrics-format <string>    format of --metrics\n")
+        _T("                                 ndjson (default), openmetrics\n")
+        _T("   --vpp-profile [<string>]     measure gpu time of each filter / kernel\n")
+        _T("                                 and write result to log (and json file).\n"));
     return str;
 }
@@ -46,6 +46,8 @@ static const int MAX_FILENAME_LEN = 1024;
 static const int RGY_OUTPUT_THREAD_AUTO = -1;
 static const int RGY_AUDIO_THREAD_AUTO = -1;
 static const int RGY_INPUT_THREAD_AUTO = -1;
+static const int RGY_INPUT_READ_AHEAD_DEFAULT = 4;
+static const int RGY_INPUT_READ_AHEAD_MAX = 64;
 
 static const int CHECK_PTS_MAX_INSERT_FRAMES = 8;
 
@@ -214,6 +214,7 @@ void RGYInput::CreateInputInfo(const TCHAR *inputTypeName, const TCHAR *inputCSp
 #include "rgy_input_vpy.h"
 #include "rgy_input_sm.h"
 #include "rgy_input_avcodec.h"
+#include "rgy_perf_monitor.h"
 
 #if ENABLE_AVSW_READER
 template<bool subtitle, typename T>
@@ -383,6 +384,8 @@ RGY_ERR initReaders(
     RGYInputPrm inputPrm;
     inputPrm.threadCsp = ctrl->threadCsp;
     inputPrm.simdCsp = ctrl->simdCsp;
+    inputPrm.readAhead = (ctrl->inputReadAhead < 0) ? RGY_INPUT_READ_AHEAD_DEFAULT : ctrl->inputReadAhead;
+    inputPrm.queueInfo = (perfMonitor) ? perfMonitor->GetQueueInfoPtr() : nullptr;
     RGYInputPrm *pInputPrm = &inputPrm;
 
     auto subBurnTrack = std::make_unique<SubtitleSelect>();
@@ -458,6 +461,8 @@ RGY_ERR initReaders(
         inputInfoAVCuvid.procSpeedLimit = ctrl->procSpeedLimit;
         inputInfoAVCuvid.AVSyncMode = RGY_AVSYNC_ASSUME_CFR;
         inputInfoAVCuvid.seekSec = common->seekSec;
+        inputInfoAVCuvid.useIndex = common->inputIndex;
+        inputInfoAVCuvid.indexFile = common->inputIndexFile;
         inputInfoAVCuvid.logFramePosList = (ctrl->logFramePosList) ? common->outputFilename + _T(".framelist.csv") : _T("");
         inputInfoAVCuvid.threadInput = ctrl->threadInput;
         inputInfoAVCuvid.queueInfo = (perfMonitor) ? perfMonitor->GetQueueInfoPtr() : nullptr;
@@ -124,12 +124,16 @@ public:
     int run(int interlaced, void **dst, const void **src, int width, int src_y_pitch_byte, int src_uv_pitch_byte, int dst_y_pitch_byte, int height, int dst_height, int *crop);
 };
 
+struct PerfQueueInfo;
+
 class RGYInputPrm {
 public:
     int threadCsp;
     uint32_t simdCsp;
+    int readAhead;             //先読みするフレーム数 (0で先読みしない)
+    PerfQueueInfo *queueInfo;  //キューの情報を格納する構造体
 
-    RGYInputPrm() : threadCsp(-1), simdCsp(0) {};
+    RGYInputPrm() : threadCsp(-1), simdCsp(0), readAhead(0), queueInfo(nullptr) {};
     virtual ~RGYInputPrm() {};
 };
 
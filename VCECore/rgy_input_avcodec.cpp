@@ -102,7 +102,6 @@ RGYInputAvcodecPrm::RGYInputAvcodecPrm(RGYInputPrm base) :
     logFramePosList(),
     logCopyFrameData(),
     threadInput(0),
-    queueInfo(nullptr),
     HWDecCodecCsp(nullptr),
     videoDetectPulldown(false),
     caption2ass(FORMAT_INVALID),
@@ -111,7 +110,9 @@ RGYInputAvcodecPrm::RGYInputAvcodecPrm(RGYInputPrm base) :
     interlaceAutoFrame(false),
     qpTableListRef(nullptr),
     lowLatency(false),
-    inputOpt() {
+    inputOpt(),
+    useIndex(false),
+    indexFile() {
 
 }
 
@@ -119,9 +120,21 @@ RGYInputAvcodec::RGYInputAvcodec() :
     m_Demux(),
     m_logFramePosList(),
     m_hevcMp42AnnexbBuffer(),
-    m_cap2ass() {
+    m_cap2ass(),
+    m_index(),
+    m_indexFile(),
+    m_indexSrcFile(),
+    m_indexSeekKey(),
+    m_indexSeeked(false),
+    m_indexRecord(false),
+    m_indexReachedEof(false),
+    m_indexDecodeFrames(0),
+    m_indexHeader(),
+    m_indexKeyframes() {
     memset(&m_Demux.format, 0, sizeof(m_Demux.format));
     memset(&m_Demux.video,  0, sizeof(m_Demux.video));
+    memset(&m_indexSeekKey, 0, sizeof(m_indexSeekKey));
+    memset(&m_indexHeader, 0, sizeof(m_indexHeader));
     m_readerName = _T("av" DECODER_NAME "/avsw");
 }
 
@@ -136,6 +149,7 @@ void RGYInputAvcodec::CloseThread() {
         m_Demux.qVideoPkt.set_capacity(SIZE_MAX);
         m_Demux.qVideoPkt.set_keep_length(0);
         m_Demux.thread.thInput.join();
+        m_Demux.thread.thInputId.reset();
         AddMessage(RGY_LOG_DEBUG, _T("Closed Input thread.\n"));
     }
     m_Demux.thread.bAbortInput = false;
@@ -276,6 +290,7 @@ void RGYInputAvcodec::Close() {
     //    buffer = nullptr;
     //}
     m_encSatusInfo.reset();
+    writeFrameIndex();
     if (m_logFramePosList.length()) {
         m_Demux.frames.printList(m_logFramePosList.c_str());
         AddMessage(RGY_LOG_DEBUG, _T("Output logFramePosList.\n"));
@@ -608,6 +623,12 @@ RGY_ERR RGYInputAvcodec::getFirstFramePosAndFrameRate(const sTrim *pTrimList, in
     //timebaseが60で割り切れない場合には、ptsが完全には割り切れない値である場合があり、より多くのフレーム数を解析する必要がある
     int maxCheckFrames = (m_Demux.format.analyzeSec == 0) ? ((m_Demux.video.stream->time_base.den >= 1000 && m_Demux.video.stream->time_base.den % 60) ? 128 : ((lowLatency) ? 32 : 48)) : 7200;
     int maxCheckSec = (m_Demux.format.analyzeSec == 0) ? INT_MAX : m_Demux.format.analyzeSec;
+    //フレームインデックスにfpsが記録されていれば、fps推定のための長い先読みは不要
+    const RGYAVIndexHeader *indexHeader = (m_index && m_index->is_open() && m_index->header()->fpsNum > 0 && m_index->header()->fpsDen > 0) ? m_index->header() : nullptr;
+    if (indexHeader) {
+        maxCheckFrames = (lowLatency) ? 32 : 48;
+        maxCheckSec = INT_MAX;
+    }
     AddMessage(RGY_LOG_DEBUG, _T("fps decoder invalid: %s\n"), fpsDecoderInvalid ? _T("true") : _T("false"));
 
     AVPacket pkt;
@@ -718,7 +739,9 @@ RGY_ERR RGYInputAvcodec::getFirstFramePosAndFrameRate(const sTrim *pTrimList, in
         }
 
         //ここでやめてよいか判定する
-        if (i_retry == 0) {
+        if (indexHeader) {
+            break; //fpsはフレームインデックスの値を使用するので再解析しない
+        } else if (i_retry == 0) {
             //初回は、唯一のdurationが得られている場合を除き再解析する
             if (durationHistgram.size() <= 1) {
                 break;
@@ -856,6 +879,11 @@ RGY_ERR RGYInputAvcodec::getFirstFramePosAndFrameRate(const sTrim *pTrimList, in
     }
 
     AddMessage(RGY_LOG_DEBUG, _T("final AvgFps (round): %d/%d\n\n"), m_Demux.video.nAvgFramerate.num, m_Demux.video.nAvgFramerate.den);
+    if (indexHeader) {
+        m_Demux.video.nAvgFramerate = av_make_q(indexHeader->fpsNum, indexHeader->fpsDen);
+        m_Demux.video.streamPtsInvalid |= (indexHeader->ptsInvalid & RGY_PTS_ALL_INVALID);
+        AddMessage(RGY_LOG_DEBUG, _T("AvgFps from frame index: %d/%d\n\n"), m_Demux.video.nAvgFramerate.num, m_Demux.video.nAvgFramerate.den);
+    }
 
     auto trimList = make_vector(pTrimList, nTrimCount);
     //出力時の音声・字幕解析用に1パケットコピーしておく
@@ -912,6 +940,239 @@ RGY_ERR RGYInputAvcodec::getFirstFramePosAndFrameRate(const sTrim *pTrimList, in
     return RGY_ERR_NONE;
 }
 
+void RGYInputAvcodec::openFrameIndex(const TCHAR *strFileName, const RGYInputAvcodecPrm *input_prm) {
+    m_index.reset();
+    m_indexSeeked = false;
+    m_indexRecord = false;
+    m_indexReachedEof = false;
+    m_indexDecodeFrames = 0;
+    m_indexKeyframes.clear();
+    if (!input_prm->useIndex) {
+        return;
+    }
+    if (m_Demux.format.isPipe) {
+        AddMessage(RGY_LOG_WARN, _T("frame index is not supported for pipe input.\n"));
+        return;
+    }
+    m_indexSrcFile = strFileName;
+    m_indexFile = (input_prm->indexFile.length() > 0) ? input_prm->indexFile : RGYInputAvcodecIndex::defaultPath(strFileName);
+    m_index = std::unique_ptr<RGYInputAvcodecIndex>(new RGYInputAvcodecIndex());
+    const auto timebase = m_Demux.video.stream->time_base;
+    const auto err = m_index->open(m_indexFile.c_str(), strFileName, m_Demux.video.index, timebase.num, timebase.den);
+    if (err == RGY_ERR_NONE) {
+        const auto header = m_index->header();
+        AddMessage(RGY_LOG_INFO, _T("using frame index \"%s\": %d frames, %d key frames%s.\n"),
+            m_indexFile.c_str(), header->frameCount, header->keyframeCount, (header->complete) ? _T("") : _T(" (partial)"));
+        AddMessage(RGY_LOG_DEBUG, _T("frame index: first key pts %lld, fps %d/%d, trim offset %d, duration %s.\n"),
+            (long long int)header->firstKeyPts, header->fpsNum, header->fpsDen, header->trimOffset,
+            getTimestampString(header->videoDuration, timebase).c_str());
+    } else {
+        m_index.reset();
+        if (err == RGY_ERR_UNSUPPORTED) {
+            AddMessage(RGY_LOG_WARN, _T("frame index is not supported for this input.\n"));
+            return;
+        } else if (err == RGY_ERR_NOT_FOUND) {
+            AddMessage(RGY_LOG_DEBUG, _T("frame index \"%s\" not found, will be created.\n"), m_indexFile.c_str());
+        } else if (err == RGY_ERR_INVALID_VERSION) {
+            AddMessage(RGY_LOG_INFO, _T("frame index \"%s\" does not match the input, will be recreated.\n"), m_indexFile.c_str());
+        } else {
+            AddMessage(RGY_LOG_WARN, _T("failed to open frame index \"%s\": %s, will be recreated.\n"), m_indexFile.c_str(), get_err_mes(err));
+        }
+    }
+    //インデックスがない、あるいは途中までしかない場合は、今回読み込んだ情報で書き出す
+    //--seekの場合はフレーム番号の対応がとれないので、書き出しは行わない
+    m_indexRecord = (!m_index || !m_index->header()->complete) && input_prm->seekSec <= 0.0f;
+}
+
+RGY_ERR RGYInputAvcodec::seekByFrameIndex(const RGYInputAvcodecPrm *input_prm, int64_t firstPts, bool *seeked) {
+    *seeked = false;
+    memset(&m_indexSeekKey, 0, sizeof(m_indexSeekKey));
+    m_indexSeekKey.poc = FRAMEPOS_POC_INVALID;
+    if (!m_index) {
+        return RGY_ERR_NONE;
+    }
+    const auto header = m_index->header();
+    const RGYAVIndexKeyframe *key = nullptr;
+    if (input_prm->seekSec > 0.0f) {
+        //インデックスの有無で開始フレームが変わらないよう、通常のシークと同じ基準(先頭のパケットのpts)と向きで選ぶ
+        //通常のシークはフラグなしのav_seek_frameなので、シーク先以降で最初のキーフレームとなる
+        const auto seek_time = av_rescale_q(1, av_d2q((double)input_prm->seekSec, 1<<24), m_Demux.video.stream->time_base);
+        const int64_t target_pts = firstPts + seek_time;
+        key = m_index->findKeyframeAtOrAfterPts(target_pts);
+        //インデックスが途中までしかなく、その先にシーク先がある場合は通常のシークを行う
+        //(途中までのインデックスでは、最後のキーフレームより後にキーフレームがないとは言えない)
+        if (key == nullptr && !header->complete) {
+            return RGY_ERR_NONE;
+        }
+        //シーク先以降にキーフレームがない場合、通常のシークはAVSEEK_FLAG_ANYにフォールバックするので、それに任せる
+    } else if (input_prm->nTrimCount > 0) {
+        //trimはフレーム番号で指定されるので、開始フレーム以前で最後のclosed gopのキーフレームへシークする
+        //opengopのキーフレームへシークすると、先頭のフレームが出力されずフレーム番号がずれてしまう
+        key = m_index->findCleanKeyframeByPoc(input_prm->pTrimList[0].start - header->trimOffset);
+        if (key != nullptr && key->poc <= 0) {
+            key = nullptr; //先頭のキーフレームなら、シークは不要
+        }
+    }
+    if (key == nullptr) {
+        return RGY_ERR_NONE;
+    }
+    auto formatCtx = m_Demux.format.formatCtx;
+    auto seekToKey = [this, formatCtx, key]() {
+        int seek_ret = -1;
+        if (key->pos >= 0 && (formatCtx->iformat->flags & AVFMT_TS_DISCONT)) {
+            //mpegtsなどはtimestampでは正確にキーフレームへシークできないので、ファイル上の位置でシークする
+            seek_ret = av_seek_frame(formatCtx, -1, key->pos, AVSEEK_FLAG_BYTE);
+        }
+        if (0 > seek_ret) {
+            seek_ret = av_seek_frame(formatCtx, m_Demux.video.index, key->pts, AVSEEK_FLAG_BACKWARD);
+        }
+        if (0 > seek_ret) {
+            AddMessage(RGY_LOG_WARN, _T("failed to seek by frame index, seek normally.\n"));
+            return false;
+        }
+        return true;
+    };
+    if (!seekToKey()) {
+        return RGY_ERR_NONE;
+    }
+    if (input_prm->seekSec > 0.0f) {
+        //シーク後最初のキーフレームが、インデックスで選んだ(=通常のシークで到達する)キーフレームと一致するか確認する
+        //一致しない場合は、インデックスは使わずに通常のシークをやり直す
+        int64_t reachedPts = AV_NOPTS_VALUE;
+        AVPacket pkt;
+        while (getSample(&pkt) == 0) {
+            const bool keyPkt = (pkt.flags & AV_PKT_FLAG_KEY) != 0;
+            reachedPts = pkt.pts;
+            av_packet_unref(&pkt);
+            if (keyPkt) {
+                break;
+            }
+            reachedPts = AV_NOPTS_VALUE;
+        }
+        //確認のために行ったgetSampleの結果は破棄する
+        m_Demux.frames.clear();
+        if (reachedPts != key->pts) {
+            AddMessage(RGY_LOG_WARN, _T("seek by frame index reached key frame pts %lld, expected %lld, seek normally.\n"),
+                (long long int)reachedPts, (long long int)key->pts);
+            return RGY_ERR_NONE;
+        }
+        //確認のために読んだパケットを読み直す
+        if (!seekToKey()) {
+            return RGY_ERR_NONE;
+        }
+    }
+    AddMessage(RGY_LOG_DEBUG, _T("seek by frame index: key frame pts %lld (%s), pos %lld, poc %d.\n"),
+        (long long int)key->pts, getTimestampString(key->pts, m_Demux.video.stream->time_base).c_str(), (long long int)key->pos, key->poc);
+    if (input_prm->seekSec <= 0.0f) {
+        m_indexSeekKey = *key;
+    }
+    m_indexSeeked = true;
+    *seeked = true;
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYInputAvcodec::checkFrameIndexFirstKeyframe() {
+    if (m_indexSeeked && m_indexSeekKey.poc >= 0) {
+        //想定したキーフレームと異なる位置に到達した場合は、実際に到達したキーフレームで補正する
+        if (m_Demux.video.streamFirstKeyPts != m_indexSeekKey.pts) {
+            const auto key = m_index->findKeyframeExact(m_Demux.video.streamFirstKeyPts);
+            if (key == nullptr || key->poc < 0 || !(key->flags & RGY_AVINDEX_KEYFRAME_CLEAN)) {
+                AddMessage(RGY_LOG_ERROR, _T("failed to seek to the key frame in frame index \"%s\".\n"), m_indexFile.c_str());
+                AddMessage(RGY_LOG_ERROR, _T("please remove the frame index and retry.\n"));
+                return RGY_ERR_UNKNOWN;
+            }
+            m_indexSeekKey = *key;
+        }
+        //シーク先のキーフレームまでのフレーム数をtrimの補正に加える
+        m_trimParam.offset += m_index->header()->trimOffset + m_indexSeekKey.poc;
+        AddMessage(RGY_LOG_DEBUG, _T("trim offset by frame index: %d.\n"), m_trimParam.offset);
+    }
+    if (m_indexRecord) {
+        if (m_indexSeeked) {
+            //シーク先より前の情報は、読み込んだフレームインデックスから引き継ぐ
+            m_indexHeader = *m_index->header();
+        } else {
+            memset(&m_indexHeader, 0, sizeof(m_indexHeader));
+            m_indexHeader.videoStreamIndex = m_Demux.video.index;
+            m_indexHeader.timebaseNum = m_Demux.video.stream->time_base.num;
+            m_indexHeader.timebaseDen = m_Demux.video.stream->time_base.den;
+            m_indexHeader.fpsNum = m_Demux.video.nAvgFramerate.num;
+            m_indexHeader.fpsDen = m_Demux.video.nAvgFramerate.den;
+            m_indexHeader.ptsInvalid = (int32_t)m_Demux.video.streamPtsInvalid;
+            m_indexHeader.trimOffset = m_trimParam.offset;
+            m_indexHeader.firstKeyPts = m_Demux.video.streamFirstKeyPts;
+        }
+        m_indexHeader.formatDuration = m_Demux.format.formatCtx->duration;
+        m_indexHeader.videoDuration = m_Demux.video.stream->duration;
+    }
+    return RGY_ERR_NONE;
+}
+
+void RGYInputAvcodec::writeFrameIndex() {
+    if (m_indexRecord && m_Demux.frames.isEof() && m_Demux.frames.frameNum() > 0) {
+        vector<RGYAVIndexFrame> frames;
+        vector<RGYAVIndexKeyframe> keyframes;
+        int droppedFrames = m_indexDecodeFrames - m_Demux.frames.frameNum();
+        int pocOffset = 0;
+        int decodeIdxOffset = 0;
+        bool update = true;
+        if (m_indexSeeked && m_index) {
+            //シーク先のキーフレームより前の情報は、読み込んだフレームインデックスから引き継ぐ
+            //シーク先はclosed gopのキーフレームなので、表示順とデコード順の位置の差がそれまでに取り除かれたフレーム数となる
+            int prefixFrames = 0;
+            while (prefixFrames < m_index->frameCount() && m_index->frame(prefixFrames)->pts != m_indexSeekKey.pts) {
+                prefixFrames++;
+            }
+            update = prefixFrames < m_index->frameCount();
+            frames.insert(frames.end(), m_index->frame(0), m_index->frame(0) + prefixFrames);
+            for (int i = 0; i < m_index->keyframeCount() && m_index->keyframe(i)->pts < m_indexSeekKey.pts; i++) {
+                keyframes.push_back(*m_index->keyframe(i));
+            }
+            droppedFrames += m_indexSeekKey.decodeIdx - prefixFrames;
+            pocOffset = m_indexSeekKey.poc;
+            decodeIdxOffset = m_indexSeekKey.decodeIdx;
+        }
+        frames.reserve(frames.size() + m_Demux.frames.frameNum());
+        for (int i = 0; i < m_Demux.frames.frameNum(); i++) {
+            const auto& pos = m_Demux.frames.list(i);
+            RGYAVIndexFrame frame;
+            frame.pts = pos.pts;
+            frame.dts = pos.dts;
+            frame.duration = pos.duration;
+            frame.duration2 = pos.duration2;
+            frame.poc = (pos.poc >= 0) ? pos.poc + pocOffset : pos.poc;
+            frame.flags = pos.flags;
+            frame.pic_struct = pos.pic_struct;
+            frame.repeat_pict = pos.repeat_pict;
+            frame.pict_type = pos.pict_type;
+            frames.push_back(frame);
+        }
+        for (auto key : m_indexKeyframes) {
+            key.decodeIdx += decodeIdxOffset;
+            keyframes.push_back(key);
+        }
+        //既存のインデックスより多くの範囲を読み込んだ場合のみ書き出す
+        update &= !m_index || m_indexReachedEof || (int)frames.size() > m_index->frameCount();
+        m_index.reset(); //書き出し前にマッピングを解除する
+        if (update) {
+            auto header = m_indexHeader;
+            header.complete = (m_indexReachedEof) ? 1 : 0;
+            const auto err = RGYInputAvcodecIndex::write(m_indexFile.c_str(), m_indexSrcFile.c_str(), header, frames, keyframes, droppedFrames);
+            if (err == RGY_ERR_NONE) {
+                AddMessage(RGY_LOG_INFO, _T("wrote frame index \"%s\": %d frames, %d key frames%s.\n"),
+                    m_indexFile.c_str(), (int)frames.size(), (int)keyframes.size(), (header.complete) ? _T("") : _T(" (partial)"));
+            } else {
+                AddMessage(RGY_LOG_WARN, _T("failed to write frame index \"%s\": %s.\n"), m_indexFile.c_str(), get_err_mes(err));
+            }
+        }
+    }
+    m_index.reset();
+    m_indexRecord = false;
+    m_indexSeeked = false;
+    m_indexDecodeFrames = 0;
+    m_indexKeyframes.clear();
+}
+
 RGY_ERR RGYInputAvcodec::parseHDRData() {
     //まずはstreamのside_dataを探す
     int size = 0;
@@ -1042,7 +1303,8 @@ RGY_ERR RGYInputAvcodec::parseHDR10plus(AVPacket *pkt) {
     if (m_Demux.video.stream->codecpar->codec_id != AV_CODEC_ID_HEVC) {
         return RGY_ERR_NONE;
     }
-    const auto nal_list = parse_nal_unit_hevc(pkt->data, pkt->size);
+    RGYNalList nal_list;
+    parse_nal_unit_hevc(nal_list, pkt->data, pkt->size);
     for (const auto& nal_unit : nal_list) {
         if (nal_unit.type != NALU_HEVC_PREFIX_SEI) {
             continue;
@@ -1304,6 +1566,10 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
     m_Demux.qVideoPkt.init(4096, SIZE_MAX, 4);
     m_Demux.qVideoPkt.set_keep_length(AV_FRAME_MAX_REORDER);
     m_Demux.qStreamPktL2.init(4096);
+    if (m_Demux.thread.queueInfo) {
+        m_Demux.qVideoPkt.set_stall_info(&m_Demux.thread.queueInfo->stall_vid_in, &m_Demux.thread.queueInfo->stall_us_vid_in);
+        m_Demux.qStreamPktL2.set_stall_info(&m_Demux.thread.queueInfo->stall_aud_in, &m_Demux.thread.queueInfo->stall_us_aud_in);
+    }
 
     //動画ストリームを探す
     //動画ストリームは動画を処理しなかったとしても同期のため必要
@@ -1655,24 +1921,35 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
             m_inputVideoInfo.codecExtra = m_Demux.video.extradata;
             m_inputVideoInfo.codecExtraSize = m_Demux.video.extradataSize;
         }
+        openFrameIndex(strFileName, input_prm);
+        //--seekの基準となる先頭のパケットのpts
+        //フレームインデックスでシークする場合も、通常のシークと同じ値を基準とする
+        int64_t firstPts = AV_NOPTS_VALUE;
         if (input_prm->seekSec > 0.0f) {
             AVPacket firstpkt;
             if (getSample(&firstpkt)) { //現在のtimestampを取得する
                 AddMessage(RGY_LOG_ERROR, _T("Failed to get firstpkt of video!\n"));
                 return RGY_ERR_UNKNOWN;
             }
+            firstPts = firstpkt.pts;
+            av_packet_unref(&firstpkt);
+            //seekのために行ったgetSampleの結果は破棄する
+            m_Demux.frames.clear();
+        }
+        bool seekedByIndex = false;
+        if (RGY_ERR_NONE != (sts = seekByFrameIndex(input_prm, firstPts, &seekedByIndex))) {
+            return sts;
+        }
+        if (!seekedByIndex && input_prm->seekSec > 0.0f) {
             const auto seek_time = av_rescale_q(1, av_d2q((double)input_prm->seekSec, 1<<24), m_Demux.video.stream->time_base);
-            int seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstpkt.pts + seek_time, 0);
+            int seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstPts + seek_time, 0);
             if (0 > seek_ret) {
-                seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstpkt.pts + seek_time, AVSEEK_FLAG_ANY);
+                seek_ret = av_seek_frame(m_Demux.format.formatCtx, m_Demux.video.index, firstPts + seek_time, AVSEEK_FLAG_ANY);
             }
-            av_packet_unref(&firstpkt);
             if (0 > seek_ret) {
                 AddMessage(RGY_LOG_ERROR, _T("failed to seek %s.\n"), print_time(input_prm->seekSec).c_str());
                 return RGY_ERR_UNKNOWN;
             }
-            //seekのために行ったgetSampleの結果は破棄する
-            m_Demux.frames.clear();
         }
 
         //parserはseek後に初期化すること
@@ -1699,6 +1976,10 @@ RGY_ERR RGYInputAvcodec::Init(const TCHAR *strFileName, VideoInfo *inputInfo, co
         if (m_cap2ass.enabled()) {
             m_cap2ass.setVidFirstKeyPts(m_Demux.video.streamFirstKeyPts);
         }
+        //フレームインデックスでシークした場合は、シーク先のキーフレームまでのフレーム数をtrimの補正に加える
+        if (RGY_ERR_NONE != (sts = checkFrameIndexFirstKeyframe())) {
+            return sts;
+        }
 
         m_trimParam.list = make_vector(input_prm->pTrimList, input_prm->nTrimCount);
         //キーフレームに到達するまでQSVではフレームが出てこない
@@ -2278,6 +2559,16 @@ int RGYInputAvcodec::getSample(AVPacket *pkt, bool bTreatFirstPacketAsKeyframe)
                 }
 #endif //#if ENCODER_NVENC
                 m_Demux.frames.add(pos);
+                if (m_indexRecord) {
+                    if (keyframe) {
+                        RGYAVIndexKeyframe key = { 0 };
+                        key.pts = (pos.pts == AV_NOPTS_VALUE) ? pos.dts : pos.pts;
+                        key.pos = pkt->pos;
+                        key.decodeIdx = m_indexDecodeFrames;
+                        m_indexKeyframes.push_back(key);
+                    }
+                    m_indexDecodeFrames++;
+                }
             }
             //ptsの確定したところまで、音声を出力する
             CheckAndMoveStreamPacketList();
@@ -2301,6 +2592,8 @@ int RGYInputAvcodec::getSample(AVPacket *pkt, bool bTreatFirstPacketAsKeyframe)
         return 1;
     }
     AddMessage(RGY_LOG_DEBUG, _T("%d frames, %s\n"), m_Demux.frames.frameNum(), qsv_av_err2str(ret_read_frame).c_str());
+    //trimにより読み込みを打ち切った場合は、ファイルの最後までのインデックスとはならない
+    m_indexReachedEof = (ret_read_frame == AVERROR_EOF);
     pkt->data = nullptr;
     pkt->size = 0;
     //動画の終端を表す最後のptsを挿入する
@@ -2587,7 +2880,8 @@ RGY_ERR RGYInputAvcodec::GetHeader(RGYBitstream *pBitstream) {
         //NVEncのデコーダが受け取れるヘッダは1024byteまで
         if (m_Demux.video.extradataSize > 1024) {
             if (m_Demux.video.stream->codecpar->codec_id == AV_CODEC_ID_H264) {
-                std::vector<nal_info> nal_list = parse_nal_unit_h264(m_Demux.video.extradata, m_Demux.video.extradataSize);
+                RGYNalList nal_list;
+                parse_nal_unit_h264(nal_list, m_Demux.video.extradata, m_Demux.video.extradataSize);
                 const auto h264_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_H264_SPS; });
                 const auto h264_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_H264_PPS; });
                 const bool header_check = (nal_list.end() != h264_sps_nal) && (nal_list.end() != h264_pps_nal);
@@ -2602,7 +2896,8 @@ RGY_ERR RGYInputAvcodec::GetHeader(RGYBitstream *pBitstream) {
                     m_Demux.video.extradata = new_ptr;
                 }
             } else if (m_Demux.video.stream->codecpar->codec_id == AV_CODEC_ID_HEVC) {
-                std::vector<nal_info> nal_list = parse_nal_unit_hevc(m_Demux.video.extradata, m_Demux.video.extradataSize);
+                RGYNalList nal_list;
+                parse_nal_unit_hevc(nal_list, m_Demux.video.extradata, m_Demux.video.extradataSize);
                 const auto hevc_vps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_VPS; });
                 const auto hevc_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
                 const auto hevc_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_PPS; });
@@ -2753,6 +3048,10 @@ HANDLE RGYInputAvcodec::getThreadHandleInput() {
 #endif //#if defined(WIN32) || defined(WIN64)
 }
 
+uint32_t RGYInputAvcodec::getThreadIdInput() {
+    return (m_Demux.thread.thInput.joinable()) ? m_Demux.thread.thInputId.wait() : 0;
+}
+
 //出力する動画の情報をセット
 void RGYInputAvcodec::setOutputVideoInfo(int w, int h, int sar_x, int sar_y, bool mux) {
     if (m_cap2ass.enabled()) {
@@ -2768,6 +3067,7 @@ void RGYInputAvcodec::setOutputVideoInfo(int w, int h, int sar_x, int sar_y, boo
 }
 
 RGY_ERR RGYInputAvcodec::ThreadFuncRead() {
+    m_Demux.thread.thInputId.set();
     while (!m_Demux.thread.bAbortInput) {
         AVPacket pkt;
         if (getSample(&pkt)) {
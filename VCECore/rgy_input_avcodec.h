@@ -36,6 +36,7 @@
 #include "rgy_avutil.h"
 #include "rgy_queue.h"
 #include "rgy_perf_monitor.h"
+#include "rgy_input_avcodec_index.h"
 #include "convert_csp.h"
 #include <deque>
 #include <atomic>
@@ -162,8 +163,14 @@ public:
         m_firstKeyframePts(AV_NOPTS_VALUE),
         m_PAFFRewind(0),
         m_ptsWrapArroundThreshold(0xFFFFFFFF),
+        m_ptsIndex(),
+        m_ptsIndexBreak(),
+        m_ptsIndexPopped(0),
+        m_ptsIndexLastPts(AV_NOPTS_VALUE),
         m_fpDebugCopyFrameData() {
         m_list.init();
+        m_ptsIndex.init();
+        m_ptsIndexBreak.init(16);
         static_assert(sizeof(m_list.get()[0]) == sizeof(m_list.get()->data), "FramePos must not have padding.");
     };
     virtual ~FramePosList() {
@@ -229,6 +236,10 @@ public:
         m_ptsWrapArroundThreshold = 0xFFFFFFFF;
         m_fpDebugCopyFrameData.reset();
         m_list.init();
+        m_ptsIndex.init();
+        m_ptsIndexBreak.init(16);
+        m_ptsIndexPopped = 0;
+        m_ptsIndexLastPts = AV_NOPTS_VALUE;
     }
     //ここまで計算したdurationを返す
     int64_t duration() const {
@@ -260,39 +271,92 @@ public:
         m_streamPtsStatus = RGY_PTS_UNKNOWN;
         m_PAFFRewind = 0;
         m_ptsWrapArroundThreshold = 0xFFFFFFFF;
+        m_ptsIndex.clear();
+        m_ptsIndexBreak.clear();
+        m_ptsIndexPopped = 0;
+        m_ptsIndexLastPts = AV_NOPTS_VALUE;
     }
     RGYPtsStatus getStreamPtsStatus() const {
         return m_streamPtsStatus;
     }
+    //ptsの一致するフレームの情報のコピーを返す
+    //一致するものがなければ、ptsの直前のフレームの情報を返す
+    //ptsの確定したフレームはm_ptsIndexを二分探索し、未確定のフレームのみ線形探索する
     FramePos findpts(int64_t pts, uint32_t *lastIndex) {
-        FramePos pos_last = framePosInit();
-        for (uint32_t index = *lastIndex + 1; ; index++) {
-            FramePos pos = framePosInit();
-            if (!m_list.copy(&pos, index)) {
-                break;
+        //通常は前回見つかったフレームの次のフレームが該当する
+        FramePos pos = framePosInit();
+        if (m_list.copy(&pos, *lastIndex + 1) && pos.pts == pts) {
+            *lastIndex = *lastIndex + 1;
+            return pos;
+        }
+        //m_ptsIndexBreakの位置は、m_ptsIndexの先頭から取り除いた数を含めた通し番号なので、
+        //m_ptsIndexPoppedを引いて現在のm_ptsIndex上の位置に直す
+        const int popped = m_ptsIndexPopped;
+        //m_ptsIndexBreakより先にm_ptsIndexのサイズを取得しておけば、
+        //その範囲内の区切りはすべてm_ptsIndexBreakに登録済みとなる
+        const int indexedNum = (int)m_ptsIndex.size();
+        const int breakNum = (int)m_ptsIndexBreak.size();
+        int floorIndex = -1; //ptsより大きい最初のフレームの直前のフレーム
+        bool foundLarger = false;
+        for (int iseg = 0, segStart = 0; iseg <= breakNum && segStart < indexedNum; iseg++) {
+            int segEnd = indexedNum;
+            if (iseg < breakNum) {
+                m_ptsIndexBreak.copy(&segEnd, iseg);
+                segEnd = (std::min)(segEnd - popped, indexedNum);
+                if (segEnd <= segStart) {
+                    continue; //取り除いた範囲内の区切り
+                }
             }
-            if (pts == pos.pts) {
-                *lastIndex = index;
-                return pos;
+            //[segStart, segEnd)はptsの昇順に並んでいるので、ptsより大きい最初の位置を探す
+            int lo = segStart, hi = segEnd;
+            while (lo < hi) {
+                const int mid = (lo + hi) >> 1;
+                int64_t midPts = 0;
+                m_ptsIndex.copy(&midPts, mid);
+                if (midPts <= pts) {
+                    lo = mid + 1;
+                } else {
+                    hi = mid;
+                }
             }
-            pos_last = pos;
-        }
-        //最初から探索
-        for (uint32_t index = 0; ; index++) {
-            FramePos pos = framePosInit();
-            if (!m_list.copy(&pos, index)) {
-                break;
+            if (lo > segStart) {
+                int64_t prevPts = 0;
+                m_ptsIndex.copy(&prevPts, lo - 1);
+                if (prevPts == pts) {
+                    //同じptsが複数ある場合は、最初のものを返す
+                    int first = lo - 1;
+                    while (first > segStart) {
+                        m_ptsIndex.copy(&prevPts, first - 1);
+                        if (prevPts != pts) break;
+                        first--;
+                    }
+                    if (m_list.copy(&pos, first) && pos.pts == pts) {
+                        *lastIndex = first;
+                        return pos;
+                    }
+                }
+            }
+            if (!foundLarger && lo < segEnd) {
+                foundLarger = true;
+                floorIndex = lo - 1;
             }
+            segStart = segEnd;
+        }
+        //ptsの確定していないフレームを探索する
+        for (uint32_t index = (uint32_t)indexedNum; m_list.copy(&pos, index); index++) {
             if (pts == pos.pts) {
                 *lastIndex = index;
                 return pos;
             }
-            //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
-            if (pts < pos.pts) {
-                *lastIndex = index-1;
-                return pos_last;
+            if (!foundLarger && pts < pos.pts) {
+                foundLarger = true;
+                floorIndex = (int)index - 1;
             }
-            pos_last = pos;
+        }
+        //pts < demux.videoFramePts[i]であるなら、その前のフレームを返す
+        if (foundLarger && floorIndex >= 0 && m_list.copy(&pos, floorIndex)) {
+            *lastIndex = floorIndex;
+            return pos;
         }
         //エラー
         FramePos poserr = framePosInit();
@@ -371,6 +435,7 @@ public:
         for (int i = m_nextFixNumIndex; i < nFrame; i++) {
             adjustDurationAfterSort(m_nextFixNumIndex);
             setPoc(i);
+            addPtsIndex(i);
         }
         m_nextFixNumIndex = nFrame;
         add(pos);
@@ -621,6 +686,30 @@ protected:
             m_durationNum += nNonDurationCalculatedFrames;
         }
     }
+    //ptsの確定したフレームをm_ptsIndexに追加する
+    //m_ptsIndexはm_listと同じ並びで、ソート済みなので基本的にはptsの昇順となる
+    //wrap arroundなどで昇順でなくなる位置はm_ptsIndexBreakに記録し、そこで区切って二分探索する
+    void addPtsIndex(int index) {
+        if (index != (int)m_ptsIndex.size()) {
+            return; //m_listとの対応がとれなくなるので追加しない
+        }
+        const int64_t pts = m_list[index].data.pts;
+        if (index > 0 && pts < m_ptsIndexLastPts) {
+            //findpts側はm_ptsIndexのサイズを先に取得するので、区切りを先に登録する
+            //m_ptsIndexの先頭が取り除かれても位置がずれないよう、取り除いた数を含めた通し番号で記録する
+            m_ptsIndexBreak.push(index + m_ptsIndexPopped);
+        }
+        m_ptsIndexLastPts = pts;
+        m_ptsIndex.push(pts);
+    }
+    //先頭のフレームをフレームリストから取り除く
+    void popFront() {
+        m_list.pop();
+        if (m_ptsIndex.size() > 0) {
+            m_ptsIndex.pop();
+            m_ptsIndexPopped++;
+        }
+    }
     //pocを確定させる
     void setPocAndFix(int nSortedSize) {
         //ソートによりptsが確定している範囲
@@ -631,13 +720,14 @@ protected:
             if (m_list[m_nextFixNumIndex].data.pts < m_firstKeyframePts //ソートの先頭のptsが塚下キーフレームの先頭のptsよりも小さいことがある(opengop)
                 && m_nextFixNumIndex <= 16) { //wrap arroundの場合は除く
                 //これはフレームリストから取り除く
-                m_list.pop();
+                popFront();
                 m_nextFixNumIndex--;
                 nSortFixedSize--;
             } else {
                 adjustDurationAfterSort(m_nextFixNumIndex);
                 //ソートにより確定したptsに対して、pocとdurationを設定する
                 setPoc(m_nextFixNumIndex);
+                addPtsIndex(m_nextFixNumIndex);
             }
         }
         m_PAFFRewind = 0;
@@ -662,6 +752,10 @@ protected:
     int64_t m_firstKeyframePts; //最初のキーフレームのpts
     int m_PAFFRewind; //PAFFのdurationを確定させるため、戻した枚数
     uint32_t m_ptsWrapArroundThreshold; //wrap arroundを判定する閾値
+    RGYQueueSPSP<int64_t, 1> m_ptsIndex; //ptsの確定したフレームのpts (m_listと同じ並び、findptsの二分探索用)
+    RGYQueueSPSP<int, 1> m_ptsIndexBreak; //m_ptsIndexでptsが昇順でなくなる位置 (m_ptsIndexPoppedを含めた通し番号)
+    std::atomic<int> m_ptsIndexPopped; //m_ptsIndexの先頭から取り除いた数
+    int64_t m_ptsIndexLastPts; //m_ptsIndexに最後に追加したpts
     unique_ptr<FILE, fp_deleter> m_fpDebugCopyFrameData; //copyのデバッグ用
 };
 
@@ -732,6 +826,7 @@ typedef struct AVDemuxThread {
     int                          threadInput;        //入力スレッドを使用する
     std::atomic<bool>            bAbortInput;        //読み込みスレッドに停止を通知する
     std::thread                  thInput;            //読み込みスレッド
+    RGYPerfThreadId              thInputId;          //読み込みスレッドのID (スレッド自身が記録する)
     PerfQueueInfo               *queueInfo;          //キューの情報を格納する構造体
 } AVDemuxThread;
 
@@ -951,7 +1046,6 @@ public:
     tstring        logFramePosList;         //FramePosListの内容を入力終了時に出力する (デバッグ用)
     tstring        logCopyFrameData;        //frame情報copy関数のログ出力先 (デバッグ用)
     int            threadInput;             //入力スレッドを有効にする
-    PerfQueueInfo *queueInfo;               //キューの情報を格納する構造体
     DeviceCodecCsp *HWDecCodecCsp;          //HWデコーダのサポートするコーデックと色空間
     bool           videoDetectPulldown;     //pulldownの検出を試みるかどうか
     C2AFormat      caption2ass;             //caption2assの処理の有効化
@@ -961,6 +1055,8 @@ public:
     RGYListRef<RGYFrameDataQP> *qpTableListRef; //qp tableを格納するときのベース構造体
     bool           lowLatency;
     RGYOptList     inputOpt;                //入力オプション
+    bool           useIndex;                //フレームインデックスを使用する
+    tstring        indexFile;               //フレームインデックスのパス (空ならデフォルトのパス)
 
     RGYInputAvcodecPrm(RGYInputPrm base);
     virtual ~RGYInputAvcodecPrm() {};
@@ -1027,6 +1123,8 @@ public:
 
     //入力スレッドのハンドルを取得する
     HANDLE getThreadHandleInput();
+    //入力スレッドのIDを取得する (スレッドがなければ0)
+    uint32_t getThreadIdInput();
 
     //出力する動画の情報をセット
     void setOutputVideoInfo(int w, int h, int sar_x, int sar_y, bool mux);
@@ -1104,6 +1202,20 @@ protected:
     //VC-1のフレームヘッダを追加
     void vc1AddFrameHeader(AVPacket *pkt);
 
+    //フレームインデックスを開き、書き出しの準備をする
+    void openFrameIndex(const TCHAR *strFileName, const RGYInputAvcodecPrm *input_prm);
+
+    //フレームインデックスを使って、--seek/--trimの開始位置の近くのキーフレームへシークする
+    //firstPtsは--seekの基準となる先頭のパケットのpts (通常のシークと同じ値を渡すこと)
+    RGY_ERR seekByFrameIndex(const RGYInputAvcodecPrm *input_prm, int64_t firstPts, bool *seeked);
+
+    //最初のキーフレームの確定後に、フレームインデックスでシークした結果の確認とtrimの補正、
+    //書き出し用のヘッダ情報の記録を行う
+    RGY_ERR checkFrameIndexFirstKeyframe();
+
+    //読み込んだフレーム情報をフレームインデックスに書き出す
+    void writeFrameIndex();
+
     void CloseStream(AVDemuxStream *audio);
     void CloseVideo(AVDemuxVideo *video);
     void CloseFormat(AVDemuxFormat *format);
@@ -1113,6 +1225,16 @@ protected:
     tstring          m_logFramePosList;           //FramePosListの内容を入力終了時に出力する (デバッグ用)
     vector<uint8_t>  m_hevcMp42AnnexbBuffer;       //HEVCのmp4->AnnexB簡易変換用バッファ
     AVCaption2Ass    m_cap2ass;
+    unique_ptr<RGYInputAvcodecIndex> m_index;     //読み込んだフレームインデックス
+    tstring          m_indexFile;                 //フレームインデックスのパス
+    tstring          m_indexSrcFile;              //フレームインデックスに対応する入力ファイル
+    RGYAVIndexKeyframe m_indexSeekKey;            //フレームインデックスでシークした先のキーフレーム (poc < 0ならtrim補正なし)
+    bool             m_indexSeeked;               //フレームインデックスでシークしたか
+    bool             m_indexRecord;               //フレームインデックスの書き出し用に情報を記録するか
+    bool             m_indexReachedEof;           //ファイルの最後まで読み込んだか
+    int              m_indexDecodeFrames;         //最初のキーフレーム以降にframesに追加したフレーム数
+    RGYAVIndexHeader m_indexHeader;               //書き出すフレームインデックスのヘッダ
+    vector<RGYAVIndexKeyframe> m_indexKeyframes;  //書き出し用に記録したキーフレーム
 };
 
 #endif //ENABLE_AVSW_READER
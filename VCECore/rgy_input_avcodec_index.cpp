@@ -0,0 +1,247 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include <unordered_map>
+#include "rgy_input_avcodec_index.h"
+#include "rgy_osdep.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <sys/stat.h>
+#endif
+
+RGYInputAvcodecIndex::RGYInputAvcodecIndex() :
+    m_fp(nullptr),
+    m_mappedFile(),
+    m_header(nullptr),
+    m_frames(nullptr),
+    m_keyframes(nullptr) {
+}
+
+RGYInputAvcodecIndex::~RGYInputAvcodecIndex() {
+    close();
+}
+
+tstring RGYInputAvcodecIndex::defaultPath(const TCHAR *srcFile) {
+    return tstring(srcFile) + RGY_AVINDEX_EXT;
+}
+
+bool RGYInputAvcodecIndex::getSrcFileStat(const TCHAR *srcFile, uint64_t *fileSize, uint64_t *fileTime) {
+#if defined(_WIN32) || defined(_WIN64)
+    WIN32_FILE_ATTRIBUTE_DATA fd = { 0 };
+    if (!GetFileAttributesEx(srcFile, GetFileExInfoStandard, &fd)) {
+        return false;
+    }
+    *fileSize = (((uint64_t)fd.nFileSizeHigh) << 32) + (uint64_t)fd.nFileSizeLow;
+    *fileTime = (((uint64_t)fd.ftLastWriteTime.dwHighDateTime) << 32) + (uint64_t)fd.ftLastWriteTime.dwLowDateTime;
+#else
+    struct stat st;
+    if (stat(srcFile, &st) != 0 || !S_ISREG(st.st_mode)) {
+        return false;
+    }
+    *fileSize = (uint64_t)st.st_size;
+    *fileTime = (uint64_t)st.st_mtime;
+#endif
+    return true;
+}
+
+RGY_ERR RGYInputAvcodecIndex::open(const TCHAR *indexFile, const TCHAR *srcFile, int videoStreamIndex, int timebaseNum, int timebaseDen) {
+    close();
+    uint64_t srcFileSize = 0, srcFileTime = 0;
+    if (!getSrcFileStat(srcFile, &srcFileSize, &srcFileTime)) {
+        return RGY_ERR_UNSUPPORTED;
+    }
+    if (_tfopen_s(&m_fp, indexFile, _T("rb")) || m_fp == nullptr) {
+        m_fp = nullptr;
+        return RGY_ERR_NOT_FOUND;
+    }
+    m_mappedFile = std::unique_ptr<RGYMappedFile>(new RGYMappedFile());
+    auto err = m_mappedFile->open(m_fp, 0);
+    if (err != RGY_ERR_NONE) {
+        close();
+        return err;
+    }
+    const auto indexSize = m_mappedFile->size();
+    if (indexSize < sizeof(RGYAVIndexHeader)) {
+        close();
+        return RGY_ERR_INVALID_FORMAT;
+    }
+    const uint8_t *ptr = m_mappedFile->map(0, (size_t)indexSize);
+    if (ptr == nullptr) {
+        close();
+        return RGY_ERR_NULL_PTR;
+    }
+    const auto header = (const RGYAVIndexHeader *)ptr;
+    if (memcmp(header->magic, RGY_AVINDEX_MAGIC, sizeof(RGY_AVINDEX_MAGIC)) != 0
+        || header->frameCount < 0
+        || header->keyframeCount < 0
+        || header->frameTableOffset + (uint64_t)header->frameCount * sizeof(RGYAVIndexFrame) > indexSize
+        || header->keyframeTableOffset + (uint64_t)header->keyframeCount * sizeof(RGYAVIndexKeyframe) > indexSize) {
+        close();
+        return RGY_ERR_INVALID_FORMAT;
+    }
+    //入力ファイルが更新されていたり、別のストリームのインデックスだったりする場合は使用しない
+    if (header->version != RGY_AVINDEX_VERSION
+        || header->headerSize != sizeof(RGYAVIndexHeader)
+        || header->srcFileSize != srcFileSize
+        || header->srcFileTime != srcFileTime
+        || header->videoStreamIndex != videoStreamIndex
+        || header->timebaseNum != timebaseNum
+        || header->timebaseDen != timebaseDen) {
+        close();
+        return RGY_ERR_INVALID_VERSION;
+    }
+    m_header = header;
+    m_frames = (const RGYAVIndexFrame *)(ptr + header->frameTableOffset);
+    m_keyframes = (const RGYAVIndexKeyframe *)(ptr + header->keyframeTableOffset);
+    return RGY_ERR_NONE;
+}
+
+void RGYInputAvcodecIndex::close() {
+    m_header = nullptr;
+    m_frames = nullptr;
+    m_keyframes = nullptr;
+    m_mappedFile.reset();
+    if (m_fp) {
+        fclose(m_fp);
+        m_fp = nullptr;
+    }
+}
+
+const RGYAVIndexFrame *RGYInputAvcodecIndex::frame(int idx) const {
+    return (0 <= idx && idx < frameCount()) ? &m_frames[idx] : nullptr;
+}
+
+const RGYAVIndexKeyframe *RGYInputAvcodecIndex::keyframe(int idx) const {
+    return (0 <= idx && idx < keyframeCount()) ? &m_keyframes[idx] : nullptr;
+}
+
+const RGYAVIndexKeyframe *RGYInputAvcodecIndex::findKeyframeByPts(int64_t pts) const {
+    const auto fin = m_keyframes + keyframeCount();
+    const auto it = std::upper_bound(m_keyframes, fin, pts, [](const int64_t value, const RGYAVIndexKeyframe& key) { return value < key.pts; });
+    return (it == m_keyframes) ? nullptr : it - 1;
+}
+
+const RGYAVIndexKeyframe *RGYInputAvcodecIndex::findKeyframeAtOrAfterPts(int64_t pts) const {
+    const auto fin = m_keyframes + keyframeCount();
+    const auto it = std::lower_bound(m_keyframes, fin, pts, [](const RGYAVIndexKeyframe& key, const int64_t value) { return key.pts < value; });
+    return (it == fin) ? nullptr : it;
+}
+
+const RGYAVIndexKeyframe *RGYInputAvcodecIndex::findCleanKeyframeByPoc(int poc) const {
+    //キーフレームはptsの昇順に並んでいるので、(有効な)pocも昇順に並んでいる
+    const auto fin = m_keyframes + keyframeCount();
+    auto it = std::upper_bound(m_keyframes, fin, poc, [](const int value, const RGYAVIndexKeyframe& key) { return key.poc >= 0 && value < key.poc; });
+    while (it != m_keyframes) {
+        it--;
+        if ((it->flags & RGY_AVINDEX_KEYFRAME_CLEAN) && it->poc >= 0 && it->poc <= poc) {
+            return it;
+        }
+    }
+    return nullptr;
+}
+
+const RGYAVIndexKeyframe *RGYInputAvcodecIndex::findKeyframeExact(int64_t pts) const {
+    const auto key = findKeyframeByPts(pts);
+    return (key && key->pts == pts) ? key : nullptr;
+}
+
+RGY_ERR RGYInputAvcodecIndex::write(const TCHAR *indexFile, const TCHAR *srcFile, RGYAVIndexHeader header,
+    const std::vector<RGYAVIndexFrame>& frames, std::vector<RGYAVIndexKeyframe> keyframes, int droppedFrames) {
+    if (!getSrcFileStat(srcFile, &header.srcFileSize, &header.srcFileTime)) {
+        return RGY_ERR_UNSUPPORTED;
+    }
+    //表示順のフレームリストから、キーフレームのpocを決定する
+    //キーフレームより前にデコードされたフレームの数と、キーフレームより前に表示されるフレームの数が一致すれば、
+    //そのキーフレーム以降のフレームがキーフレームより前に表示されることはない (closed gop)
+    std::unordered_map<int64_t, size_t> keyframeIdx;
+    for (size_t i = 0; i < keyframes.size(); i++) {
+        keyframes[i].poc = -1;
+        keyframes[i].flags = 0;
+        keyframeIdx.emplace(keyframes[i].pts, i);
+    }
+    for (int i = 0; i < (int)frames.size(); i++) {
+        auto it = keyframeIdx.find(frames[i].pts);
+        if (it == keyframeIdx.end()) {
+            continue;
+        }
+        auto& key = keyframes[it->second];
+        key.poc = frames[i].poc;
+        const int expectedIdx = key.decodeIdx - ((key.decodeIdx > 0) ? droppedFrames : 0);
+        if (key.poc >= 0 && i == expectedIdx) {
+            key.flags |= RGY_AVINDEX_KEYFRAME_CLEAN;
+        }
+        keyframeIdx.erase(it);
+    }
+    std::sort(keyframes.begin(), keyframes.end(), [](const RGYAVIndexKeyframe& a, const RGYAVIndexKeyframe& b) { return a.pts < b.pts; });
+
+    header.version = RGY_AVINDEX_VERSION;
+    header.headerSize = sizeof(RGYAVIndexHeader);
+    header.frameCount = (int32_t)frames.size();
+    header.keyframeCount = (int32_t)keyframes.size();
+    header.frameTableOffset = sizeof(RGYAVIndexHeader);
+    header.keyframeTableOffset = header.frameTableOffset + frames.size() * sizeof(RGYAVIndexFrame);
+
+    //一時ファイルに書き出してから置き換え、書き込み途中で中断されても既存のインデックスを壊さないようにする
+    const tstring tmpFile = tstring(indexFile) + _T(".tmp");
+    FILE *fp = nullptr;
+    if (_tfopen_s(&fp, tmpFile.c_str(), _T("wb")) || fp == nullptr) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    //途中で書き込みに失敗した場合に有効なインデックスとして扱われないよう、
+    //magicは最後に書き込む
+    RGYAVIndexHeader headerTmp = header;
+    memset(headerTmp.magic, 0, sizeof(headerTmp.magic));
+    bool ret = fwrite(&headerTmp, sizeof(headerTmp), 1, fp) == 1;
+    if (ret && frames.size() > 0) {
+        ret = fwrite(frames.data(), sizeof(frames[0]), frames.size(), fp) == frames.size();
+    }
+    if (ret && keyframes.size() > 0) {
+        ret = fwrite(keyframes.data(), sizeof(keyframes[0]), keyframes.size(), fp) == keyframes.size();
+    }
+    if (ret) {
+        memcpy(header.magic, RGY_AVINDEX_MAGIC, sizeof(header.magic));
+        ret = fflush(fp) == 0
+            && _fseeki64(fp, 0, SEEK_SET) == 0
+            && fwrite(&header, sizeof(header), 1, fp) == 1;
+    }
+    ret = fflush(fp) == 0 && ret;
+    ret = (fclose(fp) == 0) && ret;
+    if (!ret) {
+        _tremove(tmpFile.c_str());
+        return RGY_ERR_UNKNOWN;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    const bool renamed = MoveFileEx(tmpFile.c_str(), indexFile, MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool renamed = _trename(tmpFile.c_str(), indexFile) == 0;
+#endif //#if defined(_WIN32) || defined(_WIN64)
+    if (!renamed) {
+        _tremove(tmpFile.c_str());
+        return RGY_ERR_UNKNOWN;
+    }
+    return RGY_ERR_NONE;
+}
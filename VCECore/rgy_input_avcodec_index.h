@@ -0,0 +1,153 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_INPUT_AVCODEC_INDEX_H__
+#define __RGY_INPUT_AVCODEC_INDEX_H__
+
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+#include <memory>
+#include "rgy_tchar.h"
+#include "rgy_def.h"
+#include "rgy_err.h"
+#include "rgy_mapped_file.h"
+
+//avcodecリーダーのフレームインデックス (サイドカーファイル)
+//初回の読み込み時に全フレームのpts/dts/poc等とキーフレームの位置を記録しておき、
+//2回目以降は--seek/--trimの開始位置近くのキーフレームへ直接シークし、fps推定のための先読みを省略する
+//
+//ファイル構造 (すべてリトルエンディアン)
+//  RGYAVIndexHeader
+//  RGYAVIndexFrame    x frameCount    (表示順)
+//  RGYAVIndexKeyframe x keyframeCount (ptsの昇順)
+
+static const char RGY_AVINDEX_MAGIC[8] = { 'R', 'G', 'Y', 'A', 'V', 'I', 'D', 'X' };
+static const uint32_t RGY_AVINDEX_VERSION = 1;
+static const TCHAR *RGY_AVINDEX_EXT = _T(".rgyidx");
+
+//キーフレームのフラグ
+enum : uint32_t {
+    RGY_AVINDEX_KEYFRAME_CLEAN = 0x01, //そのキーフレームからデコードを開始しても、以降のフレームの表示順が変わらない (closed gop)
+};
+
+struct RGYAVIndexHeader {
+    char     magic[8];            //RGY_AVINDEX_MAGIC
+    uint32_t version;             //RGY_AVINDEX_VERSION
+    uint32_t headerSize;          //sizeof(RGYAVIndexHeader)
+    uint64_t srcFileSize;         //入力ファイルのサイズ
+    uint64_t srcFileTime;         //入力ファイルの更新日時
+    int32_t  videoStreamIndex;    //映像のストリーム番号
+    int32_t  timebaseNum;         //映像のtimebase
+    int32_t  timebaseDen;
+    int32_t  fpsNum;              //getFirstFramePosAndFrameRateで推定したfps
+    int32_t  fpsDen;
+    int32_t  ptsInvalid;          //streamPtsInvalid (RGY_PTS_xxx)
+    int32_t  trimOffset;          //最初のキーフレームまでにスキップしたフレーム数
+    uint32_t complete;            //ファイルの最後まで記録されているか (trimで途中で読み込みを打ち切った場合は0)
+    int64_t  firstKeyPts;         //最初のキーフレームのpts
+    int64_t  formatDuration;      //入力ファイルの長さ (AV_TIME_BASE)
+    int64_t  videoDuration;       //映像の長さ (映像のtimebase)
+    int32_t  frameCount;          //RGYAVIndexFrameの数
+    int32_t  keyframeCount;       //RGYAVIndexKeyframeの数
+    uint64_t frameTableOffset;    //RGYAVIndexFrameの先頭のファイル上の位置
+    uint64_t keyframeTableOffset; //RGYAVIndexKeyframeの先頭のファイル上の位置
+};
+
+//FramePosと同じ内容
+struct RGYAVIndexFrame {
+    int64_t pts;
+    int64_t dts;
+    int32_t duration;
+    int32_t duration2;
+    int32_t poc;
+    uint8_t flags;
+    uint8_t pic_struct;
+    uint8_t repeat_pict;
+    uint8_t pict_type;
+};
+
+struct RGYAVIndexKeyframe {
+    int64_t  pts;       //キーフレームのpts
+    int64_t  pos;       //キーフレームのパケットのファイル上の位置 (不明なら-1)
+    int32_t  decodeIdx; //最初のキーフレームからのデコード順の番号
+    int32_t  poc;       //最初のキーフレームからの表示順の番号 (不明ならFRAMEPOS_POC_INVALID)
+    uint32_t flags;     //RGY_AVINDEX_KEYFRAME_xxx
+    uint32_t reserved;
+};
+
+static_assert(sizeof(RGYAVIndexFrame) == 32, "sizeof(RGYAVIndexFrame) != 32");
+static_assert(sizeof(RGYAVIndexKeyframe) == 32, "sizeof(RGYAVIndexKeyframe) != 32");
+
+class RGYInputAvcodecIndex {
+public:
+    RGYInputAvcodecIndex();
+    ~RGYInputAvcodecIndex();
+
+    //入力ファイルに対応するインデックスファイルのデフォルトのパス
+    static tstring defaultPath(const TCHAR *srcFile);
+
+    //インデックスファイルを開き、入力ファイル・映像ストリームに対応するものか確認する
+    //存在しない場合はRGY_ERR_NOT_FOUND、入力ファイルと一致しない場合はRGY_ERR_INVALID_VERSIONを返す
+    RGY_ERR open(const TCHAR *indexFile, const TCHAR *srcFile, int videoStreamIndex, int timebaseNum, int timebaseDen);
+    void close();
+    bool is_open() const { return m_header != nullptr; }
+
+    const RGYAVIndexHeader *header() const { return m_header; }
+    int frameCount() const { return (m_header) ? m_header->frameCount : 0; }
+    int keyframeCount() const { return (m_header) ? m_header->keyframeCount : 0; }
+    const RGYAVIndexFrame *frame(int idx) const;
+    const RGYAVIndexKeyframe *keyframe(int idx) const;
+
+    //pts以下で最後のキーフレームを返す (なければnullptr)
+    const RGYAVIndexKeyframe *findKeyframeByPts(int64_t pts) const;
+    //pts以上で最初のキーフレームを返す (なければnullptr)
+    const RGYAVIndexKeyframe *findKeyframeAtOrAfterPts(int64_t pts) const;
+    //poc以下で最後のclosed gopのキーフレームを返す (なければnullptr)
+    const RGYAVIndexKeyframe *findCleanKeyframeByPoc(int poc) const;
+    //ptsが一致するキーフレームを返す (なければnullptr)
+    const RGYAVIndexKeyframe *findKeyframeExact(int64_t pts) const;
+
+    //インデックスファイルを書き出す
+    //headerのmagic/version/headerSize/srcFileSize/srcFileTime/テーブル情報はここで設定する
+    //keyframesはptsの昇順に並べなおし、frames(表示順)からpocとRGY_AVINDEX_KEYFRAME_CLEANを決定する
+    //droppedFrames: 最初のキーフレーム以降で、framesに含まれないフレームの数 (opengopの先頭のフレームなど)
+    static RGY_ERR write(const TCHAR *indexFile, const TCHAR *srcFile, RGYAVIndexHeader header,
+        const std::vector<RGYAVIndexFrame>& frames, std::vector<RGYAVIndexKeyframe> keyframes, int droppedFrames);
+
+    //入力ファイルのサイズと更新日時を取得する
+    static bool getSrcFileStat(const TCHAR *srcFile, uint64_t *fileSize, uint64_t *fileTime);
+protected:
+    FILE *m_fp;
+    std::unique_ptr<RGYMappedFile> m_mappedFile;
+    const RGYAVIndexHeader *m_header;
+    const RGYAVIndexFrame *m_frames;
+    const RGYAVIndexKeyframe *m_keyframes;
+};
+
+#endif //__RGY_INPUT_AVCODEC_INDEX_H__
@@ -31,6 +31,7 @@
 #pragma warning(disable:4838)
 #pragma warning(disable:4201)
 #include "Aviriff.h"
+#include <objbase.h>
 
 static const auto FOURCC_CSP = make_array<std::pair<uint32_t, RGY_CSP>>(
     std::make_pair(FCC('YUY2'), RGY_CSP_YUY2),
@@ -47,7 +48,16 @@ RGYInputAvi::RGYInputAvi() :
     m_pBitmapInfoHeader(nullptr),
     m_nYPitchMultiplizer(1),
     m_nBufSize(0),
-    m_pBuffer() {
+    m_pBuffer(),
+    m_fileName(),
+    m_streamIndex(-1),
+    m_useGetFrame(false),
+    m_getFrameFormat(),
+    m_pGetFrameFormat(nullptr),
+    m_readAheadHandle(),
+    m_readAhead() {
+    memset(&m_getFrameFormat, 0, sizeof(m_getFrameFormat));
+    memset(&m_readAheadHandle, 0, sizeof(m_readAheadHandle));
     m_readerName = _T("avi");
 }
 
@@ -67,6 +77,7 @@ RGY_ERR RGYInputAvi::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
         return RGY_ERR_FILE_OPEN;
     }
     AddMessage(RGY_LOG_DEBUG, _T("openend avi file: \"%s\"\n"), strFileName);
+    m_fileName = strFileName;
 
     AVIFILEINFO finfo = { 0 };
     if (0 != AVIFileInfo(m_pAviFile, &finfo, sizeof(AVIFILEINFO))) {
@@ -92,6 +103,7 @@ RGY_ERR RGYInputAvi::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
             char temp[5] = { 0 };
             memcpy(temp, &sinfo.fccHandler, sizeof(sinfo.fccHandler));
             strFcc = char_to_tstring(temp);
+            m_streamIndex = (int)i_stream;
             break;
         }
         AVIStreamRelease(m_pAviStream);
@@ -117,6 +129,8 @@ RGY_ERR RGYInputAvi::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
             if (NULL == (m_pGetFrame = AVIStreamGetFrameOpen(m_pAviStream, &bih[i]))) {
                 continue;
             }
+            m_getFrameFormat = bih[i];
+            m_pGetFrameFormat = &m_getFrameFormat;
             if (bih[i].biCompression == BI_RGB) {
                 m_inputCsp = (bih[i].biBitCount == 24) ? RGY_CSP_RGB24R : RGY_CSP_RGB32R;
             } else {
@@ -130,10 +144,13 @@ RGY_ERR RGYInputAvi::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
         }
 
         if (m_pGetFrame == nullptr) {
-            if (   nullptr == (m_pGetFrame = AVIStreamGetFrameOpen(m_pAviStream, NULL))
-                && nullptr == (m_pGetFrame = AVIStreamGetFrameOpen(m_pAviStream, (BITMAPINFOHEADER *)AVIGETFRAMEF_BESTDISPLAYFMT))) {
-                AddMessage(RGY_LOG_ERROR, _T("\nfailed to decode avi file.\n"));
-                return RGY_ERR_INVALID_HANDLE;
+            m_pGetFrameFormat = NULL;
+            if (nullptr == (m_pGetFrame = AVIStreamGetFrameOpen(m_pAviStream, m_pGetFrameFormat))) {
+                m_pGetFrameFormat = (BITMAPINFOHEADER *)AVIGETFRAMEF_BESTDISPLAYFMT;
+                if (nullptr == (m_pGetFrame = AVIStreamGetFrameOpen(m_pAviStream, m_pGetFrameFormat))) {
+                    AddMessage(RGY_LOG_ERROR, _T("\nfailed to decode avi file.\n"));
+                    return RGY_ERR_INVALID_HANDLE;
+                }
             }
             BITMAPINFOHEADER *bmpInfoHeader = (BITMAPINFOHEADER *)AVIStreamGetFrame(m_pGetFrame, 0);
             if (NULL == bmpInfoHeader || bmpInfoHeader->biCompression != 0) {
@@ -167,12 +184,28 @@ RGY_ERR RGYInputAvi::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
     }
     CreateInputInfo(tstring(_T("avi: ") + strFcc).c_str(), RGY_CSP_NAMES[m_convert->getFunc()->csp_from], RGY_CSP_NAMES[m_convert->getFunc()->csp_to], get_simd_str(m_convert->getFunc()->simd), &m_inputVideoInfo);
     AddMessage(RGY_LOG_DEBUG, m_inputInfo);
+    m_useGetFrame = m_pGetFrame != nullptr;
+    if (prm->readAhead > 0) {
+        //先読みスレッドでは、そのスレッドでCoInitialize/AVIFileInitを行い、ファイルを開きなおして読み込む
+        m_readAhead = std::make_unique<RGYInputReadAhead>();
+        auto err = m_readAhead->init(prm->readAhead, m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 4,
+            [this](int frameIdx, uint8_t *buf, uint32_t bufSize) { return ReadAheadFrame(frameIdx, buf, bufSize); },
+            (prm->queueInfo) ? &prm->queueInfo->usage_vid_in : nullptr,
+            [this]() { return OpenReadAheadHandle(); },
+            [this]() { CloseReadAheadHandle(); });
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("Failed to start read ahead thread: %s.\n"), get_err_mes(err));
+            return err;
+        }
+        AddMessage(RGY_LOG_DEBUG, _T("started read ahead thread: %d frames.\n"), prm->readAhead);
+    }
     *pInputInfo = m_inputVideoInfo;
     return RGY_ERR_NONE;
 }
 
 void RGYInputAvi::Close() {
     AddMessage(RGY_LOG_DEBUG, _T("Closing...\n"));
+    m_readAhead.reset(); //先読みスレッドは自分で開いたハンドルを閉じてから終了する
     if (m_pGetFrame) {
         AVIStreamGetFrameClose(m_pGetFrame);
     }
@@ -191,11 +224,74 @@ void RGYInputAvi::Close() {
     m_nYPitchMultiplizer = 1;
     m_nBufSize = 0;
     m_pBuffer.reset();
+    m_fileName.clear();
+    m_streamIndex = -1;
+    m_useGetFrame = false;
+    m_pGetFrameFormat = nullptr;
 
     AddMessage(RGY_LOG_DEBUG, _T("Closed.\n"));
     m_encSatusInfo.reset();
 }
 
+RGY_ERR RGYInputAvi::OpenReadAheadHandle() {
+    auto& handle = m_readAheadHandle;
+    handle.comInit = SUCCEEDED(CoInitialize(nullptr));
+    AVIFileInit();
+    if (0 != AVIFileOpen(&handle.aviFile, m_fileName.c_str(), OF_READ | OF_SHARE_DENY_NONE, NULL)) {
+        return RGY_ERR_FILE_OPEN;
+    }
+    if (0 != AVIFileGetStream(handle.aviFile, &handle.aviStream, 0, m_streamIndex)) {
+        return RGY_ERR_INVALID_HANDLE;
+    }
+    if (m_useGetFrame
+        && nullptr == (handle.getFrame = AVIStreamGetFrameOpen(handle.aviStream, m_pGetFrameFormat))) {
+        return RGY_ERR_INVALID_HANDLE;
+    }
+    return RGY_ERR_NONE;
+}
+
+void RGYInputAvi::CloseReadAheadHandle() {
+    auto& handle = m_readAheadHandle;
+    if (handle.getFrame) {
+        AVIStreamGetFrameClose(handle.getFrame);
+    }
+    if (handle.aviStream) {
+        AVIStreamRelease(handle.aviStream);
+    }
+    if (handle.aviFile) {
+        AVIFileRelease(handle.aviFile);
+    }
+    AVIFileExit();
+    if (handle.comInit) {
+        CoUninitialize();
+    }
+    memset(&handle, 0, sizeof(handle));
+}
+
+RGY_ERR RGYInputAvi::ReadAheadFrame(int frameIdx, uint8_t *buf, uint32_t bufSize) {
+    if (frameIdx >= m_inputVideoInfo.frames) {
+        return RGY_ERR_MORE_DATA;
+    }
+    const auto& handle = m_readAheadHandle;
+    if (handle.getFrame) {
+        const uint8_t *ptr = (const uint8_t *)AVIStreamGetFrame(handle.getFrame, frameIdx);
+        if (ptr == nullptr) {
+            return RGY_ERR_MORE_DATA;
+        }
+        //AVIStreamGetFrameの返すバッファは次の呼び出しで上書きされるので、コピーしておく
+        const uint32_t frameSize = (m_inputCsp == RGY_CSP_YV12)
+            ? m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 3 / 2
+            : m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * m_nYPitchMultiplizer;
+        memcpy(buf, ptr + sizeof(BITMAPINFOHEADER), (std::min)(frameSize, bufSize));
+    } else {
+        LONG sizeRead = 0;
+        if (0 != AVIStreamRead(handle.aviStream, frameIdx, 1, buf, (LONG)bufSize, &sizeRead, NULL)) {
+            return RGY_ERR_MORE_DATA;
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
 RGY_ERR RGYInputAvi::LoadNextFrame(RGYFrame *pSurface) {
     if ((int)m_encSatusInfo->m_sData.frameIn >= m_inputVideoInfo.frames
         //m_encSatusInfo->m_nInputFramesがtrimの結果必要なフレーム数を大きく超えたら、エンコードを打ち切る
@@ -204,8 +300,13 @@ RGY_ERR RGYInputAvi::LoadNextFrame(RGYFrame *pSurface) {
         return RGY_ERR_MORE_DATA;
     }
 
-    uint8_t *ptr_src = nullptr;
-    if (m_pGetFrame) {
+    const uint8_t *ptr_src = nullptr;
+    if (m_readAhead) {
+        auto err = m_readAhead->get(m_encSatusInfo->m_sData.frameIn, &ptr_src);
+        if (err != RGY_ERR_NONE) {
+            return err;
+        }
+    } else if (m_pGetFrame) {
         if (nullptr == (ptr_src = (uint8_t *)AVIStreamGetFrame(m_pGetFrame, m_encSatusInfo->m_sData.frameIn))) {
             return RGY_ERR_MORE_DATA;
         }
@@ -234,6 +335,9 @@ RGY_ERR RGYInputAvi::LoadNextFrame(RGYFrame *pSurface) {
         dst_array, src_array,
         m_inputVideoInfo.srcWidth, m_inputVideoInfo.srcWidth * m_nYPitchMultiplizer, m_inputVideoInfo.srcWidth/2, pSurface->pitch(),
         m_inputVideoInfo.srcHeight, m_inputVideoInfo.srcHeight, m_inputVideoInfo.crop.c);
+    if (m_readAhead) {
+        m_readAhead->release();
+    }
 
     m_encSatusInfo->m_sData.frameIn++;
     // display update
@@ -37,6 +37,7 @@
 #include <vfw.h>
 #pragma comment(lib, "vfw32.lib")
 #include "rgy_input.h"
+#include "rgy_input_read_ahead.h"
 
 class RGYInputAvi : public RGYInput
 {
@@ -48,6 +49,19 @@ public:
 protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const RGYInputPrm *prm) override;
 
+    //先読みスレッドで使用するVfWのハンドル
+    //VfWはCoInitialize/AVIFileInitを行ったスレッドから使用する必要があるため、先読みスレッド上で別に開く
+    struct ReadAheadHandle {
+        PAVIFILE aviFile;
+        PAVISTREAM aviStream;
+        PGETFRAME getFrame;
+        bool comInit;
+    };
+    //以下の3つは先読みスレッドから呼ばれる
+    RGY_ERR OpenReadAheadHandle();
+    void CloseReadAheadHandle();
+    RGY_ERR ReadAheadFrame(int frameIdx, uint8_t *buf, uint32_t bufSize);
+
     PAVIFILE m_pAviFile;
     PAVISTREAM m_pAviStream;
     PGETFRAME m_pGetFrame;
@@ -56,6 +70,14 @@ protected:
 
     uint32_t m_nBufSize;
     shared_ptr<uint8_t> m_pBuffer;
+
+    tstring m_fileName;                     //入力ファイル名 (先読みスレッドで開きなおすため)
+    int m_streamIndex;                      //映像のストリーム番号
+    bool m_useGetFrame;                     //AVIStreamGetFrameでデコードするか (falseならAVIStreamReadで読み込む)
+    BITMAPINFOHEADER m_getFrameFormat;      //AVIStreamGetFrameOpenに指定した出力形式
+    LPBITMAPINFOHEADER m_pGetFrameFormat;   //AVIStreamGetFrameOpenに渡した値 (&m_getFrameFormat, NULL, AVIGETFRAMEF_BESTDISPLAYFMT)
+    ReadAheadHandle m_readAheadHandle;      //先読みスレッドのVfWのハンドル (先読みスレッドからのみ使用する)
+    unique_ptr<RGYInputReadAhead> m_readAhead; //別スレッドでの先読み
 };
 
 #endif //ENABLE_AVI_READER
@@ -28,9 +28,16 @@
 #include <sstream>
 #include <fcntl.h>
 #include "rgy_input_raw.h"
+#include "rgy_perf_monitor.h"
 
 #if ENABLE_RAW_READER
 
+//色変換のSIMD関数が行末を超えて読み込む可能性のあるサイズ
+//マッピングの末尾でこれが確保できない場合は、バッファにコピーしてから変換する
+static const int RAW_MAPPED_OVERREAD = 64;
+//y4mのFRAMEヘッダの最大長
+static const int Y4M_FRAME_HEADER_MAX = 64;
+
 RGY_ERR RGYInputRaw::ParseY4MHeader(char *buf, VideoInfo *pInfo) {
     char *p, *q = nullptr;
 
@@ -152,7 +159,12 @@ RGY_ERR RGYInputRaw::ParseY4MHeader(char *buf, VideoInfo *pInfo) {
 RGYInputRaw::RGYInputRaw() :
     m_fSource(NULL),
     m_nBufSize(0),
-    m_pBuffer() {
+    m_pBuffer(),
+    m_mappedFile(),
+    m_y4mDataOffset(0),
+    m_frameOffsets(),
+    m_readAhead(),
+    m_readAheadFrames(0) {
     m_readerName = _T("raw");
 }
 
@@ -161,6 +173,10 @@ RGYInputRaw::~RGYInputRaw() {
 }
 
 void RGYInputRaw::Close() {
+    m_readAhead.reset(); //m_fSourceを閉じる前に先読みスレッドを止める
+    m_mappedFile.reset();
+    m_frameOffsets.clear();
+    m_y4mDataOffset = 0;
     if (m_fSource) {
         fclose(m_fSource);
         m_fSource = NULL;
@@ -295,6 +311,47 @@ RGY_ERR RGYInputRaw::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
         return RGY_ERR_NULL_PTR;
     }
 
+    m_nBufSize = bufferSize;
+
+    if (!use_stdin) {
+        if (m_inputVideoInfo.type == RGY_INPUT_FMT_Y4M) {
+            m_y4mDataOffset = _ftelli64(m_fSource);
+        }
+        //ファイルをマッピングし、読み込んだデータをコピーせずに直接色変換に渡す
+        //32bitではアドレス空間が足りないので、一部ずつマッピングする
+        const uint64_t windowSize = (sizeof(void *) >= 8) ? 0 : std::max<uint64_t>(64 * 1024 * 1024, (uint64_t)bufferSize * 8);
+        m_mappedFile = std::make_unique<RGYMappedFile>();
+        if (m_mappedFile->open(m_fSource, windowSize) != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_DEBUG, _T("failed to map file, fallback to fread.\n"));
+            m_mappedFile.reset();
+        } else {
+            if (m_inputVideoInfo.type == RGY_INPUT_FMT_Y4M) {
+                ScanY4MFrameIndex(m_y4mDataOffset);
+                m_inputVideoInfo.frames = (int)m_frameOffsets.size();
+            } else {
+                m_inputVideoInfo.frames = (int)(m_mappedFile->size() / bufferSize);
+            }
+            AddMessage(RGY_LOG_DEBUG, _T("mapped file: size %lld, %d frames.\n"), (long long)m_mappedFile->size(), m_inputVideoInfo.frames);
+        }
+    }
+    //マッピングした場合は、OSに先読みを指示するフレーム数として使用する
+    m_readAheadFrames = prm->readAhead;
+    if (!m_mappedFile && m_readAheadFrames > 0) {
+        m_readAhead = std::make_unique<RGYInputReadAhead>();
+        auto err = m_readAhead->init(m_readAheadFrames, bufferSize,
+            [this](int frameIdx, uint8_t *buf, uint32_t bufSize) {
+                UNREFERENCED_PARAMETER(frameIdx);
+                UNREFERENCED_PARAMETER(bufSize);
+                return ReadFrame(buf);
+            },
+            (prm->queueInfo) ? &prm->queueInfo->usage_vid_in : nullptr);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("Failed to start read ahead thread: %s.\n"), get_err_mes(err));
+            return err;
+        }
+        AddMessage(RGY_LOG_DEBUG, _T("started read ahead thread: %d frames.\n"), m_readAheadFrames);
+    }
+
     m_inputVideoInfo.shift = ((m_inputVideoInfo.csp == RGY_CSP_P010 || m_inputVideoInfo.csp == RGY_CSP_P210) && m_inputVideoInfo.shift) ? m_inputVideoInfo.shift : 0;
 
     if (m_convert->getFunc(m_inputCsp, m_inputVideoInfo.csp, false, prm->simdCsp) == nullptr) {
@@ -309,13 +366,74 @@ RGY_ERR RGYInputRaw::Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const
     return RGY_ERR_NONE;
 }
 
-RGY_ERR RGYInputRaw::LoadNextFrame(RGYFrame *pSurface) {
-    //m_encSatusInfo->m_nInputFramesがtrimの結果必要なフレーム数を大きく超えたら、エンコードを打ち切る
-    //ちょうどのところで打ち切ると他のストリームに影響があるかもしれないので、余分に取得しておく
-    if (getVideoTrimMaxFramIdx() < (int)m_encSatusInfo->m_sData.frameIn - TRIM_OVERREAD_FRAMES) {
-        return RGY_ERR_MORE_DATA;
+void RGYInputRaw::ScanY4MFrameIndex(uint64_t pos) {
+    const uint64_t fileSize = m_mappedFile->size();
+    //インデックスを作るのにファイル全体を先読みさせないよう、一時的にランダムアクセスとする
+    m_mappedFile->setSequential(false);
+    const uint8_t *hdr = m_mappedFile->map(pos, (size_t)std::min<uint64_t>(Y4M_FRAME_HEADER_MAX, fileSize - std::min(pos, fileSize)));
+    const uint8_t *hdr_fin = (hdr) ? (const uint8_t *)memchr(hdr, '\n', (size_t)std::min<uint64_t>(Y4M_FRAME_HEADER_MAX, fileSize - pos)) : nullptr;
+    if (hdr_fin && memcmp(hdr, "FRAME", strlen("FRAME")) == 0) {
+        //通常、FRAMEヘッダは全フレームで同じ長さなので、ファイルサイズが合えば計算で求める
+        //(実際に同じ長さかはLoadNextFrameで確認する)
+        const uint64_t frameStride = (hdr_fin - hdr) + 1 + m_nBufSize;
+        if ((fileSize - pos) % frameStride == 0) {
+            const uint64_t frameCount = (fileSize - pos) / frameStride;
+            m_frameOffsets.reserve(m_frameOffsets.size() + (size_t)frameCount);
+            for (uint64_t i = 0; i < frameCount; i++) {
+                m_frameOffsets.push_back(pos + i * frameStride + (hdr_fin - hdr) + 1);
+            }
+            m_mappedFile->setSequential(true);
+            return;
+        }
     }
+    //FRAMEヘッダを順に探す
+    while (pos + strlen("FRAME") < fileSize) {
+        const size_t hdrSize = (size_t)std::min<uint64_t>(Y4M_FRAME_HEADER_MAX, fileSize - pos);
+        hdr = m_mappedFile->map(pos, hdrSize);
+        if (hdr == nullptr || memcmp(hdr, "FRAME", strlen("FRAME")) != 0) {
+            break;
+        }
+        hdr_fin = (const uint8_t *)memchr(hdr, '\n', hdrSize);
+        if (hdr_fin == nullptr) {
+            break;
+        }
+        const uint64_t offset = pos + (hdr_fin - hdr) + 1;
+        if (offset + m_nBufSize > fileSize) {
+            break;
+        }
+        m_frameOffsets.push_back(offset);
+        pos = offset + m_nBufSize;
+    }
+    m_mappedFile->setSequential(true);
+}
 
+bool RGYInputRaw::GetFrameOffset(int frameIdx, uint64_t *offset) {
+    if (m_inputVideoInfo.type != RGY_INPUT_FMT_Y4M) {
+        *offset = (uint64_t)frameIdx * m_nBufSize;
+        return *offset + m_nBufSize <= m_mappedFile->size();
+    }
+    if (frameIdx >= (int)m_frameOffsets.size()) {
+        return false;
+    }
+    //計算で求めた位置の直前にFRAMEヘッダがあるかを確認する
+    //なければ、その位置から実際にヘッダを探してインデックスを作り直す
+    const uint64_t hdrPos = (frameIdx > 0) ? m_frameOffsets[frameIdx-1] + m_nBufSize : m_y4mDataOffset;
+    const uint8_t *hdr = m_mappedFile->map(hdrPos, (size_t)(m_frameOffsets[frameIdx] - hdrPos));
+    if (hdr == nullptr
+        || memcmp(hdr, "FRAME", strlen("FRAME")) != 0
+        || hdr[m_frameOffsets[frameIdx] - hdrPos - 1] != '\n') {
+        AddMessage(RGY_LOG_DEBUG, _T("y4m frame header length changed at frame %d, rescan.\n"), frameIdx);
+        m_frameOffsets.resize(frameIdx);
+        ScanY4MFrameIndex(hdrPos);
+        if (frameIdx >= (int)m_frameOffsets.size()) {
+            return false;
+        }
+    }
+    *offset = m_frameOffsets[frameIdx];
+    return true;
+}
+
+RGY_ERR RGYInputRaw::ReadFrame(uint8_t *buf) {
     if (m_inputVideoInfo.type == RGY_INPUT_FMT_Y4M) {
         uint8_t y4m_buf[8] = { 0 };
         if (_fread_nolock(y4m_buf, 1, strlen("FRAME"), m_fSource) != strlen("FRAME")) {
@@ -328,56 +446,72 @@ RGY_ERR RGYInputRaw::LoadNextFrame(RGYFrame *pSurface) {
         }
         int i;
         for (i = 0; _fgetc_nolock(m_fSource) != '\n'; i++) {
-            if (i >= 64) {
+            if (i >= Y4M_FRAME_HEADER_MAX) {
                 AddMessage(RGY_LOG_DEBUG, _T("header3: finish.\n"));
                 return RGY_ERR_MORE_DATA;
             }
         }
     }
-
-    uint32_t frameSize = 0;
-    switch (m_convert->getFunc()->csp_from) {
-    case RGY_CSP_NV12:
-    case RGY_CSP_YV12:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 3 / 2; break;
-    case RGY_CSP_P010:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 3; break;
-    case RGY_CSP_YUV422:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 2; break;
-    case RGY_CSP_YUV444:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 3; break;
-    case RGY_CSP_YV12_09:
-    case RGY_CSP_YV12_10:
-    case RGY_CSP_YV12_12:
-    case RGY_CSP_YV12_14:
-    case RGY_CSP_YV12_16:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 3; break;
-    case RGY_CSP_YUV422_09:
-    case RGY_CSP_YUV422_10:
-    case RGY_CSP_YUV422_12:
-    case RGY_CSP_YUV422_14:
-    case RGY_CSP_YUV422_16:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 4; break;
-    case RGY_CSP_YUV444_09:
-    case RGY_CSP_YUV444_10:
-    case RGY_CSP_YUV444_12:
-    case RGY_CSP_YUV444_14:
-    case RGY_CSP_YUV444_16:
-        frameSize = m_inputVideoInfo.srcWidth * m_inputVideoInfo.srcHeight * 6; break;
-    default:
-        AddMessage(RGY_LOG_ERROR, _T("Unknown color foramt.\n"));
-        return RGY_ERR_INVALID_COLOR_FORMAT;
+    if (m_nBufSize != _fread_nolock(buf, 1, m_nBufSize, m_fSource)) {
+        AddMessage(RGY_LOG_DEBUG, _T("fread: finish: %d.\n"), m_nBufSize);
+        return RGY_ERR_MORE_DATA;
     }
-    if (frameSize != _fread_nolock(m_pBuffer.get(), 1, frameSize, m_fSource)) {
-        AddMessage(RGY_LOG_DEBUG, _T("fread: finish: %d.\n"), frameSize);
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYInputRaw::LoadNextFrame(RGYFrame *pSurface) {
+    //m_encSatusInfo->m_nInputFramesがtrimの結果必要なフレーム数を大きく超えたら、エンコードを打ち切る
+    //ちょうどのところで打ち切ると他のストリームに影響があるかもしれないので、余分に取得しておく
+    if (getVideoTrimMaxFramIdx() < (int)m_encSatusInfo->m_sData.frameIn - TRIM_OVERREAD_FRAMES) {
         return RGY_ERR_MORE_DATA;
     }
 
+    const int frameIdx = (int)m_encSatusInfo->m_sData.frameIn;
+    const void *src_frame = m_pBuffer.get();
+    if (m_mappedFile) {
+        uint64_t offset = 0;
+        if (!GetFrameOffset(frameIdx, &offset)) {
+            AddMessage(RGY_LOG_DEBUG, _T("mapped: finish: %d.\n"), frameIdx);
+            return RGY_ERR_MORE_DATA;
+        }
+        //trimで脱落させるフレームは、読み込まずに飛ばす
+        if (!frame_inside_range(frameIdx, m_trimParam.list).first) {
+            m_encSatusInfo->m_sData.frameIn++;
+            return m_encSatusInfo->UpdateDisplay();
+        }
+        const uint8_t *ptr = m_mappedFile->map(offset, m_nBufSize + RAW_MAPPED_OVERREAD);
+        if (ptr == nullptr) {
+            //ファイルの末尾では、色変換の読み込みがはみ出さないようバッファにコピーする
+            if ((ptr = m_mappedFile->map(offset, m_nBufSize)) == nullptr) {
+                AddMessage(RGY_LOG_ERROR, _T("failed to map frame %d.\n"), frameIdx);
+                return RGY_ERR_NULL_PTR;
+            }
+            memcpy(m_pBuffer.get(), ptr, m_nBufSize);
+            ptr = m_pBuffer.get();
+        }
+        src_frame = ptr;
+        if (m_readAheadFrames > 0) {
+            m_mappedFile->prefetch(offset + m_nBufSize, (size_t)m_nBufSize * m_readAheadFrames);
+        }
+    } else if (m_readAhead) {
+        const uint8_t *ptr = nullptr;
+        auto err = m_readAhead->get(frameIdx, &ptr);
+        if (err != RGY_ERR_NONE) {
+            return err;
+        }
+        src_frame = ptr;
+    } else {
+        auto err = ReadFrame(m_pBuffer.get());
+        if (err != RGY_ERR_NONE) {
+            return err;
+        }
+    }
+
     void *dst_array[3];
     pSurface->ptrArray(dst_array, m_convert->getFunc()->csp_to == RGY_CSP_RGB24 || m_convert->getFunc()->csp_to == RGY_CSP_RGB32);
 
     const void *src_array[3];
-    src_array[0] = m_pBuffer.get();
+    src_array[0] = src_frame;
     src_array[1] = (uint8_t *)src_array[0] + m_inputVideoInfo.srcPitch * m_inputVideoInfo.srcHeight;
     switch (m_convert->getFunc()->csp_from) {
     case RGY_CSP_YV12:
@@ -428,6 +562,9 @@ RGY_ERR RGYInputRaw::LoadNextFrame(RGYFrame *pSurface) {
     m_convert->run((m_inputVideoInfo.picstruct & RGY_PICSTRUCT_INTERLACED) ? 1 : 0,
         dst_array, src_array, m_inputVideoInfo.srcWidth, m_inputVideoInfo.srcPitch,
         src_uv_pitch, pSurface->pitch(), m_inputVideoInfo.srcHeight, m_inputVideoInfo.srcHeight, m_inputVideoInfo.crop.c);
+    if (m_readAhead) {
+        m_readAhead->release();
+    }
 
     m_encSatusInfo->m_sData.frameIn++;
     return m_encSatusInfo->UpdateDisplay();
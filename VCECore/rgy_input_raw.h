@@ -30,6 +30,8 @@
 #define __RGY_INPUT_RAW_H__
 
 #include "rgy_input.h"
+#include "rgy_mapped_file.h"
+#include "rgy_input_read_ahead.h"
 
 #if ENABLE_RAW_READER
 
@@ -51,14 +53,27 @@ public:
     virtual RGY_ERR LoadNextFrame(RGYFrame *pSurface) override;
     virtual void Close() override;
 
+    //y4mのヘッダ(YUV4MPEG2に続く部分)を解析する
+    static RGY_ERR ParseY4MHeader(char *buf, VideoInfo *pInfo);
 protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, VideoInfo *pInputInfo, const RGYInputPrm *prm) override;
-    RGY_ERR ParseY4MHeader(char *buf, VideoInfo *pInfo);
+    //posから順にy4mのFRAMEヘッダを探し、各フレームのデータの位置をm_frameOffsetsに追加する
+    void ScanY4MFrameIndex(uint64_t pos);
+    //frameIdx番目のフレームのデータの位置を取得する
+    bool GetFrameOffset(int frameIdx, uint64_t *offset);
+    //m_fSourceから次のフレームをbufに読み込む
+    RGY_ERR ReadFrame(uint8_t *buf);
 
     FILE *m_fSource;
 
     uint32_t m_nBufSize;
     shared_ptr<uint8_t> m_pBuffer;
+
+    unique_ptr<RGYMappedFile> m_mappedFile; //ファイルをマッピングして読み込む場合に使用
+    uint64_t m_y4mDataOffset;               //y4mのストリームヘッダの直後の位置
+    vector<uint64_t> m_frameOffsets;        //y4mの各フレームのデータの位置
+    unique_ptr<RGYInputReadAhead> m_readAhead; //マッピングできない場合に、別スレッドで先読みする
+    int m_readAheadFrames;                  //先読みするフレーム数
 };
 
 #endif //ENABLE_RAW_READER
@@ -0,0 +1,169 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include "rgy_input_read_ahead.h"
+
+RGYInputReadAhead::RGYInputReadAhead() :
+    m_slots(),
+    m_bufSize(0),
+    m_read(),
+    m_threadInit(),
+    m_threadExit(),
+    m_queueUsage(nullptr),
+    m_thread(),
+    m_mtx(),
+    m_cvRead(),
+    m_cvReleased(),
+    m_readIdx(0),
+    m_consumeIdx(0),
+    m_finished(false),
+    m_abort(false) {
+}
+
+RGYInputReadAhead::~RGYInputReadAhead() {
+    close();
+}
+
+RGY_ERR RGYInputReadAhead::init(int frames, uint32_t bufSize, ReadFunc func, size_t *queueUsage,
+    ThreadInitFunc threadInit, ThreadExitFunc threadExit) {
+    close();
+    if (frames <= 0 || bufSize == 0 || !func) {
+        return RGY_ERR_INVALID_PARAM;
+    }
+    m_slots.resize(frames);
+    for (auto& slot : m_slots) {
+        slot.buf = std::unique_ptr<uint8_t, aligned_malloc_deleter>((uint8_t *)_aligned_malloc(bufSize, 64), aligned_malloc_deleter());
+        if (!slot.buf) {
+            m_slots.clear();
+            return RGY_ERR_MEMORY_ALLOC;
+        }
+        slot.err = RGY_ERR_NONE;
+    }
+    m_bufSize = bufSize;
+    m_read = func;
+    m_threadInit = threadInit;
+    m_threadExit = threadExit;
+    m_queueUsage = queueUsage;
+    m_readIdx = 0;
+    m_consumeIdx = 0;
+    m_finished = false;
+    m_abort = false;
+    m_thread = std::thread(&RGYInputReadAhead::threadFunc, this);
+    return RGY_ERR_NONE;
+}
+
+void RGYInputReadAhead::close() {
+    if (m_thread.joinable()) {
+        {
+            std::lock_guard<std::mutex> lock(m_mtx);
+            m_abort = true;
+        }
+        m_cvReleased.notify_all();
+        m_thread.join();
+    }
+    m_slots.clear();
+    m_read = nullptr;
+    m_threadInit = nullptr;
+    m_threadExit = nullptr;
+    m_queueUsage = nullptr;
+    m_bufSize = 0;
+}
+
+void RGYInputReadAhead::updateQueueUsage() {
+    if (m_queueUsage) {
+        *m_queueUsage = m_readIdx - m_consumeIdx;
+    }
+}
+
+void RGYInputReadAhead::threadFunc() {
+    const auto err = (m_threadInit) ? m_threadInit() : RGY_ERR_NONE;
+    if (err == RGY_ERR_NONE) {
+        readLoop();
+    } else {
+        //初期化に失敗した場合は、最初のフレームの読み込みエラーとして取り出し側に返す
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_slots[0].err = err;
+        m_readIdx++;
+        m_finished = true;
+        updateQueueUsage();
+        m_cvRead.notify_one();
+    }
+    if (m_threadExit) {
+        m_threadExit();
+    }
+}
+
+void RGYInputReadAhead::readLoop() {
+    const int slots = (int)m_slots.size();
+    std::unique_lock<std::mutex> lock(m_mtx);
+    while (!m_abort) {
+        //空きバッファができるまで待機
+        if (m_readIdx - m_consumeIdx >= slots) {
+            m_cvReleased.wait(lock);
+            continue;
+        }
+        const int frameIdx = m_readIdx;
+        auto& slot = m_slots[frameIdx % slots];
+        //読み込み中はロックを外し、取り出し側を止めないようにする
+        lock.unlock();
+        const auto err = m_read(frameIdx, slot.buf.get(), m_bufSize);
+        lock.lock();
+        slot.err = err;
+        m_readIdx++;
+        updateQueueUsage();
+        if (err != RGY_ERR_NONE) {
+            m_finished = true;
+        }
+        m_cvRead.notify_one();
+        if (m_finished) {
+            break;
+        }
+    }
+}
+
+RGY_ERR RGYInputReadAhead::get(int frameIdx, const uint8_t **buf) {
+    std::unique_lock<std::mutex> lock(m_mtx);
+    if (frameIdx != m_consumeIdx) {
+        return RGY_ERR_INVALID_CALL;
+    }
+    m_cvRead.wait(lock, [&]() { return m_readIdx > frameIdx || m_finished; });
+    if (m_readIdx <= frameIdx) {
+        return RGY_ERR_MORE_DATA; //終端に達した後の呼び出し
+    }
+    const auto& slot = m_slots[frameIdx % (int)m_slots.size()];
+    *buf = slot.buf.get();
+    return slot.err;
+}
+
+void RGYInputReadAhead::release() {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_consumeIdx++;
+        updateQueueUsage();
+    }
+    m_cvReleased.notify_one();
+}
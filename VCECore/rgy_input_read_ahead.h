@@ -0,0 +1,97 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_INPUT_READ_AHEAD_H__
+#define __RGY_INPUT_READ_AHEAD_H__
+
+#include <cstdint>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "rgy_osdep.h"
+#include "rgy_err.h"
+#include "rgy_util.h"
+
+//別スレッドでフレームを先読みし、ファイルの読み込みと色変換・エンコードを並行して行うためのクラス
+//フレームは0から順に読み込み、get() -> release() の順に1フレームずつ取り出す
+class RGYInputReadAhead {
+public:
+    //frameIdx番目のフレームをbufに読み込む関数
+    //ファイルの終端ではRGY_ERR_MORE_DATAを返す
+    typedef std::function<RGY_ERR(int frameIdx, uint8_t *buf, uint32_t bufSize)> ReadFunc;
+    //読み込みスレッドの開始時・終了時に、そのスレッド上で呼ばれる関数
+    //スレッドごとに初期化が必要なAPI (VfWなど) を読み込みに使う場合に指定する
+    typedef std::function<RGY_ERR()> ThreadInitFunc;
+    typedef std::function<void()> ThreadExitFunc;
+
+    RGYInputReadAhead();
+    ~RGYInputReadAhead();
+
+    //frames: 先読みするフレーム数
+    //bufSize: 1フレームの読み込みに必要なバッファサイズ
+    //queueUsage: 先読み済みのフレーム数の書き込み先 (PerfQueueInfo向け、nullptrなら書き込まない)
+    //threadInit: 読み込みスレッドの開始時に呼ぶ関数 (エラーを返した場合、最初のget()がそのエラーを返す)
+    //threadExit: 読み込みスレッドの終了時に呼ぶ関数 (threadInitが失敗した場合も呼ばれる)
+    RGY_ERR init(int frames, uint32_t bufSize, ReadFunc func, size_t *queueUsage,
+        ThreadInitFunc threadInit = nullptr, ThreadExitFunc threadExit = nullptr);
+    void close();
+
+    //frameIdx番目のフレームが読み込まれるまで待機し、そのバッファを返す
+    //frameIdxは前回get()したフレームの次のフレームでなければならない
+    RGY_ERR get(int frameIdx, const uint8_t **buf);
+    //get()で取得したバッファを返却し、先読みに再利用させる
+    void release();
+protected:
+    struct ReadAheadSlot {
+        std::unique_ptr<uint8_t, aligned_malloc_deleter> buf;
+        RGY_ERR err;
+    };
+    void threadFunc();
+    void readLoop();
+    void updateQueueUsage();
+
+    std::vector<ReadAheadSlot> m_slots; //先読み用のバッファ (frameIdx % m_slots.size()番目を使用する)
+    uint32_t m_bufSize;
+    ReadFunc m_read;
+    ThreadInitFunc m_threadInit;
+    ThreadExitFunc m_threadExit;
+    size_t *m_queueUsage;
+    std::thread m_thread;
+    std::mutex m_mtx;
+    std::condition_variable m_cvRead;     //先読みが進んだことの通知
+    std::condition_variable m_cvReleased; //バッファが返却されたことの通知
+    int m_readIdx;    //次に読み込むフレーム (m_mtxで保護)
+    int m_consumeIdx; //次に取り出すフレーム (m_mtxで保護)
+    bool m_finished;  //読み込みスレッドが終端かエラーに達した (m_mtxで保護)
+    bool m_abort;     //読み込みスレッドの中断要求 (m_mtxで保護)
+};
+
+#endif //__RGY_INPUT_READ_AHEAD_H__
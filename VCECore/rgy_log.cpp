@@ -28,22 +28,160 @@
 #include <algorithm>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include "rgy_log.h"
+#include "rgy_event.h"
 #include "rgy_version.h"
 #include "rgy_util.h"
+#include "rgy_queue.h"
 #include "cpu_info.h"
 #include "gpu_info.h"
 
 const char *RGYLog::HTML_FOOTER = "</body>\n</html>\n";
 
+//ログファイルへの書き込みを別スレッドでまとめて行うクラス
+//write_logを呼ぶスレッドはキュー(RGYQueueMPMC)に文字列を積むだけにして、
+//書き込みスレッドがファイルを開いたまま、まとめて書き込む
+class RGYLogWriter {
+public:
+    static const size_t QUEUE_SIZE = 4096; //2の累乗とすること
+    static const uint32_t WRITE_INTERVAL_MS = 100; //通知がなくても書き込みを行う間隔
+
+    RGYLogWriter() :
+        m_queue(),
+        m_line(),
+        m_heEvent(CreateEvent(nullptr, FALSE, FALSE, nullptr)),
+        m_abort(false),
+        m_thread(),
+        m_fp(nullptr),
+        m_footer(nullptr) {
+        //空き待ちの押し込み側は、ある程度空いてからまとめて起床させる
+        m_queue.init(QUEUE_SIZE, QUEUE_SIZE, QUEUE_SIZE / 4);
+    }
+    ~RGYLogWriter() {
+        close();
+        if (m_heEvent) {
+            CloseEvent(m_heEvent);
+            m_heEvent = nullptr;
+        }
+    }
+    //footer: htmlの場合はフッタ、それ以外はnullptr
+    bool open(const TCHAR *pLogFile, const char *footer) {
+        m_footer = footer;
+        //logはANSI(まあようはShift-JIS)で保存する
+        if (_tfopen_s(&m_fp, pLogFile, (m_footer) ? _T("rb+") : _T("a")) || m_fp == nullptr) {
+            m_fp = nullptr;
+            return false;
+        }
+        if (m_footer) {
+            //フッタの位置から書き込む
+            _fseeki64(m_fp, 0, SEEK_END);
+            const int64_t pos = _ftelli64(m_fp);
+            _fseeki64(m_fp, (std::max)(pos - (int64_t)strlen(m_footer), (int64_t)0), SEEK_SET);
+        }
+        m_thread = std::thread(&RGYLogWriter::run, this);
+        return true;
+    }
+    void close() {
+        if (m_thread.joinable()) {
+            m_abort = true;
+            SetEvent(m_heEvent);
+            m_thread.join();
+        }
+        if (m_fp) {
+            fclose(m_fp);
+            m_fp = nullptr;
+        }
+    }
+    //複数のスレッドから呼ばれる
+    void push(int log_level, const char *str) {
+        const LogLineRef line = { log_level, str };
+        if (!m_queue.try_push(line)) {
+            //キューがいっぱいなので、書き込みスレッドを起こしてから空きができるのを待つ
+            SetEvent(m_heEvent);
+            m_queue.push(line);
+        }
+        //warning以上はすぐに書き込む
+        //それ以外はキューが半分埋まったら通知し、あとは一定間隔での書き込みに任せる
+        if (log_level >= RGY_LOG_WARN || m_queue.size() >= QUEUE_SIZE / 2) {
+            SetEvent(m_heEvent);
+        }
+    }
+private:
+    //push時にキューに渡す参照 (文字列はキュー内のstd::stringにコピーされる)
+    struct LogLineRef {
+        int log_level;
+        const char *str;
+    };
+    struct LogLine {
+        int log_level;
+        std::string str;
+        LogLine() : log_level(RGY_LOG_INFO), str() {}
+        //キュー内のstd::stringのバッファを使いまわすため、代入で文字列をコピーする
+        LogLine& operator=(const LogLineRef& ref) {
+            log_level = ref.log_level;
+            str.assign(ref.str);
+            return *this;
+        }
+    };
+    //書き込みスレッドのみから呼ぶ
+    //たまっている文字列をbatchに取り出し、warning以上のものが含まれていればtrueを返す
+    bool drain(std::string& batch) {
+        bool flush = false;
+        //取り出しはキュー内の要素との交換なので、lineのバッファは次の押し込みで再利用される
+        while (m_queue.front_copy_and_pop_no_lock(&m_line)) {
+            batch += m_line.str;
+            flush |= m_line.log_level >= RGY_LOG_WARN;
+        }
+        return flush;
+    }
+    void writeBatch(const std::string& batch, bool flush) {
+        if (batch.length() > 0) {
+            fwrite(batch.c_str(), 1, batch.length(), m_fp);
+            if (m_footer) {
+                //フッタは次の書き込みで上書きする
+                const auto footerLen = strlen(m_footer);
+                fwrite(m_footer, 1, footerLen, m_fp);
+                _fseeki64(m_fp, -(int64_t)footerLen, SEEK_CUR);
+            }
+        }
+        if (flush) {
+            fflush(m_fp);
+        }
+    }
+    void run() {
+        std::string batch;
+        while (!m_abort) {
+            WaitForSingleObject(m_heEvent, WRITE_INTERVAL_MS);
+            batch.clear();
+            const bool flush = drain(batch);
+            writeBatch(batch, flush);
+        }
+        //終了時は残りをすべて書き込む
+        batch.clear();
+        drain(batch);
+        writeBatch(batch, true);
+    }
+
+    RGYQueueMPMC<LogLine> m_queue; //write_logを呼ぶ各スレッドから書き込みスレッドへ文字列を渡すキュー
+    LogLine m_line;             //キューから取り出す際の一時領域 (書き込みスレッド側)
+    HANDLE m_heEvent;           //書き込みスレッドへの通知
+    std::atomic<bool> m_abort;
+    std::thread m_thread;
+    FILE *m_fp;
+    const char *m_footer;
+};
+
 RGYLog::RGYLog(const TCHAR *pLogFile, int log_level) {
     init(pLogFile, log_level);
 };
 
 RGYLog::~RGYLog() {
+    m_writer.reset();
 }
 
 void RGYLog::init(const TCHAR *pLogFile, int log_level) {
+    m_writer.reset();
     m_pStrLog = pLogFile;
     m_nLogLevel = log_level;
     m_mtx.reset(new std::mutex());
@@ -69,6 +207,11 @@ void RGYLog::init(const TCHAR *pLogFile, int log_level) {
                 }
             }
             fclose(fp);
+            m_writer.reset(new RGYLogWriter());
+            if (!m_writer->open(pLogFile, (m_bHtml) ? HTML_FOOTER : nullptr)) {
+                fprintf(stderr, "failed to open log file, log writing disabled.\n");
+                m_writer.reset();
+            }
         }
     }
 };
@@ -203,25 +346,11 @@ void RGYLog::write_log(int log_level, const TCHAR *buffer, bool file_only) {
         buffer_ptr = &buffer_char[0];
     }
 #endif
-    std::lock_guard<std::mutex> lock(*m_mtx.get());
-    if (m_pStrLog) {
-        FILE *fp_log = NULL;
-        //logはANSI(まあようはShift-JIS)で保存する
-        if (0 == _tfopen_s(&fp_log, m_pStrLog, (m_bHtml) ? _T("rb+") : _T("a")) && fp_log) {
-            if (m_bHtml) {
-                _fseeki64(fp_log, 0, SEEK_END);
-                int64_t pos = _ftelli64(fp_log);
-                _fseeki64(fp_log, 0, SEEK_SET);
-                _fseeki64(fp_log, pos -1 * strlen(HTML_FOOTER), SEEK_CUR);
-            }
-            fwrite(buffer_ptr, 1, strlen(buffer_ptr), fp_log);
-            if (m_bHtml) {
-                fwrite(HTML_FOOTER, 1, strlen(HTML_FOOTER), fp_log);
-            }
-            fclose(fp_log);
-        }
+    if (m_pStrLog && m_writer) {
+        m_writer->push(log_level, buffer_ptr);
     }
     if (!file_only) {
+        std::lock_guard<std::mutex> lock(*m_mtx.get());
 #ifdef UNICODE
         if (!stderr_write_to_console) //出力先がリダイレクトされるならANSIで
             fprintf(stderr, buffer_ptr);
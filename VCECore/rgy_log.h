@@ -39,6 +39,7 @@
 namespace std {
     class mutex;
 }
+class RGYLogWriter;
 
 enum {
     RGY_LOG_TRACE = -3,
@@ -56,6 +57,7 @@ protected:
     const TCHAR *m_pStrLog = nullptr;
     bool m_bHtml = false;
     std::unique_ptr<std::mutex> m_mtx;
+    std::unique_ptr<RGYLogWriter> m_writer; //ログファイルへの書き込みを行うスレッド
     static const char *HTML_FOOTER;
 public:
     RGYLog(const TCHAR *pLogFile, int log_level = RGY_LOG_INFO);
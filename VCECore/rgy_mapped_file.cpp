@@ -0,0 +1,198 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <algorithm>
+#include "rgy_mapped_file.h"
+#if defined(_WIN32) || defined(_WIN64)
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+RGYMappedFile::RGYMappedFile() :
+#if defined(_WIN32) || defined(_WIN64)
+    m_hMapping(NULL),
+#else
+    m_fd(-1),
+#endif
+    m_fileSize(0),
+    m_windowSize(0),
+    m_granularity(4096),
+    m_sequential(true),
+    m_view(nullptr),
+    m_viewOffset(0),
+    m_viewSize(0) {
+}
+
+RGYMappedFile::~RGYMappedFile() {
+    close();
+}
+
+RGY_ERR RGYMappedFile::open(FILE *fp, uint64_t windowSize) {
+    close();
+    if (fp == nullptr) {
+        return RGY_ERR_NULL_PTR;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE hFile = (HANDLE)_get_osfhandle(_fileno(fp));
+    if (hFile == INVALID_HANDLE_VALUE || GetFileType(hFile) != FILE_TYPE_DISK) {
+        return RGY_ERR_UNSUPPORTED; //パイプなどはマッピングできない
+    }
+    LARGE_INTEGER fileSize = { 0 };
+    if (!GetFileSizeEx(hFile, &fileSize) || fileSize.QuadPart <= 0) {
+        return RGY_ERR_UNSUPPORTED;
+    }
+    m_hMapping = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (m_hMapping == NULL) {
+        return RGY_ERR_UNSUPPORTED;
+    }
+    SYSTEM_INFO si = { 0 };
+    GetSystemInfo(&si);
+    m_granularity = si.dwAllocationGranularity;
+    m_fileSize = fileSize.QuadPart;
+#else
+    const int fd = fileno(fp);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+        return RGY_ERR_UNSUPPORTED; //パイプなどはマッピングできない
+    }
+    m_fd = fd;
+    m_granularity = sysconf(_SC_PAGESIZE);
+    m_fileSize = st.st_size;
+#endif
+    //アドレス空間に収まらない場合は、一部ずつマッピングする
+    m_windowSize = (windowSize == 0 && m_fileSize > (uint64_t)SIZE_MAX / 2) ? (uint64_t)SIZE_MAX / 4 : windowSize;
+    m_sequential = true;
+    auto err = mapView(0, (size_t)std::min<uint64_t>(m_fileSize, (m_windowSize) ? m_windowSize : m_fileSize));
+    if (err != RGY_ERR_NONE) {
+        close();
+    }
+    return err;
+}
+
+void RGYMappedFile::close() {
+    unmapView();
+#if defined(_WIN32) || defined(_WIN64)
+    if (m_hMapping) {
+        CloseHandle(m_hMapping);
+        m_hMapping = NULL;
+    }
+#else
+    m_fd = -1; //fdはFILEの持ち主が閉じる
+#endif
+    m_fileSize = 0;
+    m_windowSize = 0;
+}
+
+void RGYMappedFile::unmapView() {
+    if (m_view) {
+#if defined(_WIN32) || defined(_WIN64)
+        UnmapViewOfFile(m_view);
+#else
+        munmap(m_view, m_viewSize);
+#endif
+        m_view = nullptr;
+    }
+    m_viewOffset = 0;
+    m_viewSize = 0;
+}
+
+RGY_ERR RGYMappedFile::mapView(uint64_t offset, size_t size) {
+    unmapView();
+    //開始位置はアライメントに合わせる必要がある
+    const uint64_t viewOffset = offset & ~(m_granularity - 1);
+    const uint64_t viewEnd = std::min(m_fileSize, std::max(offset + size, viewOffset + m_windowSize));
+    const size_t viewSize = (size_t)(viewEnd - viewOffset);
+#if defined(_WIN32) || defined(_WIN64)
+    m_view = (uint8_t *)MapViewOfFile(m_hMapping, FILE_MAP_READ, (DWORD)(viewOffset >> 32), (DWORD)(viewOffset & 0xffffffffu), viewSize);
+    if (m_view == nullptr) {
+        return RGY_ERR_NULL_PTR;
+    }
+#else
+    void *ptr = mmap(nullptr, viewSize, PROT_READ, MAP_SHARED, m_fd, (off_t)viewOffset);
+    if (ptr == MAP_FAILED) {
+        return RGY_ERR_NULL_PTR;
+    }
+    m_view = (uint8_t *)ptr;
+    madvise(m_view, viewSize, (m_sequential) ? MADV_SEQUENTIAL : MADV_RANDOM);
+#endif
+    m_viewOffset = viewOffset;
+    m_viewSize = viewSize;
+    return RGY_ERR_NONE;
+}
+
+const uint8_t *RGYMappedFile::map(uint64_t offset, size_t size) {
+    if (m_fileSize == 0 || offset + size > m_fileSize) {
+        return nullptr;
+    }
+    if (offset < m_viewOffset || m_viewOffset + m_viewSize < offset + size) {
+        if (mapView(offset, size) != RGY_ERR_NONE) {
+            return nullptr;
+        }
+    }
+    return m_view + (offset - m_viewOffset);
+}
+
+#if defined(_WIN32) || defined(_WIN64)
+//PrefetchVirtualMemoryはWindows 8以降でのみ使用可能なため、動的に取得する
+typedef struct {
+    PVOID VirtualAddress;
+    SIZE_T NumberOfBytes;
+} RGY_MEMORY_RANGE_ENTRY;
+typedef BOOL(WINAPI *funcPrefetchVirtualMemory)(HANDLE hProcess, ULONG_PTR NumberOfEntries, RGY_MEMORY_RANGE_ENTRY *VirtualAddresses, ULONG Flags);
+#endif
+
+void RGYMappedFile::prefetch(uint64_t offset, size_t size) {
+    //マッピングしている範囲のみが対象
+    const uint64_t start = std::max(offset, m_viewOffset) & ~(m_granularity - 1);
+    const uint64_t fin = std::min(offset + size, m_viewOffset + m_viewSize);
+    if (m_view == nullptr || start >= fin) {
+        return;
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    static const auto fPrefetchVirtualMemory = (funcPrefetchVirtualMemory)GetProcAddress(GetModuleHandle(_T("kernel32.dll")), "PrefetchVirtualMemory");
+    if (fPrefetchVirtualMemory) {
+        RGY_MEMORY_RANGE_ENTRY range;
+        range.VirtualAddress = m_view + (start - m_viewOffset);
+        range.NumberOfBytes = (SIZE_T)(fin - start);
+        fPrefetchVirtualMemory(GetCurrentProcess(), 1, &range, 0);
+    }
+#else
+    madvise(m_view + (start - m_viewOffset), (size_t)(fin - start), MADV_WILLNEED);
+#endif
+}
+
+void RGYMappedFile::setSequential(bool sequential) {
+    m_sequential = sequential;
+#if !(defined(_WIN32) || defined(_WIN64))
+    if (m_view) {
+        madvise(m_view, m_viewSize, (m_sequential) ? MADV_SEQUENTIAL : MADV_RANDOM);
+    }
+#endif
+}
@@ -0,0 +1,80 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_MAPPED_FILE_H__
+#define __RGY_MAPPED_FILE_H__
+
+#include <cstdint>
+#include <cstdio>
+#include "rgy_osdep.h"
+#include "rgy_err.h"
+
+//読み込み専用でファイルをメモリにマッピングし、ファイルの内容をコピーせずに参照するためのクラス
+//windowSizeを指定した場合は、ファイル全体ではなく一部のみをマッピングし、
+//map()で範囲外が要求されたらマッピングする範囲をずらす (32bit環境でのアドレス空間の節約用)
+class RGYMappedFile {
+public:
+    RGYMappedFile();
+    ~RGYMappedFile();
+
+    //fpで開かれているファイルをマッピングする
+    //windowSize: 一度にマッピングするサイズ (0ならファイル全体)
+    RGY_ERR open(FILE *fp, uint64_t windowSize);
+    void close();
+    bool is_open() const { return m_fileSize > 0; }
+    uint64_t size() const { return m_fileSize; }
+
+    //ファイルの[offset, offset+size)を参照するポインタを返す
+    //返したポインタは、次にmap()を呼ぶまで有効
+    //範囲がファイルの外にかかる場合はnullptrを返す
+    const uint8_t *map(uint64_t offset, size_t size);
+
+    //[offset, offset+size)を近いうちに参照することをOSに通知し、先読みさせる
+    void prefetch(uint64_t offset, size_t size);
+
+    //順次アクセスかどうかをOSに通知する (ランダムアクセスの場合は先読みを抑制させる)
+    void setSequential(bool sequential);
+protected:
+    RGY_ERR mapView(uint64_t offset, size_t size);
+    void unmapView();
+
+#if defined(_WIN32) || defined(_WIN64)
+    HANDLE m_hMapping;
+#else
+    int m_fd;
+#endif
+    uint64_t m_fileSize;    //ファイルサイズ
+    uint64_t m_windowSize;  //一度にマッピングするサイズ (0ならファイル全体)
+    uint64_t m_granularity; //マッピングの開始位置のアライメント
+    bool m_sequential;      //順次アクセスの通知を行っているか
+    uint8_t *m_view;        //マッピングしている領域の先頭
+    uint64_t m_viewOffset;  //m_viewのファイル上の位置
+    size_t m_viewSize;      //マッピングしている領域のサイズ
+};
+
+#endif //__RGY_MAPPED_FILE_H__
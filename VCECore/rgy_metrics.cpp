@@ -0,0 +1,373 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cctype>
+#include <algorithm>
+#include <cstdarg>
+#include "rgy_metrics.h"
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <errno.h>
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+
+//ソケットの受信側が詰まっても、パフォーマンスモニタのスレッドが止まり続けないようにする
+static const int RGY_METRICS_SOCKET_SEND_TIMEOUT_MS = 1000;
+
+static const char *RGY_METRICS_QUEUE_NAME[RGY_METRICS_QUEUE_MAX] = {
+    "vid_in", "aud_in", "vid_out", "aud_out", "aud_proc", "aud_enc"
+};
+static const char *RGY_METRICS_THREAD_NAME[RGY_METRICS_THREAD_MAX] = {
+    "main", "enc", "in", "out", "aud_proc", "aud_enc"
+};
+
+//jsonではNaN/Infは使用できないのでnullとする
+static std::string json_num(double value, int digits) {
+    if (!std::isfinite(value)) {
+        return "null";
+    }
+    return strsprintf("%.*f", digits, value);
+}
+
+//OpenMetricsのNaN/Infの表記
+static std::string om_num(double value, int digits) {
+    if (std::isnan(value)) {
+        return "NaN";
+    } else if (std::isinf(value)) {
+        return (value > 0.0) ? "+Inf" : "-Inf";
+    }
+    return strsprintf("%.*f", digits, value);
+}
+
+std::string RGYMetricsWriter::toJson(const RGYMetricsSample& s) {
+    const int64_t frames_in_flight = s.frames_enc_in - s.frames_enc_out;
+    std::string str = "{";
+    str += strsprintf("\"timestamp\":%lld,\"time\":%s,\"finished\":%s",
+        (long long)s.timestamp_ms, json_num(s.elapsed_sec, 3).c_str(), (s.finished) ? "true" : "false");
+    str += strsprintf(",\"frames\":{\"total\":%lld,\"enc_in\":%lld,\"enc_out\":%lld,\"out\":%lld,\"drop\":%lld,\"idr\":%lld,\"i\":%lld,\"p\":%lld,\"b\":%lld}",
+        (long long)s.frames_total, (long long)s.frames_enc_in, (long long)s.frames_enc_out, (long long)s.frames_out, (long long)s.frames_drop,
+        (long long)s.frames_idr, (long long)s.frames_i, (long long)s.frames_p, (long long)s.frames_b);
+    str += strsprintf(",\"fps\":%s,\"fps_avg\":%s,\"bitrate_kbps\":%s,\"bitrate_kbps_avg\":%s,\"out_bytes\":%lld",
+        json_num(s.fps, 3).c_str(), json_num(s.fps_avg, 3).c_str(),
+        json_num(s.bitrate_kbps, 3).c_str(), json_num(s.bitrate_kbps_avg, 3).c_str(), (long long)s.out_bytes);
+    str += strsprintf(",\"latency\":{\"frames_in_flight\":%lld,\"avg_ms\":%s,\"max_ms\":%s,\"sum_ms\":%s}",
+        (long long)frames_in_flight, json_num(s.enc_latency_ms, 3).c_str(),
+        json_num(s.enc_latency_us_max * 1e-3, 3).c_str(), json_num(s.enc_latency_us_sum * 1e-3, 3).c_str());
+    str += ",\"queue\":{";
+    for (int i = 0; i < RGY_METRICS_QUEUE_MAX; i++) {
+        str += strsprintf("%s\"%s\":{\"usage\":%lld,\"stall\":%lld,\"stall_ms\":%s}", (i) ? "," : "",
+            RGY_METRICS_QUEUE_NAME[i], (long long)s.queue_usage[i], (long long)s.queue_stall[i], json_num(s.queue_stall_us[i] * 1e-3, 3).c_str());
+    }
+    str += "}";
+    str += strsprintf(",\"cpu\":{\"total\":%s,\"kernel\":%s", json_num(s.cpu_percent, 2).c_str(), json_num(s.cpu_kernel_percent, 2).c_str());
+    for (int i = 0; i < RGY_METRICS_THREAD_MAX; i++) {
+        str += strsprintf(",\"%s\":%s", RGY_METRICS_THREAD_NAME[i], json_num(s.thread_percent[i], 2).c_str());
+    }
+    str += "}";
+    str += strsprintf(",\"mem\":{\"private\":%lld,\"virtual\":%lld}", (long long)s.mem_private, (long long)s.mem_virtual);
+    str += strsprintf(",\"io\":{\"read_per_sec\":%s,\"write_per_sec\":%s}", json_num(s.io_read_per_sec, 0).c_str(), json_num(s.io_write_per_sec, 0).c_str());
+    if (s.gpu_info_valid) {
+        str += strsprintf(",\"gpu\":{\"load\":%s,\"clock\":%s,\"vee_load\":%s,\"ved_load\":%s,\"ve_clock\":%s}",
+            json_num(s.gpu_load_percent, 2).c_str(), json_num(s.gpu_clock, 1).c_str(),
+            json_num(s.vee_load_percent, 2).c_str(), json_num(s.ved_load_percent, 2).c_str(), json_num(s.ve_clock, 1).c_str());
+    }
+    str += "}\n";
+    return str;
+}
+
+std::string RGYMetricsWriter::toOpenMetrics(const RGYMetricsSample& s) {
+    //メトリクス名はエンコーダ名を小文字にしたもの(vceenc_...)から始める
+    //counterは"_total"を付けたものを値とする
+    std::string prefix = ENCODER_NAME;
+    std::transform(prefix.begin(), prefix.end(), prefix.begin(), [](char c) { return (char)tolower(c); });
+    std::string str;
+    auto family = [&str, &prefix](const char *name, const char *type, const char *unit, const char *help) {
+        str += strsprintf("# TYPE %s_%s %s\n", prefix.c_str(), name, type);
+        if (unit) {
+            str += strsprintf("# UNIT %s_%s %s\n", prefix.c_str(), name, unit);
+        }
+        str += strsprintf("# HELP %s_%s %s\n", prefix.c_str(), name, help);
+    };
+    auto value = [&str, &prefix](const char *name, const std::string& labels, const std::string& val) {
+        str += strsprintf("%s_%s%s%s%s %s\n", prefix.c_str(), name,
+            (labels.length()) ? "{" : "", labels.c_str(), (labels.length()) ? "}" : "", val.c_str());
+    };
+    auto i64 = [](int64_t v) { return strsprintf("%lld", (long long)v); };
+
+    family("frames", "counter", nullptr, "Frames processed at each stage.");
+    value("frames_total", "stage=\"enc_in\"",  i64(s.frames_enc_in));
+    value("frames_total", "stage=\"enc_out\"", i64(s.frames_enc_out));
+    value("frames_total", "stage=\"out\"",     i64(s.frames_out));
+    value("frames_total", "stage=\"drop\"",    i64(s.frames_drop));
+    family("output_frames", "counter", nullptr, "Output frames by picture type.");
+    value("output_frames_total", "type=\"idr\"", i64(s.frames_idr));
+    value("output_frames_total", "type=\"i\"",   i64(s.frames_i));
+    value("output_frames_total", "type=\"p\"",   i64(s.frames_p));
+    value("output_frames_total", "type=\"b\"",   i64(s.frames_b));
+    family("frames_planned", "gauge", nullptr, "Frames expected to be encoded, 0 if unknown.");
+    value("frames_planned", "", i64(s.frames_total));
+    family("output_bytes", "counter", "bytes", "Bytes written to the output.");
+    value("output_bytes_total", "", i64(s.out_bytes));
+    family("fps", "gauge", nullptr, "Encode speed over the last interval.");
+    value("fps", "", om_num(s.fps, 3));
+    family("fps_avg", "gauge", nullptr, "Average encode speed.");
+    value("fps_avg", "", om_num(s.fps_avg, 3));
+    family("bitrate_kbps", "gauge", nullptr, "Output bitrate over the last interval.");
+    value("bitrate_kbps", "", om_num(s.bitrate_kbps, 3));
+    family("bitrate_avg_kbps", "gauge", nullptr, "Average output bitrate.");
+    value("bitrate_avg_kbps", "", om_num(s.bitrate_kbps_avg, 3));
+    family("frames_in_flight", "gauge", nullptr, "Frames submitted to the encoder and not yet returned.");
+    value("frames_in_flight", "", i64(s.frames_enc_in - s.frames_enc_out));
+    family("encode_latency_seconds", "summary", "seconds", "Time from encoder submission to encoder output.");
+    value("encode_latency_seconds_sum", "", om_num(s.enc_latency_us_sum * 1e-6, 6));
+    value("encode_latency_seconds_count", "", i64(s.frames_enc_out));
+    family("encode_latency_max_seconds", "gauge", "seconds", "Maximum time from encoder submission to encoder output.");
+    value("encode_latency_max_seconds", "", om_num(s.enc_latency_us_max * 1e-6, 6));
+    family("queue_depth", "gauge", nullptr, "Items waiting in each queue.");
+    for (int i = 0; i < RGY_METRICS_QUEUE_MAX; i++) {
+        value("queue_depth", strsprintf("queue=\"%s\"", RGY_METRICS_QUEUE_NAME[i]), i64(s.queue_usage[i]));
+    }
+    family("queue_stalls", "counter", nullptr, "Times the producer waited on a full queue.");
+    for (int i = 0; i < RGY_METRICS_QUEUE_MAX; i++) {
+        value("queue_stalls_total", strsprintf("queue=\"%s\"", RGY_METRICS_QUEUE_NAME[i]), i64(s.queue_stall[i]));
+    }
+    family("queue_stall_seconds", "counter", "seconds", "Time the producer waited on a full queue.");
+    for (int i = 0; i < RGY_METRICS_QUEUE_MAX; i++) {
+        value("queue_stall_seconds_total", strsprintf("queue=\"%s\"", RGY_METRICS_QUEUE_NAME[i]), om_num(s.queue_stall_us[i] * 1e-6, 6));
+    }
+    family("cpu_percent", "gauge", nullptr, "CPU usage of the process and of each pipeline thread.");
+    value("cpu_percent", "stage=\"total\"",  om_num(s.cpu_percent, 2));
+    value("cpu_percent", "stage=\"kernel\"", om_num(s.cpu_kernel_percent, 2));
+    for (int i = 0; i < RGY_METRICS_THREAD_MAX; i++) {
+        value("cpu_percent", strsprintf("stage=\"%s\"", RGY_METRICS_THREAD_NAME[i]), om_num(s.thread_percent[i], 2));
+    }
+    family("memory_bytes", "gauge", "bytes", "Memory usage of the process.");
+    value("memory_bytes", "type=\"private\"", i64(s.mem_private));
+    value("memory_bytes", "type=\"virtual\"", i64(s.mem_virtual));
+    family("io_bytes_per_second", "gauge", nullptr, "File I/O rate of the process.");
+    value("io_bytes_per_second", "direction=\"read\"",  om_num(s.io_read_per_sec, 0));
+    value("io_bytes_per_second", "direction=\"write\"", om_num(s.io_write_per_sec, 0));
+    if (s.gpu_info_valid) {
+        family("gpu_load_percent", "gauge", nullptr, "GPU engine load.");
+        value("gpu_load_percent", "engine=\"gpu\"",    om_num(s.gpu_load_percent, 2));
+        value("gpu_load_percent", "engine=\"encode\"", om_num(s.vee_load_percent, 2));
+        value("gpu_load_percent", "engine=\"decode\"", om_num(s.ved_load_percent, 2));
+        family("gpu_clock_mhz", "gauge", nullptr, "GPU clock.");
+        value("gpu_clock_mhz", "domain=\"gpu\"", om_num(s.gpu_clock, 1));
+        value("gpu_clock_mhz", "domain=\"ve\"",  om_num(s.ve_clock, 1));
+    }
+    family("finished", "gauge", nullptr, "1 after the encode has finished.");
+    value("finished", "", (s.finished) ? "1" : "0");
+    str += "# EOF\n";
+    return str;
+}
+
+RGYMetricsWriter::RGYMetricsWriter() :
+    m_dest(),
+    m_format(RGY_METRICS_FORMAT_NDJSON),
+    m_pLog(),
+    m_fp(),
+    m_socketMode(false),
+    m_socketPath(),
+    m_socket(-1),
+    m_socketErrorReported(false) {
+}
+
+RGYMetricsWriter::~RGYMetricsWriter() {
+    close();
+}
+
+void RGYMetricsWriter::AddMessage(int log_level, const TCHAR *format, ...) {
+    if (m_pLog == nullptr || log_level < m_pLog->getLogLevel()) {
+        return;
+    }
+    va_list args;
+    va_start(args, format);
+    int len = _vsctprintf(format, args) + 1; // _vscprintf doesn't count terminating '\0'
+    tstring buffer;
+    buffer.resize(len, _T('\0'));
+    _vstprintf_s(&buffer[0], len, format, args);
+    va_end(args);
+    m_pLog->write(log_level, (_T("metrics: ") + tstring(buffer.c_str())).c_str());
+}
+
+RGY_ERR RGYMetricsWriter::init(const tstring& dest, RGYMetricsFormat format, std::shared_ptr<RGYLog> pLog) {
+    close();
+    m_pLog = pLog;
+    m_dest = dest;
+    m_format = format;
+    const tstring prefix = RGY_METRICS_UNIX_SOCKET_PREFIX;
+    m_socketMode = m_dest.substr(0, prefix.length()) == prefix;
+    if (m_socketMode) {
+#if defined(_WIN32) || defined(_WIN64)
+        AddMessage(RGY_LOG_ERROR, _T("unix domain socket output is not supported on this platform: %s\n"), m_dest.c_str());
+        return RGY_ERR_UNSUPPORTED;
+#else
+        m_socketPath = tchar_to_string(m_dest.substr(prefix.length()));
+        if (m_socketPath.length() == 0 || m_socketPath.length() >= sizeof(sockaddr_un::sun_path)) {
+            AddMessage(RGY_LOG_ERROR, _T("invalid socket path: %s\n"), m_dest.c_str());
+            return RGY_ERR_INVALID_PARAM;
+        }
+        //受信側が後から起動する場合もあるので、接続できなくてもエラーにはせず、書き込みのたびに再接続を試みる
+        connectSocket();
+#endif //#if defined(_WIN32) || defined(_WIN64)
+    } else if (m_format == RGY_METRICS_FORMAT_NDJSON) {
+        m_fp = std::unique_ptr<FILE, fp_deleter>(_tfopen(m_dest.c_str(), _T("a")));
+        if (!m_fp) {
+            AddMessage(RGY_LOG_ERROR, _T("Failed to open %s.\n"), m_dest.c_str());
+            return RGY_ERR_FILE_OPEN;
+        }
+    }
+    AddMessage(RGY_LOG_DEBUG, _T("output %s to %s.\n"), get_chr_from_value(list_metrics_format, m_format), m_dest.c_str());
+    return RGY_ERR_NONE;
+}
+
+void RGYMetricsWriter::close() {
+    closeSocket();
+    m_fp.reset();
+    m_socketMode = false;
+    m_socketErrorReported = false;
+}
+
+RGY_ERR RGYMetricsWriter::write(const RGYMetricsSample& sample) {
+    const auto str = (m_format == RGY_METRICS_FORMAT_OPENMETRICS) ? toOpenMetrics(sample) : toJson(sample);
+    return (m_socketMode) ? writeSocket(str) : writeFile(str);
+}
+
+RGY_ERR RGYMetricsWriter::writeFile(const std::string& str) {
+    if (m_format == RGY_METRICS_FORMAT_NDJSON) {
+        if (!m_fp) {
+            return RGY_ERR_NULL_PTR;
+        }
+        //読み取り側がすぐに読めるよう、1行ごとにflushする
+        if (fwrite(str.c_str(), 1, str.length(), m_fp.get()) != str.length() || fflush(m_fp.get()) != 0) {
+            AddMessage(RGY_LOG_WARN, _T("Failed to write to %s.\n"), m_dest.c_str());
+            return RGY_ERR_UNKNOWN;
+        }
+        return RGY_ERR_NONE;
+    }
+    //書き込み途中のファイルを読み取り側が読まないよう、一時ファイルに書いてから置き換える
+    const auto tmpFile = m_dest + _T(".tmp");
+    {
+        std::unique_ptr<FILE, fp_deleter> fp(_tfopen(tmpFile.c_str(), _T("wb")));
+        if (!fp) {
+            AddMessage(RGY_LOG_WARN, _T("Failed to open %s.\n"), tmpFile.c_str());
+            return RGY_ERR_FILE_OPEN;
+        }
+        if (fwrite(str.c_str(), 1, str.length(), fp.get()) != str.length()) {
+            fp.reset();
+            _tremove(tmpFile.c_str());
+            AddMessage(RGY_LOG_WARN, _T("Failed to write to %s.\n"), tmpFile.c_str());
+            return RGY_ERR_UNKNOWN;
+        }
+    }
+#if defined(_WIN32) || defined(_WIN64)
+    const bool renamed = MoveFileEx(tmpFile.c_str(), m_dest.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool renamed = _trename(tmpFile.c_str(), m_dest.c_str()) == 0;
+#endif //#if defined(_WIN32) || defined(_WIN64)
+    if (!renamed) {
+        _tremove(tmpFile.c_str());
+        AddMessage(RGY_LOG_WARN, _T("Failed to replace %s.\n"), m_dest.c_str());
+        return RGY_ERR_UNKNOWN;
+    }
+    return RGY_ERR_NONE;
+}
+
+bool RGYMetricsWriter::connectSocket() {
+#if defined(_WIN32) || defined(_WIN64)
+    return false;
+#else
+    closeSocket();
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return false;
+    }
+    struct timeval tv;
+    tv.tv_sec = RGY_METRICS_SOCKET_SEND_TIMEOUT_MS / 1000;
+    tv.tv_usec = (RGY_METRICS_SOCKET_SEND_TIMEOUT_MS % 1000) * 1000;
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &tv, sizeof(tv));
+
+    struct sockaddr_un addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    memcpy(addr.sun_path, m_socketPath.c_str(), m_socketPath.length());
+    if (connect(fd, (const struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        const int err = errno;
+        ::close(fd);
+        if (!m_socketErrorReported) {
+            AddMessage(RGY_LOG_WARN, _T("Failed to connect to %s: %s, will retry.\n"), m_dest.c_str(), char_to_tstring(strerror(err)).c_str());
+            m_socketErrorReported = true;
+        }
+        return false;
+    }
+    m_socket = fd;
+    m_socketErrorReported = false;
+    AddMessage(RGY_LOG_DEBUG, _T("connected to %s.\n"), m_dest.c_str());
+    return true;
+#endif //#if defined(_WIN32) || defined(_WIN64)
+}
+
+void RGYMetricsWriter::closeSocket() {
+#if !(defined(_WIN32) || defined(_WIN64))
+    if (m_socket >= 0) {
+        ::close(m_socket);
+        m_socket = -1;
+    }
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+}
+
+RGY_ERR RGYMetricsWriter::writeSocket(const std::string& str) {
+#if defined(_WIN32) || defined(_WIN64)
+    UNREFERENCED_PARAMETER(str);
+    return RGY_ERR_UNSUPPORTED;
+#else
+    if (m_socket < 0 && !connectSocket()) {
+        return RGY_ERR_DEVICE_NOT_AVAILABLE;
+    }
+    //受信側が切断してもSIGPIPEで落ちないよう、MSG_NOSIGNALを付ける
+    size_t sent = 0;
+    while (sent < str.length()) {
+        const auto ret = send(m_socket, str.c_str() + sent, str.length() - sent, MSG_NOSIGNAL);
+        if (ret < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            //途中まで送った場合も、受信側で行が壊れるだけなので、次回再接続する
+            AddMessage(RGY_LOG_DEBUG, _T("Failed to send to %s: %s.\n"), m_dest.c_str(), char_to_tstring(strerror(errno)).c_str());
+            closeSocket();
+            return RGY_ERR_UNKNOWN;
+        }
+        sent += ret;
+    }
+    return RGY_ERR_NONE;
+#endif //#if defined(_WIN32) || defined(_WIN64)
+}
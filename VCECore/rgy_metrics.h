@@ -0,0 +1,157 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_METRICS_H__
+#define __RGY_METRICS_H__
+
+#include <cstdint>
+#include <string>
+#include <memory>
+#include "rgy_osdep.h"
+#include "rgy_tchar.h"
+#include "rgy_err.h"
+#include "rgy_log.h"
+#include "rgy_def.h"
+#include "rgy_util.h"
+
+//--metricsの出力先にこれを付けると、Unixドメインソケットへ出力する
+#define RGY_METRICS_UNIX_SOCKET_PREFIX _T("unix:")
+
+enum RGYMetricsFormat {
+    RGY_METRICS_FORMAT_NDJSON,
+    RGY_METRICS_FORMAT_OPENMETRICS,
+};
+
+static const CX_DESC list_metrics_format[] = {
+    { _T("ndjson"),      RGY_METRICS_FORMAT_NDJSON },
+    { _T("openmetrics"), RGY_METRICS_FORMAT_OPENMETRICS },
+    { NULL, 0 }
+};
+
+enum RGYMetricsQueue {
+    RGY_METRICS_QUEUE_VID_IN,
+    RGY_METRICS_QUEUE_AUD_IN,
+    RGY_METRICS_QUEUE_VID_OUT,
+    RGY_METRICS_QUEUE_AUD_OUT,
+    RGY_METRICS_QUEUE_AUD_PROC,
+    RGY_METRICS_QUEUE_AUD_ENC,
+    RGY_METRICS_QUEUE_MAX
+};
+
+enum RGYMetricsThread {
+    RGY_METRICS_THREAD_MAIN,
+    RGY_METRICS_THREAD_ENC,
+    RGY_METRICS_THREAD_IN,
+    RGY_METRICS_THREAD_OUT,
+    RGY_METRICS_THREAD_AUD_PROC,
+    RGY_METRICS_THREAD_AUD_ENC,
+    RGY_METRICS_THREAD_MAX
+};
+
+//CPerfMonitorの計測間隔ごとに出力する値
+struct RGYMetricsSample {
+    int64_t timestamp_ms;       //UNIX時刻(ms)
+    double  elapsed_sec;        //計測開始からの経過時間(s)
+    bool    finished;           //最後の出力かどうか
+
+    int64_t frames_total;       //入力予定の全フレーム数 (不明なら0)
+    int64_t frames_enc_in;      //エンコーダに投入したフレーム数
+    int64_t frames_enc_out;     //エンコーダから出力されたフレーム数
+    int64_t frames_out;         //出力ファイルに書き込んだフレーム数
+    int64_t frames_drop;        //ドロップしたフレーム数
+    int64_t frames_idr;         //出力したフレームのうち、IDR
+    int64_t frames_i;           //出力したフレームのうち、IDR以外のI
+    int64_t frames_p;
+    int64_t frames_b;
+    int64_t out_bytes;          //出力したバイト数
+
+    double  fps;                //直前の計測区間のエンコード速度
+    double  fps_avg;
+    double  bitrate_kbps;       //直前の計測区間のビットレート
+    double  bitrate_kbps_avg;
+
+    int64_t enc_latency_us_sum; //エンコーダ投入から出力までの時間の合計(us)
+    int64_t enc_latency_us_max; //エンコーダ投入から出力までの時間の最大(us)
+    double  enc_latency_ms;     //直前の計測区間のエンコーダ投入から出力までの時間の平均(ms)
+
+    int64_t queue_usage[RGY_METRICS_QUEUE_MAX];    //キューに積まれているデータの数
+    int64_t queue_stall[RGY_METRICS_QUEUE_MAX];    //キューがいっぱいで押し込み側が待機した回数
+    int64_t queue_stall_us[RGY_METRICS_QUEUE_MAX]; //キューがいっぱいで押し込み側が待機した合計時間(us)
+
+    double  cpu_percent;
+    double  cpu_kernel_percent;
+    double  thread_percent[RGY_METRICS_THREAD_MAX];
+
+    int64_t mem_private;        //byte
+    int64_t mem_virtual;        //byte
+    double  io_read_per_sec;    //byte/s
+    double  io_write_per_sec;   //byte/s
+
+    bool    gpu_info_valid;
+    double  gpu_load_percent;
+    double  gpu_clock;          //MHz
+    double  vee_load_percent;
+    double  ved_load_percent;
+    double  ve_clock;           //MHz
+};
+
+//RGYMetricsSampleを機械的に読み取りやすい形式で出力する
+//  ndjson      ... 1回の計測ごとに1行のjsonを追記する
+//  openmetrics ... 1回の計測ごとにOpenMetricsのテキスト形式で全体を書き換える
+//                  (ファイルの場合は一時ファイルに書いてから置き換え、ソケットの場合は"# EOF"までを送る)
+class RGYMetricsWriter {
+public:
+    RGYMetricsWriter();
+    ~RGYMetricsWriter();
+
+    //dest: 出力ファイル名、または"unix:<path>"でUnixドメインソケット (SOCK_STREAM) へ送信する
+    RGY_ERR init(const tstring& dest, RGYMetricsFormat format, std::shared_ptr<RGYLog> pLog);
+    RGY_ERR write(const RGYMetricsSample& sample);
+    void close();
+
+    static std::string toJson(const RGYMetricsSample& sample);
+    static std::string toOpenMetrics(const RGYMetricsSample& sample);
+protected:
+    RGY_ERR writeFile(const std::string& str);
+    RGY_ERR writeSocket(const std::string& str);
+    bool connectSocket();
+    void closeSocket();
+    void AddMessage(int log_level, const TCHAR *format, ...);
+
+    tstring m_dest;
+    RGYMetricsFormat m_format;
+    std::shared_ptr<RGYLog> m_pLog;
+    std::unique_ptr<FILE, fp_deleter> m_fp; //ndjsonでファイルに出力する場合に開いたままにしておく
+    bool m_socketMode;
+    std::string m_socketPath;
+    int m_socket;
+    bool m_socketErrorReported; //接続失敗を何度も表示しないようにする
+};
+
+#endif //__RGY_METRICS_H__
@@ -32,7 +32,10 @@
 #include <tchar.h>
 #include <vector>
 #include <atomic>
+#include <chrono>
 #include <fstream>
+#include <algorithm>
+#include <numeric>
 #define CL_EXTERN
 #include "rgy_opencl.h"
 
@@ -254,6 +257,7 @@ int initOpenCLGlobal() {
     LOAD(clReleaseContext);
 
     LOAD(clCreateProgramWithSource);
+    LOAD(clCreateProgramWithBinary);
     LOAD(clBuildProgram);
     LOAD(clGetProgramBuildInfo);
     LOAD(clGetProgramInfo);
@@ -285,6 +289,7 @@ int initOpenCLGlobal() {
     LOAD(clEnqueueMapBuffer);
     LOAD(clEnqueueMapImage);
     LOAD(clEnqueueUnmapMemObject);
+    LOAD(clEnqueueMarkerWithWaitList);
 
     LOAD(clWaitForEvents);
     LOAD(clGetEventInfo);
@@ -485,6 +490,136 @@ bool RGYOpenCLPlatform::isVendor(const char *vendor) {
     return checkVendor(info().vendor.c_str(), vendor);
 }
 
+RGYCLFramePool::RGYCLFramePool(shared_ptr<RGYLog> pLog, size_t maxIdleBytes, size_t lowIdleBytes, int trimIdleMs) :
+    m_pLog(pLog),
+    m_mtx(),
+    m_idle(),
+    m_maxIdleBytes(maxIdleBytes),
+    m_lowIdleBytes((std::min)(lowIdleBytes, maxIdleBytes)),
+    m_trimIdle(trimIdleMs),
+    m_lastUsed(std::chrono::steady_clock::now()),
+    m_idleBytes(0),
+    m_hit(0),
+    m_miss(0),
+    m_evict(0),
+    m_trimmed(0) {
+}
+
+RGYCLFramePool::~RGYCLFramePool() {
+    clear();
+    m_pLog.reset();
+}
+
+size_t RGYCLFramePool::frameBytes(const FrameInfo &frame) {
+    size_t bytes = 0;
+    for (int i = 0; i < RGY_CSP_PLANES[frame.csp]; i++) {
+        const auto plane = getPlane(&frame, (RGY_PLANE)i);
+        bytes += (size_t)plane.pitch[0] * plane.height;
+    }
+    return bytes;
+}
+
+bool RGYCLFramePool::match(const Entry &entry, const FrameInfo &frame, cl_mem_flags flags) {
+    return entry.flags == flags
+        && entry.frame.csp == frame.csp
+        && entry.frame.width == frame.width
+        && entry.frame.height == frame.height;
+}
+
+void RGYCLFramePool::release(Entry &entry) {
+    for (int i = 0; i < _countof(entry.frame.ptr); i++) {
+        if (entry.frame.ptr[i]) {
+            clReleaseMemObject((cl_mem)entry.frame.ptr[i]);
+            entry.frame.ptr[i] = nullptr;
+        }
+    }
+}
+
+unique_ptr<RGYCLFrame> RGYCLFramePool::get(const FrameInfo &frame, cl_mem_flags flags) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_lastUsed = std::chrono::steady_clock::now();
+    //直近に返却されたものから探す
+    for (auto it = m_idle.rbegin(); it != m_idle.rend(); it++) {
+        if (match(*it, frame, flags)) {
+            FrameInfo clframe = frame;
+            clframe.mem_type = RGY_MEM_TYPE_GPU;
+            for (int i = 0; i < _countof(clframe.ptr); i++) {
+                clframe.ptr[i] = it->frame.ptr[i];
+                clframe.pitch[i] = it->frame.pitch[i];
+            }
+            m_idleBytes -= it->bytes;
+            m_idle.erase(std::next(it).base());
+            m_hit++;
+            auto ret = std::make_unique<RGYCLFrame>(clframe, flags);
+            ret->pool = shared_from_this();
+            return ret;
+        }
+    }
+    m_miss++;
+    return nullptr;
+}
+
+void RGYCLFramePool::recycle(const FrameInfo &frame, cl_mem_flags flags) {
+    Entry entry;
+    entry.frame = frame;
+    entry.flags = flags;
+    entry.bytes = frameBytes(frame);
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_lastUsed = std::chrono::steady_clock::now();
+    if (entry.bytes > m_maxIdleBytes) {
+        release(entry);
+        m_evict++;
+        return;
+    }
+    //上限を超える場合は、古いものから解放する
+    while (m_idle.size() > 0 && m_idleBytes + entry.bytes > m_maxIdleBytes) {
+        m_idleBytes -= m_idle.front().bytes;
+        release(m_idle.front());
+        m_idle.pop_front();
+        m_evict++;
+    }
+    m_idleBytes += entry.bytes;
+    m_idle.push_back(entry);
+}
+
+void RGYCLFramePool::clear() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    for (auto &entry : m_idle) {
+        release(entry);
+    }
+    m_idle.clear();
+    m_idleBytes = 0;
+}
+
+void RGYCLFramePool::trim() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_idleBytes <= m_lowIdleBytes
+        || std::chrono::steady_clock::now() - m_lastUsed < m_trimIdle) {
+        return;
+    }
+    const auto idleBytesBefore = m_idleBytes;
+    while (m_idle.size() > 0 && m_idleBytes > m_lowIdleBytes) {
+        m_idleBytes -= m_idle.front().bytes;
+        release(m_idle.front());
+        m_idle.pop_front();
+        m_trimmed++;
+    }
+    if (m_pLog && RGY_LOG_DEBUG >= m_pLog->getLogLevel()) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("CL frame pool: trimmed idle buffers %.1f MB -> %.1f MB.\n"),
+            idleBytesBefore / (double)(1024 * 1024), m_idleBytes / (double)(1024 * 1024));
+    }
+}
+
+void RGYCLFramePool::printStats(int log_level) {
+    if (m_pLog == nullptr || log_level < m_pLog->getLogLevel()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_pLog->write(log_level, _T("CL frame pool: hit %llu, miss %llu, evict %llu, trimmed %llu, idle %d frames (%.1f MB).\n"),
+        (unsigned long long)m_hit, (unsigned long long)m_miss, (unsigned long long)m_evict, (unsigned long long)m_trimmed,
+        (int)m_idle.size(), m_idleBytes / (double)(1024 * 1024));
+}
+
 RGYOpenCLContext::RGYOpenCLContext(shared_ptr<RGYOpenCLPlatform> platform, shared_ptr<RGYLog> pLog) :
     m_platform(std::move(platform)),
     m_context(nullptr, clReleaseContext),
@@ -495,11 +630,23 @@ RGYOpenCLContext::RGYOpenCLContext(shared_ptr<RGYOpenCLPlatform> platform, share
     m_copyB2B(),
     m_copyI2I(),
     m_setB(),
-    m_setI() {
+    m_setI(),
+    m_profiler(),
+    m_framePool(std::make_shared<RGYCLFramePool>(pLog, (size_t)RGY_CL_FRAME_POOL_MAX_IDLE_MB * 1024 * 1024,
+        (size_t)RGY_CL_FRAME_POOL_LOW_IDLE_MB * 1024 * 1024, RGY_CL_FRAME_POOL_TRIM_IDLE_MS)),
+    m_programCacheDir(),
+    m_programCacheBase(),
+    m_programBuildCount(0),
+    m_programCacheHit(0),
+    m_programBuildMs(0.0) {
 
 }
 
 RGYOpenCLContext::~RGYOpenCLContext() {
+    if (m_programBuildCount > 0) {
+        LOG_IF_EXIST(RGY_LOG_DEBUG, _T("CL program build: %d programs (cache hit %d, miss %d), %.1f ms total.\n"),
+            m_programBuildCount, m_programCacheHit, m_programBuildCount - m_programCacheHit, m_programBuildMs);
+    }
     LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closing CL Context...\n"));
     m_copyI2I.reset();  LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL copyI2I program.\n"));
     m_copyB2B.reset();  LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL copyB2B program.\n"));
@@ -507,6 +654,11 @@ RGYOpenCLContext::~RGYOpenCLContext() {
     m_copyB2I.reset();  LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL copyB2I program.\n"));
     m_setB.reset();     LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL m_setB program.\n"));
     m_setI.reset();     LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL m_setI program.\n"));
+    m_profiler.reset(); LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL profiler.\n"));
+    if (m_framePool) {
+        m_framePool->printStats(RGY_LOG_DEBUG);
+        m_framePool.reset(); LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL frame pool.\n"));
+    }
     m_queue.clear();    LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL Queue.\n"));
     m_context.reset();  LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL Context.\n"));
     m_platform.reset(); LOG_IF_EXIST(RGY_LOG_DEBUG, _T("Closed CL Platform.\n"));
@@ -558,12 +710,19 @@ RGY_ERR RGYOpenCLContext::createContext() {
     return RGY_ERR_NONE;
 }
 
+void RGYOpenCLContext::enableProfiling() {
+    if (!m_profiler) {
+        m_profiler = std::make_shared<RGYOpenCLProfiler>(m_pLog);
+    }
+}
+
 RGYOpenCLQueue RGYOpenCLContext::createQueue(cl_device_id devid) {
     RGYOpenCLQueue queue;
     cl_int err = RGY_ERR_NONE;
-    m_pLog->write(RGY_LOG_DEBUG, _T("createQueue for device : %p\n"), devid);
+    const cl_command_queue_properties properties = (m_profiler) ? CL_QUEUE_PROFILING_ENABLE : 0;
+    m_pLog->write(RGY_LOG_DEBUG, _T("createQueue for device : %p%s\n"), devid, (m_profiler) ? _T(" (profiling)") : _T(""));
     try {
-        queue = std::move(RGYOpenCLQueue(clCreateCommandQueue(m_context.get(), devid, 0, &err), devid));
+        queue = std::move(RGYOpenCLQueue(clCreateCommandQueue(m_context.get(), devid, properties, &err), devid));
         if (err != RGY_ERR_NONE) {
             m_pLog->write(RGY_LOG_ERROR, _T("Error (clCreateCommandQueue): %s\n"), cl_errmes(err));
         }
@@ -574,8 +733,242 @@ RGYOpenCLQueue RGYOpenCLContext::createQueue(cl_device_id devid) {
     return std::move(queue);
 }
 
-RGYOpenCLKernelLauncher::RGYOpenCLKernelLauncher(cl_kernel kernel, std::string kernelName, cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global, shared_ptr<RGYLog> pLog, const std::vector<RGYOpenCLEvent>& wait_events, RGYOpenCLEvent *event) :
-    m_kernel(kernel), m_kernelName(kernelName), m_queue(queue), m_local(local), m_global(global), m_pLog(pLog), m_wait_events(toVec(wait_events)), m_event(event) {
+RGYOpenCLProfiler::RGYOpenCLProfiler(shared_ptr<RGYLog> pLog) :
+    m_pLog(pLog),
+    m_mtx(),
+    m_stageName(),
+    m_pending(),
+    m_runs(),
+    m_currentRun(0),
+    m_currentStage(0),
+    m_stageTime(),
+    m_kernelTime(),
+    m_errorCount(0) {
+    m_currentStage = stageIndex(_T("(other)"));
+}
+
+RGYOpenCLProfiler::~RGYOpenCLProfiler() {
+    m_pending.clear();
+    m_pLog.reset();
+}
+
+int RGYOpenCLProfiler::stageIndex(const tstring& stage) {
+    auto it = std::find(m_stageName.begin(), m_stageName.end(), stage);
+    if (it != m_stageName.end()) {
+        return (int)(it - m_stageName.begin());
+    }
+    m_stageName.push_back(stage);
+    m_stageTime.push_back(std::vector<float>());
+    return (int)m_stageName.size() - 1;
+}
+
+void RGYOpenCLProfiler::setStage(const tstring& stage) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    const auto prevRun = m_currentRun;
+    m_currentRun++;
+    m_currentStage = stageIndex(stage);
+    closeRun(prevRun, false);
+    if (m_pending.size() >= COLLECT_THRESHOLD) {
+        //完了したものだけ集計し、ここでは待機しない
+        collectPending(false);
+    }
+}
+
+void RGYOpenCLProfiler::add(const std::string& name, const RGYOpenCLEvent& event) {
+    if (event() == nullptr) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mtx);
+    Record record;
+    record.stage = m_currentStage;
+    record.run = m_currentRun;
+    record.name = name;
+    record.event = event;
+    m_pending.push_back(record);
+    auto& run = m_runs[m_currentRun];
+    if (run.pending == 0 && run.sumUs == 0.0) {
+        run.stage = m_currentStage;
+    }
+    run.pending++;
+}
+
+void RGYOpenCLProfiler::collectRecord(const Record& record, bool completed) {
+    cl_ulong start = 0, end = 0;
+    if (completed
+        && clGetEventProfilingInfo(record.event(), CL_PROFILING_COMMAND_START, sizeof(start), &start, nullptr) == CL_SUCCESS
+        && clGetEventProfilingInfo(record.event(), CL_PROFILING_COMMAND_END, sizeof(end), &end, nullptr) == CL_SUCCESS
+        && end >= start) {
+        const double us = (end - start) * 1e-3;
+        m_kernelTime[std::make_pair(record.stage, record.name)].push_back((float)us);
+        auto it = m_runs.find(record.run);
+        if (it != m_runs.end()) {
+            it->second.sumUs += us;
+        }
+    } else {
+        //エラーで終了したか、キューがプロファイリング無効で作成されている
+        m_errorCount++;
+    }
+    auto it = m_runs.find(record.run);
+    if (it != m_runs.end()) {
+        it->second.pending--;
+        closeRun(record.run, false);
+    }
+}
+
+void RGYOpenCLProfiler::closeRun(uint64_t run, bool force) {
+    //現在のsetStage()の区間はまだコマンドが追加されうるので、forceでなければ閉じない
+    auto it = m_runs.find(run);
+    if (it == m_runs.end()
+        || (!force && (run == m_currentRun || it->second.pending > 0))) {
+        return;
+    }
+    if (it->second.sumUs > 0.0) {
+        m_stageTime[it->second.stage].push_back((float)it->second.sumUs);
+    }
+    m_runs.erase(it);
+}
+
+void RGYOpenCLProfiler::collect(bool wait) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    collectPending(wait);
+}
+
+void RGYOpenCLProfiler::collectPending(bool wait) {
+    auto it = std::remove_if(m_pending.begin(), m_pending.end(), [this, wait](const Record& record) {
+        if (wait) {
+            record.event.wait();
+        }
+        cl_int status = CL_QUEUED;
+        if (clGetEventInfo(record.event(), CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr) != CL_SUCCESS) {
+            status = -1;
+        }
+        if (status > CL_COMPLETE) {
+            return false;
+        }
+        collectRecord(record, status == CL_COMPLETE);
+        return true;
+    });
+    m_pending.erase(it, m_pending.end());
+    if (wait) {
+        std::vector<uint64_t> runs;
+        for (const auto& run : m_runs) {
+            runs.push_back(run.first);
+        }
+        for (const auto run : runs) {
+            closeRun(run, true);
+        }
+    }
+}
+
+RGYOpenCLProfiler::Stats RGYOpenCLProfiler::calcStats(std::vector<float> values) {
+    Stats stats = { 0 };
+    if (values.size() == 0) {
+        return stats;
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&values](double p) {
+        const size_t idx = std::min(values.size() - 1, (size_t)(p * (values.size() - 1) + 0.5));
+        return (double)values[idx];
+    };
+    stats.count = (int)values.size();
+    stats.total = std::accumulate(values.begin(), values.end(), 0.0);
+    stats.avg = stats.total / stats.count;
+    stats.p50 = percentile(0.50);
+    stats.p99 = percentile(0.99);
+    stats.max = values.back();
+    return stats;
+}
+
+void RGYOpenCLProfiler::print(int log_level) {
+    if (m_pLog == nullptr || log_level < m_pLog->getLogLevel()) {
+        return;
+    }
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_pLog->write(log_level, _T("OpenCL profile (GPU time, us)\n"));
+    m_pLog->write(log_level, _T("%-40s %8s %10s %9s %9s %9s %9s\n"), _T("filter / kernel"), _T("count"), _T("total(ms)"), _T("avg"), _T("p50"), _T("p99"), _T("max"));
+    for (int istage = 0; istage < (int)m_stageName.size(); istage++) {
+        const auto stats = calcStats(m_stageTime[istage]);
+        if (stats.count == 0) {
+            continue;
+        }
+        m_pLog->write(log_level, _T("%-40s %8d %10.1f %9.1f %9.1f %9.1f %9.1f\n"),
+            m_stageName[istage].c_str(), stats.count, stats.total * 1e-3, stats.avg, stats.p50, stats.p99, stats.max);
+        for (const auto& kernel : m_kernelTime) {
+            if (kernel.first.first != istage) {
+                continue;
+            }
+            const auto kstats = calcStats(kernel.second);
+            m_pLog->write(log_level, _T("  %-38s %8d %10.1f %9.1f %9.1f %9.1f %9.1f\n"),
+                char_to_tstring(kernel.first.second).c_str(), kstats.count, kstats.total * 1e-3, kstats.avg, kstats.p50, kstats.p99, kstats.max);
+        }
+    }
+    if (m_errorCount > 0) {
+        m_pLog->write(log_level, _T("OpenCL profile: failed to get time of %llu commands.\n"), (unsigned long long)m_errorCount);
+    }
+}
+
+RGY_ERR RGYOpenCLProfiler::writeJson(const tstring& filename) {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    std::ofstream fout(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!fout.good()) {
+        m_pLog->write(RGY_LOG_ERROR, _T("Failed to open OpenCL profile file: %s\n"), filename.c_str());
+        return RGY_ERR_FILE_OPEN;
+    }
+    auto escape = [](const std::string& str) {
+        std::string ret;
+        for (const auto c : str) {
+            if (c == '\"' || c == '\\') {
+                ret += '\\';
+                ret += c;
+            } else if ((unsigned char)c < 0x20) {
+                ret += strsprintf("\\u%04x", (unsigned char)c);
+            } else {
+                ret += c;
+            }
+        }
+        return ret;
+    };
+    auto statsJson = [](const Stats& stats) {
+        return strsprintf("\"count\": %d, \"total_ms\": %.3f, \"avg_us\": %.3f, \"p50_us\": %.3f, \"p99_us\": %.3f, \"max_us\": %.3f",
+            stats.count, stats.total * 1e-3, stats.avg, stats.p50, stats.p99, stats.max);
+    };
+    fout << "{\n";
+    fout << "  \"unit\": \"us\",\n";
+    fout << "  \"error_count\": " << m_errorCount << ",\n";
+    fout << "  \"filters\": [";
+    bool firstStage = true;
+    for (int istage = 0; istage < (int)m_stageName.size(); istage++) {
+        const auto stats = calcStats(m_stageTime[istage]);
+        if (stats.count == 0) {
+            continue;
+        }
+        fout << ((firstStage) ? "\n" : ",\n");
+        firstStage = false;
+        fout << "    { \"name\": \"" << escape(tchar_to_string(m_stageName[istage], CP_UTF8)) << "\", " << statsJson(stats) << ",\n";
+        fout << "      \"kernels\": [";
+        bool firstKernel = true;
+        for (const auto& kernel : m_kernelTime) {
+            if (kernel.first.first != istage) {
+                continue;
+            }
+            fout << ((firstKernel) ? "\n" : ",\n");
+            firstKernel = false;
+            fout << "        { \"name\": \"" << escape(kernel.first.second) << "\", " << statsJson(calcStats(kernel.second)) << " }";
+        }
+        fout << "\n      ] }";
+    }
+    fout << "\n  ]\n";
+    fout << "}\n";
+    if (!fout.good()) {
+        m_pLog->write(RGY_LOG_ERROR, _T("Failed to write OpenCL profile file: %s\n"), filename.c_str());
+        return RGY_ERR_UNKNOWN;
+    }
+    m_pLog->write(RGY_LOG_INFO, _T("Wrote OpenCL profile to %s.\n"), filename.c_str());
+    return RGY_ERR_NONE;
+}
+
+RGYOpenCLKernelLauncher::RGYOpenCLKernelLauncher(cl_kernel kernel, std::string kernelName, cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global, shared_ptr<RGYLog> pLog, const std::vector<RGYOpenCLEvent>& wait_events, RGYOpenCLEvent *event, shared_ptr<RGYOpenCLProfiler> profiler) :
+    m_kernel(kernel), m_kernelName(kernelName), m_queue(queue), m_local(local), m_global(global), m_pLog(pLog), m_wait_events(toVec(wait_events)), m_event(event), m_profiler(profiler) {
 }
 
 RGY_ERR RGYOpenCLKernelLauncher::launch(std::vector<void *> arg_ptrs, std::vector<size_t> arg_size, std::vector<std::type_index> arg_type) {
@@ -597,19 +990,25 @@ RGY_ERR RGYOpenCLKernelLauncher::launch(std::vector<void *> arg_ptrs, std::vecto
             }
         }
     }
+    //プロファイリング時は、呼び出し元がイベントを要求していなくても計測用にイベントを取得する
+    RGYOpenCLEvent eventProfile;
+    RGYOpenCLEvent *event = (m_event) ? m_event : ((m_profiler) ? &eventProfile : nullptr);
     auto globalCeiled = m_global.ceilGlobal(m_local);
     auto err = err_cl_to_rgy(clEnqueueNDRangeKernel(m_queue, m_kernel, 3, NULL, globalCeiled(), m_local(),
         (int)m_wait_events.size(),
         (m_wait_events.size() > 0) ? m_wait_events.data() : nullptr,
-        (m_event) ? m_event->reset_ptr() : nullptr));
+        (event) ? event->reset_ptr() : nullptr));
     if (err != CL_SUCCESS) {
         m_pLog->write(RGY_LOG_ERROR, _T("Error: Failed to run kernel \"%s\": %s\n"), char_to_tstring(m_kernelName).c_str(), cl_errmes(err));
         return err;
     }
+    if (m_profiler) {
+        m_profiler->add(m_kernelName, *event);
+    }
     return err;
 }
 
-RGYOpenCLKernel::RGYOpenCLKernel(cl_kernel kernel, std::string kernelName, shared_ptr<RGYLog> pLog) : m_kernel(kernel), m_kernelName(kernelName), m_pLog(pLog) {
+RGYOpenCLKernel::RGYOpenCLKernel(cl_kernel kernel, std::string kernelName, shared_ptr<RGYLog> pLog, shared_ptr<RGYOpenCLProfiler> profiler) : m_kernel(kernel), m_kernelName(kernelName), m_pLog(pLog), m_profiler(profiler) {
 
 }
 
@@ -619,10 +1018,11 @@ RGYOpenCLKernel::~RGYOpenCLKernel() {
         m_kernel = nullptr;
     }
     m_kernelName.clear();
+    m_profiler.reset();
     m_pLog.reset();
 };
 
-RGYOpenCLProgram::RGYOpenCLProgram(cl_program program, shared_ptr<RGYLog> pLog) : m_program(program), m_pLog(pLog) {
+RGYOpenCLProgram::RGYOpenCLProgram(cl_program program, shared_ptr<RGYLog> pLog, shared_ptr<RGYOpenCLProfiler> profiler) : m_program(program), m_pLog(pLog), m_profiler(profiler) {
 };
 
 RGYOpenCLProgram::~RGYOpenCLProgram() {
@@ -635,15 +1035,15 @@ RGYOpenCLProgram::~RGYOpenCLProgram() {
 };
 
 RGYOpenCLKernelLauncher RGYOpenCLKernel::config(cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global) {
-    return RGYOpenCLKernelLauncher(m_kernel, m_kernelName, queue, local, global, m_pLog, {}, nullptr);
+    return RGYOpenCLKernelLauncher(m_kernel, m_kernelName, queue, local, global, m_pLog, {}, nullptr, m_profiler);
 }
 
 RGYOpenCLKernelLauncher RGYOpenCLKernel::config(cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global, RGYOpenCLEvent *event) {
-    return RGYOpenCLKernelLauncher(m_kernel, m_kernelName, queue, local, global, m_pLog, {}, event);
+    return RGYOpenCLKernelLauncher(m_kernel, m_kernelName, queue, local, global, m_pLog, {}, event, m_profiler);
 }
 
 RGYOpenCLKernelLauncher RGYOpenCLKernel::config(cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event) {
-    return RGYOpenCLKernelLauncher(m_kernel, m_kernelName, queue, local, global, m_pLog, wait_events, event);
+    return RGYOpenCLKernelLauncher(m_kernel, m_kernelName, queue, local, global, m_pLog, wait_events, event, m_profiler);
 }
 
 RGYOpenCLKernel RGYOpenCLProgram::kernel(const char *kernelName) {
@@ -652,27 +1052,39 @@ RGYOpenCLKernel RGYOpenCLProgram::kernel(const char *kernelName) {
     if (err != CL_SUCCESS) {
         m_pLog->write(RGY_LOG_ERROR, _T("Failed to get kernel %s: %s\n"), char_to_tstring(kernelName).c_str(), cl_errmes(err));
     }
-    return RGYOpenCLKernel(kernel, kernelName, m_pLog);
+    return RGYOpenCLKernel(kernel, kernelName, m_pLog, m_profiler);
 }
 
 std::vector<uint8_t> RGYOpenCLProgram::getBinary() {
     std::vector<uint8_t> binary;
     if (!m_program) return binary;
 
-    size_t binary_size = 0;
-    cl_int err = clGetProgramInfo(m_program, CL_PROGRAM_BINARY_SIZES, sizeof(size_t), &binary_size, nullptr);
-    if (err != CL_SUCCESS) {
+    //CL_PROGRAM_BINARY_SIZES, CL_PROGRAM_BINARIESはデバイスごとの配列で返る
+    //ここでは最初のデバイスのものを返す
+    size_t sizes_bytes = 0;
+    cl_int err = clGetProgramInfo(m_program, CL_PROGRAM_BINARY_SIZES, 0, nullptr, &sizes_bytes);
+    if (err != CL_SUCCESS || sizes_bytes < sizeof(size_t)) {
         m_pLog->write(RGY_LOG_ERROR, _T("Failed to get program binary size: %s\n"), cl_errmes(err));
         return binary;
     }
-
-    binary.resize(binary_size + 1, 0);
-    err = clGetProgramInfo(m_program, CL_PROGRAM_BINARIES, binary_size, binary.data(), &binary_size);
+    std::vector<size_t> binary_sizes(sizes_bytes / sizeof(size_t), 0);
+    err = clGetProgramInfo(m_program, CL_PROGRAM_BINARY_SIZES, sizes_bytes, binary_sizes.data(), nullptr);
+    if (err != CL_SUCCESS || binary_sizes[0] == 0) {
+        m_pLog->write(RGY_LOG_ERROR, _T("Failed to get program binary size: %s\n"), cl_errmes(err));
+        return binary;
+    }
+    std::vector<std::vector<uint8_t>> binaries(binary_sizes.size());
+    std::vector<uint8_t *> binary_ptrs(binary_sizes.size(), nullptr);
+    for (size_t i = 0; i < binary_sizes.size(); i++) {
+        binaries[i].resize(binary_sizes[i]);
+        binary_ptrs[i] = (binary_sizes[i] > 0) ? binaries[i].data() : nullptr;
+    }
+    err = clGetProgramInfo(m_program, CL_PROGRAM_BINARIES, binary_ptrs.size() * sizeof(binary_ptrs[0]), binary_ptrs.data(), nullptr);
     if (err != CL_SUCCESS) {
         m_pLog->write(RGY_LOG_ERROR, _T("Failed to get program binary: %s\n"), cl_errmes(err));
-        binary.clear();
+        return binary;
     }
-    binary.resize(binary_size);
+    binary = std::move(binaries[0]);
     return binary;
 }
 
@@ -696,7 +1108,7 @@ RGY_ERR RGYCLBufMap::unmap(cl_command_queue queue) {
     return unmap(queue, {});
 }
 RGY_ERR RGYCLBufMap::unmap(cl_command_queue queue, const std::vector<RGYOpenCLEvent> &wait_events) {
-    if (m_hostPtr) return RGY_ERR_NONE;
+    if (!m_hostPtr) return RGY_ERR_NONE;
     m_queue = queue;
     const std::vector<cl_event> v_wait_list = toVec(wait_events);
     const cl_event *wait_list = (v_wait_list.size() > 0) ? v_wait_list.data() : nullptr;
@@ -738,6 +1150,13 @@ RGY_ERR RGYOpenCLQueue::finish() const {
     return err_cl_to_rgy(clFinish(m_queue.get()));
 }
 
+RGY_ERR RGYOpenCLQueue::marker(RGYOpenCLEvent *event) const {
+    if (!m_queue) {
+        return RGY_ERR_NULL_PTR;
+    }
+    return err_cl_to_rgy(clEnqueueMarkerWithWaitList(m_queue.get(), 0, nullptr, event->reset_ptr()));
+}
+
 void RGYOpenCLQueue::clear() {
     m_queue.reset();
 }
@@ -760,7 +1179,13 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
     const std::vector<cl_event> v_wait_list = toVec(wait_events);
     const int wait_count = (int)v_wait_list.size();
     const cl_event *wait_list = (wait_count > 0) ? v_wait_list.data() : nullptr;
+    //プロファイリング時は、呼び出し元がイベントを要求していなくても計測用にイベントを取得する
+    RGYOpenCLEvent eventProfile;
+    if (!event && m_profiler) {
+        event = &eventProfile;
+    }
     cl_event *event_ptr = (event) ? event->reset_ptr() : nullptr;
+    const char *profileName = nullptr; //カーネルを使用しない場合のプロファイリング用の名前
 
     const int pixel_size = RGY_CSP_BIT_DEPTH[planeDstOrg->csp] > 8 ? 2 : 1;
     FrameInfo planeDst = *planeDstOrg;
@@ -781,6 +1206,7 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
     if (planeSrc.mem_type == RGY_MEM_TYPE_GPU) {
         if (planeDst.mem_type == RGY_MEM_TYPE_GPU) {
             if (planeDst.csp == planeSrc.csp) {
+                profileName = "copyBufferRect";
                 err = clEnqueueCopyBufferRect(queue, (cl_mem)planeSrc.ptr[0], (cl_mem)planeDst.ptr[0], src_origin, dst_origin,
                     region, planeSrc.pitch[0], 0, planeDst.pitch[0], 0, wait_count, wait_list, event_ptr);
             } else {
@@ -825,6 +1251,7 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
                 planeSrc.width, planeSrc.height);
             err = err_rgy_to_cl(rgy_err);
         } else if (planeDst.mem_type == RGY_MEM_TYPE_CPU) {
+            profileName = "readBufferRect";
             err = clEnqueueReadBufferRect(queue, (cl_mem)planeSrc.ptr[0], false, src_origin, dst_origin,
                 region, planeSrc.pitch[0], 0, planeDst.pitch[0], 0, planeDst.ptr[0], wait_count, wait_list, event_ptr);
         } else {
@@ -854,6 +1281,7 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
         } else if (planeDst.mem_type == RGY_MEM_TYPE_GPU_IMAGE) {
             if (planeDst.csp == planeSrc.csp) {
                 clGetImageInfo((cl_mem)planeDst.ptr[0], CL_IMAGE_WIDTH, sizeof(region[0]), &region[0], nullptr);
+                profileName = "copyImage";
                 err = clEnqueueCopyImage(queue, (cl_mem)planeSrc.ptr[0], (cl_mem)planeDst.ptr[0], src_origin, dst_origin, region, wait_count, wait_list, event_ptr);
             } else {
                 if (!m_copyI2I) {
@@ -878,6 +1306,7 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
             }
         } else if (planeDst.mem_type == RGY_MEM_TYPE_CPU) {
             clGetImageInfo((cl_mem)planeSrc.ptr[0], CL_IMAGE_WIDTH, sizeof(region[0]), &region[0], nullptr);
+            profileName = "readImage";
             err = clEnqueueReadImage(queue, (cl_mem)planeSrc.ptr[0], false, dst_origin,
                 region, planeDst.pitch[0], 0, planeDst.ptr[0], wait_count, wait_list, event_ptr);
         } else {
@@ -885,10 +1314,12 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
         }
     } else if (planeSrc.mem_type == RGY_MEM_TYPE_CPU) {
         if (planeDst.mem_type == RGY_MEM_TYPE_GPU) {
+            profileName = "writeBufferRect";
             err = clEnqueueWriteBufferRect(queue, (cl_mem)planeDst.ptr[0], false, dst_origin, src_origin,
                 region, planeDst.pitch[0], 0, planeSrc.pitch[0], 0, planeSrc.ptr[0], wait_count, wait_list, event_ptr);
         } else if (planeDst.mem_type == RGY_MEM_TYPE_GPU_IMAGE) {
             clGetImageInfo((cl_mem)planeDst.ptr[0], CL_IMAGE_WIDTH, sizeof(region[0]), &region[0], nullptr);
+            profileName = "writeImage";
             err = clEnqueueWriteImage(queue, (cl_mem)planeDst.ptr[0], false, src_origin,
                 region, planeSrc.pitch[0], 0, (void *)planeSrc.ptr[0], wait_count, wait_list, event_ptr);
         } else if (planeDst.mem_type == RGY_MEM_TYPE_CPU) {
@@ -903,6 +1334,9 @@ RGY_ERR RGYOpenCLContext::copyPlane(FrameInfo *planeDstOrg, const FrameInfo *pla
     } else {
         return RGY_ERR_UNSUPPORTED;
     }
+    if (m_profiler && profileName && err == CL_SUCCESS) {
+        m_profiler->add(profileName, *event);
+    }
     return err_cl_to_rgy(err);
 }
 RGY_ERR RGYOpenCLContext::copyFrame(FrameInfo *dst, const FrameInfo *src) {
@@ -1058,6 +1492,24 @@ unique_ptr<RGYOpenCLProgram> RGYOpenCLContext::build(const char *data, const siz
         m_pLog->write(RGY_LOG_DEBUG, _T("options: %s\nsource\n"), char_to_tstring(options).c_str());
         m_pLog->write_log(RGY_LOG_DEBUG, (char_to_tstring(data, CP_UTF8) + _T("\n") + sep).c_str());
     }
+    const auto timeStart = std::chrono::system_clock::now();
+    auto buildFin = [&](bool cacheHit) {
+        const auto ms = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - timeStart).count() * 0.001;
+        m_programBuildCount++;
+        m_programCacheHit += (cacheHit) ? 1 : 0;
+        m_programBuildMs += ms;
+        m_pLog->write(RGY_LOG_DEBUG, _T("clBuildProgram success! (%s, %.1f ms)\n"), (cacheHit) ? _T("cache hit") : _T("built from source"), ms);
+    };
+    //キャッシュがあれば、バイナリから読み込む
+    std::string cacheKey;
+    const auto cacheFile = programCacheFile(data, datalen, options, cacheKey);
+    if (cacheFile.length() > 0) {
+        auto cached = buildFromCache(cacheFile, cacheKey, options);
+        if (cached) {
+            buildFin(true);
+            return cached;
+        }
+    }
     cl_int err = CL_SUCCESS;
     cl_program program = clCreateProgramWithSource(m_context.get(), 1, &data, &datalen, &err);
     if (err != CL_SUCCESS) {
@@ -1084,8 +1536,144 @@ unique_ptr<RGYOpenCLProgram> RGYOpenCLContext::build(const char *data, const siz
             return nullptr;
         }
     }
-    m_pLog->write(RGY_LOG_DEBUG, _T("clBuildProgram success!\n"));
-    return std::make_unique<RGYOpenCLProgram>(program, m_pLog);
+    auto built = std::make_unique<RGYOpenCLProgram>(program, m_pLog, m_profiler);
+    if (cacheFile.length() > 0) {
+        saveProgramCache(built.get(), cacheFile, cacheKey);
+    }
+    buildFin(false);
+    return built;
+}
+
+//プログラムのバイナリのキャッシュファイルの形式
+//  magic (8byte), version (uint32_t), キーの長さ (uint32_t), キー, バイナリの長さ (uint64_t), バイナリ
+//キーにはソースのハッシュ、ビルドオプション、プラットフォーム・デバイス・ドライバの情報を含み、
+//読み込み時にキー全体を比較するので、ファイル名(キーのハッシュ)が衝突しても誤ったバイナリは使用しない
+static const char RGY_CL_CACHE_MAGIC[8] = { 'R', 'G', 'Y', 'C', 'L', 'B', 'I', 'N' };
+static const uint32_t RGY_CL_CACHE_VERSION = 1;
+
+static uint64_t rgy_cl_cache_hash(uint64_t hash, const void *ptr, size_t size) {
+    //FNV-1a
+    const uint8_t *p = (const uint8_t *)ptr;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= p[i];
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+tstring RGYOpenCLContext::programCacheFile(const char *data, const size_t size, const char *options, std::string& cacheKey) {
+    cacheKey.clear();
+    if (m_programCacheDir.length() == 0 || m_platform->devs().size() != 1) {
+        return tstring();
+    }
+    if (m_programCacheBase.length() == 0) {
+        const auto platformInfo = m_platform->info();
+        const auto devInfo = RGYOpenCLDevice(m_platform->dev(0)).info();
+        if (devInfo.name.length() == 0 || devInfo.driver_version.length() == 0) {
+            return tstring();
+        }
+        m_programCacheBase = platformInfo.name + "\n" + platformInfo.version + "\n"
+            + devInfo.name + "\n" + devInfo.version + "\n" + devInfo.driver_version + "\n";
+    }
+    const uint64_t FNV_OFFSET = 14695981039346656037ull;
+    char buf[64];
+    sprintf_s(buf, "%016llx:%llu\n", (unsigned long long)rgy_cl_cache_hash(FNV_OFFSET, data, size), (unsigned long long)size);
+    cacheKey = m_programCacheBase + buf + ((options) ? options : "");
+    sprintf_s(buf, "%016llx.bin", (unsigned long long)rgy_cl_cache_hash(FNV_OFFSET, cacheKey.c_str(), cacheKey.length()));
+    return m_programCacheDir + _T("\\") + char_to_tstring(buf);
+}
+
+unique_ptr<RGYOpenCLProgram> RGYOpenCLContext::buildFromCache(const tstring& cacheFile, const std::string& cacheKey, const char *options) {
+    std::ifstream fin(cacheFile, std::ios::in | std::ios::binary);
+    if (!fin.good()) {
+        return nullptr;
+    }
+    char magic[sizeof(RGY_CL_CACHE_MAGIC)] = { 0 };
+    uint32_t version = 0, keyLength = 0;
+    uint64_t binaryLength = 0;
+    fin.read(magic, sizeof(magic));
+    fin.read((char *)&version, sizeof(version));
+    fin.read((char *)&keyLength, sizeof(keyLength));
+    if (!fin.good()
+        || memcmp(magic, RGY_CL_CACHE_MAGIC, sizeof(magic)) != 0
+        || version != RGY_CL_CACHE_VERSION
+        || keyLength != cacheKey.length()) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("CL program cache mismatch: %s\n"), cacheFile.c_str());
+        return nullptr;
+    }
+    std::string key(keyLength, '\0');
+    fin.read(&key[0], keyLength);
+    fin.read((char *)&binaryLength, sizeof(binaryLength));
+    if (!fin.good() || key != cacheKey || binaryLength == 0 || binaryLength > (uint64_t)256 * 1024 * 1024) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("CL program cache mismatch: %s\n"), cacheFile.c_str());
+        return nullptr;
+    }
+    std::vector<uint8_t> binary((size_t)binaryLength);
+    fin.read((char *)binary.data(), binary.size());
+    if (fin.gcount() != (std::streamsize)binary.size()) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("CL program cache broken: %s\n"), cacheFile.c_str());
+        return nullptr;
+    }
+    fin.close();
+
+    const size_t length = binary.size();
+    const unsigned char *ptr = binary.data();
+    cl_int binaryStatus = CL_SUCCESS;
+    cl_int err = CL_SUCCESS;
+    cl_program program = clCreateProgramWithBinary(m_context.get(), 1, m_platform->devs().data(), &length, &ptr, &binaryStatus, &err);
+    if (err != CL_SUCCESS || binaryStatus != CL_SUCCESS) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("Failed to load CL program cache %s: %s, fallback to source.\n"), cacheFile.c_str(), cl_errmes((err != CL_SUCCESS) ? err : binaryStatus));
+        if (program) {
+            clReleaseProgram(program);
+        }
+        return nullptr;
+    }
+    err = clBuildProgram(program, (cl_uint)m_platform->devs().size(), m_platform->devs().data(), options, NULL, NULL);
+    if (err != CL_SUCCESS) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("Failed to build CL program from cache %s: %s, fallback to source.\n"), cacheFile.c_str(), cl_errmes(err));
+        clReleaseProgram(program);
+        return nullptr;
+    }
+    m_pLog->write(RGY_LOG_DEBUG, _T("Loaded CL program cache: %s\n"), cacheFile.c_str());
+    return std::make_unique<RGYOpenCLProgram>(program, m_pLog, m_profiler);
+}
+
+void RGYOpenCLContext::saveProgramCache(RGYOpenCLProgram *program, const tstring& cacheFile, const std::string& cacheKey) {
+    const auto binary = program->getBinary();
+    if (binary.size() == 0) {
+        return;
+    }
+    if (!CreateDirectoryRecursive(m_programCacheDir.c_str())) {
+        m_pLog->write(RGY_LOG_DEBUG, _T("Failed to create CL program cache dir: %s\n"), m_programCacheDir.c_str());
+        return;
+    }
+    //書き込み途中のファイルを他のプロセスが読まないよう、一時ファイルに書いてから置き換える
+    const auto tmpFile = cacheFile + strsprintf(_T(".%u.tmp"), GetCurrentProcessId());
+    {
+        std::ofstream fout(tmpFile, std::ios::out | std::ios::binary | std::ios::trunc);
+        if (!fout.good()) {
+            m_pLog->write(RGY_LOG_DEBUG, _T("Failed to open CL program cache file: %s\n"), tmpFile.c_str());
+            return;
+        }
+        const uint32_t keyLength = (uint32_t)cacheKey.length();
+        const uint64_t binaryLength = binary.size();
+        fout.write(RGY_CL_CACHE_MAGIC, sizeof(RGY_CL_CACHE_MAGIC));
+        fout.write((const char *)&RGY_CL_CACHE_VERSION, sizeof(RGY_CL_CACHE_VERSION));
+        fout.write((const char *)&keyLength, sizeof(keyLength));
+        fout.write(cacheKey.c_str(), keyLength);
+        fout.write((const char *)&binaryLength, sizeof(binaryLength));
+        fout.write((const char *)binary.data(), binary.size());
+        if (!fout.good()) {
+            fout.close();
+            _tremove(tmpFile.c_str());
+            return;
+        }
+    }
+    if (!MoveFileEx(tmpFile.c_str(), cacheFile.c_str(), MOVEFILE_REPLACE_EXISTING)) {
+        _tremove(tmpFile.c_str());
+        return;
+    }
+    m_pLog->write(RGY_LOG_DEBUG, _T("Saved CL program cache: %s (%llu bytes)\n"), cacheFile.c_str(), (unsigned long long)binary.size());
 }
 
 unique_ptr<RGYOpenCLProgram> RGYOpenCLContext::build(const std::string &source, const char *options) {
@@ -1191,7 +1779,20 @@ unique_ptr<RGYCLFrame> RGYOpenCLContext::createImageFromFrameBuffer(const FrameI
     return std::make_unique<RGYCLFrame>(frameImage, flags);
 }
 
+void RGYOpenCLContext::trimFramePool() {
+    if (m_framePool) {
+        m_framePool->trim();
+    }
+}
+
 std::unique_ptr<RGYCLFrame> RGYOpenCLContext::createFrameBuffer(const FrameInfo& frame, cl_mem_flags flags) {
+    //返却済みのバッファがあれば再利用する
+    if (m_framePool) {
+        auto pooled = m_framePool->get(frame, flags);
+        if (pooled) {
+            return pooled;
+        }
+    }
     cl_int err = CL_SUCCESS;
     int pixsize = RGY_CSP_BIT_DEPTH[frame.csp] > 8 ? 2 : 1;
     switch (frame.csp) {
@@ -1212,8 +1813,8 @@ std::unique_ptr<RGYCLFrame> RGYOpenCLContext::createFrameBuffer(const FrameInfo&
     FrameInfo clframe = frame;
     clframe.mem_type = RGY_MEM_TYPE_GPU;
     for (int i = 0; i < _countof(clframe.ptr); i++) {
-        clframe.ptr[0] = nullptr;
-        clframe.pitch[0] = 0;
+        clframe.ptr[i] = nullptr;
+        clframe.pitch[i] = 0;
     }
     for (int i = 0; i < RGY_CSP_PLANES[frame.csp]; i++) {
         const auto plane = getPlane(&clframe, (RGY_PLANE)i);
@@ -1234,7 +1835,9 @@ std::unique_ptr<RGYCLFrame> RGYOpenCLContext::createFrameBuffer(const FrameInfo&
         clframe.pitch[i] = memPitch;
         clframe.ptr[i] = (uint8_t *)mem;
     }
-    return std::make_unique<RGYCLFrame>(clframe, flags);
+    auto ret = std::make_unique<RGYCLFrame>(clframe, flags);
+    ret->pool = m_framePool;
+    return ret;
 }
 
 RGYOpenCL::RGYOpenCL() : m_pLog(std::make_shared<RGYLog>(nullptr, RGY_LOG_ERROR)) {
@@ -38,6 +38,10 @@
 #include <CL/cl_dx9_media_sharing.h>
 #include <CL/cl_d3d11.h>
 #include <unordered_map>
+#include <map>
+#include <list>
+#include <mutex>
+#include <chrono>
 #include <vector>
 #include <array>
 #include <memory>
@@ -68,6 +72,7 @@ CL_EXTERN cl_int (CL_API_CALL* f_clGetCommandQueueInfo)(cl_command_queue command
 CL_EXTERN cl_int (CL_API_CALL* f_clReleaseCommandQueue) (cl_command_queue command_queue);
 
 CL_EXTERN cl_program(CL_API_CALL* f_clCreateProgramWithSource) (cl_context context, cl_uint count, const char **strings, const size_t *lengths, cl_int *errcode_ret);
+CL_EXTERN cl_program(CL_API_CALL* f_clCreateProgramWithBinary) (cl_context context, cl_uint num_devices, const cl_device_id *device_list, const size_t *lengths, const unsigned char **binaries, cl_int *binary_status, cl_int *errcode_ret);
 CL_EXTERN cl_int (CL_API_CALL* f_clBuildProgram) (cl_program program, cl_uint num_devices, const cl_device_id *device_list, const char *options, void (CL_CALLBACK *pfn_notify)(cl_program program, void *user_data), void* user_data);
 CL_EXTERN cl_int (CL_API_CALL* f_clGetProgramBuildInfo) (cl_program program, cl_device_id device, cl_program_build_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret);
 CL_EXTERN cl_int (CL_API_CALL* f_clGetProgramInfo)(cl_program program, cl_program_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret);
@@ -99,6 +104,7 @@ CL_EXTERN cl_int(CL_API_CALL *f_clEnqueueCopyBufferToImage)(cl_command_queue com
 CL_EXTERN void *(CL_API_CALL *f_clEnqueueMapBuffer)(cl_command_queue command_queue, cl_mem buffer, cl_bool blocking_map, cl_map_flags map_flags, size_t offset, size_t size, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event, cl_int *errcode_ret);
 CL_EXTERN void *(CL_API_CALL *f_clEnqueueMapImage)(cl_command_queue  command_queue, cl_mem image, cl_bool blocking_map, cl_map_flags map_flags, const size_t origin[3], const size_t region[3], size_t *image_row_pitch, size_t *image_slice_pitch, cl_uint  num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event, cl_int *errcode_ret);
 CL_EXTERN cl_int(CL_API_CALL *f_clEnqueueUnmapMemObject)(cl_command_queue command_queue, cl_mem memobj, void *mapped_ptr, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
+CL_EXTERN cl_int(CL_API_CALL *f_clEnqueueMarkerWithWaitList)(cl_command_queue command_queue, cl_uint num_events_in_wait_list, const cl_event *event_wait_list, cl_event *event);
 
 CL_EXTERN cl_int(CL_API_CALL *f_clWaitForEvents)(cl_uint num_events, const cl_event *event_list);
 CL_EXTERN cl_int(CL_API_CALL *f_clGetEventInfo)(cl_event event, cl_event_info param_name, size_t param_value_size, void *param_value, size_t *param_value_size_ret);
@@ -130,6 +136,7 @@ CL_EXTERN cl_int(CL_API_CALL *f_clGetKernelSubGroupInfoKHR)(cl_kernel kernel, cl
 #define clReleaseCommandQueue f_clReleaseCommandQueue
 
 #define clCreateProgramWithSource f_clCreateProgramWithSource
+#define clCreateProgramWithBinary f_clCreateProgramWithBinary
 #define clBuildProgram f_clBuildProgram
 #define clGetProgramBuildInfo f_clGetProgramBuildInfo
 #define clGetProgramInfo f_clGetProgramInfo
@@ -161,6 +168,7 @@ CL_EXTERN cl_int(CL_API_CALL *f_clGetKernelSubGroupInfoKHR)(cl_kernel kernel, cl
 #define clEnqueueMapBuffer f_clEnqueueMapBuffer
 #define clEnqueueMapImage f_clEnqueueMapImage
 #define clEnqueueUnmapMemObject f_clEnqueueUnmapMemObject
+#define clEnqueueMarkerWithWaitList f_clEnqueueMarkerWithWaitList
 
 #define clWaitForEvents f_clWaitForEvents
 #define clGetEventInfo f_clGetEventInfo
@@ -241,6 +249,17 @@ public:
     void wait() const {
         clWaitForEvents(1, &(*event_));
     }
+    //イベントが完了しているか (エラーで終了した場合も完了とみなす)
+    bool completed() const {
+        if (*event_ == nullptr) {
+            return true;
+        }
+        cl_int status = CL_QUEUED;
+        if (clGetEventInfo(*event_, CL_EVENT_COMMAND_EXECUTION_STATUS, sizeof(status), &status, nullptr) != CL_SUCCESS) {
+            return true;
+        }
+        return status <= CL_COMPLETE;
+    }
     void reset() {
         if (*event_ != nullptr) {
             event_ = std::shared_ptr<cl_event>(new cl_event, cl_event_deleter());
@@ -318,15 +337,73 @@ protected:
     RGYCLBufMap m_mapped;
 };
 
+struct RGYCLFrame;
+
+//RGYCLFramePoolで保持する未使用のバッファの上限
+//フィルタ1つの再初期化で返却され、直後に同じ形式で確保しなおされる分を想定 (4K NV12 (約12MB) で10フレーム程度)
+static const int RGY_CL_FRAME_POOL_MAX_IDLE_MB = 128;
+//RGYCLFramePoolが一定時間使われなかった場合に、未使用のバッファをここまで減らす
+//再初期化の直後に使われなかったバッファは以降も使われないことが多いので、すべて解放する
+static const int RGY_CL_FRAME_POOL_LOW_IDLE_MB = 0;
+//この時間get/recycleがなければ、未使用のバッファを減らす
+static const int RGY_CL_FRAME_POOL_TRIM_IDLE_MS = 1000;
+
+//RGYCLFrameのバッファを再利用するためのプール
+//RGYOpenCLContext::createFrameBuffer()で確保したRGYCLFrameは、解放時にバッファをここに返却し、
+//同じ形式(csp, 解像度, mem_flags)のフレームの確保時に再利用する
+//フィルタの再初期化(解像度の変更など)や、フィルタ間で同じ形式のバッファを確保・解放する場合に、
+//デバイスメモリの確保を省略する
+//定常状態のメモリ使用量を減らすものではなく、未使用のバッファはRGY_CL_FRAME_POOL_TRIM_IDLE_MS後に解放される
+//返却されたバッファはそのまま別のフィルタで使用されうるので、
+//返却前に投入した処理と同じキューで順序付けられない処理に使用する場合は、返却前に処理の完了を待つこと
+class RGYCLFramePool : public std::enable_shared_from_this<RGYCLFramePool> {
+public:
+    RGYCLFramePool(shared_ptr<RGYLog> pLog, size_t maxIdleBytes, size_t lowIdleBytes, int trimIdleMs);
+    ~RGYCLFramePool();
+    //条件に合う未使用のバッファがあれば取り出す (なければnullptr)
+    unique_ptr<RGYCLFrame> get(const FrameInfo &frame, cl_mem_flags flags);
+    //バッファを返却する (frame.ptrの所有権はプールに移る)
+    void recycle(const FrameInfo &frame, cl_mem_flags flags);
+    //未使用のバッファをすべて解放する
+    void clear();
+    //一定時間get/recycleが行われていなければ、未使用のバッファを古いものから解放し、lowIdleBytes以下にする
+    //定期的に呼ぶこと (時間を確認するだけなので、毎フレーム呼んでもかまわない)
+    void trim();
+    void printStats(int log_level);
+protected:
+    struct Entry {
+        FrameInfo frame;
+        cl_mem_flags flags;
+        size_t bytes;
+    };
+    static size_t frameBytes(const FrameInfo &frame);
+    static bool match(const Entry &entry, const FrameInfo &frame, cl_mem_flags flags);
+    static void release(Entry &entry);
+
+    shared_ptr<RGYLog> m_pLog;
+    std::mutex m_mtx;
+    std::list<Entry> m_idle; //未使用のバッファ (古いものが先頭)
+    size_t m_maxIdleBytes;
+    size_t m_lowIdleBytes; //trim()で減らす目標
+    std::chrono::milliseconds m_trimIdle; //trim()でバッファを減らすまでの、get/recycleが行われていない時間
+    std::chrono::steady_clock::time_point m_lastUsed; //最後にget/recycleが行われた時刻
+    size_t m_idleBytes;
+    uint64_t m_hit;
+    uint64_t m_miss;
+    uint64_t m_evict;
+    uint64_t m_trimmed; //trim()で解放した数
+};
+
 struct RGYCLFrame {
 public:
     FrameInfo frame;
     cl_mem_flags flags;
+    std::weak_ptr<RGYCLFramePool> pool; //解放時にバッファを返却するプール
     RGYCLFrame()
-        : frame(), flags(0) {
+        : frame(), flags(0), pool() {
     };
     RGYCLFrame(const FrameInfo &info_, cl_mem_flags flags_ = CL_MEM_READ_WRITE)
-        : frame(info_), flags(flags_) {
+        : frame(info_), flags(flags_), pool() {
     };
 protected:
     RGYCLFrame(const RGYCLFrame &) = delete;
@@ -336,6 +413,16 @@ public:
         return (cl_mem&)frame.ptr[i];
     }
     void clear() {
+        auto framePool = pool.lock();
+        pool.reset();
+        if (framePool && frame.mem_type == RGY_MEM_TYPE_GPU && mem(0)) {
+            framePool->recycle(frame, flags);
+            for (int i = 0; i < _countof(frame.ptr); i++) {
+                mem(i) = nullptr;
+                frame.pitch[i] = 0;
+            }
+            return;
+        }
         for (int i = 0; i < _countof(frame.ptr); i++) {
             if (mem(i)) {
                 clReleaseMemObject(mem(i));
@@ -479,9 +566,63 @@ public:
     size_t size() const { return size_; }
 };
 
+//OpenCLのコマンドのGPU上での実行時間を計測する
+//CL_QUEUE_PROFILING_ENABLEで作成したキューに投入したコマンドのイベントを登録しておき、
+//完了したものから順に開始・終了時刻を取得して、フィルタ(stage)ごと・カーネルごとに集計する
+class RGYOpenCLProfiler {
+public:
+    RGYOpenCLProfiler(shared_ptr<RGYLog> pLog);
+    ~RGYOpenCLProfiler();
+
+    //以降に投入されるコマンドを集計するフィルタ名を設定する
+    void setStage(const tstring& stage);
+    //コマンドの完了イベントを登録する
+    void add(const std::string& name, const RGYOpenCLEvent& event);
+    //完了したイベントの実行時間を集計する (wait = trueなら、未完了のイベントの完了を待つ)
+    void collect(bool wait);
+    //集計結果をログに出力する
+    void print(int log_level);
+    //集計結果をjsonで出力する
+    RGY_ERR writeJson(const tstring& filename);
+protected:
+    static const int COLLECT_THRESHOLD = 256; //未集計のイベントがこれを超えたら、完了したものを集計する
+
+    struct Record {
+        int stage;            //m_stageNameのindex
+        uint64_t run;         //何回目のsetStage()で投入されたか
+        std::string name;     //カーネル名など
+        RGYOpenCLEvent event;
+    };
+    struct StageRun {
+        int stage;
+        int pending;          //未集計のイベントの数
+        double sumUs;         //集計済みのイベントの実行時間の合計
+    };
+    struct Stats {
+        int count;
+        double total, avg, p50, p99, max;
+    };
+    int stageIndex(const tstring& stage);
+    void collectPending(bool wait);
+    void collectRecord(const Record& record, bool completed);
+    void closeRun(uint64_t run, bool force);
+    static Stats calcStats(std::vector<float> values);
+
+    shared_ptr<RGYLog> m_pLog;
+    std::mutex m_mtx;
+    std::vector<tstring> m_stageName;
+    std::vector<Record> m_pending;
+    std::map<uint64_t, StageRun> m_runs;
+    uint64_t m_currentRun;
+    int m_currentStage;
+    std::vector<std::vector<float>> m_stageTime;                     //フィルタごと、1回のfilter()あたりの実行時間 (us)
+    std::map<std::pair<int, std::string>, std::vector<float>> m_kernelTime; //フィルタ・カーネルごとの1回あたりの実行時間 (us)
+    uint64_t m_errorCount;
+};
+
 class RGYOpenCLKernelLauncher {
 public:
-    RGYOpenCLKernelLauncher(cl_kernel kernel, std::string kernelName, cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global, shared_ptr<RGYLog> pLog, const std::vector<RGYOpenCLEvent>& wait_events, RGYOpenCLEvent *event);
+    RGYOpenCLKernelLauncher(cl_kernel kernel, std::string kernelName, cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global, shared_ptr<RGYLog> pLog, const std::vector<RGYOpenCLEvent>& wait_events, RGYOpenCLEvent *event, shared_ptr<RGYOpenCLProfiler> profiler = nullptr);
     virtual ~RGYOpenCLKernelLauncher() {};
 
     RGY_ERR launch(std::vector<void *> arg_ptrs = std::vector<void *>(), std::vector<size_t> arg_size = std::vector<size_t>(), std::vector<std::type_index> = std::vector<std::type_index>());
@@ -507,12 +648,13 @@ protected:
     shared_ptr<RGYLog> m_pLog;
     std::vector<cl_event> m_wait_events;
     RGYOpenCLEvent *m_event;
+    shared_ptr<RGYOpenCLProfiler> m_profiler;
 };
 
 class RGYOpenCLKernel {
 public:
-    RGYOpenCLKernel() : m_kernel(), m_kernelName(), m_pLog() {};
-    RGYOpenCLKernel(cl_kernel kernel, std::string kernelName, shared_ptr<RGYLog> pLog);
+    RGYOpenCLKernel() : m_kernel(), m_kernelName(), m_pLog(), m_profiler() {};
+    RGYOpenCLKernel(cl_kernel kernel, std::string kernelName, shared_ptr<RGYLog> pLog, shared_ptr<RGYOpenCLProfiler> profiler = nullptr);
     cl_kernel get() const { return m_kernel; }
     virtual ~RGYOpenCLKernel();
     RGYOpenCLKernelLauncher config(cl_command_queue queue, const RGYWorkSize &local, const RGYWorkSize &global);
@@ -522,11 +664,12 @@ protected:
     cl_kernel m_kernel;
     std::string m_kernelName;
     shared_ptr<RGYLog> m_pLog;
+    shared_ptr<RGYOpenCLProfiler> m_profiler;
 };
 
 class RGYOpenCLProgram {
 public:
-    RGYOpenCLProgram(cl_program program, shared_ptr<RGYLog> pLog);
+    RGYOpenCLProgram(cl_program program, shared_ptr<RGYLog> pLog, shared_ptr<RGYOpenCLProfiler> profiler = nullptr);
     virtual ~RGYOpenCLProgram();
 
     RGYOpenCLKernel kernel(const char *kernelName);
@@ -534,6 +677,7 @@ public:
 protected:
     cl_program m_program;
     shared_ptr<RGYLog> m_pLog;
+    shared_ptr<RGYOpenCLProfiler> m_profiler;
 };
 
 class RGYOpenCLQueue {
@@ -560,6 +704,8 @@ public:
     }
     RGY_ERR flush() const;
     RGY_ERR finish() const;
+    //それまでに投入されたすべてのコマンドの完了を示すイベントを取得する
+    RGY_ERR marker(RGYOpenCLEvent *event) const;
     void clear();
 protected:
     RGYOpenCLQueue(const RGYOpenCLQueue &) = delete;
@@ -580,11 +726,17 @@ public:
     virtual ~RGYOpenCLContext();
 
     RGY_ERR createContext();
+    //createContext()の前に呼ぶと、キューをCL_QUEUE_PROFILING_ENABLEで作成し、各コマンドの実行時間を計測する
+    void enableProfiling();
+    RGYOpenCLProfiler *profiler() { return m_profiler.get(); };
     cl_context context() const { return m_context.get(); };
     const RGYOpenCLQueue& queue(int idx=0) const { return m_queue[idx]; };
     RGYOpenCLQueue& queue(int idx=0) { return m_queue[idx]; };
     RGYOpenCLPlatform *platform() const { return m_platform.get(); };
 
+    //ビルドしたプログラムのバイナリをキャッシュするディレクトリ (空ならキャッシュしない)
+    void setProgramCacheDir(const tstring& dir) { m_programCacheDir = dir; };
+    const tstring& programCacheDir() const { return m_programCacheDir; };
     unique_ptr<RGYOpenCLProgram> build(const std::string& source, const char *options);
     unique_ptr<RGYOpenCLProgram> buildFile(const tstring &filename, const char *options);
     unique_ptr<RGYOpenCLProgram> buildResource(const TCHAR *name, const TCHAR *type, const char *options);
@@ -595,6 +747,8 @@ public:
     RGY_ERR createImageFromPlane(cl_mem& image, cl_mem buffer, int bit_depth, int channel_order, bool normalized, int pitch, int width, int height, cl_mem_flags flags);
     unique_ptr<RGYCLFrame> createImageFromFrameBuffer(const FrameInfo &frame, bool normalized, cl_mem_flags flags);
     unique_ptr<RGYCLFrame> createFrameBuffer(const FrameInfo &frame, cl_mem_flags flags = CL_MEM_READ_WRITE);
+    //しばらく使われていないフレームプールのバッファを解放する
+    void trimFramePool();
     RGY_ERR copyFrame(FrameInfo *dst, const FrameInfo *src);
     RGY_ERR copyFrame(FrameInfo *dst, const FrameInfo *src, const sInputCrop *srcCrop);
     RGY_ERR copyFrame(FrameInfo *dst, const FrameInfo *src, const sInputCrop *srcCrop, cl_command_queue queue);
@@ -617,6 +771,9 @@ public:
     RGY_ERR setFrame(int value, FrameInfo *dst, const sInputCrop *srcCrop, cl_command_queue queue, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event = nullptr);
 protected:
     unique_ptr<RGYOpenCLProgram> build(const char *data, const size_t size, const char *options);
+    unique_ptr<RGYOpenCLProgram> buildFromCache(const tstring& cacheFile, const std::string& cacheKey, const char *options);
+    void saveProgramCache(RGYOpenCLProgram *program, const tstring& cacheFile, const std::string& cacheKey);
+    tstring programCacheFile(const char *data, const size_t size, const char *options, std::string& cacheKey);
 
     shared_ptr<RGYOpenCLPlatform> m_platform;
     unique_context m_context;
@@ -628,6 +785,13 @@ protected:
     unique_ptr<RGYOpenCLProgram> m_copyI2I;
     unique_ptr<RGYOpenCLProgram> m_setB;
     unique_ptr<RGYOpenCLProgram> m_setI;
+    shared_ptr<RGYOpenCLProfiler> m_profiler;
+    shared_ptr<RGYCLFramePool> m_framePool;
+    tstring m_programCacheDir;      //プログラムのバイナリのキャッシュの保存先
+    std::string m_programCacheBase; //キャッシュのキーのうち、プラットフォーム・デバイス・ドライバに依存する部分
+    int m_programBuildCount;        //build()の回数
+    int m_programCacheHit;          //そのうちキャッシュから読み込めた回数
+    double m_programBuildMs;        //build()にかかった時間の合計
 };
 
 class RGYOpenCL {
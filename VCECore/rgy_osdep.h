@@ -72,6 +72,7 @@
 #include <pthread.h>
 #include <sched.h>
 #include <dlfcn.h>
+#include <sys/syscall.h>
 
 static inline void *_aligned_malloc(size_t size, size_t alignment) {
     void *p;
@@ -281,6 +282,11 @@ static pthread_t GetCurrentThread() {
     return pthread_self();
 }
 
+//Linuxではtidを返す
+static uint32_t GetCurrentThreadId() {
+    return (uint32_t)syscall(SYS_gettid);
+}
+
 static void SetThreadAffinityMask(pthread_t thread, size_t mask) {
     cpu_set_t cpuset;
     CPU_ZERO(&cpuset);
@@ -28,6 +28,11 @@
 #include "rgy_output.h"
 #include "rgy_bitstream.h"
 #include <smmintrin.h>
+#if !(defined(_WIN32) || defined(_WIN64))
+#include <sys/uio.h>
+#include <climits>
+#include <cerrno>
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 
 #if ENCODER_QSV
 
@@ -105,7 +110,7 @@ void RGYOutput::Close() {
 }
 
 RGYOutputRaw::RGYOutputRaw() :
-    m_outputBuf2(),
+    m_segments(),
     m_seiNal()
 #if ENABLE_AVSW_READER
     , m_pBsfc()
@@ -279,31 +284,79 @@ RGY_ERR RGYOutputRaw::Init(const TCHAR *strFileName, const VideoInfo *pVideoOutp
 }
 #pragma warning (pop)
 
+size_t RGYOutputRaw::WriteSegments() {
+    size_t nBytesWritten = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    //writevがないので、順にバッファに書き込む
+    for (const auto& seg : m_segments) {
+        nBytesWritten += _fwrite_nolock(seg.ptr, 1, seg.size, m_fDest.get());
+    }
+#else
+    //stdioのバッファに残っているデータを先に出力してから、writevでまとめて出力する
+    if (fflush(m_fDest.get()) != 0) {
+        return 0;
+    }
+    const int fd = fileno(m_fDest.get());
+    struct iovec iov[64];
+    size_t iseg = 0;
+    size_t segOffset = 0; //m_segments[iseg]のうち、出力済みのバイト数
+    while (iseg < m_segments.size()) {
+        int iovcnt = 0;
+        for (size_t i = iseg; i < m_segments.size() && iovcnt < (int)_countof(iov); i++, iovcnt++) {
+            const size_t offset = (i == iseg) ? segOffset : 0;
+            iov[iovcnt].iov_base = (void *)(m_segments[i].ptr + offset);
+            iov[iovcnt].iov_len = m_segments[i].size - offset;
+        }
+        const auto ret = writev(fd, iov, iovcnt);
+        if (ret <= 0) {
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        //一部しか出力されなかった場合は、続きから再度出力する
+        size_t written = (size_t)ret;
+        nBytesWritten += written;
+        while (iseg < m_segments.size() && written >= m_segments[iseg].size - segOffset) {
+            written -= m_segments[iseg].size - segOffset;
+            segOffset = 0;
+            iseg++;
+        }
+        segOffset += written;
+    }
+#endif
+    return nBytesWritten;
+}
+
 RGY_ERR RGYOutputRaw::WriteNextFrame(RGYBitstream *pBitstream) {
     if (pBitstream == nullptr) {
         AddMessage(RGY_LOG_ERROR, _T("Invalid call: WriteNextFrame\n"));
         return RGY_ERR_NULL_PTR;
     }
 
-    size_t nBytesWritten = 0;
+    size_t outputSize = pBitstream->size();
     if (!m_noOutput) {
+        //SPSの置き換えやSEIの挿入が必要な場合は、フレームのデータを移動/コピーせず、
+        //出力するデータの断片のリストを作成してまとめて出力する
+        nal_info sps_nal = { nullptr, 0, 0 }; //bsfで置き換えるSPS
+        RGYNalList nal_list;
 #if ENABLE_AVSW_READER
+        AVPacket pkt = { 0 }; //bsfで置き換えたSPS
         if (m_pBsfc) {
             uint8_t nal_type = 0;
-            std::vector<nal_info> nal_list;
             if (m_VideoOutputInfo.codec == RGY_CODEC_HEVC) {
                 nal_type = NALU_HEVC_SPS;
-                nal_list = parse_nal_unit_hevc(pBitstream->data(), pBitstream->size());
+                parse_nal_unit_hevc(nal_list, pBitstream->data(), pBitstream->size());
             } else if (m_VideoOutputInfo.codec == RGY_CODEC_H264) {
                 nal_type = NALU_H264_SPS;
-                nal_list = parse_nal_unit_h264(pBitstream->data(), pBitstream->size());
+                parse_nal_unit_h264(nal_list, pBitstream->data(), pBitstream->size());
             }
-            auto sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
-            if (sps_nal != nal_list.end()) {
-                AVPacket pkt = { 0 };
+            auto sps_nal_it = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
+            if (sps_nal_it != nal_list.end()) {
+                sps_nal = *sps_nal_it;
                 av_init_packet(&pkt);
-                av_new_packet(&pkt, (int)sps_nal->size);
-                memcpy(pkt.data, sps_nal->ptr, sps_nal->size);
+                av_new_packet(&pkt, (int)sps_nal.size);
+                memcpy(pkt.data, sps_nal.ptr, sps_nal.size);
                 int ret = 0;
                 if (0 > (ret = av_bsf_send_packet(m_pBsfc.get(), &pkt))) {
                     av_packet_unref(&pkt);
@@ -319,59 +372,72 @@ RGY_ERR RGYOutputRaw::WriteNextFrame(RGYBitstream *pBitstream) {
                         char_to_tstring(m_pBsfc->filter->name).c_str(), qsv_av_err2str(ret).c_str());
                     return RGY_ERR_UNKNOWN;
                 }
-                const auto new_data_size = pBitstream->size() + pkt.size - sps_nal->size;
-                const auto sps_nal_offset = sps_nal->ptr - pBitstream->data();
-                const auto next_nal_orig_offset = sps_nal_offset + sps_nal->size;
-                const auto next_nal_new_offset = sps_nal_offset + pkt.size;
-                const auto stream_orig_length = pBitstream->size();
-                if ((decltype(new_data_size))pBitstream->bufsize() < new_data_size) {
-#if ENCODER_QSV
-                    pBitstream->changeSize(new_data_size);
-#else //NVEnc, VCEの場合はこうしないとメモリリークが発生する
-                    const auto org_data_size = pBitstream->size();
-                    m_outputBuf2.resize(new_data_size);
-                    memcpy(m_outputBuf2.data(), pBitstream->data(), org_data_size);
-                    pBitstream->release();
-                    pBitstream->ref(m_outputBuf2.data(), m_outputBuf2.size());
-#endif
-                } else if (pkt.size > (decltype(pkt.size))sps_nal->size) {
-                    pBitstream->trim();
-                }
-                memmove(pBitstream->data() + next_nal_new_offset, pBitstream->data() + next_nal_orig_offset, stream_orig_length - next_nal_orig_offset);
-                memcpy(pBitstream->data() + sps_nal_offset, pkt.data, pkt.size);
-                av_packet_unref(&pkt);
+                outputSize = pBitstream->size() + pkt.size - sps_nal.size;
             }
         }
 #endif //#if ENABLE_AVSW_READER
+        //nal_infoのかわりに出力するデータ (SPSはbsfの結果に置き換える)
+        auto nal_segment = [&](const nal_info& nal) {
+            RGYOutputSegment seg = { nal.ptr, nal.size };
+#if ENABLE_AVSW_READER
+            if (sps_nal.ptr && nal.ptr == sps_nal.ptr) {
+                seg.ptr = pkt.data;
+                seg.size = pkt.size;
+            }
+#endif //#if ENABLE_AVSW_READER
+            return seg;
+        };
+        m_segments.clear();
         if (m_seiNal.size() > 0 && (pBitstream->frametype() & (RGY_FRAMETYPE_IDR|RGY_FRAMETYPE_xIDR)) != 0) {
-            const auto nal_list = parse_nal_unit_hevc(pBitstream->data(), pBitstream->size());
+            if (!m_pBsfc || m_VideoOutputInfo.codec != RGY_CODEC_HEVC) {
+                //NALの区切りはH.264として解析した場合と同じなので、sps_nalとはptrで対応がとれる
+                parse_nal_unit_hevc(nal_list, pBitstream->data(), pBitstream->size());
+            }
             const auto hevc_vps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_VPS; });
             const auto hevc_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
             const auto hevc_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_PPS; });
             const bool header_check = (nal_list.end() != hevc_vps_nal) && (nal_list.end() != hevc_sps_nal) && (nal_list.end() != hevc_pps_nal);
+            const RGYOutputSegment sei = { m_seiNal.data(), m_seiNal.size() };
             bool seiWritten = false;
             if (!header_check) {
-                nBytesWritten += _fwrite_nolock(m_seiNal.data(), 1, m_seiNal.size(), m_fDest.get());
+                m_segments.push_back(sei);
                 seiWritten = true;
             }
             for (size_t i = 0; i < nal_list.size(); i++) {
-                nBytesWritten += _fwrite_nolock(nal_list[i].ptr, 1, nal_list[i].size, m_fDest.get());
+                m_segments.push_back(nal_segment(nal_list[i]));
                 if (nal_list[i].type == NALU_HEVC_VPS || nal_list[i].type == NALU_HEVC_SPS || nal_list[i].type == NALU_HEVC_PPS) {
                     if (!seiWritten
                         && i+1 < nal_list.size()
                         && (nal_list[i+1].type != NALU_HEVC_VPS && nal_list[i+1].type != NALU_HEVC_SPS && nal_list[i+1].type != NALU_HEVC_PPS)) {
-                        nBytesWritten += _fwrite_nolock(m_seiNal.data(), 1, m_seiNal.size(), m_fDest.get());
+                        m_segments.push_back(sei);
                         seiWritten = true;
                     }
                 }
             }
+        } else if (sps_nal.ptr) {
+            const RGYOutputSegment head = { pBitstream->data(), (size_t)(sps_nal.ptr - pBitstream->data()) };
+            const RGYOutputSegment tail = { sps_nal.ptr + sps_nal.size, pBitstream->size() - head.size - sps_nal.size };
+            m_segments.push_back(head);
+            m_segments.push_back(nal_segment(sps_nal));
+            m_segments.push_back(tail);
+        }
+        if (m_segments.size() > 0) {
+            size_t expectedBytes = 0;
+            for (const auto& seg : m_segments) {
+                expectedBytes += seg.size;
+            }
+            const size_t nBytesWritten = WriteSegments();
+#if ENABLE_AVSW_READER
+            av_packet_unref(&pkt);
+#endif //#if ENABLE_AVSW_READER
+            WRITE_CHECK(nBytesWritten, expectedBytes);
         } else {
-            nBytesWritten = _fwrite_nolock(pBitstream->data(), 1, pBitstream->size(), m_fDest.get());
+            const size_t nBytesWritten = _fwrite_nolock(pBitstream->data(), 1, pBitstream->size(), m_fDest.get());
             WRITE_CHECK(nBytesWritten, pBitstream->size());
         }
     }
 
-    m_encSatusInfo->SetOutputData(pBitstream->frametype(), pBitstream->size(), 0);
+    m_encSatusInfo->SetOutputData(pBitstream->frametype(), outputSize, 0);
     pBitstream->setSize(0);
 
     return RGY_ERR_NONE;
@@ -187,6 +187,12 @@ struct RGYOutputRawPrm {
     const HEVCHDRSei *hedrsei;
 };
 
+//まとめて出力するデータの断片
+struct RGYOutputSegment {
+    const uint8_t *ptr;
+    size_t size;
+};
+
 class RGYOutputRaw : public RGYOutput {
 public:
 
@@ -198,7 +204,10 @@ public:
 protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, const VideoInfo *pOutputInfo, const void *prm) override;
 
-    vector<uint8_t> m_outputBuf2;
+    //m_segmentsを順に出力し、出力したバイト数を返す
+    size_t WriteSegments();
+
+    vector<RGYOutputSegment> m_segments; //出力するデータの断片 (SEIの挿入やSPSの置き換えの際、フレームのデータをコピーせずに出力するため)
     vector<uint8_t> m_seiNal;
 #if ENABLE_AVSW_READER
     unique_ptr<AVBSFContext, RGYAVDeleter<AVBSFContext>> m_pBsfc;
@@ -180,7 +180,7 @@ void RGYOutputAvcodec::CloseQueues() {
     m_Mux.thread.thAudEncodeAbort = true;
     m_Mux.thread.thAudProcessAbort = true;
     m_Mux.thread.abortOutput = true;
-    m_Mux.thread.qVideobitstream.close();
+    m_Mux.thread.qVideobitstream.close([](RGYBitstream *pBitstream) { pBitstream->clear(); });
     m_Mux.thread.qVideobitstreamFreeI.close([](RGYBitstream *pBitstream) { pBitstream->clear(); });
     m_Mux.thread.qVideobitstreamFreePB.close([](RGYBitstream *pBitstream) { pBitstream->clear(); });
     m_Mux.thread.qAudioPacketOut.close();
@@ -200,6 +200,7 @@ void RGYOutputAvcodec::CloseThread() {
             SetEvent(m_Mux.thread.heEventPktAddedAudEncode);
         }
         m_Mux.thread.thAudEncode.join();
+        m_Mux.thread.thAudEncodeId.reset();
         CloseEvent(m_Mux.thread.heEventPktAddedAudEncode);
         CloseEvent(m_Mux.thread.heEventClosingAudEncode);
         AddMessage(RGY_LOG_DEBUG, _T("closed audio encode thread...\n"));
@@ -212,6 +213,7 @@ void RGYOutputAvcodec::CloseThread() {
             SetEvent(m_Mux.thread.heEventPktAddedAudProcess);
         }
         m_Mux.thread.thAudProcess.join();
+        m_Mux.thread.thAudProcessId.reset();
         CloseEvent(m_Mux.thread.heEventPktAddedAudProcess);
         CloseEvent(m_Mux.thread.heEventClosingAudProcess);
         AddMessage(RGY_LOG_DEBUG, _T("closed audio process thread...\n"));
@@ -228,6 +230,7 @@ void RGYOutputAvcodec::CloseThread() {
             SetEvent(m_Mux.thread.heEventPktAddedOutput);
         }
         m_Mux.thread.thOutput.join();
+        m_Mux.thread.thOutputId.reset();
         CloseEvent(m_Mux.thread.heEventPktAddedOutput);
         CloseEvent(m_Mux.thread.heEventClosingOutput);
         AddMessage(RGY_LOG_DEBUG, _T("closed output thread...\n"));
@@ -1902,6 +1905,10 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
         m_Mux.thread.qVideobitstream.init(4096, (std::max)(256, (m_Mux.video.outputFps.den) ? m_Mux.video.outputFps.num * 4 / m_Mux.video.outputFps.den : 0));
         m_Mux.thread.qVideobitstreamFreeI.init(256);
         m_Mux.thread.qVideobitstreamFreePB.init(3840);
+        if (m_Mux.thread.queueInfo) {
+            m_Mux.thread.qAudioPacketOut.set_stall_info(&m_Mux.thread.queueInfo->stall_aud_out, &m_Mux.thread.queueInfo->stall_us_aud_out);
+            m_Mux.thread.qVideobitstream.set_stall_info(&m_Mux.thread.queueInfo->stall_vid_out, &m_Mux.thread.queueInfo->stall_us_vid_out);
+        }
         m_Mux.thread.heEventPktAddedOutput = CreateEvent(NULL, TRUE, FALSE, NULL);
         m_Mux.thread.heEventClosingOutput  = CreateEvent(NULL, TRUE, FALSE, NULL);
         m_Mux.thread.thOutput = std::thread(&RGYOutputAvcodec::WriteThreadFunc, this);
@@ -1909,12 +1916,18 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
         if (m_Mux.thread.enableAudProcessThread) {
             AddMessage(RGY_LOG_DEBUG, _T("starting audio process thread...\n"));
             m_Mux.thread.qAudioPacketProcess.init(16384, audioQueueCapacity * std::max(2, (int)m_Mux.audio.size()), 4);
+            if (m_Mux.thread.queueInfo) {
+                m_Mux.thread.qAudioPacketProcess.set_stall_info(&m_Mux.thread.queueInfo->stall_aud_proc, &m_Mux.thread.queueInfo->stall_us_aud_proc);
+            }
             m_Mux.thread.heEventPktAddedAudProcess = CreateEvent(NULL, TRUE, FALSE, NULL);
             m_Mux.thread.heEventClosingAudProcess  = CreateEvent(NULL, TRUE, FALSE, NULL);
             m_Mux.thread.thAudProcess = std::thread(&RGYOutputAvcodec::ThreadFuncAudThread, this);
             if (m_Mux.thread.enableAudEncodeThread) {
                 AddMessage(RGY_LOG_DEBUG, _T("starting audio encode thread...\n"));
                 m_Mux.thread.qAudioFrameEncode.init(16384, audioQueueCapacity * std::max(2, (int)m_Mux.audio.size()), 4);
+                if (m_Mux.thread.queueInfo) {
+                    m_Mux.thread.qAudioFrameEncode.set_stall_info(&m_Mux.thread.queueInfo->stall_aud_enc, &m_Mux.thread.queueInfo->stall_us_aud_enc);
+                }
                 m_Mux.thread.heEventPktAddedAudEncode = CreateEvent(NULL, TRUE, FALSE, NULL);
                 m_Mux.thread.heEventClosingAudEncode  = CreateEvent(NULL, TRUE, FALSE, NULL);
                 m_Mux.thread.thAudEncode = std::thread(&RGYOutputAvcodec::ThreadFuncAudEncodeThread, this);
@@ -1935,7 +1948,8 @@ RGY_ERR RGYOutputAvcodec::Init(const TCHAR *strFileName, const VideoInfo *videoO
 }
 
 RGY_ERR RGYOutputAvcodec::AddH264HeaderToExtraData(const RGYBitstream *bitstream) {
-    std::vector<nal_info> nal_list = parse_nal_unit_h264(bitstream->data(), bitstream->size());
+    RGYNalList nal_list;
+    parse_nal_unit_h264(nal_list, bitstream->data(), bitstream->size());
     const auto h264_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_H264_SPS; });
     const auto h264_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_H264_PPS; });
     const bool header_check = (nal_list.end() != h264_sps_nal) && (nal_list.end() != h264_pps_nal);
@@ -1954,7 +1968,8 @@ RGY_ERR RGYOutputAvcodec::AddH264HeaderToExtraData(const RGYBitstream *bitstream
 
 //extradataにHEVCのヘッダーを追加する
 RGY_ERR RGYOutputAvcodec::AddHEVCHeaderToExtraData(const RGYBitstream *bitstream) {
-    std::vector<nal_info> nal_list = parse_nal_unit_hevc(bitstream->data(), bitstream->size());
+    RGYNalList nal_list;
+    parse_nal_unit_hevc(nal_list, bitstream->data(), bitstream->size());
     const auto hevc_vps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_VPS; });
     const auto hevc_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
     const auto hevc_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_PPS; });
@@ -2177,6 +2192,18 @@ uint32_t RGYOutputAvcodec::getH264PAFFFieldLength(const uint8_t *ptr, uint32_t s
 RGY_ERR RGYOutputAvcodec::WriteNextFrame(RGYBitstream *bitstream) {
 #if ENABLE_AVCODEC_OUT_THREAD
     if (m_Mux.thread.thOutput.joinable()) {
+        if (bitstream->hasRefOwner() && m_Mux.thread.qVideobitstream.size() < VID_BITSTREAM_QUEUE_SIZE_REF) {
+            //参照しているバッファの所有権ごとキューに渡し、コピーを省略する
+            //バッファはWriteNextFrameInternalで書き出した後に解放される
+            if (!m_Mux.thread.qVideobitstream.push(*bitstream)) {
+                AddMessage(RGY_LOG_ERROR, _T("Failed to allocate memory for video bitstream queue.\n"));
+                m_Mux.format.streamError = true;
+                return RGY_ERR_MEMORY_ALLOC;
+            }
+            bitstream->detach();
+            SetEvent(m_Mux.thread.heEventPktAddedOutput);
+            return (m_Mux.format.streamError) ? RGY_ERR_UNKNOWN : RGY_ERR_NONE;
+        }
         RGYBitstream copyStream = RGYBitstreamInit();
         bool bFrameI = (bitstream->frametype() & RGY_FRAMETYPE_I) != 0;
         bool bFrameP = (bitstream->frametype() & RGY_FRAMETYPE_P) != 0;
@@ -2301,13 +2328,13 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
 
     if (m_Mux.video.bsfc) {
         int target_nal = 0;
-        std::vector<nal_info> nal_list;
+        RGYNalList nal_list;
         if (m_VideoOutputInfo.codec == RGY_CODEC_HEVC) {
             target_nal = NALU_HEVC_SPS;
-            nal_list = parse_nal_unit_hevc(bitstream->data(), bitstream->size());
+            parse_nal_unit_hevc(nal_list, bitstream->data(), bitstream->size());
         } else if (m_VideoOutputInfo.codec == RGY_CODEC_H264) {
             target_nal = NALU_H264_SPS;
-            nal_list = parse_nal_unit_h264(bitstream->data(), bitstream->size());
+            parse_nal_unit_h264(nal_list, bitstream->data(), bitstream->size());
         }
         auto sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [target_nal](nal_info info) { return info.type == target_nal; });
         if (sps_nal != nal_list.end()) {
@@ -2350,7 +2377,8 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
     bool isIDR = (bitstream->frametype() & (RGY_FRAMETYPE_IDR | RGY_FRAMETYPE_xIDR)) != 0;
     if (m_Mux.video.streamOut->codecpar->field_order != AV_FIELD_PROGRESSIVE) {
         if (m_VideoOutputInfo.codec == RGY_CODEC_H264) {
-            const auto nal_list = parse_nal_unit_h264(bitstream->data(), bitstream->size());
+            RGYNalList nal_list;
+            parse_nal_unit_h264(nal_list, bitstream->data(), bitstream->size());
             //インタレ保持の際、IDRかどうかのフラグが正しく設定されていないことがある
             //どちらかのフィールドがIDRならIDRのフラグを立てる
             isIDR = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_H264_IDR; }) != nal_list.end();
@@ -2364,7 +2392,8 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
         && isIDR) {
         RGYBitstream bsCopy = RGYBitstreamInit();
         bsCopy.copy(bitstream);
-        const auto nal_list = parse_nal_unit_hevc(bsCopy.data(), bsCopy.size());
+        RGYNalList nal_list;
+        parse_nal_unit_hevc(nal_list, bsCopy.data(), bsCopy.size());
         const auto hevc_vps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_VPS; });
         const auto hevc_sps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_SPS; });
         const auto hevc_pps_nal = std::find_if(nal_list.begin(), nal_list.end(), [](nal_info info) { return info.type == NALU_HEVC_PPS; });
@@ -2441,7 +2470,10 @@ RGY_ERR RGYOutputAvcodec::WriteNextFrameInternal(RGYBitstream *bitstream, int64_
     m_encSatusInfo->SetOutputData(frameType, bitstream->size(), bitstream->avgQP());
 #if ENABLE_AVCODEC_OUT_THREAD
     //最初のヘッダーを書いたパケットはコピーではないので、キューに入れない
-    if (m_Mux.thread.thOutput.joinable()) {
+    if (m_Mux.thread.thOutput.joinable() && bitstream->hasRefOwner()) {
+        //エンコーダのバッファを参照していた場合は、使いまわさずに解放する
+        bitstream->clear();
+    } else if (m_Mux.thread.thOutput.joinable()) {
         //確保したメモリ領域を使いまわすためにキューに格納
         const auto frameI = (frameType & (RGY_FRAMETYPE_IDR | RGY_FRAMETYPE_I)) != 0;
         auto& qVideoQueueFree = (frameI) ? m_Mux.thread.qVideobitstreamFreeI : m_Mux.thread.qVideobitstreamFreePB;
@@ -3312,6 +3344,7 @@ RGY_ERR RGYOutputAvcodec::WriteNextAudioFrame(AVPktMuxData *pktData) {
 
 RGY_ERR RGYOutputAvcodec::ThreadFuncAudEncodeThread() {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
+    m_Mux.thread.thAudEncodeId.set();
     WaitForSingleObject(m_Mux.thread.heEventPktAddedAudEncode, INFINITE);
     while (!m_Mux.thread.thAudEncodeAbort) {
         if (!m_Mux.format.fileHeaderWritten) {
@@ -3339,6 +3372,7 @@ RGY_ERR RGYOutputAvcodec::ThreadFuncAudEncodeThread() {
 
 RGY_ERR RGYOutputAvcodec::ThreadFuncAudThread() {
 #if ENABLE_AVCODEC_AUDPROCESS_THREAD
+    m_Mux.thread.thAudProcessId.set();
     WaitForSingleObject(m_Mux.thread.heEventPktAddedAudProcess, INFINITE);
     while (!m_Mux.thread.thAudProcessAbort) {
         if (!m_Mux.format.fileHeaderWritten) {
@@ -3367,6 +3401,7 @@ RGY_ERR RGYOutputAvcodec::ThreadFuncAudThread() {
 
 RGY_ERR RGYOutputAvcodec::WriteThreadFunc() {
 #if ENABLE_AVCODEC_OUT_THREAD
+    m_Mux.thread.thOutputId.set();
     //映像と音声の同期をとる際に、それをあきらめるまでの閾値
     const int nWaitThreshold = 32;
     //キューにデータが存在するか
@@ -3420,6 +3455,9 @@ RGY_ERR RGYOutputAvcodec::WriteThreadFunc() {
             while ((audioDts < 0 || videoDts <= audioDts + dtsThreshold)
                 && false != (bVideoExists = m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr))) {
                 WriteNextFrameInternal(&bitstream, &videoDts);
+                if (bitstream.hasRefOwner()) {
+                    bitstream.clear(); //途中で抜けた場合など、参照しているバッファが残っていれば解放する
+                }
                 nWaitVideo = 0;
                 const int log_level = RGY_LOG_TRACE;
                 if (m_printMes && log_level >= m_printMes->getLogLevel()) {
@@ -3514,6 +3552,9 @@ RGY_ERR RGYOutputAvcodec::WriteThreadFunc() {
         while (videoDts <= audioDts + dtsThreshold
             && false != (bVideoExists = m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr))) {
             WriteNextFrameInternal(&bitstream, &videoDts);
+            if (bitstream.hasRefOwner()) {
+                bitstream.clear(); //途中で抜けた場合など、参照しているバッファが残っていれば解放する
+            }
         }
         bAudioExists = !m_Mux.thread.qAudioPacketOut.empty();
         bVideoExists = !m_Mux.thread.qVideobitstream.empty();
@@ -3529,6 +3570,9 @@ RGY_ERR RGYOutputAvcodec::WriteThreadFunc() {
         RGYBitstream bitstream = RGYBitstreamInit();
         while (m_Mux.thread.qVideobitstream.front_copy_and_pop_no_lock(&bitstream, (m_Mux.thread.queueInfo) ? &m_Mux.thread.queueInfo->usage_vid_out : nullptr)) {
             WriteNextFrameInternal(&bitstream, &videoDts);
+            if (bitstream.hasRefOwner()) {
+                bitstream.clear(); //途中で抜けた場合など、参照しているバッファが残っていれば解放する
+            }
         }
     }
 #endif
@@ -3563,6 +3607,30 @@ HANDLE RGYOutputAvcodec::getThreadHandleAudEncode() {
 #endif
 }
 
+uint32_t RGYOutputAvcodec::getThreadIdOutput() {
+#if ENABLE_AVCODEC_OUT_THREAD
+    return (m_Mux.thread.thOutput.joinable()) ? m_Mux.thread.thOutputId.wait() : 0;
+#else
+    return 0;
+#endif
+}
+
+uint32_t RGYOutputAvcodec::getThreadIdAudProcess() {
+#if ENABLE_AVCODEC_OUT_THREAD && ENABLE_AVCODEC_AUDPROCESS_THREAD
+    return (m_Mux.thread.thAudProcess.joinable()) ? m_Mux.thread.thAudProcessId.wait() : 0;
+#else
+    return 0;
+#endif
+}
+
+uint32_t RGYOutputAvcodec::getThreadIdAudEncode() {
+#if ENABLE_AVCODEC_OUT_THREAD && ENABLE_AVCODEC_AUDPROCESS_THREAD
+    return (m_Mux.thread.thAudEncode.joinable()) ? m_Mux.thread.thAudEncodeId.wait() : 0;
+#else
+    return 0;
+#endif
+}
+
 #if USE_CUSTOM_IO
 int RGYOutputAvcodec::readPacket(uint8_t *buf, int buf_size) {
     return (int)_fread_nolock(buf, 1, buf_size, m_Mux.format.fpOutput);
@@ -60,6 +60,9 @@ static const int SUB_ENC_BUF_MAX_SIZE = 1024 * 1024;
 
 static const int VID_BITSTREAM_QUEUE_SIZE_I  = 4;
 static const int VID_BITSTREAM_QUEUE_SIZE_PB = 64;
+//エンコーダのバッファを参照したまま出力キューに渡すのは、キューに溜まっているフレームがこれ以下の場合
+//これを超えたらエンコーダのバッファを長く抱え込まないよう、従来通りコピーして渡す
+static const int VID_BITSTREAM_QUEUE_SIZE_REF = 16;
 
 enum RGYMetadataCopyDefault {
     RGY_METADATA_DEFAULT_CLEAR,
@@ -238,10 +241,13 @@ typedef struct AVMuxThread {
     bool                           enableAudEncodeThread;     //音声エンコードスレッドを使用する
     std::atomic<bool>              abortOutput;               //出力スレッドに停止を通知する
     std::thread                    thOutput;                  //出力スレッド(mux部分を担当)
+    RGYPerfThreadId                thOutputId;                //出力スレッドのID (スレッド自身が記録する)
     std::atomic<bool>              thAudProcessAbort;         //音声処理スレッドに停止を通知する
     std::thread                    thAudProcess;              //音声処理スレッド(デコード/thAudEncodeがなければエンコードも担当)
+    RGYPerfThreadId                thAudProcessId;            //音声処理スレッドのID (スレッド自身が記録する)
     std::atomic<bool>              thAudEncodeAbort;          //音声エンコードスレッドに停止を通知する
     std::thread                    thAudEncode;               //音声エンコードスレッド(エンコードを担当)
+    RGYPerfThreadId                thAudEncodeId;             //音声エンコードスレッドのID (スレッド自身が記録する)
     HANDLE                         heEventPktAddedOutput;     //キューのいずれかにデータが追加されたことを通知する
     HANDLE                         heEventClosingOutput;      //出力スレッドが停止処理を開始したことを通知する
     HANDLE                         heEventPktAddedAudProcess; //キューのいずれかにデータが追加されたことを通知する
@@ -384,6 +390,10 @@ public:
     HANDLE getThreadHandleOutput();
     HANDLE getThreadHandleAudProcess();
     HANDLE getThreadHandleAudEncode();
+    //出力スレッドのIDを取得する (スレッドがなければ0)
+    uint32_t getThreadIdOutput();
+    uint32_t getThreadIdAudProcess();
+    uint32_t getThreadIdAudEncode();
 protected:
     virtual RGY_ERR Init(const TCHAR *strFileName, const VideoInfo *videoOutputInfo, const void *option) override;
 
@@ -44,6 +44,8 @@
 #include <psapi.h>
 #else
 #include <unistd.h>
+#include <fcntl.h>
+#include <pthread.h>
 #include <sys/types.h>
 #include <sys/time.h>
 #include <sys/resource.h>
@@ -479,6 +481,7 @@ CPerfMonitor::CPerfMonitor() :
     m_nSelectOutputPlot(0),
     m_QueueInfo(),
     m_pRGYLog(),
+    m_metrics(),
 #if ENABLE_METRIC_FRAMEWORK
     m_pLoader(nullptr),
     m_pManager(),
@@ -496,6 +499,19 @@ CPerfMonitor::CPerfMonitor() :
     m_perfCounter(),
 #endif //#if ENABLE_PERF_COUNTER
     m_prefCounterValid(false)
+#if !(defined(_WIN32) || defined(_WIN64))
+    , m_fdProcStat(-1),
+    m_fdProcIo(-1),
+    m_mtxThreadStat(),
+    m_fdMainThreadStat(-1),
+    m_fdEncThreadStat(-1),
+    m_fdInThreadStat(-1),
+    m_fdOutThreadStat(-1),
+    m_fdAudProcThreadStat(-1),
+    m_fdAudEncThreadStat(-1),
+    m_nPageSize(sysconf(_SC_PAGESIZE)),
+    m_nClockTick(sysconf(_SC_CLK_TCK))
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 {
     memset(m_info, 0, sizeof(m_info));
     memset(&m_pipes, 0, sizeof(m_pipes));
@@ -537,6 +553,26 @@ void CPerfMonitor::clear() {
     m_pManager.reset();
 #endif //#if ENABLE_METRIC_FRAMEWORK
 
+#if !(defined(_WIN32) || defined(_WIN64))
+    if (m_fdProcStat >= 0) {
+        close(m_fdProcStat);
+        m_fdProcStat = -1;
+    }
+    if (m_fdProcIo >= 0) {
+        close(m_fdProcIo);
+        m_fdProcIo = -1;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mtxThreadStat);
+        for (int *fd : { &m_fdMainThreadStat, &m_fdEncThreadStat, &m_fdInThreadStat, &m_fdOutThreadStat, &m_fdAudProcThreadStat, &m_fdAudEncThreadStat }) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+    }
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+
     m_nStep = 0;
     m_thMainThread.reset();
     m_thAudProcThread = NULL;
@@ -554,6 +590,7 @@ void CPerfMonitor::clear() {
         m_pipes.f_stdin = NULL;
     }
     m_pProcess.reset();
+    m_metrics.reset();
     m_pRGYLog.reset();
 }
 
@@ -663,6 +700,10 @@ void CPerfMonitor::write_header(FILE *fp, int nSelect) {
     if (nSelect & PERF_MONITOR_QUEUE_AUD_OUT) {
         str += ",queue aud out";
     }
+    if (nSelect & PERF_MONITOR_QUEUE_STALL) {
+        str += ",stall vid in,stall aud in,stall vid out,stall aud out,stall aud proc,stall aud enc";
+        str += ",stall time vid in (ms),stall time aud in (ms),stall time vid out (ms),stall time aud out (ms),stall time aud proc (ms),stall time aud enc (ms)";
+    }
     if (nSelect & PERF_MONITOR_MEM_PRIVATE) {
         str += ",mem private (MB)";
     }
@@ -711,6 +752,39 @@ void CPerfMonitor::runCounterThread() {
 }
 #endif //#if ENABLE_PERF_COUNTER
 
+void RGYPerfThreadId::set() {
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_id = GetCurrentThreadId();
+    }
+    m_cv.notify_all();
+}
+
+uint32_t RGYPerfThreadId::wait() {
+    //set()はスレッドの最初に呼ばれるので、通常はすぐに返る
+    std::unique_lock<std::mutex> lock(m_mtx);
+    m_cv.wait_for(lock, std::chrono::seconds(1), [this]() { return m_id != 0; });
+    return m_id;
+}
+
+void RGYPerfThreadId::reset() {
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_id = 0;
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+//スレッドの"/proc/self/task/<tid>/stat"を開く
+//開いたままにしておけば、tidが再利用されても別のスレッドを参照することはない
+static int open_thread_stat(pid_t tid) {
+    if (tid <= 0) {
+        return -1;
+    }
+    char path[64];
+    sprintf_s(path, "/proc/self/task/%d/stat", (int)tid);
+    return open(path, O_RDONLY);
+}
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+
 int CPerfMonitor::init(tstring filename, const TCHAR *pPythonPath,
     int interval, int nSelectOutputLog, int nSelectOutputPlot,
     std::unique_ptr<void, handle_deleter> thMainThread,
@@ -720,7 +794,16 @@ int CPerfMonitor::init(tstring filename, const TCHAR *pPythonPath,
     m_luid = prm->luid;
     m_pid = GetCurrentProcessId();
 
+#if defined(_WIN32) || defined(_WIN64)
     m_nCreateTime100ns = (int64_t)(clock() * (1e7 / CLOCKS_PER_SEC) + 0.5);
+#else
+    m_nCreateTime100ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
+    //サンプリングのたびにpopenやopenをしないよう、開いたままにしておく
+    m_fdProcStat = open("/proc/self/stat", O_RDONLY);
+    m_fdProcIo = open("/proc/self/io", O_RDONLY);
+    //initはメインスレッドから呼ばれる
+    m_fdMainThreadStat = open_thread_stat((pid_t)GetCurrentThreadId());
+#endif //#if defined(_WIN32) || defined(_WIN64)
     m_sMonitorFilename = filename;
     m_nInterval = interval;
     m_nSelectOutputPlot = nSelectOutputPlot;
@@ -737,6 +820,13 @@ int CPerfMonitor::init(tstring filename, const TCHAR *pPythonPath,
             return 1;
         }
     }
+    if (prm->metricsOutput.length() > 0) {
+        m_metrics = std::make_unique<RGYMetricsWriter>();
+        if (m_metrics->init(prm->metricsOutput, prm->metricsFormat, m_pRGYLog) != RGY_ERR_NONE) {
+            m_pRGYLog->write(RGY_LOG_WARN, _T("metrics output disabled.\n"));
+            m_metrics.reset();
+        }
+    }
 #if ENABLE_METRIC_FRAMEWORK
     //LoadAllを使用する場合、下記のように使わないモジュールを書くことで取得するモジュールを制限できる
     //putenv("GM_EXTENSION_LIB_SKIP_LIST=SEPPublisher,PVRPublisher,CPUInfoPublisher,RenderPerfPublisher");
@@ -922,6 +1012,76 @@ void CPerfMonitor::SetThreadHandles(HANDLE thEncThread, HANDLE thInThread, HANDL
     m_thAudEncThread = thAudEncThread;
 }
 
+void CPerfMonitor::SetThreadIds(uint32_t tidEncThread, uint32_t tidInThread, uint32_t tidOutThread, uint32_t tidAudProcThread, uint32_t tidAudEncThread) {
+#if !(defined(_WIN32) || defined(_WIN64))
+    //スレッドが動作しているうちに(スレッドの開始直後に呼ばれる)"/proc/self/task/<tid>/stat"を開いておく
+    //Linuxでは、pthread_t (SetThreadHandlesで渡されるハンドル) はCPU時間の取得には使用しない
+    std::lock_guard<std::mutex> lock(m_mtxThreadStat);
+    const std::pair<int *, uint32_t> threads[] = {
+        { &m_fdEncThreadStat,     tidEncThread },
+        { &m_fdInThreadStat,      tidInThread },
+        { &m_fdOutThreadStat,     tidOutThread },
+        { &m_fdAudProcThreadStat, tidAudProcThread },
+        { &m_fdAudEncThreadStat,  tidAudEncThread },
+    };
+    for (const auto& th : threads) {
+        if (*th.first >= 0) {
+            close(*th.first);
+        }
+        *th.first = open_thread_stat((pid_t)th.second);
+    }
+#else
+    UNREFERENCED_PARAMETER(tidEncThread);
+    UNREFERENCED_PARAMETER(tidInThread);
+    UNREFERENCED_PARAMETER(tidOutThread);
+    UNREFERENCED_PARAMETER(tidAudProcThread);
+    UNREFERENCED_PARAMETER(tidAudEncThread);
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+}
+
+#if !(defined(_WIN32) || defined(_WIN64))
+//開いたままの/procのファイルを先頭から読み直す
+static int read_proc_file(int fd, char *buffer, size_t size) {
+    if (fd < 0) {
+        return -1;
+    }
+    const auto len = pread(fd, buffer, size - 1, 0);
+    if (len < 0) {
+        return -1;
+    }
+    buffer[len] = '\0';
+    return (int)len;
+}
+
+//スレッドのCPU時間(us)を"/proc/self/task/<tid>/stat"から取得する
+//スレッドが終了している場合は読み込みに失敗するので、falseを返す
+static bool get_thread_active_us(int fd, int64_t clockTick, int64_t *active_us) {
+    char buffer[1024];
+    if (read_proc_file(fd, buffer, sizeof(buffer)) <= 0) {
+        return false;
+    }
+    //2番目の項目(comm)は空白や括弧を含みうるので、最後の')'以降を解析する
+    const char *ptr = strrchr(buffer, ')');
+    if (!ptr || ptr[1] != ' ') {
+        return false;
+    }
+    //ptrを3番目の項目(state)から14番目の項目(utime)まで進める
+    ptr += 2;
+    for (int i = 3; i < 14 && ptr; i++) {
+        ptr = strchr(ptr, ' ');
+        if (ptr) ptr++;
+    }
+    if (!ptr) {
+        return false;
+    }
+    char *end = nullptr;
+    const long long utime = strtoll(ptr, &end, 10); //clock tick
+    const long long stime = strtoll(end, nullptr, 10); //clock tick
+    *active_us = (int64_t)(utime + stime) * 1000000 / clockTick;
+    return true;
+}
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
+
 void CPerfMonitor::check() {
     PerfInfo *pInfoNew = &m_info[(m_nStep + 1) & 1];
     PerfInfo *pInfoOld = &m_info[ m_nStep      & 1];
@@ -1052,46 +1212,38 @@ void CPerfMonitor::check() {
     getrusage(RUSAGE_SELF, &usage);
 
     //現在時間
-    uint64_t current_time = clock() * (1e7 / CLOCKS_PER_SEC);
+    const int64_t current_time = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count() / 100;
 
-    std::string proc_dir = strsprintf("/proc/%d/", (int)getpid());
+    char buffer[1024];
     //メモリ情報
-    FILE *fp_mem = popen((std::string("cat ") + proc_dir + std::string("status")).c_str(), "r");
-    if (fp_mem) {
-        char buffer[2048] = { 0 };
-        while (NULL != fgets(buffer, _countof(buffer), fp_mem)) {
-            if (nullptr != strstr(buffer, "VmSize")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "VmSize: %lld kB", &i)) {
-                    pInfoNew->mem_virtual = i << 10;
-                }
-            } else if (nullptr != strstr(buffer, "VmRSS")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "VmRSS: %lld kB", &i)) {
-                    pInfoNew->mem_private = i << 10;
-                }
+    if (read_proc_file(m_fdProcStat, buffer, sizeof(buffer)) > 0) {
+        //2番目の項目(comm)は空白や括弧を含みうるので、最後の')'以降を解析する
+        const char *ptr = strrchr(buffer, ')');
+        if (ptr && ptr[1] == ' ') {
+            //ptrを3番目の項目(state)から23番目の項目(vsize)まで進める
+            ptr += 2;
+            for (int i = 3; i < 23 && ptr; i++) {
+                ptr = strchr(ptr, ' ');
+                if (ptr) ptr++;
+            }
+            if (ptr) {
+                char *end = nullptr;
+                const long long vsize = strtoll(ptr, &end, 10); //byte
+                const long long rss = strtoll(end, nullptr, 10); //page
+                pInfoNew->mem_virtual = vsize;
+                pInfoNew->mem_private = rss * m_nPageSize;
             }
         }
-        fclose(fp_mem);
     }
     //IO情報
-    FILE *fp_io = popen((std::string("cat ") + proc_dir + std::string("io")).c_str(), "r");
-    if (fp_io) {
-        char buffer[2048] = { 0 };
-        while (NULL != fgets(buffer, _countof(buffer), fp_io)) {
-            if (nullptr != strstr(buffer, "rchar:")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "rchar: %lld", &i)) {
-                    pInfoNew->io_total_read = i;
-                }
-            } else if (nullptr != strstr(buffer, "wchar")) {
-                long long i = 0;
-                if (1 == sscanf(buffer, "wchar: %lld", &i)) {
-                    pInfoNew->io_total_write = i;
-                }
-            }
+    if (read_proc_file(m_fdProcIo, buffer, sizeof(buffer)) > 0) {
+        const char *ptr = nullptr;
+        if ((ptr = strstr(buffer, "rchar:")) != nullptr) {
+            pInfoNew->io_total_read = strtoll(ptr + strlen("rchar:"), nullptr, 10);
+        }
+        if ((ptr = strstr(buffer, "wchar:")) != nullptr) {
+            pInfoNew->io_total_write = strtoll(ptr + strlen("wchar:"), nullptr, 10);
         }
-        fclose(fp_io);
     }
 
     //CPU情報
@@ -1181,13 +1333,38 @@ void CPerfMonitor::check() {
                 pInfoNew->out_thread_percent = 0.0;
             }
         }
+#else
+        //スレッドCPU使用率
+        //SetThreadIdsで開いておいた"/proc/self/task/<tid>/stat"を読み直す
+        auto thread_percent = [&](int fd, int64_t& total_active_us_new, int64_t total_active_us_old, double& percent) {
+            if (fd < 0) {
+                return;
+            }
+            if (get_thread_active_us(fd, m_nClockTick, &total_active_us_new)) {
+                percent = (total_active_us_new - total_active_us_old) * 100.0 * logical_cpu_inv * time_diff_inv;
+            } else {
+                percent = 0.0;
+            }
+        };
+        std::lock_guard<std::mutex> lock(m_mtxThreadStat);
+        thread_percent(m_fdMainThreadStat,    pInfoNew->main_thread_total_active_us,     pInfoOld->main_thread_total_active_us,     pInfoNew->main_thread_percent);
+        thread_percent(m_fdEncThreadStat,     pInfoNew->enc_thread_total_active_us,      pInfoOld->enc_thread_total_active_us,      pInfoNew->enc_thread_percent);
+        thread_percent(m_fdAudProcThreadStat, pInfoNew->aud_proc_thread_total_active_us, pInfoOld->aud_proc_thread_total_active_us, pInfoNew->aud_proc_thread_percent);
+        thread_percent(m_fdAudEncThreadStat,  pInfoNew->aud_enc_thread_total_active_us,  pInfoOld->aud_enc_thread_total_active_us,  pInfoNew->aud_enc_thread_percent);
+        thread_percent(m_fdInThreadStat,      pInfoNew->in_thread_total_active_us,       pInfoOld->in_thread_total_active_us,       pInfoNew->in_thread_percent);
+        thread_percent(m_fdOutThreadStat,     pInfoNew->out_thread_total_active_us,      pInfoOld->out_thread_total_active_us,      pInfoNew->out_thread_percent);
 #endif //defined(_WIN32) || defined(_WIN64)
     }
 
     if (!m_bEncStarted && m_pEncStatus) {
         m_bEncStarted = m_pEncStatus->getEncStarted();
         if (m_bEncStarted) {
+#if defined(_WIN32) || defined(_WIN64)
             m_nEncStartTime = m_pEncStatus->getStartTimeMicroSec();
+#else
+            //getStartTimeMicroSec()はclock()基準なので、current_timeと同じsteady_clockで開始時刻とする
+            m_nEncStartTime = current_time / 10;
+#endif //#if defined(_WIN32) || defined(_WIN64)
         }
     }
 
@@ -1197,8 +1374,15 @@ void CPerfMonitor::check() {
     if (m_bEncStarted && m_pEncStatus) {
         EncodeStatusData data = m_pEncStatus->GetEncodeData();
 
+        //エンコード遅延
+        pInfoNew->frames_enc_out = data.frameEncOut;
+        pInfoNew->enc_latency_us_sum = data.encLatencyUsSum;
+        if (pInfoNew->frames_enc_out > pInfoOld->frames_enc_out) {
+            pInfoNew->enc_latency_ms = (pInfoNew->enc_latency_us_sum - pInfoOld->enc_latency_us_sum) * 1e-3 / (pInfoNew->frames_enc_out - pInfoOld->frames_enc_out);
+        }
+
         //fps情報
-        pInfoNew->frames_out = data.frameTotal;
+        pInfoNew->frames_out = data.frameOut;
         if (pInfoNew->frames_out > pInfoOld->frames_out) {
             pInfoNew->fps_avg = pInfoNew->frames_out / (double)(current_time / 10 - m_nEncStartTime) * 1e6;
             if (pInfoNew->time_us > pInfoOld->time_us) {
@@ -1285,6 +1469,16 @@ void CPerfMonitor::write(FILE *fp, int nSelect) {
     if (nSelect & PERF_MONITOR_QUEUE_AUD_OUT) {
         str += strsprintf(",%d", (int)m_QueueInfo.usage_aud_out);
     }
+    if (nSelect & PERF_MONITOR_QUEUE_STALL) {
+        str += strsprintf(",%d,%d,%d,%d,%d,%d",
+            (int)m_QueueInfo.stall_vid_in, (int)m_QueueInfo.stall_aud_in,
+            (int)m_QueueInfo.stall_vid_out, (int)m_QueueInfo.stall_aud_out,
+            (int)m_QueueInfo.stall_aud_proc, (int)m_QueueInfo.stall_aud_enc);
+        str += strsprintf(",%.3lf,%.3lf,%.3lf,%.3lf,%.3lf,%.3lf",
+            m_QueueInfo.stall_us_vid_in * 1e-3, m_QueueInfo.stall_us_aud_in * 1e-3,
+            m_QueueInfo.stall_us_vid_out * 1e-3, m_QueueInfo.stall_us_aud_out * 1e-3,
+            m_QueueInfo.stall_us_aud_proc * 1e-3, m_QueueInfo.stall_us_aud_enc * 1e-3);
+    }
     if (nSelect & PERF_MONITOR_MEM_PRIVATE) {
         str += strsprintf(",%.2lf", pInfo->mem_private / (double)(1024 * 1024));
     }
@@ -1322,6 +1516,81 @@ void CPerfMonitor::write(FILE *fp, int nSelect) {
     }
 }
 
+void CPerfMonitor::writeMetrics(bool finished) {
+    if (!m_metrics) {
+        return;
+    }
+    const PerfInfo *pInfo = &m_info[m_nStep & 1];
+    RGYMetricsSample sample;
+    memset(&sample, 0, sizeof(sample));
+    sample.timestamp_ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::system_clock::now().time_since_epoch()).count();
+    sample.elapsed_sec = pInfo->time_us * 1e-6;
+    sample.finished = finished;
+    if (m_pEncStatus) {
+        const EncodeStatusData data = m_pEncStatus->GetEncodeData();
+        sample.frames_total = data.frameTotal;
+        sample.frames_enc_in = data.frameEncIn;
+        sample.frames_enc_out = data.frameEncOut;
+        sample.frames_out = data.frameOut;
+        sample.frames_drop = data.frameDrop;
+        //frameOutIはIDRを含むので、IDR以外のIとして出力する
+        sample.frames_idr = data.frameOutIDR;
+        sample.frames_i = data.frameOutI - data.frameOutIDR;
+        sample.frames_p = data.frameOutP;
+        sample.frames_b = data.frameOutB;
+        sample.out_bytes = data.outFileSize;
+        sample.enc_latency_us_sum = data.encLatencyUsSum;
+        sample.enc_latency_us_max = data.encLatencyUsMax;
+    }
+    sample.fps = pInfo->fps;
+    sample.fps_avg = pInfo->fps_avg;
+    sample.bitrate_kbps = pInfo->bitrate_kbps;
+    sample.bitrate_kbps_avg = pInfo->bitrate_kbps_avg;
+    sample.enc_latency_ms = pInfo->enc_latency_ms;
+
+    sample.queue_usage[RGY_METRICS_QUEUE_VID_IN]   = m_QueueInfo.usage_vid_in;
+    sample.queue_usage[RGY_METRICS_QUEUE_AUD_IN]   = m_QueueInfo.usage_aud_in;
+    sample.queue_usage[RGY_METRICS_QUEUE_VID_OUT]  = m_QueueInfo.usage_vid_out;
+    sample.queue_usage[RGY_METRICS_QUEUE_AUD_OUT]  = m_QueueInfo.usage_aud_out;
+    sample.queue_usage[RGY_METRICS_QUEUE_AUD_PROC] = m_QueueInfo.usage_aud_proc;
+    sample.queue_usage[RGY_METRICS_QUEUE_AUD_ENC]  = m_QueueInfo.usage_aud_enc;
+    sample.queue_stall[RGY_METRICS_QUEUE_VID_IN]   = m_QueueInfo.stall_vid_in;
+    sample.queue_stall[RGY_METRICS_QUEUE_AUD_IN]   = m_QueueInfo.stall_aud_in;
+    sample.queue_stall[RGY_METRICS_QUEUE_VID_OUT]  = m_QueueInfo.stall_vid_out;
+    sample.queue_stall[RGY_METRICS_QUEUE_AUD_OUT]  = m_QueueInfo.stall_aud_out;
+    sample.queue_stall[RGY_METRICS_QUEUE_AUD_PROC] = m_QueueInfo.stall_aud_proc;
+    sample.queue_stall[RGY_METRICS_QUEUE_AUD_ENC]  = m_QueueInfo.stall_aud_enc;
+    sample.queue_stall_us[RGY_METRICS_QUEUE_VID_IN]   = m_QueueInfo.stall_us_vid_in;
+    sample.queue_stall_us[RGY_METRICS_QUEUE_AUD_IN]   = m_QueueInfo.stall_us_aud_in;
+    sample.queue_stall_us[RGY_METRICS_QUEUE_VID_OUT]  = m_QueueInfo.stall_us_vid_out;
+    sample.queue_stall_us[RGY_METRICS_QUEUE_AUD_OUT]  = m_QueueInfo.stall_us_aud_out;
+    sample.queue_stall_us[RGY_METRICS_QUEUE_AUD_PROC] = m_QueueInfo.stall_us_aud_proc;
+    sample.queue_stall_us[RGY_METRICS_QUEUE_AUD_ENC]  = m_QueueInfo.stall_us_aud_enc;
+
+    sample.cpu_percent = pInfo->cpu_percent;
+    sample.cpu_kernel_percent = pInfo->cpu_kernel_percent;
+    sample.thread_percent[RGY_METRICS_THREAD_MAIN]     = pInfo->main_thread_percent;
+    sample.thread_percent[RGY_METRICS_THREAD_ENC]      = pInfo->enc_thread_percent;
+    sample.thread_percent[RGY_METRICS_THREAD_IN]       = pInfo->in_thread_percent;
+    sample.thread_percent[RGY_METRICS_THREAD_OUT]      = pInfo->out_thread_percent;
+    sample.thread_percent[RGY_METRICS_THREAD_AUD_PROC] = pInfo->aud_proc_thread_percent;
+    sample.thread_percent[RGY_METRICS_THREAD_AUD_ENC]  = pInfo->aud_enc_thread_percent;
+
+    sample.mem_private = pInfo->mem_private;
+    sample.mem_virtual = pInfo->mem_virtual;
+    sample.io_read_per_sec = pInfo->io_read_per_sec;
+    sample.io_write_per_sec = pInfo->io_write_per_sec;
+
+    sample.gpu_info_valid = pInfo->gpu_info_valid != FALSE;
+    sample.gpu_load_percent = pInfo->gpu_load_percent;
+    sample.gpu_clock = pInfo->gpu_clock;
+    sample.vee_load_percent = pInfo->vee_load_percent;
+    sample.ved_load_percent = pInfo->ved_load_percent;
+    sample.ve_clock = pInfo->ve_clock;
+
+    m_metrics->write(sample);
+}
+
 void CPerfMonitor::loader(void *prm) {
     reinterpret_cast<CPerfMonitor*>(prm)->run();
 }
@@ -1343,6 +1612,7 @@ void CPerfMonitor::run() {
             }
             write(m_fpLog.get(), m_nSelectOutputLog);
             write(m_pipes.f_stdin, m_nSelectOutputPlot);
+            writeMetrics(false);
             m_refreshedTime = timenow;
         }
         std::this_thread::sleep_for(std::chrono::milliseconds((m_nInterval <= 100) ? m_nInterval : 50));
@@ -1350,4 +1620,5 @@ void CPerfMonitor::run() {
     check();
     write(m_fpLog.get(),   m_nSelectOutputLog);
     write(m_pipes.f_stdin, m_nSelectOutputPlot);
+    writeMetrics(true);
 }
@@ -30,6 +30,8 @@
 #define __RGY_PERF_MONITOR_H__
 
 #include <thread>
+#include <mutex>
+#include <condition_variable>
 #include <cstdint>
 #include <climits>
 #include <memory>
@@ -41,6 +43,7 @@
 #include "rgy_log.h"
 #include "gpuz_info.h"
 #include "rgy_util.h"
+#include "rgy_metrics.h"
 
 #if ENABLE_PERF_COUNTER
 #include "rgy_perf_counter.h"
@@ -100,6 +103,7 @@ enum : int {
     PERF_MONITOR_VEE_LOAD      = 0x04000000,
     PERF_MONITOR_VED_LOAD      = 0x08000000,
     PERF_MONITOR_PCIE_LOAD     = 0x10000000,
+    PERF_MONITOR_QUEUE_STALL   = 0x20000000,
     PERF_MONITOR_ALL         = (int)UINT_MAX,
 };
 
@@ -137,6 +141,7 @@ static const CX_DESC list_pref_monitor[] = {
     { _T("pcie_load"),   PERF_MONITOR_PCIE_LOAD },
     { _T("ve_clock"),    PERF_MONITOR_VE_CLOCK },
     { _T("queue"),       PERF_MONITOR_QUEUE_VID_IN | PERF_MONITOR_QUEUE_VID_OUT | PERF_MONITOR_QUEUE_AUD_IN | PERF_MONITOR_QUEUE_AUD_OUT },
+    { _T("queue_stall"), PERF_MONITOR_QUEUE_STALL },
     { nullptr, 0 }
 };
 
@@ -168,6 +173,10 @@ struct PerfInfo {
     double  bitrate_kbps;
     double  bitrate_kbps_avg;
 
+    int64_t frames_enc_out;      //エンコーダから出力されたフレーム数
+    int64_t enc_latency_us_sum;  //エンコーダ投入から出力までの時間の合計(us)
+    double  enc_latency_ms;      //直前の計測区間のエンコーダ投入から出力までの時間の平均(ms)
+
     double  io_read_per_sec;
     double  io_write_per_sec;
 
@@ -210,6 +219,20 @@ struct PerfQueueInfo {
     size_t usage_aud_out;
     size_t usage_aud_enc;
     size_t usage_aud_proc;
+    //キューがいっぱいで押し込み側が待機した回数
+    size_t stall_vid_in;
+    size_t stall_aud_in;
+    size_t stall_vid_out;
+    size_t stall_aud_out;
+    size_t stall_aud_enc;
+    size_t stall_aud_proc;
+    //キューがいっぱいで押し込み側が待機した合計時間(us)
+    int64_t stall_us_vid_in;
+    int64_t stall_us_aud_in;
+    int64_t stall_us_vid_out;
+    int64_t stall_us_aud_out;
+    int64_t stall_us_aud_enc;
+    int64_t stall_us_aud_proc;
 };
 
 #if ENABLE_METRIC_FRAMEWORK
@@ -367,13 +390,33 @@ struct CPerfMonitorPrm {
     std::string pciBusId;
 #endif
     LUID luid;
+    tstring metricsOutput; //機械的に読み取れる形式のメトリクスの出力先 (空なら出力しない)
+    RGYMetricsFormat metricsFormat;
     char reserved[256];
 
     CPerfMonitorPrm() :
 #if ENABLE_NVML
         pciBusId(),
 #endif
-        luid({ 0 }), reserved() {};
+        luid({ 0 }), metricsOutput(), metricsFormat(RGY_METRICS_FORMAT_NDJSON), reserved() {};
+};
+
+//CPU使用率の計測のため、スレッドのID (LinuxではGetCurrentThreadIdの返すtid) をそのスレッド自身が記録する
+//Linuxではpthread_tからtidを得る方法がないので、スレッドの中で取得して渡す
+class RGYPerfThreadId {
+public:
+    RGYPerfThreadId() : m_mtx(), m_cv(), m_id(0) {};
+    //スレッドの開始直後に、そのスレッドから呼ぶ
+    void set();
+    //set()されるまで待機し、記録されたIDを返す (タイムアウトした場合は0)
+    //スレッドを起動していない場合は待機する意味がないので、呼び出し側で0を返すこと
+    uint32_t wait();
+    //スレッドの終了後に呼ぶ
+    void reset();
+protected:
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    uint32_t m_id;
 };
 
 class CPerfMonitor {
@@ -387,6 +430,9 @@ public:
 
     void SetEncStatus(std::shared_ptr<EncodeStatus> encStatus);
     void SetThreadHandles(HANDLE thEncThread, HANDLE thInThread, HANDLE thOutThread, HANDLE thAudProcThread, HANDLE thAudEncThread);
+    //各スレッドのID (RGYPerfThreadIdで記録したもの、スレッドがなければ0)
+    //LinuxではスレッドごとのCPU時間をtidから"/proc/self/task/<tid>/stat"で取得するので、SetThreadHandlesとあわせて呼ぶ
+    void SetThreadIds(uint32_t tidEncThread, uint32_t tidInThread, uint32_t tidOutThread, uint32_t tidAudProcThread, uint32_t tidAudEncThread);
     PerfQueueInfo *GetQueueInfoPtr() {
         return &m_QueueInfo;
     }
@@ -441,6 +487,7 @@ protected:
     void run();
     void write_header(FILE *fp, int nSelect);
     void write(FILE *fp, int nSelect);
+    void writeMetrics(bool finished);
 
     void AddMessage(int log_level, const tstring &str) {
         if (m_pRGYLog == nullptr || log_level < m_pRGYLog->getLogLevel()) {
@@ -503,6 +550,7 @@ protected:
     int m_nSelectOutputPlot;
     PerfQueueInfo m_QueueInfo;
     std::shared_ptr<RGYLog> m_pRGYLog;
+    std::unique_ptr<RGYMetricsWriter> m_metrics;
 
 #if ENABLE_METRIC_FRAMEWORK
     IExtensionLoader *m_pLoader;
@@ -522,6 +570,21 @@ protected:
     std::unique_ptr<RGYGPUCounterWin> m_perfCounter;
 #endif
     bool m_prefCounterValid;
+#if !(defined(_WIN32) || defined(_WIN64))
+    int m_fdProcStat;   //"/proc/self/stat" (サンプリングのたびにpreadで読み直す)
+    int m_fdProcIo;     //"/proc/self/io"
+    //各スレッドの"/proc/self/task/<tid>/stat"
+    //tidが再利用されても別のスレッドを参照しないよう、SetThreadIdsの時点で開いておく
+    std::mutex m_mtxThreadStat;
+    int m_fdMainThreadStat;
+    int m_fdEncThreadStat;
+    int m_fdInThreadStat;
+    int m_fdOutThreadStat;
+    int m_fdAudProcThreadStat;
+    int m_fdAudEncThreadStat;
+    int64_t m_nPageSize;
+    int64_t m_nClockTick;
+#endif //#if !(defined(_WIN32) || defined(_WIN64))
 };
 
 
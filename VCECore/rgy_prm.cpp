@@ -33,6 +33,7 @@
 #include "rgy_prm.h"
 #include "rgy_err.h"
 #include "rgy_perf_monitor.h"
+#include "rgy_waiter.h"
 
 AudioSelect::AudioSelect() :
     trackID(0),
@@ -112,6 +113,8 @@ RGYParamCommon::RGYParamCommon() :
     videoMetadata(),
     formatMetadata(),
     seekSec(0.0f),               //指定された秒数分先頭を飛ばす
+    inputIndex(false),
+    inputIndexFile(),
     nSubtitleSelectCount(0),
     ppSubtitleSelectList(nullptr),
     subSource(),
@@ -155,12 +158,19 @@ RGYParamControl::RGYParamControl() :
     threadOutput(RGY_OUTPUT_THREAD_AUTO),
     threadAudio(RGY_AUDIO_THREAD_AUTO),
     threadInput(RGY_INPUT_THREAD_AUTO),
+    inputReadAhead(-1),
     procSpeedLimit(0),      //処理速度制限 (0で制限なし)
     perfMonitorSelect(0),
     perfMonitorSelectMatplot(0),
     perfMonitorInterval(RGY_DEFAULT_PERF_MONITOR_INTERVAL),
+    metricsOutput(),
+    metricsFormat(RGY_METRICS_FORMAT_NDJSON),
+    vppProfile(false),
+    vppProfileFile(),
     parentProcessID(0),
     lowLatency(false),
+    waitMode(RGY_WAIT_MODE_SLEEP),
+    waitBlockMaxMs(RGY_WAIT_BLOCK_MAX_MS_DEFAULT),
     gpuSelect(),
     avsdll() {
 
@@ -135,6 +135,8 @@ struct RGYParamCommon {
     std::vector<tstring> videoMetadata;
     std::vector<tstring> formatMetadata;
     float seekSec;               //指定された秒数分先頭を飛ばす
+    bool inputIndex;             //avhw/avswリーダーでフレームインデックスを使用する
+    tstring inputIndexFile;      //フレームインデックスのパス (空なら入力ファイル名+.rgyidx)
     int nSubtitleSelectCount;
     SubtitleSelect **ppSubtitleSelectList;
     std::vector<SubSource> subSource;
@@ -181,12 +183,19 @@ struct RGYParamControl {
     int threadOutput;
     int threadAudio;
     int threadInput;
+    int inputReadAhead;      //raw/y4m/aviリーダーで別スレッドで先読みするフレーム数 (-1で自動、0で先読みしない)
     int procSpeedLimit;      //処理速度制限 (0で制限なし)
     int64_t perfMonitorSelect;
     int64_t perfMonitorSelectMatplot;
     int     perfMonitorInterval;
+    tstring metricsOutput;      //機械的に読み取れる形式のメトリクスの出力先 (ファイル or unix:<path>)
+    int     metricsFormat;      //RGYMetricsFormat
+    bool    vppProfile;         //OpenCLのフィルタの実行時間を計測する
+    tstring vppProfileFile;     //計測結果のjsonの出力先
     uint32_t parentProcessID;
     bool lowLatency;
+    int waitMode;            //エンコーダ/デコーダの完了待ちの方法 (RGYWaitMode)
+    int waitBlockMaxMs;      //waitMode = adaptiveでのイベント待機の最大時間(ms)
     GPUAutoSelectMul gpuSelect;
     tstring avsdll;
 
@@ -210,6 +219,7 @@ const CX_DESC list_simd[] = {
     { _T("sse41"),    SSE41|SSSE3|SSE3|SSE2 },
     { _T("avx"),      AVX|SSE42|SSE41|SSSE3|SSE3|SSE2 },
     { _T("avx2"),     AVX2|AVX|SSE42|SSE41|SSSE3|SSE3|SSE2 },
+    { _T("avx512bw"), AVX512VL|AVX512BW|AVX512DQ|AVX512F|AVX2|AVX|SSE42|SSE41|SSSE3|SSE3|SSE2 },
     { NULL, 0 }
 };
 
@@ -34,6 +34,10 @@
 #include <atomic>
 #include <climits>
 #include <memory>
+#include <chrono>
+#include <new>
+#include <algorithm>
+#include <utility>
 #include <xmmintrin.h>
 #include "rgy_osdep.h"
 #include "rgy_event.h"
@@ -59,7 +63,8 @@ public:
         m_nMallocAlign(32),
         m_nMaxCapacity(SIZE_MAX),
         m_nKeepLength(0),
-        m_pBufStart(), m_pBufFin(nullptr), m_pBufIn(nullptr), m_pBufOut(nullptr), m_bUsingData(false) {
+        m_pBufStart(), m_pBufFin(nullptr), m_pBufIn(nullptr), m_pBufOut(nullptr), m_bUsingData(false),
+        m_bPushWaiting(false), m_nStallCount(0), m_nStallTimeUs(0), m_pStallCount(nullptr), m_pStallTimeUs(nullptr) {
         //実際のメモリのアライメントに適切な2の倍数であるか確認する
         //そうでない場合は32をデフォルトとして使用
         for (uint32_t i = 4; i < sizeof(i) * 8; i++) {
@@ -105,7 +110,24 @@ public:
         m_heEventPushed = CreateEvent(NULL, TRUE, TRUE, NULL);
         m_nMaxCapacity = maxCapacity;
         m_nKeepLength = 0;
-        m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (int)std::min<size_t>(INT_MAX, maxCapacity) - 4);
+        //maxCapacityが小さい場合に上限が下限を下回らないようにする
+        m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (std::max)(0, (int)std::min<size_t>(INT_MAX, maxCapacity) - 4));
+        m_bPushWaiting = false;
+        m_nStallCount = 0;
+        m_nStallTimeUs = 0;
+    }
+    //キューがいっぱいで押し込み側が待機した回数と合計時間(us)の書き込み先を設定する (PerfQueueInfo向け)
+    void set_stall_info(size_t *pStallCount, int64_t *pStallTimeUs) {
+        m_pStallCount = pStallCount;
+        m_pStallTimeUs = pStallTimeUs;
+    }
+    //キューがいっぱいで押し込み側が待機した回数
+    uint64_t get_stall_count() const {
+        return m_nStallCount;
+    }
+    //キューがいっぱいで押し込み側が待機した合計時間(us)
+    int64_t get_stall_time_us() const {
+        return m_nStallTimeUs;
     }
     //キューのデータをクリアする
     void clear() {
@@ -113,6 +135,7 @@ public:
         m_pBufFin = m_pBufStart.get() + bufSize;
         m_pBufIn  = m_pBufStart.get();
         m_pBufOut = m_pBufStart.get();
+        notify_pusher();
     }
     //キューのデータをクリアする際に、指定した関数で内部データを開放してから、データをクリアする
     template<typename Func>
@@ -129,6 +152,10 @@ public:
             CloseEvent(m_heEventPoped);
             m_heEventPoped = NULL;
         }
+        if (m_heEventPushed) {
+            CloseEvent(m_heEventPushed);
+            m_heEventPushed = NULL;
+        }
         m_pBufStart.reset();
         m_pBufFin = nullptr;
         m_pBufIn = nullptr;
@@ -145,9 +172,30 @@ public:
     //キューのデータ量があらかじめ設定した上限に達した場合は、キューに空きができるまで待機する
     bool push(const Type& in) {
         //最初に決めた容量分までキューにデータがたまっていたら、キューに空きができるまで待機する
-        while (size() >= m_nMaxCapacity) {
-            ResetEvent(m_heEventPoped);
-            WaitForSingleObject(m_heEventPoped, 16);
+        if (size() >= m_nMaxCapacity) {
+            const auto stallStart = std::chrono::high_resolution_clock::now();
+            while (size() >= m_nMaxCapacity) {
+                //取り出し側は、待機中であることを確認し、
+                //キューの空きがm_nPushRestartExtraを超えた時点で一度だけイベントをセットする
+                ResetEvent(m_heEventPoped);
+                m_bPushWaiting = true;
+                //待機中であることを通知した後に取り出されていないかを再確認する
+                if (size() < m_nMaxCapacity) {
+                    break;
+                }
+                //通常は取り出し側からの通知で起床するので、タイムアウトは万一のためのもの
+                WaitForSingleObject(m_heEventPoped, PUSH_WAIT_TIMEOUT_MS);
+            }
+            m_bPushWaiting = false;
+            const auto stallUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - stallStart).count();
+            m_nStallCount++;
+            m_nStallTimeUs += stallUs;
+            if (m_pStallCount) {
+                *m_pStallCount = (size_t)m_nStallCount;
+            }
+            if (m_pStallTimeUs) {
+                *m_pStallTimeUs = m_nStallTimeUs;
+            }
         }
         if (m_pBufIn >= m_pBufFin) {
             //現時点でのm_pBufOut (この後別スレッドによって書き換わるかもしれない)
@@ -224,21 +272,25 @@ public:
     //キューの最大サイズを設定する
     void set_capacity(size_t capacity) {
         m_nMaxCapacity = capacity;
-        m_nPushRestartExtra = (std::min)(m_nPushRestartExtra, (int)std::min<size_t>(INT_MAX, m_nMaxCapacity) - 1);
+        m_nPushRestartExtra = (std::max)(0, (std::min)(m_nPushRestartExtra, (int)std::min<size_t>(INT_MAX, m_nMaxCapacity) - 1));
+        notify_pusher();
     }
     //indexの位置のコピーを取得する
     bool copy(Type *out, uint32_t index, size_t *pnSize = nullptr) {
         m_bUsingData++;
         auto nSize = size();
         bool bCopy = index < nSize;
+        if (!bCopy) {
+            //イベントをリセットしてから再確認し、その間に押し込まれたときの通知を取りこぼさないようにする
+            ResetEvent(m_heEventPushed);
+            nSize = size();
+            bCopy = index < nSize;
+        }
         if (bCopy) {
             auto ptr = m_pBufOut + index;
             *out = ptr->data;
         }
         m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
-        }
         if (pnSize) {
             *pnSize = nSize;
         }
@@ -250,13 +302,16 @@ public:
         m_bUsingData++;
         auto nSize = size();
         bool bCopy = nSize > m_nKeepLength;
+        if (!bCopy) {
+            //イベントをリセットしてから再確認し、その間に押し込まれたときの通知を取りこぼさないようにする
+            ResetEvent(m_heEventPushed);
+            nSize = size();
+            bCopy = nSize > m_nKeepLength;
+        }
         if (bCopy) {
             *out = m_pBufOut.load()->data;
         }
         m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
-        }
         if (pnSize) {
             *pnSize = nSize;
         }
@@ -268,17 +323,20 @@ public:
         m_bUsingData++;
         auto nSize = size();
         bool bCopy = nSize > m_nKeepLength;
+        if (!bCopy) {
+            //イベントをリセットしてから再確認し、その間に押し込まれたときの通知を取りこぼさないようにする
+            ResetEvent(m_heEventPushed);
+            nSize = size();
+            bCopy = nSize > m_nKeepLength;
+        }
         if (bCopy) {
             *out = m_pBufOut.load()->data;
             m_pBufOut++;
             if (nSize <= m_nMaxCapacity - m_nPushRestartExtra) {
-                SetEvent(m_heEventPoped);
+                notify_pusher();
             }
         }
         m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
-        }
         if (pnSize) {
             *pnSize = nSize;
         }
@@ -290,16 +348,19 @@ public:
         m_bUsingData++;
         auto nSize = size();
         bool bCopy = nSize > m_nKeepLength;
+        if (!bCopy) {
+            //イベントをリセットしてから再確認し、その間に押し込まれたときの通知を取りこぼさないようにする
+            ResetEvent(m_heEventPushed);
+            nSize = size();
+            bCopy = nSize > m_nKeepLength;
+        }
         if (bCopy) {
             m_pBufOut++;
             if (nSize <= m_nMaxCapacity - m_nPushRestartExtra) {
-                SetEvent(m_heEventPoped);
+                notify_pusher();
             }
         }
         m_bUsingData--;
-        if (!bCopy) {
-            ResetEvent(m_heEventPushed);
-        }
         return bCopy;
     }
     //要素が追加されるまで待機する
@@ -311,6 +372,14 @@ public:
         return m_heEventPushed;
     }
 protected:
+    static const uint32_t PUSH_WAIT_TIMEOUT_MS = 1000;
+    //押し込み側が空き待ちをしている場合のみ、イベントをセットして起床させる
+    //空き待ちをしていなければ、イベント操作(Linuxではmutex/condvar)のコストを払わずに済む
+    void notify_pusher() {
+        if (m_bPushWaiting && m_bPushWaiting.exchange(false)) {
+            SetEvent(m_heEventPoped);
+        }
+    }
     //bufSize分の内部領域を確保する
     //m_nMaxCapacity以上確保してもかまわない
     //基本的には大きいほうがパフォーマンスは向上する
@@ -333,6 +402,253 @@ protected:
     std::atomic<queueData*> m_pBufIn; //キューにデータを格納する位置へのポインタ
     std::atomic<queueData*> m_pBufOut; //キューから取り出すべき先頭のデータへのポインタ
     std::atomic<int> m_bUsingData; //キューから読み出し中のスレッドの数
+    std::atomic<bool> m_bPushWaiting; //押し込み側がキューの空き待ちをしているか
+    uint64_t m_nStallCount; //キューがいっぱいで押し込み側が待機した回数
+    int64_t m_nStallTimeUs; //キューがいっぱいで押し込み側が待機した合計時間(us)
+    size_t *m_pStallCount; //m_nStallCountの書き込み先 (PerfQueueInfo)
+    int64_t *m_pStallTimeUs; //m_nStallTimeUsの書き込み先 (PerfQueueInfo)
+};
+
+//固定容量の複数押し込み/複数取り出しが可能なキュー (D. Vyukovのbounded MPMC queue)
+//各要素はシーケンス番号を持ち、押し込み/取り出し位置をCASで確保するので、ロックは不要
+//押し込み位置と取り出し位置、各要素はそれぞれalign_byte単位でアライメントをとり、false sharingを回避する
+//RGYQueueSPSPとは異なり、バッファは拡張されず、set_keep_lengthや添字アクセスはサポートしない
+template<typename Type, size_t align_byte = 64>
+class RGYQueueMPMC {
+    struct alignas(align_byte) queueCell {
+        std::atomic<size_t> seq;
+        Type data;
+    };
+    struct alignas(align_byte) queuePos {
+        std::atomic<size_t> pos;
+    };
+public:
+    RGYQueueMPMC() :
+        m_nPushRestartExtra(0),
+        m_heEventPoped(NULL),
+        m_heEventPushed(NULL),
+        m_nMask(0),
+        m_pBuf(),
+        m_enqueue(),
+        m_dequeue(),
+        m_nPushWaiting(0),
+        m_bPopWaiting(false) {
+        m_enqueue.pos = 0;
+        m_dequeue.pos = 0;
+    }
+    ~RGYQueueMPMC() {
+        close();
+    }
+    //キューを初期化する
+    //RGYQueueSPSPと引数をそろえているが、バッファは拡張しないので、
+    //maxCapacityが指定されていればそれを、そうでなければbufSizeを容量とする (2の累乗に切り上げ)
+    void init(size_t bufSize = 1024, size_t maxCapacity = SIZE_MAX, int nPushRestart = 1) {
+        close();
+        const size_t capacity = (std::max<size_t>)(2, (maxCapacity != SIZE_MAX) ? maxCapacity : bufSize);
+        size_t allocSize = 2;
+        while (allocSize < capacity) {
+            allocSize <<= 1;
+        }
+        m_pBuf = std::unique_ptr<queueCell, aligned_malloc_deleter>(
+            (queueCell *)_aligned_malloc(sizeof(queueCell) * allocSize, (std::max<size_t>)(alignof(queueCell), 16)), aligned_malloc_deleter());
+        for (size_t i = 0; i < allocSize; i++) {
+            new (m_pBuf.get() + i) queueCell();
+            m_pBuf.get()[i].seq.store(i, std::memory_order_relaxed);
+        }
+        m_nMask = allocSize - 1;
+        m_enqueue.pos.store(0, std::memory_order_relaxed);
+        m_dequeue.pos.store(0, std::memory_order_relaxed);
+        m_heEventPoped = CreateEvent(NULL, TRUE, TRUE, NULL);
+        m_heEventPushed = CreateEvent(NULL, TRUE, TRUE, NULL);
+        m_nPushRestartExtra = clamp(nPushRestart - 1, 0, (std::max)(0, (int)std::min<size_t>(INT_MAX, allocSize) - 4));
+        m_nPushWaiting = 0;
+        m_bPopWaiting = false;
+    }
+    //キューのデータを取り除く
+    // !! 他のスレッドが押し込み/取り出しを行っていないときのみ有効 !!
+    void clear() {
+        Type tmp;
+        while (try_pop(&tmp)) {
+        }
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、データをクリアする
+    // !! 他のスレッドが押し込み/取り出しを行っていないときのみ有効 !!
+    template<typename Func>
+    void clear(Func deleter) {
+        Type tmp;
+        while (try_pop(&tmp)) {
+            deleter(&tmp);
+        }
+    }
+    //キューのデータをクリアし、リソースを破棄する
+    void close() {
+        if (m_heEventPoped) {
+            CloseEvent(m_heEventPoped);
+            m_heEventPoped = NULL;
+        }
+        if (m_heEventPushed) {
+            CloseEvent(m_heEventPushed);
+            m_heEventPushed = NULL;
+        }
+        if (m_pBuf) {
+            for (size_t i = 0; i <= m_nMask; i++) {
+                m_pBuf.get()[i].~queueCell();
+            }
+            m_pBuf.reset();
+        }
+        m_nMask = 0;
+        m_enqueue.pos.store(0, std::memory_order_relaxed);
+        m_dequeue.pos.store(0, std::memory_order_relaxed);
+    }
+    //キューのデータをクリアする際に、指定した関数で内部データを開放してから、リソースを破棄する
+    template<typename Func>
+    void close(Func deleter) {
+        clear(deleter);
+        close();
+    }
+    //データをキューに押し込む (Typeに代入可能な型であればよい)
+    //キューがいっぱいならなにもせずfalseを返す
+    template<typename T>
+    bool try_push(T&& in) {
+        queueCell *cell = nullptr;
+        size_t pos = m_enqueue.pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = m_pBuf.get() + (pos & m_nMask);
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)pos;
+            if (diff == 0) {
+                if (m_enqueue.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; //キューがいっぱい
+            } else {
+                pos = m_enqueue.pos.load(std::memory_order_relaxed);
+            }
+        }
+        cell->data = std::forward<T>(in);
+        cell->seq.store(pos + 1, std::memory_order_release);
+        notify_popper();
+        return true;
+    }
+    //データをキューに押し込む (Typeに代入可能な型であればよい)
+    //キューがいっぱいの場合は、取り出し側からの通知があるまで待機する
+    template<typename T>
+    bool push(T&& in) {
+        if (try_push(std::forward<T>(in))) {
+            return true;
+        }
+        m_nPushWaiting++;
+        for (;;) {
+            //取り出し側は、待機中のスレッドがいることを確認してからイベントをセットする
+            //イベントをリセットし、待機中であることを通知した後に取り出されていないかを再確認してから待機する
+            ResetEvent(m_heEventPoped);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (try_push(std::forward<T>(in))) {
+                break;
+            }
+            WaitForSingleObject(m_heEventPoped, INFINITE);
+        }
+        m_nPushWaiting--;
+        return true;
+    }
+    //キューの先頭のデータを取り出し、キューから取り除く
+    //取り出したデータはoutと交換するので、outの元の値は次の押し込みで上書きされるまでキュー内に残る
+    //キューが空ならなにもせずfalseを返す
+    bool try_pop(Type *out) {
+        queueCell *cell = nullptr;
+        size_t pos = m_dequeue.pos.load(std::memory_order_relaxed);
+        for (;;) {
+            cell = m_pBuf.get() + (pos & m_nMask);
+            const size_t seq = cell->seq.load(std::memory_order_acquire);
+            const intptr_t diff = (intptr_t)seq - (intptr_t)(pos + 1);
+            if (diff == 0) {
+                if (m_dequeue.pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false; //キューが空
+            } else {
+                pos = m_dequeue.pos.load(std::memory_order_relaxed);
+            }
+        }
+        //std::stringなどのバッファを押し込み側で使いまわせるよう、コピーではなく交換する
+        std::swap(*out, cell->data);
+        cell->seq.store(pos + m_nMask + 1, std::memory_order_release);
+        return true;
+    }
+    //キューの先頭のデータを取り出しながら(outにコピーする)、キューから取り除く
+    //キューが空ならなにもせずfalseを返す
+    bool front_copy_and_pop_no_lock(Type *out, size_t *pnSize = nullptr) {
+        bool bCopy = try_pop(out);
+        if (!bCopy) {
+            //待機中であることを通知し、イベントをリセットしてから再確認し、
+            //その間に押し込まれたときの通知を取りこぼさないようにする
+            m_bPopWaiting = true;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            ResetEvent(m_heEventPushed);
+            bCopy = try_pop(out);
+        }
+        const size_t nSize = size();
+        if (bCopy) {
+            notify_pusher(nSize);
+        }
+        if (pnSize) {
+            //RGYQueueSPSPと同様、取り出し前のサイズを返す
+            *pnSize = nSize + (bCopy ? 1 : 0);
+        }
+        return bCopy;
+    }
+    //キューのsizeを取得する
+    //他のスレッドが操作中の場合は、その時点での概算値となる
+    size_t size() const {
+        const size_t dequeuePos = m_dequeue.pos.load(std::memory_order_acquire);
+        const size_t enqueuePos = m_enqueue.pos.load(std::memory_order_acquire);
+        return (enqueuePos > dequeuePos) ? enqueuePos - dequeuePos : 0;
+    }
+    //キューが空ならtrueを返す
+    bool empty() const {
+        return size() == 0;
+    }
+    //キューの最大サイズを取得する
+    size_t capacity() const {
+        return (m_pBuf) ? m_nMask + 1 : 0;
+    }
+    //要素が追加されるまで待機する
+    //front_copy_and_pop_no_lockがfalseを返した後に呼ぶこと (イベントのリセットはそちらで行う)
+    void wait_for_push(uint32_t millisec = INFINITE) {
+        WaitForSingleObject(m_heEventPushed, millisec);
+    }
+    //要素が追加されるまで待機するイベントを取得
+    HANDLE get_push_event() {
+        return m_heEventPushed;
+    }
+protected:
+    //取り出し側がキューが空で待機している可能性がある場合のみ、イベントをセットして起床させる
+    void notify_popper() {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_bPopWaiting && m_bPopWaiting.exchange(false)) {
+            SetEvent(m_heEventPushed);
+        }
+    }
+    //押し込み側が空き待ちをしていて、空きがm_nPushRestartExtraを超えていれば、イベントをセットして起床させる
+    //空き待ちをしていなければ、イベント操作(Linuxではmutex/condvar)のコストを払わずに済む
+    void notify_pusher(size_t nSize) {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_nPushWaiting > 0 && nSize + 1 + m_nPushRestartExtra <= capacity()) {
+            SetEvent(m_heEventPoped);
+        }
+    }
+
+    int m_nPushRestartExtra; //キューに空きがこのぶんだけ余剰にないと空き通知を行わない (0 = ひとつあけば通知を行う)
+    HANDLE m_heEventPoped; //キューからデータを取り出したときセットする
+    HANDLE m_heEventPushed; //キューにデータが追加されたときセットする
+    size_t m_nMask; //容量-1 (容量は2の累乗)
+    std::unique_ptr<queueCell, aligned_malloc_deleter> m_pBuf; //リングバッファ
+    queuePos m_enqueue; //次に押し込む位置
+    queuePos m_dequeue; //次に取り出す位置
+    std::atomic<int> m_nPushWaiting; //キューの空き待ちをしている押し込み側のスレッドの数
+    std::atomic<bool> m_bPopWaiting; //取り出し側がキューが空であることを確認し、押し込み待ちをしている可能性があるか
 };
 
 #endif //__RGY_QUEUE_H__
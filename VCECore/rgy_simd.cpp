@@ -57,5 +57,16 @@ unsigned int get_availableSIMD() {
     __cpuid(CPUInfo, 7);
     if ((simd & AVX) && (CPUInfo[1] & 0x00000020))
         simd |= AVX2;
+#if defined(_MSC_VER) || defined(__AVX__)
+    //AVX-512はOSがopmask/zmmレジスタの退避に対応している(XCR0のbit5-7)場合のみ使用可能
+    if ((simd & AVX) && ((xgetbv & 0xE6) == 0xE6)) {
+        if (CPUInfo[1] & 0x00010000) simd |= AVX512F;
+        if (simd & AVX512F) {
+            if (CPUInfo[1] & 0x00020000) simd |= AVX512DQ;
+            if (CPUInfo[1] & 0x40000000) simd |= AVX512BW;
+            if (CPUInfo[1] & 0x80000000) simd |= AVX512VL;
+        }
+    }
+#endif
     return simd;
 }
@@ -48,6 +48,10 @@ enum {
     AVX    = 0x0040,
     AVX2   = 0x0080,
     FMA3   = 0x0100,
+    AVX512F  = 0x0200,
+    AVX512DQ = 0x0400,
+    AVX512BW = 0x0800,
+    AVX512VL = 0x1000,
 };
 
 unsigned int get_availableSIMD();
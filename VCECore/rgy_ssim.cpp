@@ -0,0 +1,583 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <cmath>
+#include <cstring>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include "rgy_ssim.h"
+#include "rgy_ssim_c.h"
+#include "rgy_simd.h"
+#include "rgy_mapped_file.h"
+#include "rgy_input_raw.h"
+#include "cpu_info.h"
+
+void ssim_block_stat_avx2_u8(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count);
+void ssim_block_stat_avx2_u16(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count);
+double ssim_end_avx2_u8(const RGYSsimBlockStat *stat0, const RGYSsimBlockStat *stat1, int window_count, int bit_depth);
+int64_t ssim_sse_line_avx2_u8(const void *p0, const void *p1, int width);
+int64_t ssim_sse_line_avx2_u16(const void *p0, const void *p1, int width);
+
+void ssim_block_stat_avx512bw_u8(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count);
+void ssim_block_stat_avx512bw_u16(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count);
+double ssim_end_avx512bw_u8(const RGYSsimBlockStat *stat0, const RGYSsimBlockStat *stat1, int window_count, int bit_depth);
+int64_t ssim_sse_line_avx512bw_u8(const void *p0, const void *p1, int width);
+int64_t ssim_sse_line_avx512bw_u16(const void *p0, const void *p1, int width);
+
+static void ssim_block_stat_c_u8(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    ssim_block_stat_c<uint8_t>(stat, p0, pitch0, p1, pitch1, block_count);
+}
+static void ssim_block_stat_c_u16(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    ssim_block_stat_c<uint16_t>(stat, p0, pitch0, p1, pitch1, block_count);
+}
+static double ssim_end_c_i32(const RGYSsimBlockStat *stat0, const RGYSsimBlockStat *stat1, int window_count, int bit_depth) {
+    return ssim_end_c(stat0, stat1, window_count, bit_depth);
+}
+
+static const RGYSsimFunc SSIM_FUNC_LIST[] = {
+#if defined(_MSC_VER) || (defined(__AVX512BW__) && defined(__AVX512VL__))
+    {
+        { ssim_block_stat_avx512bw_u8, ssim_block_stat_avx512bw_u16 },
+        { ssim_end_avx512bw_u8, ssim_end_c_i32 },
+        { ssim_sse_line_avx512bw_u8, ssim_sse_line_avx512bw_u16 },
+        AVX512BW|AVX512VL|AVX512F|AVX2|AVX
+    },
+#endif
+#if defined(_MSC_VER) || defined(__AVX2__)
+    {
+        { ssim_block_stat_avx2_u8, ssim_block_stat_avx2_u16 },
+        { ssim_end_avx2_u8, ssim_end_c_i32 },
+        { ssim_sse_line_avx2_u8, ssim_sse_line_avx2_u16 },
+        AVX2|AVX
+    },
+#endif
+    {
+        { ssim_block_stat_c_u8, ssim_block_stat_c_u16 },
+        { ssim_end_c_i32, ssim_end_c_i32 },
+        { ssim_sse_line_c<uint8_t>, ssim_sse_line_c<uint16_t> },
+        NONE
+    },
+};
+
+const RGYSsimFunc *get_ssim_func(uint32_t simd) {
+    const uint32_t availableSIMD = get_availableSIMD() & simd;
+    for (int i = 0; i < _countof(SSIM_FUNC_LIST); i++) {
+        if (SSIM_FUNC_LIST[i].simd == (availableSIMD & SSIM_FUNC_LIST[i].simd)) {
+            return &SSIM_FUNC_LIST[i];
+        }
+    }
+    return nullptr;
+}
+
+//RGY_SSIM_SIMD_MAX_BIT_DEPTHより大きいbit深度用の64bit整数の統計量
+struct RGYSsimBlockStat64 {
+    int64_t *s1;
+    int64_t *s2;
+    int64_t *ss;
+    int64_t *s12;
+};
+
+//ブロック1行分の統計量を上下2行分交互に計算しながら、窓の行[y_start, y_end)のssimの和を求める
+template<typename Tstat, typename Tval>
+static double ssim_plane_rows(const FrameInfo *plane0, const FrameInfo *plane1, int y_start, int y_end,
+    std::function<void(Tstat *, const void *, int, const void *, int, int)> block_stat,
+    std::function<double(const Tstat *, const Tstat *, int, int)> ssim_end) {
+    const auto window = rgy_ssim_window_count(plane0->width, plane0->height);
+    y_start = (std::max)(y_start, 0);
+    y_end = (std::min)(y_end, window.second);
+    if (window.first <= 0 || y_start >= y_end) {
+        return 0.0;
+    }
+    const int bit_depth = RGY_CSP_BIT_DEPTH[plane0->csp];
+    const int block_count = window.first + 1;
+    const int stride = ALIGN(block_count, 16);
+    std::vector<Tval> buf(stride * 8);
+    Tstat stat[2];
+    for (int i = 0; i < 2; i++) {
+        stat[i].s1  = buf.data() + stride * (i * 4 + 0);
+        stat[i].s2  = buf.data() + stride * (i * 4 + 1);
+        stat[i].ss  = buf.data() + stride * (i * 4 + 2);
+        stat[i].s12 = buf.data() + stride * (i * 4 + 3);
+    }
+    auto calc_block_stat = [&](Tstat *dst, int by) {
+        block_stat(dst,
+            plane0->ptr[0] + by * 4 * plane0->pitch[0], plane0->pitch[0],
+            plane1->ptr[0] + by * 4 * plane1->pitch[0], plane1->pitch[0], block_count);
+    };
+    calc_block_stat(&stat[0], y_start);
+    double ssim = 0.0;
+    for (int y = y_start; y < y_end; y++) {
+        Tstat *stat0 = &stat[(y - y_start + 0) & 1];
+        Tstat *stat1 = &stat[(y - y_start + 1) & 1];
+        calc_block_stat(stat1, y + 1);
+        ssim += ssim_end(stat0, stat1, window.first, bit_depth);
+    }
+    return ssim;
+}
+
+double rgy_ssim_plane(const FrameInfo *plane0, const FrameInfo *plane1, int y_start, int y_end, const RGYSsimFunc *func) {
+    const int bit_depth = RGY_CSP_BIT_DEPTH[plane0->csp];
+    if (bit_depth > RGY_SSIM_SIMD_MAX_BIT_DEPTH) {
+        return ssim_plane_rows<RGYSsimBlockStat64, int64_t>(plane0, plane1, y_start, y_end,
+            ssim_block_stat_c<uint16_t, RGYSsimBlockStat64>, ssim_end_c<RGYSsimBlockStat64>);
+    }
+    const int idx = (bit_depth > 8) ? 1 : 0;
+    return ssim_plane_rows<RGYSsimBlockStat, int32_t>(plane0, plane1, y_start, y_end,
+        func->block_stat[idx], func->ssim_end[idx]);
+}
+
+int64_t rgy_sse_plane(const FrameInfo *plane0, const FrameInfo *plane1, int y_start, int y_end, const RGYSsimFunc *func) {
+    const int bit_depth = RGY_CSP_BIT_DEPTH[plane0->csp];
+    //madd_epi16で差分の二乗を計算するので、SIMD版はRGY_SSIM_SIMD_MAX_BIT_DEPTHまで
+    auto sse_line = (bit_depth > RGY_SSIM_SIMD_MAX_BIT_DEPTH) ? ssim_sse_line_c<uint16_t> : func->sse_line[(bit_depth > 8) ? 1 : 0];
+    y_start = (std::max)(y_start, 0);
+    y_end = (std::min)(y_end, plane0->height);
+    int64_t sse = 0;
+    for (int y = y_start; y < y_end; y++) {
+        sse += sse_line(plane0->ptr[0] + y * plane0->pitch[0], plane1->ptr[0] + y * plane1->pitch[0], plane0->width);
+    }
+    return sse;
+}
+
+RGYSsimCPU::RGYSsimCPU() :
+    m_func(nullptr),
+    m_csp(RGY_CSP_NA),
+    m_width(0),
+    m_height(0),
+    m_ssim(false),
+    m_psnr(false),
+    m_threads(1),
+    m_planeCoef(),
+    m_ssimBand(),
+    m_sseBand(),
+    m_th(), m_heStart(), m_heFin(), m_heFinCopy(),
+    m_prm() {
+}
+
+RGYSsimCPU::~RGYSsimCPU() {
+    close();
+}
+
+void RGYSsimCPU::close() {
+    m_prm.abort = true;
+    for (size_t i = 0; i < m_heStart.size(); i++) {
+        SetEvent(m_heStart[i].get());
+    }
+    for (size_t i = 0; i < m_th.size(); i++) {
+        m_th[i].join();
+    }
+    m_heFinCopy.clear();
+    m_heStart.clear();
+    m_heFin.clear();
+    m_th.clear();
+}
+
+RGY_ERR RGYSsimCPU::init(RGY_CSP csp, int width, int height, bool ssim, bool psnr, int threads, uint32_t simd) {
+    close();
+    if (RGY_CSP_PLANES[csp] != 3
+        || (   RGY_CSP_CHROMA_FORMAT[csp] != RGY_CHROMAFMT_YUV420
+            && RGY_CSP_CHROMA_FORMAT[csp] != RGY_CHROMAFMT_YUV422
+            && RGY_CSP_CHROMA_FORMAT[csp] != RGY_CHROMAFMT_YUV444)) {
+        return RGY_ERR_INVALID_COLOR_FORMAT;
+    }
+    if (width <= 0 || height <= 0) {
+        return RGY_ERR_INVALID_PARAM;
+    }
+    m_func = get_ssim_func(simd);
+    m_csp = csp;
+    m_width = width;
+    m_height = height;
+    m_ssim = ssim;
+    m_psnr = psnr;
+
+    FrameInfo frame;
+    frame.csp = csp;
+    frame.width = width;
+    frame.height = height;
+    double elemSum = 0.0;
+    for (int i = 0; i < RGY_CSP_PLANES[csp]; i++) {
+        const auto plane = getPlane(&frame, (RGY_PLANE)i);
+        elemSum += plane.width * plane.height;
+    }
+    for (int i = 0; i < RGY_CSP_PLANES[csp]; i++) {
+        const auto plane = getPlane(&frame, (RGY_PLANE)i);
+        m_planeCoef[i] = (double)(plane.width * plane.height) / elemSum;
+    }
+
+    //各スレッドが少なくとも窓の数行分を担当するようにする
+    const int threadMax = (std::max)(1, height >> 5);
+    m_threads = (threads > 0) ? threads : (int)get_cpu_info().physical_cores;
+    m_threads = clamp(m_threads, 1, threadMax);
+    m_ssimBand.resize(m_threads);
+    m_sseBand.resize(m_threads);
+
+    m_prm.abort = false;
+    for (int ith = 1; ith < m_threads; ith++) {
+        auto heStart = std::unique_ptr<void, handle_deleter>(CreateEvent(nullptr, false, false, nullptr), handle_deleter());
+        auto heFin = std::unique_ptr<void, handle_deleter>(CreateEvent(nullptr, false, false, nullptr), handle_deleter());
+        m_th.push_back(std::thread([this, heStart = heStart.get(), heFin = heFin.get(), ithId = ith]() {
+            WaitForSingleObject((HANDLE)heStart, INFINITE);
+            while (!m_prm.abort) {
+                run_band(ithId);
+                SetEvent((HANDLE)heFin);
+                WaitForSingleObject((HANDLE)heStart, INFINITE);
+            }
+        }));
+        m_heFinCopy.push_back(heFin.get());
+        m_heStart.push_back(std::move(heStart));
+        m_heFin.push_back(std::move(heFin));
+    }
+    return RGY_ERR_NONE;
+}
+
+void RGYSsimCPU::run_band(int ith) {
+    for (int i = 0; i < RGY_CSP_PLANES[m_csp]; i++) {
+        const auto plane0 = getPlane(m_prm.frame0, (RGY_PLANE)i);
+        const auto plane1 = getPlane(m_prm.frame1, (RGY_PLANE)i);
+        if (m_ssim) {
+            const int rows = rgy_ssim_window_count(plane0.width, plane0.height).second;
+            m_ssimBand[ith][i] = rgy_ssim_plane(&plane0, &plane1, rows * ith / m_threads, rows * (ith + 1) / m_threads, m_func);
+        }
+        if (m_psnr) {
+            const int rows = plane0.height;
+            m_sseBand[ith][i] = rgy_sse_plane(&plane0, &plane1, rows * ith / m_threads, rows * (ith + 1) / m_threads, m_func);
+        }
+    }
+}
+
+RGY_ERR RGYSsimCPU::compare(RGYSsimResult *result, const FrameInfo *frame0, const FrameInfo *frame1) {
+    if (!m_func) {
+        return RGY_ERR_NOT_INITIALIZED;
+    }
+    if (frame0->csp != m_csp || frame1->csp != m_csp
+        || frame0->width != m_width || frame1->width != m_width
+        || frame0->height != m_height || frame1->height != m_height) {
+        return RGY_ERR_INVALID_PARAM;
+    }
+    m_prm.frame0 = frame0;
+    m_prm.frame1 = frame1;
+    for (size_t i = 0; i < m_heStart.size(); i++) {
+        SetEvent(m_heStart[i].get());
+    }
+    run_band(0);
+    if (m_th.size() > 0) {
+        WaitForMultipleObjects((uint32_t)m_heFinCopy.size(), m_heFinCopy.data(), TRUE, INFINITE);
+    }
+
+    *result = RGYSsimResult();
+    for (int i = 0; i < RGY_CSP_PLANES[m_csp]; i++) {
+        const auto plane0 = getPlane(frame0, (RGY_PLANE)i);
+        if (m_ssim) {
+            double ssimPlane = 0.0;
+            for (int ith = 0; ith < m_threads; ith++) {
+                ssimPlane += m_ssimBand[ith][i];
+            }
+            const auto window = rgy_ssim_window_count(plane0.width, plane0.height);
+            if (window.first * window.second > 0) {
+                ssimPlane /= (double)(window.first * window.second);
+            }
+            result->ssimPlane[i] = ssimPlane;
+            result->ssim += ssimPlane * m_planeCoef[i];
+        }
+        if (m_psnr) {
+            int64_t ssePlane = 0;
+            for (int ith = 0; ith < m_threads; ith++) {
+                ssePlane += m_sseBand[ith][i];
+            }
+            const double msePlane = ssePlane / (double)(plane0.width * plane0.height);
+            result->msePlane[i] = msePlane;
+            result->mse += msePlane * m_planeCoef[i];
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+static double ssim_db(double ssim, double weight) {
+    return 10.0 * log10(weight / (weight - ssim));
+}
+
+static double get_psnr(double mse, uint64_t nb_frames, int max) {
+    return 10.0 * log10((max * max) / (mse / nb_frames));
+}
+
+//比較用にy4m/rawファイルからフレームを順に読み込む
+//ファイルをマッピングし、読み込んだデータをコピーせずにそのまま比較に使用する
+class RGYSsimFileReader {
+public:
+    RGYSsimFileReader() : m_fp(), m_mappedFile(), m_y4m(false), m_csp(RGY_CSP_NA), m_width(0), m_height(0), m_frameSize(0), m_pos(0), m_buf() {};
+    ~RGYSsimFileReader() {};
+
+    RGY_ERR open(const TCHAR *filename, const RGYSsimCompareFilePrm *prm) {
+        FILE *fp = nullptr;
+        int error = 0;
+        if (0 != (error = _tfopen_s(&fp, filename, _T("rb"))) || fp == nullptr) {
+            _ftprintf(stderr, _T("Failed to open file \"%s\": %s.\n"), filename, _tcserror(error));
+            return RGY_ERR_FILE_OPEN;
+        }
+        m_fp = std::unique_ptr<FILE, fp_deleter>(fp, fp_deleter());
+
+        char buf[256] = { 0 };
+        m_y4m = fread(buf, 1, strlen("YUV4MPEG2"), m_fp.get()) == strlen("YUV4MPEG2") && strcmp(buf, "YUV4MPEG2") == 0;
+        if (m_y4m) {
+#if ENABLE_RAW_READER
+            VideoInfo info;
+            if (!fgets(buf, sizeof(buf), m_fp.get())
+                || RGY_ERR_NONE != RGYInputRaw::ParseY4MHeader(buf, &info)) {
+                _ftprintf(stderr, _T("Failed to parse y4m header: \"%s\".\n"), filename);
+                return RGY_ERR_INVALID_FORMAT;
+            }
+            m_width = info.srcWidth;
+            m_height = info.srcHeight;
+            m_csp = info.csp;
+#else
+            return RGY_ERR_UNSUPPORTED;
+#endif
+        } else {
+            m_width = prm->width;
+            m_height = prm->height;
+            m_csp = prm->csp;
+            if (m_width <= 0 || m_height <= 0) {
+                _ftprintf(stderr, _T("--input-res is required for raw input: \"%s\".\n"), filename);
+                return RGY_ERR_INVALID_PARAM;
+            }
+        }
+        if (RGY_CSP_PLANES[m_csp] != 3
+            || (   RGY_CSP_CHROMA_FORMAT[m_csp] != RGY_CHROMAFMT_YUV420
+                && RGY_CSP_CHROMA_FORMAT[m_csp] != RGY_CHROMAFMT_YUV422
+                && RGY_CSP_CHROMA_FORMAT[m_csp] != RGY_CHROMAFMT_YUV444)) {
+            _ftprintf(stderr, _T("Unsupported colorspace %s: \"%s\".\n"), RGY_CSP_NAMES[m_csp], filename);
+            return RGY_ERR_INVALID_COLOR_FORMAT;
+        }
+        m_pos = m_y4m ? _ftelli64(m_fp.get()) : 0;
+        _fseeki64(m_fp.get(), m_pos, SEEK_SET);
+
+        const auto frame = frameInfo(nullptr);
+        m_frameSize = 0;
+        for (int i = 0; i < RGY_CSP_PLANES[m_csp]; i++) {
+            const auto plane = getPlane(&frame, (RGY_PLANE)i);
+            m_frameSize += (size_t)plane.pitch[0] * plane.height;
+        }
+        //32bitではアドレス空間が足りないので、一部ずつマッピングする
+        const uint64_t windowSize = (sizeof(void *) >= 8) ? 0 : std::max<uint64_t>(64 * 1024 * 1024, (uint64_t)m_frameSize * 8);
+        m_mappedFile = std::make_unique<RGYMappedFile>();
+        if (m_mappedFile->open(m_fp.get(), windowSize) != RGY_ERR_NONE) {
+            //マッピングできない場合はfreadで読み込む
+            m_mappedFile.reset();
+            m_buf.resize(m_frameSize);
+        }
+        return RGY_ERR_NONE;
+    }
+
+    //次のフレームを読み込む (終端ではRGY_ERR_MORE_DATAを返す)
+    //返したフレームは、次にreadFrame()を呼ぶまで有効
+    RGY_ERR readFrame(FrameInfo *frame) {
+        if (m_y4m) {
+            //FRAMEヘッダを読み飛ばす
+            char hdr[Y4M_FRAME_HEADER_MAX] = { 0 };
+            size_t hdrSize = 0;
+            if (m_mappedFile) {
+                const size_t mapSize = (size_t)std::min<uint64_t>(sizeof(hdr), m_mappedFile->size() - std::min(m_pos, m_mappedFile->size()));
+                const uint8_t *ptr = (mapSize > 0) ? m_mappedFile->map(m_pos, mapSize) : nullptr;
+                const uint8_t *ptr_fin = (ptr) ? (const uint8_t *)memchr(ptr, '\n', mapSize) : nullptr;
+                if (ptr_fin == nullptr) {
+                    return RGY_ERR_MORE_DATA;
+                }
+                hdrSize = ptr_fin - ptr + 1;
+                memcpy(hdr, ptr, std::min(hdrSize, sizeof(hdr)));
+            } else {
+                if (!fgets(hdr, sizeof(hdr), m_fp.get())) {
+                    return RGY_ERR_MORE_DATA;
+                }
+                hdrSize = strlen(hdr);
+            }
+            if (memcmp(hdr, "FRAME", strlen("FRAME")) != 0) {
+                return RGY_ERR_MORE_DATA;
+            }
+            m_pos += hdrSize;
+        }
+        const uint8_t *ptr = nullptr;
+        if (m_mappedFile) {
+            if (m_pos + m_frameSize > m_mappedFile->size()
+                || (ptr = m_mappedFile->map(m_pos, m_frameSize)) == nullptr) {
+                return RGY_ERR_MORE_DATA;
+            }
+            m_mappedFile->prefetch(m_pos + m_frameSize, m_frameSize);
+        } else {
+            if (fread(m_buf.data(), 1, m_frameSize, m_fp.get()) != m_frameSize) {
+                return RGY_ERR_MORE_DATA;
+            }
+            ptr = m_buf.data();
+        }
+        m_pos += m_frameSize;
+        *frame = frameInfo(ptr);
+        return RGY_ERR_NONE;
+    }
+
+    RGY_CSP csp() const { return m_csp; }
+    int width() const { return m_width; }
+    int height() const { return m_height; }
+protected:
+    static const int Y4M_FRAME_HEADER_MAX = 64;
+
+    //平面形式のフレームの各プレーンの位置
+    FrameInfo frameInfo(const uint8_t *ptr) const {
+        FrameInfo frame;
+        frame.csp = m_csp;
+        frame.width = m_width;
+        frame.height = m_height;
+        const int pixsize = (RGY_CSP_BIT_DEPTH[m_csp] > 8) ? 2 : 1;
+        const int uvshift_x = (RGY_CSP_CHROMA_FORMAT[m_csp] == RGY_CHROMAFMT_YUV444) ? 0 : 1;
+        const int uvshift_y = (RGY_CSP_CHROMA_FORMAT[m_csp] == RGY_CHROMAFMT_YUV420) ? 1 : 0;
+        frame.pitch[0] = m_width * pixsize;
+        frame.pitch[1] = frame.pitch[2] = (m_width >> uvshift_x) * pixsize;
+        frame.ptr[0] = (uint8_t *)ptr;
+        if (ptr) {
+            frame.ptr[1] = frame.ptr[0] + frame.pitch[0] * m_height;
+            frame.ptr[2] = frame.ptr[1] + frame.pitch[1] * (m_height >> uvshift_y);
+        }
+        return frame;
+    }
+
+    std::unique_ptr<FILE, fp_deleter> m_fp;
+    std::unique_ptr<RGYMappedFile> m_mappedFile;
+    bool m_y4m;
+    RGY_CSP m_csp;
+    int m_width;
+    int m_height;
+    size_t m_frameSize;
+    uint64_t m_pos;
+    std::vector<uint8_t> m_buf;
+};
+
+int rgy_compare_files(const RGYSsimCompareFilePrm *prm) {
+    RGYSsimFileReader reader[2];
+    for (int i = 0; i < 2; i++) {
+        if (reader[i].open(prm->file[i].c_str(), prm) != RGY_ERR_NONE) {
+            return 1;
+        }
+    }
+    if (reader[0].csp() != reader[1].csp()
+        || reader[0].width() != reader[1].width()
+        || reader[0].height() != reader[1].height()) {
+        _ftprintf(stderr, _T("Input files have different format: %s %dx%d, %s %dx%d.\n"),
+            RGY_CSP_NAMES[reader[0].csp()], reader[0].width(), reader[0].height(),
+            RGY_CSP_NAMES[reader[1].csp()], reader[1].width(), reader[1].height());
+        return 1;
+    }
+    const auto csp = reader[0].csp();
+    const int planes = RGY_CSP_PLANES[csp];
+    const int maxval = (1 << RGY_CSP_BIT_DEPTH[csp]) - 1;
+
+    RGYSsimCPU ssim;
+    auto err = ssim.init(csp, reader[0].width(), reader[0].height(), prm->ssim, prm->psnr, prm->threads, 0xffffffff);
+    if (err != RGY_ERR_NONE) {
+        _ftprintf(stderr, _T("Failed to initialize ssim/psnr calculation: %s.\n"), get_err_mes(err));
+        return 1;
+    }
+
+    std::unique_ptr<FILE, fp_deleter> fpLog;
+    if (prm->qualityLog.length() > 0) {
+        FILE *fp = nullptr;
+        if (_tfopen_s(&fp, prm->qualityLog.c_str(), _T("w")) || fp == NULL) {
+            _ftprintf(stderr, _T("Failed to open quality log file \"%s\".\n"), prm->qualityLog.c_str());
+            return 1;
+        }
+        fpLog = std::unique_ptr<FILE, fp_deleter>(fp, fp_deleter());
+        fprintf(fpLog.get(), "frame");
+        if (prm->ssim) fprintf(fpLog.get(), ",ssim_y,ssim_u,ssim_v,ssim_all");
+        if (prm->psnr) fprintf(fpLog.get(), ",psnr_y,psnr_u,psnr_v,psnr_all");
+        fprintf(fpLog.get(), "\n");
+    }
+
+    std::array<double, 3> ssimTotalPlane = { 0.0, 0.0, 0.0 };
+    std::array<double, 3> mseTotalPlane = { 0.0, 0.0, 0.0 };
+    double ssimTotal = 0.0;
+    double mseTotal = 0.0;
+    int frames = 0;
+    const auto timeStart = std::chrono::system_clock::now();
+    for (;; frames++) {
+        FrameInfo frame[2];
+        if (reader[0].readFrame(&frame[0]) != RGY_ERR_NONE
+            || reader[1].readFrame(&frame[1]) != RGY_ERR_NONE) {
+            break;
+        }
+        RGYSsimResult result;
+        if ((err = ssim.compare(&result, &frame[0], &frame[1])) != RGY_ERR_NONE) {
+            _ftprintf(stderr, _T("Failed to calculate ssim/psnr: %s.\n"), get_err_mes(err));
+            return 1;
+        }
+        for (int i = 0; i < planes; i++) {
+            ssimTotalPlane[i] += result.ssimPlane[i];
+            mseTotalPlane[i] += result.msePlane[i];
+        }
+        ssimTotal += result.ssim;
+        mseTotal += result.mse;
+        if (fpLog) {
+            fprintf(fpLog.get(), "%d", frames);
+            if (prm->ssim) {
+                fprintf(fpLog.get(), ",%.6f,%.6f,%.6f,%.6f", result.ssimPlane[0], result.ssimPlane[1], result.ssimPlane[2], result.ssim);
+            }
+            if (prm->psnr) {
+                //psnrは1フレーム分のmseから計算する (mse = 0 のときはinf)
+                for (const auto psnrMse : { result.msePlane[0], result.msePlane[1], result.msePlane[2], result.mse }) {
+                    if (psnrMse > 0.0) {
+                        fprintf(fpLog.get(), ",%.4f", get_psnr(psnrMse, 1, maxval));
+                    } else {
+                        fprintf(fpLog.get(), ",inf");
+                    }
+                }
+            }
+            fprintf(fpLog.get(), "\n");
+        }
+    }
+    const double elapsed = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now() - timeStart).count() * 1e-6;
+    if (frames == 0) {
+        _ftprintf(stderr, _T("No frames to compare.\n"));
+        return 1;
+    }
+    _ftprintf(stderr, _T("compared %d frames, %.2f fps (%s, %d threads).\n"),
+        frames, frames / (std::max)(elapsed, 1e-6), get_simd_str(ssim.getFunc()->simd), ssim.threads());
+    if (prm->ssim) {
+        auto str = strsprintf(_T("SSIM YUV:"));
+        for (int i = 0; i < planes; i++) {
+            str += strsprintf(_T(" %f (%f),"), ssimTotalPlane[i] / frames, ssim_db(ssimTotalPlane[i], (double)frames));
+        }
+        str += strsprintf(_T(" All: %f (%f), (Frames: %d)\n"), ssimTotal / frames, ssim_db(ssimTotal, (double)frames), frames);
+        _ftprintf(stdout, _T("%s"), str.c_str());
+    }
+    if (prm->psnr) {
+        auto str = strsprintf(_T("PSNR YUV:"));
+        for (int i = 0; i < planes; i++) {
+            str += strsprintf(_T(" %f,"), get_psnr(mseTotalPlane[i], frames, maxval));
+        }
+        str += strsprintf(_T(" Avg: %f, (Frames: %d)\n"), get_psnr(mseTotal, frames, maxval), frames);
+        _ftprintf(stdout, _T("%s"), str.c_str());
+    }
+    return 0;
+}
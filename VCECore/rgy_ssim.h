@@ -0,0 +1,160 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_SSIM_H__
+#define __RGY_SSIM_H__
+
+#include <cstdint>
+#include <array>
+#include <vector>
+#include <thread>
+#include <memory>
+#include <algorithm>
+#include "rgy_osdep.h"
+#include "rgy_util.h"
+#include "rgy_err.h"
+#include "rgy_event.h"
+#include "rgy_tchar.h"
+#include "convert_csp.h"
+
+//CPU版のssim/psnrの計算
+//OpenCL版(vce_filter_ssim.cl)と同じく、4x4ブロックの統計量を2x2ブロック(8x8の窓)ずつ、
+//4画素おきに集計してssimを計算する
+//  ssim: 8x8の窓は横(width>>2)-1個、縦(height>>2)-1個
+//        (幅・高さが4の倍数でない場合、OpenCL版は端のブロックで範囲外を読むが、CPU版は4の倍数に満たない部分を使用しない)
+//  psnr: 二乗誤差の総和を返す (OpenCL版と同じ整数値となる)
+//SIMD版は12bitまでで、それより大きいbit深度では64bit整数を使用するC版で計算する
+
+//SIMD版で計算可能な最大bit深度 (4x4ブロックの統計量がint32に収まる範囲)
+static const int RGY_SSIM_SIMD_MAX_BIT_DEPTH = 12;
+
+//4x4ブロックの統計量 (ブロック1行分をSoAで保持する)
+//s1, s2: 画素値の和, ss: 画素値の二乗の和(2フレーム分), s12: 画素値の積の和
+struct RGYSsimBlockStat {
+    int32_t *s1;
+    int32_t *s2;
+    int32_t *ss;
+    int32_t *s12;
+};
+
+//ssim/psnrの計算関数 ([0]=8bit, [1]=16bit(RGY_SSIM_SIMD_MAX_BIT_DEPTHまで))
+struct RGYSsimFunc {
+    //ブロック1行分(4画素行)の4x4ブロックの統計量を計算する
+    void (*block_stat[2])(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count);
+    //上下に隣接するブロック1行分ずつの統計量から、8x8の窓のssimの和を計算する
+    //窓はwindow_count個、統計量はwindow_count+1個必要
+    double (*ssim_end[2])(const RGYSsimBlockStat *stat0, const RGYSsimBlockStat *stat1, int window_count, int bit_depth);
+    //1行分の二乗誤差の和
+    int64_t (*sse_line[2])(const void *p0, const void *p1, int width);
+    uint32_t simd;
+};
+
+const RGYSsimFunc *get_ssim_func(uint32_t simd);
+
+//プレーン単位のssimの和 (窓の行[y_start, y_end)の範囲)
+//窓の数で割る前の値を返す (窓の数は rgy_ssim_window_count() で取得する)
+double rgy_ssim_plane(const FrameInfo *plane0, const FrameInfo *plane1, int y_start, int y_end, const RGYSsimFunc *func);
+//プレーン単位の二乗誤差の和 (画素の行[y_start, y_end)の範囲)
+int64_t rgy_sse_plane(const FrameInfo *plane0, const FrameInfo *plane1, int y_start, int y_end, const RGYSsimFunc *func);
+
+//プレーンの8x8の窓の数 (横, 縦)
+static inline std::pair<int, int> rgy_ssim_window_count(int width, int height) {
+    return std::make_pair((std::max)((width >> 2) - 1, 0), (std::max)((height >> 2) - 1, 0));
+}
+
+//1フレーム分のssim/psnrの計算結果
+struct RGYSsimResult {
+    std::array<double, 3> ssimPlane; //各プレーンのssim
+    double ssim;                     //プレーンの画素数で重みづけしたssim
+    std::array<double, 3> msePlane;  //各プレーンのmse
+    double mse;                      //プレーンの画素数で重みづけしたmse
+
+    RGYSsimResult() : ssimPlane(), ssim(0.0), msePlane(), mse(0.0) {};
+};
+
+struct RGYSsimCPUPrm {
+    bool abort;
+    const FrameInfo *frame0;
+    const FrameInfo *frame1;
+
+    RGYSsimCPUPrm() : abort(false), frame0(nullptr), frame1(nullptr) {};
+};
+
+//フレーム単位のssim/psnrの計算
+//プレーンを横帯に分割し、複数スレッドで計算する
+class RGYSsimCPU {
+public:
+    RGYSsimCPU();
+    ~RGYSsimCPU();
+    //threads: 0で自動
+    RGY_ERR init(RGY_CSP csp, int width, int height, bool ssim, bool psnr, int threads, uint32_t simd);
+    //CPUメモリ上の平面形式のフレーム同士を比較する
+    RGY_ERR compare(RGYSsimResult *result, const FrameInfo *frame0, const FrameInfo *frame1);
+    const RGYSsimFunc *getFunc() const { return m_func; }
+    int threads() const { return m_threads; }
+protected:
+    //ith番目のスレッドの担当する横帯を計算する
+    void run_band(int ith);
+    void close();
+
+    const RGYSsimFunc *m_func;
+    RGY_CSP m_csp;
+    int m_width;
+    int m_height;
+    bool m_ssim;
+    bool m_psnr;
+    int m_threads;
+    std::array<double, 3> m_planeCoef; //各プレーンの画素数の比
+    std::vector<std::array<double, 3>> m_ssimBand;  //スレッドごとのssimの和
+    std::vector<std::array<int64_t, 3>> m_sseBand;  //スレッドごとの二乗誤差の和
+    std::vector<std::thread> m_th;
+    std::vector<std::unique_ptr<void, handle_deleter>> m_heStart;
+    std::vector<std::unique_ptr<void, handle_deleter>> m_heFin;
+    std::vector<HANDLE> m_heFinCopy;
+    RGYSsimCPUPrm m_prm;
+};
+
+//2つのy4m/rawファイルを比較する際のパラメータ
+struct RGYSsimCompareFilePrm {
+    tstring file[2];
+    int width;          //rawの場合に必要
+    int height;         //rawの場合に必要
+    RGY_CSP csp;        //rawの場合に必要
+    bool ssim;
+    bool psnr;
+    int threads;
+    tstring qualityLog; //フレームごとの結果を出力するcsvファイル
+
+    RGYSsimCompareFilePrm() : file(), width(0), height(0), csp(RGY_CSP_YV12), ssim(true), psnr(true), threads(0), qualityLog() {};
+};
+
+//2つのy4m/rawファイルをフレームごとに比較し、結果を表示する
+int rgy_compare_files(const RGYSsimCompareFilePrm *prm);
+
+#endif //__RGY_SSIM_H__
@@ -0,0 +1,184 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include "rgy_ssim.h"
+#include "rgy_ssim_c.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
+#endif
+
+#if defined(_MSC_VER) || defined(__AVX2__)
+
+//32画素分(8ブロック分)を16bit x 16 x 2 に読み込む
+template<typename Type>
+static RGY_FORCEINLINE void ssim_load32(__m256i& y0, __m256i& y1, const void *ptr) {
+    if (sizeof(Type) == 1) {
+        const __m256i y = _mm256_loadu_si256((const __m256i *)ptr);
+        y0 = _mm256_cvtepu8_epi16(_mm256_castsi256_si128(y));
+        y1 = _mm256_cvtepu8_epi16(_mm256_extracti128_si256(y, 1));
+    } else {
+        y0 = _mm256_loadu_si256((const __m256i *)ptr);
+        y1 = _mm256_loadu_si256((const __m256i *)ptr + 1);
+    }
+}
+
+//2画素ずつの統計量を加算する
+static RGY_FORCEINLINE void ssim_stat_madd(__m256i& yS1, __m256i& yS2, __m256i& ySS, __m256i& yS12, const __m256i& yA, const __m256i& yB, const __m256i& yOne) {
+    yS1  = _mm256_add_epi32(yS1,  _mm256_madd_epi16(yA, yOne));
+    yS2  = _mm256_add_epi32(yS2,  _mm256_madd_epi16(yB, yOne));
+    ySS  = _mm256_add_epi32(ySS,  _mm256_add_epi32(_mm256_madd_epi16(yA, yA), _mm256_madd_epi16(yB, yB)));
+    yS12 = _mm256_add_epi32(yS12, _mm256_madd_epi16(yA, yB));
+}
+
+//2画素ずつの和(ブロック0-3, 4-7)から、4画素ずつの和をブロック順に並べる
+static RGY_FORCEINLINE __m256i ssim_stat_reduce(const __m256i& y0, const __m256i& y1) {
+    //hadd: [0,1,4,5 | 2,3,6,7] -> [0,1,2,3 | 4,5,6,7]
+    return _mm256_permute4x64_epi64(_mm256_hadd_epi32(y0, y1), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+template<typename Type>
+static RGY_FORCEINLINE void ssim_block_stat_avx2(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    const __m256i yOne = _mm256_set1_epi16(1);
+    int ib = 0;
+    for (; ib + 8 <= block_count; ib += 8) {
+        __m256i yS1_0 = _mm256_setzero_si256(), yS2_0 = _mm256_setzero_si256(), ySS_0 = _mm256_setzero_si256(), yS12_0 = _mm256_setzero_si256();
+        __m256i yS1_1 = _mm256_setzero_si256(), yS2_1 = _mm256_setzero_si256(), ySS_1 = _mm256_setzero_si256(), yS12_1 = _mm256_setzero_si256();
+        for (int y = 0; y < 4; y++) {
+            __m256i yA0, yA1, yB0, yB1;
+            ssim_load32<Type>(yA0, yA1, (const uint8_t *)p0 + y * pitch0 + ib * 4 * sizeof(Type));
+            ssim_load32<Type>(yB0, yB1, (const uint8_t *)p1 + y * pitch1 + ib * 4 * sizeof(Type));
+            ssim_stat_madd(yS1_0, yS2_0, ySS_0, yS12_0, yA0, yB0, yOne);
+            ssim_stat_madd(yS1_1, yS2_1, ySS_1, yS12_1, yA1, yB1, yOne);
+        }
+        _mm256_storeu_si256((__m256i *)(stat->s1  + ib), ssim_stat_reduce(yS1_0,  yS1_1));
+        _mm256_storeu_si256((__m256i *)(stat->s2  + ib), ssim_stat_reduce(yS2_0,  yS2_1));
+        _mm256_storeu_si256((__m256i *)(stat->ss  + ib), ssim_stat_reduce(ySS_0,  ySS_1));
+        _mm256_storeu_si256((__m256i *)(stat->s12 + ib), ssim_stat_reduce(yS12_0, yS12_1));
+    }
+    if (ib < block_count) {
+        auto statRemain = ssim_stat_offset(stat, ib);
+        ssim_block_stat_c<Type>(&statRemain,
+            (const uint8_t *)p0 + ib * 4 * sizeof(Type), pitch0,
+            (const uint8_t *)p1 + ib * 4 * sizeof(Type), pitch1, block_count - ib);
+    }
+}
+
+void ssim_block_stat_avx2_u8(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    ssim_block_stat_avx2<uint8_t>(stat, p0, pitch0, p1, pitch1, block_count);
+}
+
+void ssim_block_stat_avx2_u16(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    ssim_block_stat_avx2<uint16_t>(stat, p0, pitch0, p1, pitch1, block_count);
+}
+
+//8bitの場合、8x8の窓の統計量とssim_end1xの途中の値はすべてint32に収まるので、
+//C版と同じ整数演算・単精度の演算をそのまま8窓ずつ行う
+double ssim_end_avx2_u8(const RGYSsimBlockStat *stat0, const RGYSsimBlockStat *stat1, int window_count, int bit_depth) {
+    const __m256i yC1 = _mm256_set1_epi32((int)ssim_c1(bit_depth));
+    const __m256i yC2 = _mm256_set1_epi32((int)ssim_c2(bit_depth));
+    __m256d yAcc0 = _mm256_setzero_pd();
+    __m256d yAcc1 = _mm256_setzero_pd();
+    auto sum_window = [](const int32_t *ptr0, const int32_t *ptr1) {
+        return _mm256_add_epi32(
+            _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)ptr0), _mm256_loadu_si256((const __m256i *)(ptr0 + 1))),
+            _mm256_add_epi32(_mm256_loadu_si256((const __m256i *)ptr1), _mm256_loadu_si256((const __m256i *)(ptr1 + 1))));
+    };
+    int ix = 0;
+    for (; ix + 8 <= window_count; ix += 8) {
+        const __m256i yS1  = sum_window(stat0->s1  + ix, stat1->s1  + ix);
+        const __m256i yS2  = sum_window(stat0->s2  + ix, stat1->s2  + ix);
+        const __m256i ySS  = sum_window(stat0->ss  + ix, stat1->ss  + ix);
+        const __m256i yS12 = sum_window(stat0->s12 + ix, stat1->s12 + ix);
+        const __m256i yS1S1 = _mm256_mullo_epi32(yS1, yS1);
+        const __m256i yS2S2 = _mm256_mullo_epi32(yS2, yS2);
+        const __m256i yS1S2 = _mm256_mullo_epi32(yS1, yS2);
+        const __m256i yVars  = _mm256_sub_epi32(_mm256_sub_epi32(_mm256_slli_epi32(ySS, 6), yS1S1), yS2S2);
+        const __m256i yCovar = _mm256_sub_epi32(_mm256_slli_epi32(yS12, 6), yS1S2);
+        const __m256 yNum0 = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_slli_epi32(yS1S2, 1), yC1));
+        const __m256 yNum1 = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_slli_epi32(yCovar, 1), yC2));
+        const __m256 yDen0 = _mm256_cvtepi32_ps(_mm256_add_epi32(_mm256_add_epi32(yS1S1, yS2S2), yC1));
+        const __m256 yDen1 = _mm256_cvtepi32_ps(_mm256_add_epi32(yVars, yC2));
+        const __m256 ySsim = _mm256_div_ps(_mm256_mul_ps(yNum0, yNum1), _mm256_mul_ps(yDen0, yDen1));
+        yAcc0 = _mm256_add_pd(yAcc0, _mm256_cvtps_pd(_mm256_castps256_ps128(ySsim)));
+        yAcc1 = _mm256_add_pd(yAcc1, _mm256_cvtps_pd(_mm256_extractf128_ps(ySsim, 1)));
+    }
+    yAcc0 = _mm256_add_pd(yAcc0, yAcc1);
+    __m128d xAcc = _mm_add_pd(_mm256_castpd256_pd128(yAcc0), _mm256_extractf128_pd(yAcc0, 1));
+    xAcc = _mm_add_sd(xAcc, _mm_unpackhi_pd(xAcc, xAcc));
+    double ssim = _mm_cvtsd_f64(xAcc);
+    if (ix < window_count) {
+        const auto stat0Remain = ssim_stat_offset(stat0, ix);
+        const auto stat1Remain = ssim_stat_offset(stat1, ix);
+        ssim += ssim_end_c(&stat0Remain, &stat1Remain, window_count - ix, bit_depth);
+    }
+    return ssim;
+}
+
+//二乗誤差の和 (madd_epi16の結果は非負なので、符号なしで64bitに拡張して加算する)
+template<typename Type>
+static RGY_FORCEINLINE int64_t ssim_sse_line_avx2(const void *p0, const void *p1, int width) {
+    const __m256i yMaskLo = _mm256_set1_epi64x(0xffffffff);
+    __m256i yAcc = _mm256_setzero_si256();
+    int x = 0;
+    for (; x + 32 <= width; x += 32) {
+        __m256i yA0, yA1, yB0, yB1;
+        ssim_load32<Type>(yA0, yA1, (const Type *)p0 + x);
+        ssim_load32<Type>(yB0, yB1, (const Type *)p1 + x);
+        const __m256i yDiff0 = _mm256_sub_epi16(yA0, yB0);
+        const __m256i yDiff1 = _mm256_sub_epi16(yA1, yB1);
+        const __m256i ySse = _mm256_add_epi32(_mm256_madd_epi16(yDiff0, yDiff0), _mm256_madd_epi16(yDiff1, yDiff1));
+        yAcc = _mm256_add_epi64(yAcc, _mm256_and_si256(ySse, yMaskLo));
+        yAcc = _mm256_add_epi64(yAcc, _mm256_srli_epi64(ySse, 32));
+    }
+    alignas(16) int64_t acc[2];
+    _mm_store_si128((__m128i *)acc, _mm_add_epi64(_mm256_castsi256_si128(yAcc), _mm256_extracti128_si256(yAcc, 1)));
+    int64_t sse = acc[0] + acc[1];
+    if (x < width) {
+        sse += ssim_sse_line_c<Type>((const Type *)p0 + x, (const Type *)p1 + x, width - x);
+    }
+    return sse;
+}
+
+int64_t ssim_sse_line_avx2_u8(const void *p0, const void *p1, int width) {
+    return ssim_sse_line_avx2<uint8_t>(p0, p1, width);
+}
+
+int64_t ssim_sse_line_avx2_u16(const void *p0, const void *p1, int width) {
+    return ssim_sse_line_avx2<uint16_t>(p0, p1, width);
+}
+
+#endif //#if defined(_MSC_VER) || defined(__AVX2__)
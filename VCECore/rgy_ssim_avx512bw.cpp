@@ -0,0 +1,188 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include "rgy_ssim.h"
+#include "rgy_ssim_c.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX512BW__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX512 for this file.");
+#endif
+
+#if defined(_MSC_VER) || (defined(__AVX512BW__) && defined(__AVX512VL__))
+
+//64画素分(16ブロック分)を16bit x 32 x 2 に読み込む
+template<typename Type>
+static RGY_FORCEINLINE void ssim_load64(__m512i& z0, __m512i& z1, const void *ptr) {
+    if (sizeof(Type) == 1) {
+        const __m512i z = _mm512_loadu_si512((const __m512i *)ptr);
+        z0 = _mm512_cvtepu8_epi16(_mm512_castsi512_si256(z));
+        z1 = _mm512_cvtepu8_epi16(_mm512_extracti64x4_epi64(z, 1));
+    } else {
+        z0 = _mm512_loadu_si512((const __m512i *)ptr);
+        z1 = _mm512_loadu_si512((const __m512i *)ptr + 1);
+    }
+}
+
+//2画素ずつの統計量を加算する
+static RGY_FORCEINLINE void ssim_stat_madd(__m512i& zS1, __m512i& zS2, __m512i& zSS, __m512i& zS12, const __m512i& zA, const __m512i& zB, const __m512i& zOne) {
+    zS1  = _mm512_add_epi32(zS1,  _mm512_madd_epi16(zA, zOne));
+    zS2  = _mm512_add_epi32(zS2,  _mm512_madd_epi16(zB, zOne));
+    zSS  = _mm512_add_epi32(zSS,  _mm512_add_epi32(_mm512_madd_epi16(zA, zA), _mm512_madd_epi16(zB, zB)));
+    zS12 = _mm512_add_epi32(zS12, _mm512_madd_epi16(zA, zB));
+}
+
+//2画素ずつの和(ブロック0-7, 8-15)から、4画素ずつの和をブロック順に並べる
+static RGY_FORCEINLINE __m512i ssim_stat_reduce(const __m512i& z0, const __m512i& z1, const __m512i& zIdxEven) {
+    //隣接する2要素の和を各64bitの下位に求め、偶数番目の要素を集める
+    const __m512i zSum0 = _mm512_add_epi32(z0, _mm512_srli_epi64(z0, 32));
+    const __m512i zSum1 = _mm512_add_epi32(z1, _mm512_srli_epi64(z1, 32));
+    return _mm512_permutex2var_epi32(zSum0, zIdxEven, zSum1);
+}
+
+template<typename Type>
+static RGY_FORCEINLINE void ssim_block_stat_avx512(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    const __m512i zOne = _mm512_set1_epi16(1);
+    const __m512i zIdxEven = _mm512_set_epi32(30, 28, 26, 24, 22, 20, 18, 16, 14, 12, 10, 8, 6, 4, 2, 0);
+    int ib = 0;
+    for (; ib + 16 <= block_count; ib += 16) {
+        __m512i zS1_0 = _mm512_setzero_si512(), zS2_0 = _mm512_setzero_si512(), zSS_0 = _mm512_setzero_si512(), zS12_0 = _mm512_setzero_si512();
+        __m512i zS1_1 = _mm512_setzero_si512(), zS2_1 = _mm512_setzero_si512(), zSS_1 = _mm512_setzero_si512(), zS12_1 = _mm512_setzero_si512();
+        for (int y = 0; y < 4; y++) {
+            __m512i zA0, zA1, zB0, zB1;
+            ssim_load64<Type>(zA0, zA1, (const uint8_t *)p0 + y * pitch0 + ib * 4 * sizeof(Type));
+            ssim_load64<Type>(zB0, zB1, (const uint8_t *)p1 + y * pitch1 + ib * 4 * sizeof(Type));
+            ssim_stat_madd(zS1_0, zS2_0, zSS_0, zS12_0, zA0, zB0, zOne);
+            ssim_stat_madd(zS1_1, zS2_1, zSS_1, zS12_1, zA1, zB1, zOne);
+        }
+        _mm512_storeu_si512((__m512i *)(stat->s1  + ib), ssim_stat_reduce(zS1_0,  zS1_1,  zIdxEven));
+        _mm512_storeu_si512((__m512i *)(stat->s2  + ib), ssim_stat_reduce(zS2_0,  zS2_1,  zIdxEven));
+        _mm512_storeu_si512((__m512i *)(stat->ss  + ib), ssim_stat_reduce(zSS_0,  zSS_1,  zIdxEven));
+        _mm512_storeu_si512((__m512i *)(stat->s12 + ib), ssim_stat_reduce(zS12_0, zS12_1, zIdxEven));
+    }
+    if (ib < block_count) {
+        auto statRemain = ssim_stat_offset(stat, ib);
+        ssim_block_stat_c<Type>(&statRemain,
+            (const uint8_t *)p0 + ib * 4 * sizeof(Type), pitch0,
+            (const uint8_t *)p1 + ib * 4 * sizeof(Type), pitch1, block_count - ib);
+    }
+}
+
+void ssim_block_stat_avx512bw_u8(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    ssim_block_stat_avx512<uint8_t>(stat, p0, pitch0, p1, pitch1, block_count);
+}
+
+void ssim_block_stat_avx512bw_u16(RGYSsimBlockStat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    ssim_block_stat_avx512<uint16_t>(stat, p0, pitch0, p1, pitch1, block_count);
+}
+
+//AVX2版と同じく、8bitの場合のみ16窓ずつ計算する
+double ssim_end_avx512bw_u8(const RGYSsimBlockStat *stat0, const RGYSsimBlockStat *stat1, int window_count, int bit_depth) {
+    const __m512i zC1 = _mm512_set1_epi32((int)ssim_c1(bit_depth));
+    const __m512i zC2 = _mm512_set1_epi32((int)ssim_c2(bit_depth));
+    __m512d zAcc0 = _mm512_setzero_pd();
+    __m512d zAcc1 = _mm512_setzero_pd();
+    auto sum_window = [](const int32_t *ptr0, const int32_t *ptr1) {
+        return _mm512_add_epi32(
+            _mm512_add_epi32(_mm512_loadu_si512((const __m512i *)ptr0), _mm512_loadu_si512((const __m512i *)(ptr0 + 1))),
+            _mm512_add_epi32(_mm512_loadu_si512((const __m512i *)ptr1), _mm512_loadu_si512((const __m512i *)(ptr1 + 1))));
+    };
+    int ix = 0;
+    for (; ix + 16 <= window_count; ix += 16) {
+        const __m512i zS1  = sum_window(stat0->s1  + ix, stat1->s1  + ix);
+        const __m512i zS2  = sum_window(stat0->s2  + ix, stat1->s2  + ix);
+        const __m512i zSS  = sum_window(stat0->ss  + ix, stat1->ss  + ix);
+        const __m512i zS12 = sum_window(stat0->s12 + ix, stat1->s12 + ix);
+        const __m512i zS1S1 = _mm512_mullo_epi32(zS1, zS1);
+        const __m512i zS2S2 = _mm512_mullo_epi32(zS2, zS2);
+        const __m512i zS1S2 = _mm512_mullo_epi32(zS1, zS2);
+        const __m512i zVars  = _mm512_sub_epi32(_mm512_sub_epi32(_mm512_slli_epi32(zSS, 6), zS1S1), zS2S2);
+        const __m512i zCovar = _mm512_sub_epi32(_mm512_slli_epi32(zS12, 6), zS1S2);
+        const __m512 zNum0 = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_slli_epi32(zS1S2, 1), zC1));
+        const __m512 zNum1 = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_slli_epi32(zCovar, 1), zC2));
+        const __m512 zDen0 = _mm512_cvtepi32_ps(_mm512_add_epi32(_mm512_add_epi32(zS1S1, zS2S2), zC1));
+        const __m512 zDen1 = _mm512_cvtepi32_ps(_mm512_add_epi32(zVars, zC2));
+        const __m512 zSsim = _mm512_div_ps(_mm512_mul_ps(zNum0, zNum1), _mm512_mul_ps(zDen0, zDen1));
+        zAcc0 = _mm512_add_pd(zAcc0, _mm512_cvtps_pd(_mm512_castps512_ps256(zSsim)));
+        zAcc1 = _mm512_add_pd(zAcc1, _mm512_cvtps_pd(_mm256_castpd_ps(_mm512_extractf64x4_pd(_mm512_castps_pd(zSsim), 1))));
+    }
+    zAcc0 = _mm512_add_pd(zAcc0, zAcc1);
+    const __m256d yAcc = _mm256_add_pd(_mm512_castpd512_pd256(zAcc0), _mm512_extractf64x4_pd(zAcc0, 1));
+    __m128d xAcc = _mm_add_pd(_mm256_castpd256_pd128(yAcc), _mm256_extractf128_pd(yAcc, 1));
+    xAcc = _mm_add_sd(xAcc, _mm_unpackhi_pd(xAcc, xAcc));
+    double ssim = _mm_cvtsd_f64(xAcc);
+    if (ix < window_count) {
+        const auto stat0Remain = ssim_stat_offset(stat0, ix);
+        const auto stat1Remain = ssim_stat_offset(stat1, ix);
+        ssim += ssim_end_c(&stat0Remain, &stat1Remain, window_count - ix, bit_depth);
+    }
+    return ssim;
+}
+
+//二乗誤差の和 (madd_epi16の結果は非負なので、符号なしで64bitに拡張して加算する)
+template<typename Type>
+static RGY_FORCEINLINE int64_t ssim_sse_line_avx512(const void *p0, const void *p1, int width) {
+    const __m512i zMaskLo = _mm512_set1_epi64(0xffffffff);
+    __m512i zAcc = _mm512_setzero_si512();
+    int x = 0;
+    for (; x + 64 <= width; x += 64) {
+        __m512i zA0, zA1, zB0, zB1;
+        ssim_load64<Type>(zA0, zA1, (const Type *)p0 + x);
+        ssim_load64<Type>(zB0, zB1, (const Type *)p1 + x);
+        const __m512i zDiff0 = _mm512_sub_epi16(zA0, zB0);
+        const __m512i zDiff1 = _mm512_sub_epi16(zA1, zB1);
+        const __m512i zSse = _mm512_add_epi32(_mm512_madd_epi16(zDiff0, zDiff0), _mm512_madd_epi16(zDiff1, zDiff1));
+        zAcc = _mm512_add_epi64(zAcc, _mm512_and_si512(zSse, zMaskLo));
+        zAcc = _mm512_add_epi64(zAcc, _mm512_srli_epi64(zSse, 32));
+    }
+    const __m256i yAcc = _mm256_add_epi64(_mm512_castsi512_si256(zAcc), _mm512_extracti64x4_epi64(zAcc, 1));
+    alignas(16) int64_t acc[2];
+    _mm_store_si128((__m128i *)acc, _mm_add_epi64(_mm256_castsi256_si128(yAcc), _mm256_extracti128_si256(yAcc, 1)));
+    int64_t sse = acc[0] + acc[1];
+    if (x < width) {
+        sse += ssim_sse_line_c<Type>((const Type *)p0 + x, (const Type *)p1 + x, width - x);
+    }
+    return sse;
+}
+
+int64_t ssim_sse_line_avx512bw_u8(const void *p0, const void *p1, int width) {
+    return ssim_sse_line_avx512<uint8_t>(p0, p1, width);
+}
+
+int64_t ssim_sse_line_avx512bw_u16(const void *p0, const void *p1, int width) {
+    return ssim_sse_line_avx512<uint16_t>(p0, p1, width);
+}
+
+#endif //#if defined(_MSC_VER) || (defined(__AVX512BW__) && defined(__AVX512VL__))
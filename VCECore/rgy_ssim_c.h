@@ -0,0 +1,119 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_SSIM_C_H__
+#define __RGY_SSIM_C_H__
+
+#include <cstdint>
+#include "rgy_ssim.h"
+
+//C版のssim/psnrの計算 (SIMD版の端数処理にも使用する)
+
+//ssimの定数 (vce_filter_ssim.cl の ssim_end1x() と同じ)
+static inline int64_t ssim_c1(int bit_depth) {
+    const int64_t max = (1 << bit_depth) - 1;
+    return (int64_t)(0.01 * 0.01 * max * max * 64.0 + 0.5);
+}
+
+static inline int64_t ssim_c2(int bit_depth) {
+    const int64_t max = (1 << bit_depth) - 1;
+    return (int64_t)(0.03 * 0.03 * max * max * 64.0 * 63.0 + 0.5);
+}
+
+//8x8の窓の統計量からssimを計算する (vce_filter_ssim.cl の ssim_end1x() と同じ演算)
+static RGY_FORCEINLINE float ssim_end1x_c(int64_t s1, int64_t s2, int64_t ss, int64_t s12, int64_t c1, int64_t c2) {
+    const int64_t vars = ss * 64 - s1 * s1 - s2 * s2;
+    const int64_t covar = s12 * 64 - s1 * s2;
+    return ((float)(2 * s1 * s2 + c1) * (float)(2 * covar + c2))
+        / ((float)(s1 * s1 + s2 * s2 + c1) * (float)(vars + c2));
+}
+
+//Tstat: RGYSsimBlockStat (int32) または 64bit整数の統計量
+template<typename Type, typename Tstat>
+static void ssim_block_stat_c(Tstat *stat, const void *p0, int pitch0, const void *p1, int pitch1, int block_count) {
+    for (int ib = 0; ib < block_count; ib++) {
+        decltype(stat->s1[0] + 0) s1 = 0, s2 = 0, ss = 0, s12 = 0;
+        for (int y = 0; y < 4; y++) {
+            const Type *ptr0 = (const Type *)((const uint8_t *)p0 + y * pitch0) + ib * 4;
+            const Type *ptr1 = (const Type *)((const uint8_t *)p1 + y * pitch1) + ib * 4;
+            for (int x = 0; x < 4; x++) {
+                const int a = ptr0[x];
+                const int b = ptr1[x];
+                s1  += a;
+                s2  += b;
+                ss  += (decltype(ss))a * a + (decltype(ss))b * b;
+                s12 += (decltype(s12))a * b;
+            }
+        }
+        stat->s1[ib]  = s1;
+        stat->s2[ib]  = s2;
+        stat->ss[ib]  = ss;
+        stat->s12[ib] = s12;
+    }
+}
+
+template<typename Tstat>
+static double ssim_end_c(const Tstat *stat0, const Tstat *stat1, int window_count, int bit_depth) {
+    const int64_t c1 = ssim_c1(bit_depth);
+    const int64_t c2 = ssim_c2(bit_depth);
+    double ssim = 0.0;
+    for (int ix = 0; ix < window_count; ix++) {
+        //2x2ブロックの統計量の和が8x8の窓の統計量
+        const int64_t s1  = (int64_t)stat0->s1[ix]  + stat0->s1[ix+1]  + stat1->s1[ix]  + stat1->s1[ix+1];
+        const int64_t s2  = (int64_t)stat0->s2[ix]  + stat0->s2[ix+1]  + stat1->s2[ix]  + stat1->s2[ix+1];
+        const int64_t ss  = (int64_t)stat0->ss[ix]  + stat0->ss[ix+1]  + stat1->ss[ix]  + stat1->ss[ix+1];
+        const int64_t s12 = (int64_t)stat0->s12[ix] + stat0->s12[ix+1] + stat1->s12[ix] + stat1->s12[ix+1];
+        ssim += ssim_end1x_c(s1, s2, ss, s12, c1, c2);
+    }
+    return ssim;
+}
+
+template<typename Type>
+static int64_t ssim_sse_line_c(const void *p0, const void *p1, int width) {
+    const Type *ptr0 = (const Type *)p0;
+    const Type *ptr1 = (const Type *)p1;
+    int64_t sse = 0;
+    for (int x = 0; x < width; x++) {
+        const int64_t diff = (int)ptr0[x] - (int)ptr1[x];
+        sse += diff * diff;
+    }
+    return sse;
+}
+
+//SIMD版の端数処理用に、統計量の先頭をoffsetだけずらす
+static RGY_FORCEINLINE RGYSsimBlockStat ssim_stat_offset(const RGYSsimBlockStat *stat, int offset) {
+    RGYSsimBlockStat ret;
+    ret.s1  = stat->s1  + offset;
+    ret.s2  = stat->s2  + offset;
+    ret.ss  = stat->ss  + offset;
+    ret.s12 = stat->s12 + offset;
+    return ret;
+}
+
+#endif //__RGY_SSIM_C_H__
@@ -43,7 +43,15 @@
 #include "gpuz_info.h"
 #include "rgy_status.h"
 
-EncodeStatus::EncodeStatus() {
+EncodeStatus::EncodeStatus() :
+    m_surfPoolHit(0),
+    m_surfPoolMiss(0),
+    m_surfPoolWait(0),
+    m_surfPoolOverCap(0),
+    m_frameEncIn(0),
+    m_frameEncOut(0),
+    m_encLatencyUsSum(0),
+    m_encLatencyUsMax(0) {
     memset(&m_sData, 0, sizeof(m_sData));
 
     m_sStartTime = std::unique_ptr<PROCESS_TIME>(new PROCESS_TIME());
@@ -102,6 +110,24 @@ void EncodeStatus::SetOutputData(RGY_FRAMETYPE picType, uint64_t outputBytes, ui
     m_sData.frameOutPQPSum += (0-((picType & RGY_FRAMETYPE_P)   >> 1)) & frameAvgQP;
     m_sData.frameOutBQPSum += (0-((picType & RGY_FRAMETYPE_B)   >> 2)) & frameAvgQP;
 }
+void EncodeStatus::SetSurfacePoolData(uint64_t hit, uint64_t miss, uint64_t wait, uint64_t overCap) {
+    m_surfPoolHit     = hit;
+    m_surfPoolMiss    = miss;
+    m_surfPoolWait    = wait;
+    m_surfPoolOverCap = overCap;
+}
+void EncodeStatus::SetEncodeInput() {
+    m_frameEncIn++;
+}
+void EncodeStatus::SetEncodeOutput(int64_t latencyUs) {
+    const uint64_t latency = (uint64_t)(std::max<int64_t>)(latencyUs, 0);
+    m_frameEncOut++;
+    m_encLatencyUsSum += latency;
+    uint64_t latencyMax = m_encLatencyUsMax;
+    while (latencyMax < latency && !m_encLatencyUsMax.compare_exchange_weak(latencyMax, latency)) {
+        ;
+    }
+}
 #pragma warning(push)
 #pragma warning(disable: 4100)
 void EncodeStatus::UpdateDisplay(const TCHAR *mes, double progressPercent) {
@@ -400,6 +426,13 @@ void EncodeStatus::WriteResults() {
     WriteFrameTypeResult(_T("frame type I   "), m_sData.frameOutI, maxCount, m_sData.frameOutISize, maxFrameSize, (m_sData.frameOutI && m_sData.frameOutIQPSum) ? m_sData.frameOutIQPSum / (double)m_sData.frameOutI : -1);
     WriteFrameTypeResult(_T("frame type P   "), m_sData.frameOutP, maxCount, m_sData.frameOutPSize, maxFrameSize, (m_sData.frameOutP && m_sData.frameOutPQPSum) ? m_sData.frameOutPQPSum / (double)m_sData.frameOutP : -1);
     WriteFrameTypeResult(_T("frame type B   "), m_sData.frameOutB, maxCount, m_sData.frameOutBSize, maxFrameSize, (m_sData.frameOutB && m_sData.frameOutBQPSum) ? m_sData.frameOutBQPSum / (double)m_sData.frameOutB : -1);
+
+    const auto data = GetEncodeData();
+    if (m_pRGYLog && data.surfPoolHit + data.surfPoolMiss > 0) {
+        m_pRGYLog->write(RGY_LOG_DEBUG, _T("surface pool: hit %llu, miss %llu, wait %llu, over limit %llu.\n"),
+            (unsigned long long)data.surfPoolHit, (unsigned long long)data.surfPoolMiss, (unsigned long long)data.surfPoolWait,
+            (unsigned long long)data.surfPoolOverCap);
+    }
 }
 int64_t EncodeStatus::getStartTimeMicroSec() {
 #if defined(_WIN32) || defined(_WIN64)
@@ -418,7 +451,16 @@ void EncodeStatus::SetPrivData(void *pPrivateData) {
 }
 #pragma warning(pop)
 EncodeStatusData EncodeStatus::GetEncodeData() {
-    return m_sData;
+    auto data = m_sData;
+    data.surfPoolHit     = m_surfPoolHit;
+    data.surfPoolMiss    = m_surfPoolMiss;
+    data.surfPoolWait    = m_surfPoolWait;
+    data.surfPoolOverCap = m_surfPoolOverCap;
+    data.frameEncIn      = m_frameEncIn;
+    data.frameEncOut     = m_frameEncOut;
+    data.encLatencyUsSum = m_encLatencyUsSum;
+    data.encLatencyUsMax = m_encLatencyUsMax;
+    return data;
 }
 
 void EncodeStatus::WriteLine(const TCHAR *mes) {
@@ -38,6 +38,7 @@
 #include <chrono>
 #include <memory>
 #include <vector>
+#include <atomic>
 #include <cmath>
 #include <algorithm>
 #include "rgy_err.h"
@@ -87,6 +88,15 @@ typedef struct EncodeStatusData {
     double VEDLoadPercentTotal;
     double VEClockTotal;
     double GPUClockTotal;
+    //surfPoolXXX/frameEncXXX/encLatencyUsXXXは複数のスレッドから更新されるため、EncodeStatus::GetEncodeData()で取得すること
+    uint64_t surfPoolHit;      //surfaceプールから再利用できた回数
+    uint64_t surfPoolMiss;     //surfaceプールで新たに確保した回数
+    uint64_t surfPoolWait;     //surfaceプールに空きがなく待機した回数
+    uint64_t surfPoolOverCap;  //surfaceプールの上限を超えて確保した回数
+    uint32_t frameEncIn;       //エンコーダに投入したフレーム数
+    uint32_t frameEncOut;      //エンコーダから出力されたフレーム数
+    uint64_t encLatencyUsSum;  //エンコーダ投入から出力までの時間の合計(us)
+    uint64_t encLatencyUsMax;  //エンコーダ投入から出力までの時間の最大(us)
 } EncodeStatusData;
 
 class EncodeStatus {
@@ -99,6 +109,9 @@ public:
 
     void SetStart();
     void SetOutputData(RGY_FRAMETYPE picType, uint64_t outputBytes, uint32_t frameAvgQP);
+    void SetSurfacePoolData(uint64_t hit, uint64_t miss, uint64_t wait, uint64_t overCap);
+    void SetEncodeInput();
+    void SetEncodeOutput(int64_t latencyUs);
     virtual void UpdateDisplay(const TCHAR *mes, double progressPercent = 0.0);
 
     virtual RGY_ERR UpdateDisplayByCurrentDuration(double currentDuration);
@@ -122,6 +135,16 @@ protected:
     std::chrono::system_clock::time_point m_tmLastUpdate;     //最終更新時刻
     bool m_bStdErrWriteToConsole;
     bool m_bEncStarted;
+    //エンコーダの入力/出力スレッドなど複数のスレッドから更新されるカウンタ
+    //m_sDataには直接書き込まず、GetEncodeData()でコピーして返す
+    std::atomic<uint64_t> m_surfPoolHit;
+    std::atomic<uint64_t> m_surfPoolMiss;
+    std::atomic<uint64_t> m_surfPoolWait;
+    std::atomic<uint64_t> m_surfPoolOverCap;
+    std::atomic<uint32_t> m_frameEncIn;
+    std::atomic<uint32_t> m_frameEncOut;
+    std::atomic<uint64_t> m_encLatencyUsSum;
+    std::atomic<uint64_t> m_encLatencyUsMax;
 };
 
 class CProcSpeedControl {
@@ -0,0 +1,173 @@
+﻿// -----------------------------------------------------------------------------------------
+// QSVEnc/NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __RGY_WAITER_H__
+#define __RGY_WAITER_H__
+
+#include <cstdint>
+#include <thread>
+#include <chrono>
+#include <memory>
+#include <algorithm>
+#include <xmmintrin.h>
+#include "rgy_osdep.h"
+#include "rgy_event.h"
+#include "rgy_def.h"
+
+//QueryOutputのように、結果が得られるまでポーリングするしかない処理の待機方法
+enum RGYWaitMode {
+    RGY_WAIT_MODE_SLEEP,    //従来通り、一定時間sleepしてから再度ポーリングする
+    RGY_WAIT_MODE_ADAPTIVE, //spin -> yield -> イベント待機と段階的に切り替え、相手側からの通知で即座に起床する
+};
+
+static const int RGY_WAIT_SLEEP_MS = 1;          //RGY_WAIT_MODE_SLEEPでの1回のsleepの時間
+static const int RGY_WAIT_BLOCK_MAX_MS_DEFAULT = 4; //RGY_WAIT_MODE_ADAPTIVEでのイベント待機の最大時間のデフォルト
+
+const CX_DESC list_wait_mode[] = {
+    { _T("sleep"),    RGY_WAIT_MODE_SLEEP },
+    { _T("adaptive"), RGY_WAIT_MODE_ADAPTIVE },
+    { NULL, 0 }
+};
+
+//ポーリング処理の待機を行うクラス
+//ポーリングする側: 結果が得られなければwait()、得られたらdone()を呼ぶ
+//相手側のスレッド: ポーリング結果に影響する操作(SubmitInputなど)を行ったらnotify()を呼ぶ
+class RGYWaiter {
+public:
+    RGYWaiter() : m_waitCount(0), m_blockCount(0) {};
+    virtual ~RGYWaiter() {};
+    //相手側のスレッドから、状態が変化したことを通知する
+    virtual void notify() = 0;
+    //ポーリングの結果が得られなかったときに呼び、次のポーリングまで待機する
+    virtual void wait() = 0;
+    //ポーリングの結果が得られたときに呼ぶ
+    virtual void done() = 0;
+    //wait()が呼ばれた回数
+    uint64_t waitCount() const { return m_waitCount; }
+    //wait()のうち、実際にスレッドを停止させた回数
+    uint64_t blockCount() const { return m_blockCount; }
+protected:
+    uint64_t m_waitCount;
+    uint64_t m_blockCount;
+};
+
+class RGYWaiterSleep : public RGYWaiter {
+public:
+    RGYWaiterSleep(uint32_t sleepMs) : RGYWaiter(), m_sleepMs(sleepMs) {};
+    virtual ~RGYWaiterSleep() {};
+    virtual void notify() override {};
+    virtual void wait() override {
+        m_waitCount++;
+        m_blockCount++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(m_sleepMs));
+    }
+    virtual void done() override {};
+protected:
+    uint32_t m_sleepMs;
+};
+
+class RGYWaiterAdaptive : public RGYWaiter {
+public:
+    static const int SPIN_PAUSE     = 64;   //spin中の1回のwait()で行う_mm_pauseの回数
+    static const int SPIN_COUNT_MIN = 4;    //spinするwait()の回数の下限
+    static const int SPIN_COUNT_MAX = 1024; //spinするwait()の回数の上限
+    static const int YIELD_COUNT    = 16;   //spinの後、yieldするwait()の回数
+
+    //maxBlockMs: イベント待機の最大時間
+    //  通知が来なくても状態が変化しうる(GPUの処理完了など)ため、一定時間で再度ポーリングする
+    //  イベント待機が続く場合は、1msから倍々にmaxBlockMsまで待機時間を伸ばす
+    RGYWaiterAdaptive(uint32_t maxBlockMs) :
+        RGYWaiter(),
+        m_event(CreateEvent(NULL, FALSE, FALSE, NULL)),
+        m_maxBlockMs((std::max)(maxBlockMs, 1u)),
+        m_blockMs(1),
+        m_spinCount(SPIN_COUNT_MIN),
+        m_count(0),
+        m_blocked(false) {
+    };
+    virtual ~RGYWaiterAdaptive() {
+        if (m_event) {
+            CloseEvent(m_event);
+            m_event = NULL;
+        }
+    };
+    virtual void notify() override {
+        SetEvent(m_event);
+    }
+    virtual void wait() override {
+        m_waitCount++;
+        if (m_count < m_spinCount) {
+            for (int i = 0; i < SPIN_PAUSE; i++) {
+                _mm_pause();
+            }
+        } else if (m_count < m_spinCount + YIELD_COUNT) {
+            std::this_thread::yield();
+        } else {
+            m_blockCount++;
+            m_blocked = true;
+            //通知で起床した場合は待機時間を戻し、タイムアウトした場合は次回の待機時間を伸ばす
+            if (WaitForSingleObject(m_event, m_blockMs) == WAIT_OBJECT_0) {
+                m_blockMs = 1;
+            } else {
+                m_blockMs = (std::min)(m_blockMs * 2, m_maxBlockMs);
+            }
+        }
+        m_count++;
+    }
+    virtual void done() override {
+        //直前の待機で結果が得られるまでの長さに応じて、spinする回数を調整する
+        //spinしているうちに得られたなら次回も得られる可能性が高いので、spinを少し伸ばす
+        //待機まで必要だったなら、spinはCPUを浪費するだけなので短くする
+        if (m_blocked) {
+            m_spinCount = (std::max)(m_spinCount >> 1, (int)SPIN_COUNT_MIN);
+        } else if (m_count > 0 && m_count <= m_spinCount) {
+            m_spinCount = (std::min)(m_spinCount + (m_spinCount >> 2) + 1, (int)SPIN_COUNT_MAX);
+        }
+        m_count = 0;
+        m_blocked = false;
+        m_blockMs = 1;
+    }
+protected:
+    HANDLE m_event;       //相手側からの通知を受けるイベント (自動リセット)
+    uint32_t m_maxBlockMs; //イベント待機の最大時間
+    uint32_t m_blockMs;    //次回のイベント待機の時間
+    int m_spinCount;      //現在のspinする回数
+    int m_count;          //直前のdone()以降にwait()した回数
+    bool m_blocked;       //直前のdone()以降にイベント待機を行ったか
+};
+
+//maxBlockMs: RGY_WAIT_MODE_ADAPTIVEでのイベント待機の最大時間 (RGY_WAIT_MODE_SLEEPでは使用しない)
+static inline std::unique_ptr<RGYWaiter> createWaiter(RGYWaitMode mode, uint32_t maxBlockMs) {
+    switch (mode) {
+    case RGY_WAIT_MODE_ADAPTIVE: return std::unique_ptr<RGYWaiter>(new RGYWaiterAdaptive(maxBlockMs));
+    case RGY_WAIT_MODE_SLEEP:
+    default:                     return std::unique_ptr<RGYWaiter>(new RGYWaiterSleep(RGY_WAIT_SLEEP_MS));
+    }
+}
+
+#endif //__RGY_WAITER_H__
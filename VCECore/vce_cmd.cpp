@@ -221,6 +221,11 @@ tstring encoder_help() {
     str += strsprintf(_T("\n")
         _T("   --ssim                       calc ssim\n")
         _T("   --psnr                       calc psnr\n")
+        _T("   --quality-log <string>       output ssim/psnr of each frame to csv file\n")
+        _T("   --compare <string> <string>  calc ssim/psnr of 2 y4m/raw files on cpu, without encoding.\n")
+        _T("                                 --input-res and --input-csp are required for raw files,\n")
+        _T("                                 --ssim, --psnr, --quality-log can be used (default: ssim and psnr).\n")
+        _T("   --compare-threads <int>      set thread num for --compare (default: auto)\n")
         _T("\n"));
     str += strsprintf(_T("")
         _T("   --vpp-afs [<param1>=<value>][,<param2>=<value>][...]\n")
@@ -254,7 +259,17 @@ tstring encoder_help() {
         _T("      tune=<bool>   (調整モード)       show scan result   (default=%s)\n")
         _T("      rff=<bool>                       rff flag aware     (default=%s)\n")
         _T("      timecode=<bool>                  output timecode    (default=%s)\n")
-        _T("      log=<bool>                       output log         (default=%s)\n"),
+        _T("      log=<bool>                       output log         (default=%s)\n")
+        _T("      backend=<string>                 device to run analyze/synthesize\n")
+        _T("                                         (default=%s)\n")
+        _T("                                         gpu    ... OpenCL\n")
+        _T("                                         cpu    ... CPU (AVX2 if available)\n")
+        _T("                                         verify ... OpenCL, compare with CPU\n")
+        _T("      count_reduce=<string>            where to sum motion/stripe counts\n")
+        _T("                                         (default=%s)\n")
+        _T("                                         device ... OpenCL, transfer only the sums\n")
+        _T("                                         host   ... transfer all counts, sum on CPU\n")
+        _T("                                         verify ... both, compare the results\n"),
         FILTER_DEFAULT_AFS_CLIP_TB, FILTER_DEFAULT_AFS_CLIP_TB,
         FILTER_DEFAULT_AFS_CLIP_LR, FILTER_DEFAULT_AFS_CLIP_LR,
         FILTER_DEFAULT_AFS_METHOD_SWITCH, FILTER_DEFAULT_AFS_COEFF_SHIFT,
@@ -268,7 +283,9 @@ tstring encoder_help() {
         FILTER_DEFAULT_AFS_TUNE    ? _T("on") : _T("off"),
         FILTER_DEFAULT_AFS_RFF     ? _T("on") : _T("off"),
         FILTER_DEFAULT_AFS_TIMECODE ? _T("on") : _T("off"),
-        FILTER_DEFAULT_AFS_LOG      ? _T("on") : _T("off"));
+        FILTER_DEFAULT_AFS_LOG      ? _T("on") : _T("off"),
+        get_chr_from_value(list_vpp_afs_backend, FILTER_DEFAULT_AFS_BACKEND),
+        get_chr_from_value(list_vpp_afs_count_reduce, FILTER_DEFAULT_AFS_COUNT_REDUCE));
     str += strsprintf(_T("\n")
         _T("   --vpp-nnedi [<param1>=<value>][,<param2>=<value>][...]\n")
         _T("     enable nnedi deinterlacer\n")
@@ -298,6 +315,11 @@ tstring encoder_help() {
         _T("      weightfile=<string>   Set path of weight file. By default (not specified),\n")
         _T("                              internal weight params will be used.\n"));
     str += print_list_options(_T("--vpp-resize <string>"), list_vpp_resize, 0);
+    str += strsprintf(_T("\n")
+        _T("   --vpp-resize-fuse <string>\n")
+        _T("     process resize with the following pad and csp conversion in one pass.\n")
+        _T("       off (default), on,\n")
+        _T("       verify ... also run them separately and compare the results.\n"));
     str += strsprintf(_T("\n")
         _T("   --vpp-pad <int>,<int>,<int>,<int>\n")
         _T("     add padding to left,top,right,bottom (in pixels)\n"));
@@ -793,6 +815,11 @@ int parse_one_option(const TCHAR *option_name, const TCHAR* strInput[], int& i,
         pParams->psnr = false;
         return 0;
     }
+    if (IS_OPTION("quality-log")) {
+        i++;
+        pParams->qualityLog = strInput[i];
+        return 0;
+    }
     if (IS_OPTION("no-pe")) {
         pParams->pe = false;
         return 0;
@@ -897,6 +924,16 @@ int parse_one_option(const TCHAR *option_name, const TCHAR* strInput[], int& i,
         pParams->vpp.resize = (RGY_VPP_RESIZE_ALGO)value;
         return 0;
     }
+    if (IS_OPTION("vpp-resize-fuse")) {
+        i++;
+        int value;
+        if (PARSE_ERROR_FLAG == (value = get_value_from_chr(list_vpp_resize_fuse, strInput[i]))) {
+            print_cmd_error_invalid_value(option_name, strInput[i], list_vpp_resize_fuse);
+            return 1;
+        }
+        pParams->vpp.resizeFuse = (RGY_VPP_RESIZE_FUSE)value;
+        return 0;
+    }
     if (IS_OPTION("vpp-afs")) {
         pParams->vpp.afs.enable = true;
 
@@ -922,7 +959,7 @@ int parse_one_option(const TCHAR *option_name, const TCHAR* strInput[], int& i,
         const auto paramList = std::vector<std::string>{
             "top", "bottom", "left", "right",
             "method_switch", "coeff_shift", "thre_shift", "thre_deint", "thre_motion_y", "thre_motion_c",
-            "level", "shift", "drop", "smooth", "24fps", "tune", /*"rff",*/ "timecode", "log", "ini", "preset" };
+            "level", "shift", "drop", "smooth", "24fps", "tune", /*"rff",*/ "timecode", "log", "backend", "count_reduce", "ini", "preset" };
 
         for (const auto &param : param_list) {
             auto pos = param.find_first_of(_T("="));
@@ -1151,6 +1188,26 @@ int parse_one_option(const TCHAR *option_name, const TCHAR* strInput[], int& i,
                     }
                     continue;
                 }
+                if (param_arg == _T("backend")) {
+                    int value = 0;
+                    if (get_list_value(list_vpp_afs_backend, param_val.c_str(), &value)) {
+                        pParams->vpp.afs.backend = (VppAfsBackend)value;
+                    } else {
+                        print_cmd_error_invalid_value(tstring(option_name) + _T(" ") + param_arg + _T("="), param_val, list_vpp_afs_backend);
+                        return 1;
+                    }
+                    continue;
+                }
+                if (param_arg == _T("count_reduce")) {
+                    int value = 0;
+                    if (get_list_value(list_vpp_afs_count_reduce, param_val.c_str(), &value)) {
+                        pParams->vpp.afs.count_reduce = (VppAfsCountReduce)value;
+                    } else {
+                        print_cmd_error_invalid_value(tstring(option_name) + _T(" ") + param_arg + _T("="), param_val, list_vpp_afs_count_reduce);
+                        return 1;
+                    }
+                    continue;
+                }
                 if (param_arg == _T("ini")) {
                     continue;
                 }
@@ -2298,6 +2355,7 @@ tstring gen_cmd(const VCEParam *pParams, bool save_disabled_prm) {
     }
     OPT_BOOL(_T("--ssim"), _T("--no-ssim"), ssim);
     OPT_BOOL(_T("--psnr"), _T("--no-psnr"), psnr);
+    OPT_STR_PATH(_T("--quality-log"), qualityLog);
 
     OPT_BOOL(_T("--pe"), _T("--no-pe"), pe);
     OPT_BOOL(_T("--pa"), _T("--no-pa"), pa.enable);
@@ -2321,6 +2379,7 @@ tstring gen_cmd(const VCEParam *pParams, bool save_disabled_prm) {
     std::basic_stringstream<TCHAR> tmp;
 
     OPT_LST(_T("--vpp-resize"), vpp.resize, list_vpp_resize);
+    OPT_LST(_T("--vpp-resize-fuse"), vpp.resizeFuse, list_vpp_resize_fuse);
 
 #define ADD_FLOAT(str, opt, prec) if ((pParams->opt) != (encPrmDefault.opt)) tmp << _T(",") << (str) << _T("=") << std::setprecision(prec) << (pParams->opt);
 #define ADD_NUM(str, opt) if ((pParams->opt) != (encPrmDefault.opt)) tmp << _T(",") << (str) << _T("=") << (pParams->opt);
@@ -2355,6 +2414,8 @@ tstring gen_cmd(const VCEParam *pParams, bool save_disabled_prm) {
             ADD_BOOL(_T("rff"), vpp.afs.rff);
             ADD_BOOL(_T("timecode"), vpp.afs.timecode);
             ADD_BOOL(_T("log"), vpp.afs.log);
+            ADD_LST(_T("backend"), vpp.afs.backend, list_vpp_afs_backend);
+            ADD_LST(_T("count_reduce"), vpp.afs.count_reduce, list_vpp_afs_count_reduce);
         }
         if (!tmp.str().empty()) {
             cmd << _T(" --vpp-afs ") << tmp.str().substr(1);
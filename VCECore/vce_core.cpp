@@ -77,6 +77,8 @@
 #include "hevc_level.h"
 
 static const amf::AMF_SURFACE_FORMAT formatOut = amf::AMF_SURFACE_NV12;
+//入力/エンコード用surfaceのプールで、1つの形式あたりに保持する最大のsurface数
+static const int VCE_SURFACE_POOL_SIZE = 32;
 
 void VCECore::PrintMes(int log_level, const TCHAR *format, ...) {
     if (m_pLog.get() == nullptr || log_level < m_pLog->getLogLevel()) {
@@ -114,6 +116,9 @@ VCECore::VCECore() :
     m_pPerfMonitor(),
     m_pipelineDepth(2),
     m_nProcSpeedLimit(0),
+    m_vppProfileFile(),
+    m_waitMode(RGY_WAIT_MODE_SLEEP),
+    m_waitBlockMaxMs(RGY_WAIT_BLOCK_MAX_MS_DEFAULT),
     m_nAVSyncMode(RGY_AVSYNC_ASSUME_CFR),
     m_inputFps(),
     m_encFps(),
@@ -124,6 +129,7 @@ VCECore::VCECore() :
     m_picStruct(RGY_PICSTRUCT_UNKNOWN),
     m_encVUI(),
     m_dev(),
+    m_surfPool(),
     m_dll(),
     m_pFactory(nullptr),
     m_pDebug(nullptr),
@@ -138,7 +144,12 @@ VCECore::VCECore() :
     m_pDecoder(),
     m_pEncoder(),
     m_pConverter(),
+    m_waitDecInput(),
+    m_waitDecOutput(),
+    m_waitEncInput(),
+    m_waitEncOutput(),
     m_thDecoder(),
+    m_thDecoderId(),
     m_thOutput(),
     m_params(),
     m_pAbortByUser(nullptr) {
@@ -184,6 +195,7 @@ void VCECore::Terminate() {
 
     m_vpFilters.clear();
     m_pLastFilterParam.reset();
+    m_surfPool.reset();
     m_dev.reset();
 
     m_pFileWriterListAudio.clear();
@@ -299,7 +311,10 @@ RGY_ERR VCECore::initPerfMonitor(VCEParam *prm) {
 #if ENABLE_NVML
     perfMonitorPrm.pciBusId = selectedGpu->pciBusId.c_str();
 #endif
-    if (m_pPerfMonitor->init(perfMonLog.c_str(), _T(""), (bLogOutput) ? prm->ctrl.perfMonitorInterval : 1000,
+    perfMonitorPrm.metricsOutput = prm->ctrl.metricsOutput;
+    perfMonitorPrm.metricsFormat = (RGYMetricsFormat)prm->ctrl.metricsFormat;
+    const bool bMetricsOutput = prm->ctrl.metricsOutput.length() > 0;
+    if (m_pPerfMonitor->init(perfMonLog.c_str(), _T(""), (bLogOutput || bMetricsOutput) ? prm->ctrl.perfMonitorInterval : 1000,
         (int)prm->ctrl.perfMonitorSelect, (int)prm->ctrl.perfMonitorSelectMatplot,
         std::unique_ptr<void, handle_deleter>(OpenThread(SYNCHRONIZE | THREAD_QUERY_INFORMATION, false, GetCurrentThreadId()), handle_deleter()),
         m_pLog, &perfMonitorPrm)) {
@@ -1138,10 +1153,114 @@ RGY_ERR VCECore::initFilters(VCEParam *inputParam) {
         inputFrame = param->frameOut;
         m_encFps = param->baseFps;
     }
+    auto sts = fuseFilters(inputParam->vpp.resizeFuse);
+    if (sts != RGY_ERR_NONE) {
+        return sts;
+    }
     m_picStruct = inputFrame.picstruct;
     return RGY_ERR_NONE;
 }
 
+//リサイズの後のpad/色空間変換をリサイズにまとめ、フレーム全体の読み書きの回数を減らす
+//  resize -> pad -> cspconv(最後のフィルタ) の3回を1回で行う
+//  リサイズの前のcrop/色空間変換は、CPUからの転送やimage(デコーダの出力)からの読み込みとなるため対象外
+RGY_ERR VCECore::fuseFilters(RGY_VPP_RESIZE_FUSE fuseMode) {
+    if (fuseMode == RGY_VPP_RESIZE_FUSE_OFF) {
+        return RGY_ERR_NONE;
+    }
+    for (size_t i = 0; i < m_vpFilters.size(); i++) {
+        if (typeid(*m_vpFilters[i].get()) != typeid(RGYFilterResize)) {
+            continue;
+        }
+        const auto prmResize = dynamic_cast<const RGYFilterParamResize *>(m_vpFilters[i]->GetFilterParam());
+        if (prmResize == nullptr
+            || prmResize->pad.enable
+            || prmResize->frameIn.csp != prmResize->frameOut.csp) {
+            continue; //まとめ済み
+        }
+        size_t fuseEnd = i;
+        const RGYFilterParamPad *prmPad = nullptr;
+        if (fuseEnd+1 < m_vpFilters.size() && typeid(*m_vpFilters[fuseEnd+1].get()) == typeid(RGYFilterPad)) {
+            prmPad = dynamic_cast<const RGYFilterParamPad *>(m_vpFilters[fuseEnd+1]->GetFilterParam());
+            if (prmPad
+                && !RGYFilterResize::fusable(prmPad->frameIn.csp, prmPad->frameOut.csp, prmResize->interp)) {
+                prmPad = nullptr;
+            }
+            if (prmPad) {
+                fuseEnd++;
+            }
+        }
+        const RGYFilterParamCrop *prmNext = nullptr;
+        if (fuseEnd+1 < m_vpFilters.size() && typeid(*m_vpFilters[fuseEnd+1].get()) == typeid(RGYFilterCspCrop)) {
+            prmNext = dynamic_cast<const RGYFilterParamCrop *>(m_vpFilters[fuseEnd+1]->GetFilterParam());
+            if (prmNext
+                && (cropEnabled(prmNext->crop)
+                    || prmNext->frameOut.mem_type == RGY_MEM_TYPE_CPU
+                    || !RGYFilterResize::fusable(prmResize->frameOut.csp, prmNext->frameOut.csp, prmResize->interp))) {
+                prmNext = nullptr;
+            }
+            if (prmNext) {
+                fuseEnd++;
+            }
+        }
+        if (fuseEnd == i) {
+            continue;
+        }
+        shared_ptr<RGYFilterParamResize> param(new RGYFilterParamResize(*prmResize));
+        if (prmPad) {
+            param->pad = prmPad->pad;
+            param->pad.enable = true;
+            param->frameOut = prmPad->frameOut;
+        }
+        if (prmNext) {
+            param->frameOut.csp = prmNext->frameOut.csp;
+            param->frameOut.mem_type = prmNext->frameOut.mem_type;
+        }
+        tstring fusedNames;
+        for (size_t j = i; j <= fuseEnd; j++) {
+            fusedNames += ((fusedNames.length()) ? _T(", ") : _T("")) + m_vpFilters[j]->name();
+        }
+        amf::AMFContext::AMFOpenCLLocker locker(m_dev->context());
+        unique_ptr<RGYFilterResize> filter(new RGYFilterResize(m_dev->cl()));
+        auto sts = filter->init(param, m_pLog);
+        if (sts != RGY_ERR_NONE) {
+            //まとめられなければ、そのまま個別に処理する
+            PrintMes(RGY_LOG_DEBUG, _T("Failed to fuse filters (%s): %s, keep them separated.\n"), fusedNames.c_str(), get_err_mes(sts));
+            continue;
+        }
+        if (fuseMode == RGY_VPP_RESIZE_FUSE_VERIFY) {
+            //個別のフィルタはまとめたフィルタに渡し、毎フレーム結果を比較する
+            std::vector<unique_ptr<RGYFilter>> verifyFilters;
+            for (size_t j = i; j <= fuseEnd; j++) {
+                if (j == fuseEnd && prmNext && prmNext->frameOut.mem_type != RGY_MEM_TYPE_GPU) {
+                    //エンコーダの入力のimageには出力できないので、比較用にバッファに出力するものを作成する
+                    shared_ptr<RGYFilterParamCrop> paramRef(new RGYFilterParamCrop(*prmNext));
+                    paramRef->frameOut.mem_type = RGY_MEM_TYPE_GPU;
+                    unique_ptr<RGYFilter> filterRef(new RGYFilterCspCrop(m_dev->cl()));
+                    sts = filterRef->init(paramRef, m_pLog);
+                    if (sts != RGY_ERR_NONE) {
+                        PrintMes(RGY_LOG_ERROR, _T("Failed to init %s for verification: %s.\n"), filterRef->name().c_str(), get_err_mes(sts));
+                        return sts;
+                    }
+                    verifyFilters.push_back(std::move(filterRef));
+                } else {
+                    verifyFilters.push_back(std::move(m_vpFilters[j]));
+                }
+            }
+            filter->setVerifyFilters(std::move(verifyFilters));
+        }
+        PrintMes((fuseMode == RGY_VPP_RESIZE_FUSE_VERIFY) ? RGY_LOG_INFO : RGY_LOG_DEBUG,
+            _T("Fused filters (%s) into %s%s.\n"), fusedNames.c_str(), filter->name().c_str(),
+            (fuseMode == RGY_VPP_RESIZE_FUSE_VERIFY) ? _T(", verifying results against separate filters") : _T(""));
+        if (fuseEnd == m_vpFilters.size() - 1) {
+            m_pLastFilterParam = std::dynamic_pointer_cast<RGYFilterParam>(param);
+        }
+        m_vpFilters.erase(m_vpFilters.begin() + i, m_vpFilters.begin() + fuseEnd + 1);
+        m_vpFilters.insert(m_vpFilters.begin() + i, std::move(filter));
+    }
+    return RGY_ERR_NONE;
+}
+
 RGY_ERR VCECore::initEncoder(VCEParam *prm) {
     AMF_RESULT res = AMF_OK;
 
@@ -1584,12 +1703,12 @@ RGY_ERR VCECore::initTracer(int log_level) {
     return RGY_ERR_NONE;
 }
 
-std::vector<std::unique_ptr<VCEDevice>> VCECore::createDeviceList(bool interopD3d9, bool interopD3d11) {
+std::vector<std::unique_ptr<VCEDevice>> VCECore::createDeviceList(bool interopD3d9, bool interopD3d11, bool clProfile) {
     std::vector<std::unique_ptr<VCEDevice>> devs;
     const int adapterCount = DeviceDX11::adapterCount();
     for (int i = 0; i < adapterCount; i++) {
         auto dev = std::make_unique<VCEDevice>(m_pLog, m_pFactory, m_pTrace);
-        if (dev->init(i, interopD3d9, interopD3d11) == RGY_ERR_NONE) {
+        if (dev->init(i, interopD3d9, interopD3d11, clProfile) == RGY_ERR_NONE) {
             devs.push_back(std::move(dev));
         }
     }
@@ -1895,6 +2014,7 @@ RGY_ERR VCECore::initSSIMCalc(VCEParam *prm) {
         param->bOutOverwrite = false;
         param->psnr = prm->psnr;
         param->ssim = prm->ssim;
+        param->qualityLog = prm->qualityLog;
         auto sts = filterSsim->init(param, m_pLog);
         if (sts != RGY_ERR_NONE) {
             return sts;
@@ -1923,7 +2043,10 @@ RGY_ERR VCECore::init(VCEParam *prm) {
         return ret;
     }
 
-    auto devList = createDeviceList(prm->interopD3d9, prm->interopD3d11);
+    m_vppProfileFile = prm->ctrl.vppProfileFile;
+    m_waitMode = (RGYWaitMode)prm->ctrl.waitMode;
+    m_waitBlockMaxMs = prm->ctrl.waitBlockMaxMs;
+    auto devList = createDeviceList(prm->interopD3d9, prm->interopD3d11, prm->ctrl.vppProfile);
     if (devList.size() == 0) {
         PrintMes(RGY_LOG_ERROR, _T("Could not find device to run VCE."));
         return ret;
@@ -2005,6 +2128,7 @@ RGY_ERR VCECore::init(VCEParam *prm) {
 
 RGY_ERR VCECore::run_decode() {
     m_thDecoder = std::thread([this]() {
+        m_thDecoderId.set();
         auto pAVCodecReader = std::dynamic_pointer_cast<RGYInputAvcodec>(m_pFileReader);
         if (pAVCodecReader == nullptr) {
             return RGY_ERR_UNKNOWN;
@@ -2050,13 +2174,16 @@ RGY_ERR VCECore::run_decode() {
                         PrintMes(RGY_LOG_ERROR, _T("ERROR: Resolution changed during decoding.\n"));
                         break;
                     } else if (ar == AMF_INPUT_FULL  || ar == AMF_DECODER_NO_FREE_SURFACES) {
-                        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                        m_waitDecInput->wait();
                     } else if (ar == AMF_REPEAT) {
                         pictureBuffer = nullptr;
+                        m_waitDecOutput->notify();
                     } else {
                         break;
                     }
                 } while (m_state == RGY_STATE_RUNNING);
+                m_waitDecInput->done();
+                m_waitDecOutput->notify();
                 if (ar != AMF_OK) {
                     m_state = RGY_STATE_ERROR;
                     return err_to_rgy(ar);
@@ -2064,6 +2191,7 @@ RGY_ERR VCECore::run_decode() {
             }
         }
         m_pDecoder->Drain();
+        m_waitDecOutput->notify();
         return sts;
     });
     PrintMes(RGY_LOG_DEBUG, _T("Started Encode thread.\n"));
@@ -2077,9 +2205,12 @@ RGY_ERR VCECore::run_output() {
             amf::AMFDataPtr data;
             auto ar = m_pEncoder->QueryOutput(&data);
             if (ar == AMF_REPEAT || (ar == AMF_OK && data == nullptr)) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                m_waitEncOutput->wait();
                 continue;
             }
+            m_waitEncOutput->done();
+            m_waitEncInput->notify(); //エンコーダの入力に空きができたことを通知
+            m_surfPool->released();   //エンコーダが入力surfaceを解放した可能性があるので、surfaceプールに通知
             if (ar == AMF_EOF) break;
             if (ar != AMF_OK) {
                 return err_to_rgy(ar);
@@ -2094,8 +2225,13 @@ RGY_ERR VCECore::run_output() {
             if (buffer->GetProperty(RGY_PROP_DURATION, &value) == AMF_OK) {
                 duration = value;
             }
+            if (buffer->GetProperty(RGY_PROP_SUBMIT_TIME, &value) == AMF_OK) {
+                const int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+                m_pStatus->SetEncodeOutput(now - value);
+            }
+            //出力バッファはコピーせずに参照し、可能ならそのままwriterに所有権を渡す
             RGYBitstream output = RGYBitstreamInit();
-            output.ref((uint8_t *)buffer->GetNative(), buffer->GetSize(), pts, 0, duration);
+            output.ref(buffer, pts, 0, duration);
             if (buffer->GetProperty(AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE, &value) == AMF_OK) {
                 switch ((AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_ENUM)value) {
                 case AMF_VIDEO_ENCODER_OUTPUT_DATA_TYPE_P: output.setFrametype(RGY_FRAMETYPE_P); break;
@@ -2114,6 +2250,8 @@ RGY_ERR VCECore::run_output() {
                 m_ssim->addBitstream(&output);
             }
             auto err = m_pFileWriter->WriteNextFrame(&output);
+            //writerが所有権を受け取らなかった場合はここで解放する
+            output.clear();
             if (err != RGY_ERR_NONE) {
                 return err;
             }
@@ -2127,6 +2265,15 @@ RGY_ERR VCECore::run_output() {
 RGY_ERR VCECore::run() {
     m_pStatus->SetStart();
     m_state = RGY_STATE_RUNNING;
+    //AMFのQueryOutput/SubmitInputは完了通知がないのでポーリングするしかないが、
+    //固定時間のsleepではなく、相手側のスレッドからの通知で起床できるようにする
+    m_waitDecInput  = createWaiter(m_waitMode, m_waitBlockMaxMs);
+    m_waitDecOutput = createWaiter(m_waitMode, m_waitBlockMaxMs);
+    m_waitEncInput  = createWaiter(m_waitMode, m_waitBlockMaxMs);
+    m_waitEncOutput = createWaiter(m_waitMode, m_waitBlockMaxMs);
+    PrintMes(RGY_LOG_DEBUG, _T("wait mode: %s, max block %d ms.\n"), get_chr_from_value(list_wait_mode, m_waitMode), m_waitBlockMaxMs);
+    //入力/エンコード用のsurfaceは毎フレーム確保せず、プールから再利用する
+    m_surfPool = std::make_unique<VCESurfacePool>(m_dev->context(), VCE_SURFACE_POOL_SIZE, m_pLog);
     const auto VCE_TIMEBASE = rgy_rational<int>(1, AMF_SECOND);
     const bool vpp_rff = false;
     const bool vpp_afs_rff_aware = false;
@@ -2160,17 +2307,26 @@ RGY_ERR VCECore::run() {
         HANDLE thInput = NULL;
         HANDLE thAudProc = NULL;
         HANDLE thAudEnc = NULL;
+        uint32_t tidOutput = 0;
+        uint32_t tidInput = 0;
+        uint32_t tidAudProc = 0;
+        uint32_t tidAudEnc = 0;
         auto pAVCodecReader = std::dynamic_pointer_cast<RGYInputAvcodec>(m_pFileReader);
         if (pAVCodecReader != nullptr) {
             thInput = pAVCodecReader->getThreadHandleInput();
+            tidInput = pAVCodecReader->getThreadIdInput();
         }
         auto pAVCodecWriter = std::dynamic_pointer_cast<RGYOutputAvcodec>(m_pFileWriter);
         if (pAVCodecWriter != nullptr) {
             thOutput = pAVCodecWriter->getThreadHandleOutput();
             thAudProc = pAVCodecWriter->getThreadHandleAudProcess();
             thAudEnc = pAVCodecWriter->getThreadHandleAudEncode();
+            tidOutput = pAVCodecWriter->getThreadIdOutput();
+            tidAudProc = pAVCodecWriter->getThreadIdAudProcess();
+            tidAudEnc = pAVCodecWriter->getThreadIdAudEncode();
         }
         m_pPerfMonitor->SetThreadHandles((HANDLE)(m_thDecoder.native_handle()), thInput, thOutput, thAudProc, thAudEnc);
+        m_pPerfMonitor->SetThreadIds((m_thDecoder.joinable()) ? m_thDecoderId.wait() : 0, tidInput, tidOutput, tidAudProc, tidAudEnc);
     }
 
     auto run_send_streams = [this, &pWriterForAudioStreams](int inputFrames) {
@@ -2288,6 +2444,13 @@ RGY_ERR VCECore::run() {
         return std::move(outFrames);
     };
 
+    //--vpp-profile指定時は、フィルタごとに実行時間を集計する
+    auto clProfiler = m_dev->cl()->profiler();
+    auto setProfileStage = [clProfiler](const tstring& stage) {
+        if (clProfiler) {
+            clProfiler->setStage(stage);
+        }
+    };
     auto filter_frame = [&](int &nFilterFrame, unique_ptr<RGYFrame> &inframe, deque<unique_ptr<RGYFrame>> &dqEncFrames, bool &bDrain) {
 
         deque<std::pair<FrameInfo, uint32_t>> filterframes;
@@ -2343,6 +2506,7 @@ RGY_ERR VCECore::run() {
                 amf::AMFContext::AMFOpenCLLocker locker(m_dev->context());
                 int nOutFrames = 0;
                 FrameInfo *outInfo[16] = { 0 };
+                setProfileStage(m_vpFilters[ifilter]->name());
                 auto sts_filter = m_vpFilters[ifilter]->filter(&filterframes.front().first, (FrameInfo **)&outInfo, &nOutFrames);
                 if (sts_filter != RGY_ERR_NONE) {
                     PrintMes(RGY_LOG_ERROR, _T("Error while running filter \"%s\".\n"), m_vpFilters[ifilter]->name().c_str());
@@ -2375,28 +2539,30 @@ RGY_ERR VCECore::run() {
                 auto &lastFilter = m_vpFilters[m_vpFilters.size()-1];
                 amf::AMFSurfacePtr pSurface;
                 if (m_dev->dx11interlop()) {
-                    auto ar = m_dev->context()->AllocSurface(amf::AMF_MEMORY_DX11, csp_rgy_to_enc(lastFilter->GetFilterParam()->frameOut.csp),
-                        m_encWidth, m_encHeight, &pSurface);
-                    if (ar != AMF_OK) {
-                        PrintMes(RGY_LOG_ERROR, _T("Failed to allocate surface: %s.\n"), get_err_mes(err_to_rgy(ar)));
-                        return err_to_rgy(ar);
+                    auto err = m_surfPool->get(pSurface, amf::AMF_MEMORY_DX11, csp_rgy_to_enc(lastFilter->GetFilterParam()->frameOut.csp),
+                        m_encWidth, m_encHeight);
+                    if (err != RGY_ERR_NONE) {
+                        PrintMes(RGY_LOG_ERROR, _T("Failed to allocate surface: %s.\n"), get_err_mes(err));
+                        return err;
                     }
-                    ar = pSurface->Interop(amf::AMF_MEMORY_OPENCL);
+                    auto ar = pSurface->Interop(amf::AMF_MEMORY_OPENCL);
                     if (ar != AMF_OK) {
                         PrintMes(RGY_LOG_ERROR, _T("Failed to get interop of surface: %s.\n"), get_err_mes(err_to_rgy(ar)));
                         return err_to_rgy(ar);
                     }
                 } else {
-                    auto ar = m_dev->context()->AllocSurface(amf::AMF_MEMORY_OPENCL, csp_rgy_to_enc(lastFilter->GetFilterParam()->frameOut.csp),
-                        m_encWidth, m_encHeight, &pSurface);
-                    if (ar != AMF_OK) {
-                        PrintMes(RGY_LOG_ERROR, _T("Failed to allocate surface: %s.\n"), get_err_mes(err_to_rgy(ar)));
-                        return err_to_rgy(ar);
+                    auto err = m_surfPool->get(pSurface, amf::AMF_MEMORY_OPENCL, csp_rgy_to_enc(lastFilter->GetFilterParam()->frameOut.csp),
+                        m_encWidth, m_encHeight);
+                    if (err != RGY_ERR_NONE) {
+                        PrintMes(RGY_LOG_ERROR, _T("Failed to allocate surface: %s.\n"), get_err_mes(err));
+                        return err;
                     }
                 }
+                m_pStatus->SetSurfacePoolData(m_surfPool->hit(), m_surfPool->miss(), m_surfPool->wait(), m_surfPool->overCap());
                 auto encSurface = std::make_unique<RGYFrame>(pSurface);
-                //最後のフィルタはRGYFilterCspCropでなければならない
-                if (typeid(*lastFilter.get()) != typeid(RGYFilterCspCrop)) {
+                //最後のフィルタはRGYFilterCspCrop(またはそれをまとめたRGYFilterResize)でなければならない
+                if (typeid(*lastFilter.get()) != typeid(RGYFilterCspCrop)
+                    && typeid(*lastFilter.get()) != typeid(RGYFilterResize)) {
                     PrintMes(RGY_LOG_ERROR, _T("Last filter setting invalid.\n"));
                     return RGY_ERR_INVALID_PARAM;
                 }
@@ -2405,6 +2571,7 @@ RGY_ERR VCECore::run() {
                 auto encSurfaceInfo = encSurface->getInfo();
                 FrameInfo *outInfo[1];
                 outInfo[0] = &encSurfaceInfo;
+                setProfileStage(lastFilter->name());
                 auto sts_filter = lastFilter->filter(&filterframes.front().first, (FrameInfo **)&outInfo, &nOutFrames);
                 filterframes.pop_front();
                 if (sts_filter != RGY_ERR_NONE) {
@@ -2413,13 +2580,24 @@ RGY_ERR VCECore::run() {
                 }
                 if (m_ssim) {
                     int dummy = 0;
+                    setProfileStage(m_ssim->name());
                     m_ssim->filter(&encSurfaceInfo, nullptr, &dummy);
                 }
-                auto err = m_dev->cl()->queue().finish();
+                setProfileStage(_T("(other)"));
+                //ここではキューの完了を待たず、エンコーダに渡す直前にこのフレームのイベントを待機する
+                //その間に次のフレームのフィルタ処理を投入できるようにする
+                RGYOpenCLEvent filterFin;
+                auto err = m_dev->cl()->queue().marker(&filterFin);
+                if (err == RGY_ERR_NONE) {
+                    err = m_dev->cl()->queue().flush();
+                }
                 if (err != RGY_ERR_NONE) {
-                    PrintMes(RGY_LOG_ERROR, _T("Failed to finish queue after \"%s\".\n"), lastFilter->name().c_str());
-                    return sts_filter;
+                    PrintMes(RGY_LOG_ERROR, _T("Failed to flush queue after \"%s\".\n"), lastFilter->name().c_str());
+                    //書き込み中のままencSurfaceをプールに戻さないよう、キューの完了を待ってから解放する
+                    m_dev->cl()->queue().finish();
+                    return err;
                 }
+                encSurface->setCLEvent(filterFin);
                 encSurface->setDuration(encSurfaceInfo.duration);
                 encSurface->setTimestamp(encSurfaceInfo.timestamp);
                 encSurface->setPicstruct(encSurfaceInfo.picstruct);
@@ -2432,6 +2610,8 @@ RGY_ERR VCECore::run() {
     };
 
     auto send_encoder = [this](unique_ptr<RGYFrame>& encFrame) {
+        //フィルタ処理の完了を待ってからエンコーダに渡す
+        encFrame->waitCLEvent();
         int64_t pts = encFrame->timestamp();
         int64_t duration = encFrame->duration();
         amf::AMFSurfacePtr pSurface = encFrame->detachSurface();
@@ -2447,6 +2627,8 @@ RGY_ERR VCECore::run() {
 
         pSurface->SetProperty(RGY_PROP_TIMESTAMP, pts);
         pSurface->SetProperty(RGY_PROP_DURATION, duration);
+        //入力のpropertyは出力のbufferに引き継がれるので、出力時との差をエンコード遅延とする
+        pSurface->SetProperty(RGY_PROP_SUBMIT_TIME, (int64_t)std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
 
         auto ar = AMF_OK;
         do {
@@ -2459,9 +2641,10 @@ RGY_ERR VCECore::run() {
             if (ar == AMF_NEED_MORE_INPUT) {
                 break;
             } else if (ar == AMF_INPUT_FULL) {
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                m_waitEncInput->wait();
             } else if (ar == AMF_REPEAT) {
                 pSurface = nullptr;
+                m_waitEncOutput->notify();
             } else if (m_thOutput.wait_for(std::chrono::microseconds(0)) != std::future_status::timeout) {
                 PrintMes(RGY_LOG_ERROR, _T("Error during output.\n"));
                 m_state = RGY_STATE_ERROR;
@@ -2470,6 +2653,11 @@ RGY_ERR VCECore::run() {
                 break;
             }
         } while (m_state == RGY_STATE_RUNNING);
+        m_waitEncInput->done();
+        m_waitEncOutput->notify(); //出力スレッドを起床させる
+        if (ar == AMF_OK || ar == AMF_NEED_MORE_INPUT) {
+            m_pStatus->SetEncodeInput();
+        }
         return err_to_rgy(ar);
     };
 
@@ -2480,6 +2668,20 @@ RGY_ERR VCECore::run() {
     int nInputFrame = 0;
     deque<unique_ptr<RGYFrame>> dqInFrames;
     deque<unique_ptr<RGYFrame>> dqEncFrames;
+    //フィルタ処理は非同期で行うので、入力フレームはGPUでの読み込みが完了するまで保持しておく
+    //(解放するとホストメモリのフレームはプールに、デコーダのフレームはデコーダに戻され、読み込み中に上書きされうる)
+    deque<std::pair<RGYOpenCLEvent, unique_ptr<RGYFrame>>> dqInFramesInFlight;
+    auto releaseInFrames = [&dqInFramesInFlight](size_t maxFrames) {
+        while (dqInFramesInFlight.size() > 0) {
+            auto &inFlight = dqInFramesInFlight.front();
+            if (dqInFramesInFlight.size() > maxFrames) {
+                inFlight.first.wait();
+            } else if (!inFlight.first.completed()) {
+                break;
+            }
+            dqInFramesInFlight.pop_front();
+        }
+    };
     for (int nFilterFrame = 0; m_state == RGY_STATE_RUNNING && !bInputEmpty && !bFilterEmpty; ) {
         if (m_pAbortByUser && *m_pAbortByUser) {
             m_state = RGY_STATE_ABORT;
@@ -2493,14 +2695,14 @@ RGY_ERR VCECore::run() {
         unique_ptr<RGYFrame> inputFrame;
         if (m_pDecoder == nullptr) {
             amf::AMFSurfacePtr pSurface;
-            auto ar = m_dev->context()->AllocSurface(amf::AMF_MEMORY_HOST, csp_rgy_to_enc(inputFrameInfo.csp),
+            res = m_surfPool->get(pSurface, amf::AMF_MEMORY_HOST, csp_rgy_to_enc(inputFrameInfo.csp),
                 inputFrameInfo.srcWidth - inputFrameInfo.crop.e.left - inputFrameInfo.crop.e.right,
-                inputFrameInfo.srcHeight - inputFrameInfo.crop.e.bottom - inputFrameInfo.crop.e.up,
-                &pSurface);
-            if (ar != AMF_OK) {
-                res = err_to_rgy(ar); m_state = RGY_STATE_ERROR;
+                inputFrameInfo.srcHeight - inputFrameInfo.crop.e.bottom - inputFrameInfo.crop.e.up);
+            if (res != RGY_ERR_NONE) {
+                m_state = RGY_STATE_ERROR;
                 break;
             }
+            m_pStatus->SetSurfacePoolData(m_surfPool->hit(), m_surfPool->miss(), m_surfPool->wait(), m_surfPool->overCap());
             pSurface->SetFrameType(frametype_rgy_to_enc(inputFrameInfo.picstruct));
             inputFrame = std::make_unique<RGYFrame>(pSurface);
             res = m_pFileReader->LoadNextFrame(inputFrame.get());
@@ -2539,6 +2741,8 @@ RGY_ERR VCECore::run() {
                 }
                 if (ar == AMF_OK && data != nullptr) {
                     surf = amf::AMFSurfacePtr(data);
+                    m_waitDecOutput->done();
+                    m_waitDecInput->notify(); //デコーダの出力を取り出したので、デコードスレッドを起床させる
                     break;
                 }
                 if (ar != AMF_OK) break;
@@ -2548,7 +2752,7 @@ RGY_ERR VCECore::run() {
                     ar = AMF_FAIL;
                     break;
                 }
-                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                m_waitDecOutput->wait();
                 if (m_thOutput.wait_for(std::chrono::microseconds(0)) != std::future_status::timeout) {
                     PrintMes(RGY_LOG_ERROR, _T("Error during output.\n"));
                     m_state = RGY_STATE_ERROR;
@@ -2611,29 +2815,58 @@ RGY_ERR VCECore::run() {
             if (!bDrain) {
                 dqInFrames.pop_front();
             }
+            if (inframe) {
+                //フィルタに渡したフレーム (エンコーダに直接渡した場合は除く) は、処理の完了まで保持する
+                amf::AMFContext::AMFOpenCLLocker locker(m_dev->context());
+                RGYOpenCLEvent inFin;
+                if ((err = m_dev->cl()->queue().marker(&inFin)) != RGY_ERR_NONE
+                    || (err = m_dev->cl()->queue().flush()) != RGY_ERR_NONE) {
+                    res = err;
+                    m_state = RGY_STATE_ERROR;
+                    PrintMes(RGY_LOG_ERROR, _T("Failed to flush queue.\n"));
+                    //GPUでの読み込み中にinframeを解放しないよう、キューの完了を待つ
+                    m_dev->cl()->queue().finish();
+                    break;
+                }
+                dqInFramesInFlight.push_back(std::make_pair(inFin, std::move(inframe)));
+            }
+            releaseInFrames(m_pipelineDepth + 1);
+            //フィルタの再初期化などで返却されたまま使われていないバッファを解放する
+            m_dev->cl()->trimFramePool();
             while (dqEncFrames.size() >= m_pipelineDepth) {
                 auto &encframe = dqEncFrames.front();
-                if ((err = send_encoder(encframe)) != RGY_ERR_NONE) {
+                err = send_encoder(encframe);
+                //エンコーダに渡せなかった場合も、フレームはここで解放してプールに戻す
+                dqEncFrames.pop_front();
+                if (err != RGY_ERR_NONE) {
                     res = err;
                     m_state = RGY_STATE_ERROR;
                     PrintMes(RGY_LOG_ERROR, _T("Failed to send frame to encoder.\n"));
                     break;
                 }
-                dqEncFrames.pop_front();
+            }
+            if (m_state != RGY_STATE_RUNNING) {
+                break;
             }
         }
     }
     while (dqEncFrames.size() > 0) {
         auto &encframe = dqEncFrames.front();
+        if (m_state == RGY_STATE_ERROR) {
+            //エラー終了時はエンコーダに渡さず、フィルタ処理の完了を待って解放する
+            encframe->waitCLEvent();
+            dqEncFrames.pop_front();
+            continue;
+        }
         RGY_ERR err = send_encoder(encframe);
+        dqEncFrames.pop_front();
         if (err != RGY_ERR_NONE) {
             res = err;
             m_state = RGY_STATE_ERROR;
             PrintMes(RGY_LOG_ERROR, _T("Failed to send frame to encoder.\n"));
-            break;
         }
-        dqEncFrames.pop_front();
     }
+    releaseInFrames(0);
     if (m_thDecoder.joinable()) {
         DWORD exitCode = 0;
         while (GetExitCodeThread(m_thDecoder.native_handle(), &exitCode) == STILL_ACTIVE) {
@@ -2643,12 +2876,14 @@ RGY_ERR VCECore::run() {
             std::this_thread::sleep_for(std::chrono::milliseconds(5));
         }
         m_thDecoder.join();
+        m_thDecoderId.reset();
     }
     auto ar = AMF_INPUT_FULL;
     while (ar == AMF_INPUT_FULL) {
         std::this_thread::sleep_for(std::chrono::milliseconds(10));
         ar = m_pEncoder->Drain();
     }
+    m_waitEncOutput->notify();
     if (ar != AMF_OK) {
         PrintMes(RGY_LOG_ERROR, _T("Failed to drain encoder: %s\n"), get_err_mes(err_to_rgy(ar)));
         return err_to_rgy(ar);
@@ -2659,6 +2894,13 @@ RGY_ERR VCECore::run() {
         m_thOutput.get();
         PrintMes(RGY_LOG_DEBUG, _T("Closed output thread.\n"));
     }
+    auto printWaitStats = [this](const TCHAR *name, const unique_ptr<RGYWaiter>& waiter) {
+        PrintMes(RGY_LOG_DEBUG, _T("%s: wait %llu, block %llu.\n"), name, (unsigned long long)waiter->waitCount(), (unsigned long long)waiter->blockCount());
+    };
+    printWaitStats(_T("Decoder input "), m_waitDecInput);
+    printWaitStats(_T("Decoder output"), m_waitDecOutput);
+    printWaitStats(_T("Encoder input "), m_waitEncInput);
+    printWaitStats(_T("Encoder output"), m_waitEncOutput);
     if (m_ssim) {
         PrintMes(RGY_LOG_DEBUG, _T("Flushing ssim/psnr calc.\n"));
         m_ssim->addBitstream(nullptr);
@@ -2676,6 +2918,13 @@ RGY_ERR VCECore::run() {
     if (m_ssim) {
         m_ssim->showResult();
     }
+    if (clProfiler) {
+        clProfiler->collect(true);
+        clProfiler->print(RGY_LOG_INFO);
+        if (m_vppProfileFile.length() > 0) {
+            clProfiler->writeJson(m_vppProfileFile);
+        }
+    }
     return RGY_ERR_NONE;
 }
 
@@ -41,9 +41,12 @@
 #include "rgy_log.h"
 #include "rgy_input.h"
 #include "rgy_output.h"
+#include "rgy_perf_monitor.h"
 #include "rgy_opencl.h"
 #include "rgy_device.h"
+#include "rgy_waiter.h"
 #include "vce_device.h"
+#include "vce_surface_pool.h"
 #include "vce_param.h"
 #include "vce_filter.h"
 #include "vce_filter_ssim.h"
@@ -52,6 +55,7 @@
 
 #define RGY_PROP_TIMESTAMP L"RGYPropTimestamp"
 #define RGY_PROP_DURATION  L"RGYPropDuration"
+#define RGY_PROP_SUBMIT_TIME L"RGYPropSubmitTime" //エンコーダに投入した時刻(us)、エンコード遅延の計測用
 
 const TCHAR *AMFRetString(AMF_RESULT ret);
 
@@ -112,7 +116,7 @@ public:
     virtual RGY_ERR run();
     void Terminate();
 
-    virtual std::vector<std::unique_ptr<VCEDevice>> createDeviceList(bool interopD3d9, bool interopD3d11);
+    virtual std::vector<std::unique_ptr<VCEDevice>> createDeviceList(bool interopD3d9, bool interopD3d11, bool clProfile = false);
 
     void PrintMes(int log_level, const TCHAR *format, ...);
 
@@ -133,6 +137,7 @@ protected:
     virtual RGY_ERR initPerfMonitor(VCEParam *prm);
     virtual RGY_ERR initDecoder(VCEParam *prm);
     virtual RGY_ERR initFilters(VCEParam *prm);
+    virtual RGY_ERR fuseFilters(RGY_VPP_RESIZE_FUSE fuseMode);
     virtual RGY_ERR initConverter(VCEParam *prm);
     virtual RGY_ERR InitChapters(VCEParam *prm);
     virtual RGY_ERR initEncoder(VCEParam *prm);
@@ -162,6 +167,9 @@ protected:
 
     int                m_pipelineDepth;
     int                m_nProcSpeedLimit;       //処理速度制限 (0で制限なし)
+    tstring            m_vppProfileFile;        //フィルタの実行時間の計測結果の出力先
+    RGYWaitMode        m_waitMode;              //エンコーダ/デコーダの完了待ちの方法
+    int                m_waitBlockMaxMs;        //m_waitMode = adaptiveでのイベント待機の最大時間
     RGYAVSync          m_nAVSyncMode;           //映像音声同期設定
     rgy_rational<int>  m_inputFps;              //入力フレームレート
     rgy_rational<int>  m_encFps;             //出力フレームレート
@@ -173,6 +181,7 @@ protected:
     VideoVUIInfo       m_encVUI;
 
     std::unique_ptr<VCEDevice> m_dev;
+    unique_ptr<VCESurfacePool> m_surfPool;
     unique_ptr<std::remove_pointer_t<HMODULE>, module_deleter> m_dll;
     amf::AMFFactory *m_pFactory;
     amf::AMFDebug *m_pDebug;
@@ -191,7 +200,12 @@ protected:
     amf::AMFComponentPtr m_pDecoder;
     amf::AMFComponentPtr m_pEncoder;
     amf::AMFComponentPtr m_pConverter;
+    unique_ptr<RGYWaiter> m_waitDecInput;  //デコーダの入力に空きができるのを待機 (メインスレッドから通知)
+    unique_ptr<RGYWaiter> m_waitDecOutput; //デコーダの出力を待機 (デコードスレッドから通知)
+    unique_ptr<RGYWaiter> m_waitEncInput;  //エンコーダの入力に空きができるのを待機 (出力スレッドから通知)
+    unique_ptr<RGYWaiter> m_waitEncOutput; //エンコーダの出力を待機 (メインスレッドから通知)
     std::thread m_thDecoder;
+    RGYPerfThreadId m_thDecoderId; //デコードスレッドのID (スレッド自身が記録する)
     std::future<RGY_ERR> m_thOutput;
 
     AMFParams m_params;
@@ -68,7 +68,7 @@ RGY_ERR VCEDevice::CreateContext() {
     return RGY_ERR_NONE;
 }
 
-RGY_ERR VCEDevice::init(const int deviceId, const bool interopD3d9, const bool interopD3d11) {
+RGY_ERR VCEDevice::init(const int deviceId, const bool interopD3d9, const bool interopD3d11, const bool clProfile) {
     m_devName = strsprintf(_T("device #%d"), deviceId);
     m_id = deviceId;
     {
@@ -138,10 +138,22 @@ RGY_ERR VCEDevice::init(const int deviceId, const bool interopD3d9, const bool i
         (interopD3d11) ? m_dx11.GetDevice() : nullptr);
 
     m_cl = std::make_shared<RGYOpenCLContext>(platform, m_log);
+    if (clProfile) {
+        m_cl->enableProfiling();
+    }
     if (m_cl->createContext() != CL_SUCCESS) {
         PrintMes(RGY_LOG_ERROR, _T("Failed to create OpenCL context.\n"));
         return RGY_ERR_UNKNOWN;
     }
+    {
+        //ビルドしたOpenCLのプログラムのバイナリをキャッシュし、次回以降の起動時のビルドを省略する
+        const TCHAR *localAppData = _tgetenv(_T("LOCALAPPDATA"));
+        const tstring cacheDir = (localAppData && _tcslen(localAppData) > 0)
+            ? tstring(localAppData) + _T("\\VCEEnc\\clcache")
+            : getExeDir() + _T("\\clcache");
+        m_cl->setProgramCacheDir(cacheDir);
+        PrintMes(RGY_LOG_DEBUG, _T("OpenCL program cache: %s\n"), cacheDir.c_str());
+    }
     auto amferr = m_context->InitOpenCL(m_cl->queue().get());
     if (amferr != AMF_OK) {
         PrintMes(RGY_LOG_ERROR, _T("Failed to init AMF context by OpenCL.\n"));
@@ -43,14 +43,14 @@ const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_NONE | CLK_F
 
 #define LOAD_IMG(src, ix, iy) (TypeIn)(read_imageui((src), sampler, (int2)((ix), (iy))).x)
 #define LOAD_IMG_NV12_UV(src, src_u, src_v, ix, iy, cropX, cropY) { \
-    uint4 ret = read_imageui((src), sampler, (int2)((ix) + ((cropX)>>1), (iy) + ((cropY)>>1))); \
+    uint4 ret = read_imageui((src), sampler, (int2)((ix) + (cropX), (iy) + (cropY))); \
     (src_u) = (TypeIn)ret.x; \
     (src_v) = (TypeIn)ret.y; \
 }
 #define LOAD_BUF(src, ix, iy) *(__global TypeIn *)(&(src)[(iy) * srcPitch + (ix) * sizeof(TypeIn)])
 #define LOAD_BUF_NV12_UV(src, src_u, src_v, ix, iy, cropX, cropY) { \
-    (src_u) = LOAD((src), ((ix)<<1) + 0 + (cropX), (iy) + ((cropY)>>1)); \
-    (src_v) = LOAD((src), ((ix)<<1) + 1 + (cropX), (iy) + ((cropY)>>1)); \
+    (src_u) = LOAD((src), (((ix) + (cropX))<<1) + 0, (iy) + (cropY)); \
+    (src_v) = LOAD((src), (((ix) + (cropX))<<1) + 1, (iy) + (cropY)); \
 }
 #if IMAGE_SRC
 #define LOAD         LOAD_IMG
@@ -196,8 +196,8 @@ __kernel void kernel_crop_yv12_nv12(
     const int uv_y = get_global_id(1);
 
     if (uv_x < uvWidth && uv_y < uvHeight) {
-        TypeIn pixSrcU = LOAD(srcU, uv_x + (cropX>>1), uv_y + (cropY>>1));
-        TypeIn pixSrcV = LOAD(srcV, uv_x + (cropX>>1), uv_y + (cropY>>1));
+        TypeIn pixSrcU = LOAD(srcU, uv_x + cropX, uv_y + cropY);
+        TypeIn pixSrcV = LOAD(srcV, uv_x + cropX, uv_y + cropY);
         TypeOut pixDstU = BIT_DEPTH_CONV(pixSrcU);
         TypeOut pixDstV = BIT_DEPTH_CONV(pixSrcV);
         STORE_NV12_UV(dst, uv_x, uv_y, pixDstU, pixDstV);
@@ -174,7 +174,8 @@ protected:
 class RGYFilterParamResize : public RGYFilterParam {
 public:
     RGY_VPP_RESIZE_ALGO interp;
-    RGYFilterParamResize() : interp(RGY_VPP_RESIZE_AUTO) {};
+    VppPad pad; //padとまとめて処理する場合のpad
+    RGYFilterParamResize() : interp(RGY_VPP_RESIZE_AUTO), pad() {};
     virtual ~RGYFilterParamResize() {};
 };
 
@@ -183,17 +184,29 @@ public:
     RGYFilterResize(shared_ptr<RGYOpenCLContext> context);
     virtual ~RGYFilterResize();
     virtual RGY_ERR init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYLog> pPrintMes) override;
+    //cspIn -> cspOut の色空間変換をリサイズとまとめて処理できるか
+    static bool fusable(RGY_CSP cspIn, RGY_CSP cspOut, RGY_VPP_RESIZE_ALGO interp);
+    //まとめる前の個別のフィルタを設定すると、毎フレーム結果を比較する
+    void setVerifyFilters(std::vector<unique_ptr<RGYFilter>> &&filters);
 protected:
     virtual RGY_ERR run_filter(const FrameInfo *pInputFrame, FrameInfo **ppOutputFrames, int *pOutputFrameNum, RGYOpenCLQueue &queue, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event) override;
     virtual void close() override;
 
+    static bool fused(const RGYFilterParamResize *prm);
     virtual RGY_ERR resizePlane(FrameInfo *pOutputPlane, const FrameInfo *pInputPlane, RGYOpenCLQueue &queue, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event);
     virtual RGY_ERR resizeFrame(FrameInfo *pOutputFrame, const FrameInfo *pInputFrame, RGYOpenCLQueue &queue, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event);
+    virtual RGY_ERR resizeFrameFused(FrameInfo *pOutputFrame, const FrameInfo *pInputFrame, RGYOpenCLQueue &queue, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event);
+    virtual RGY_ERR verifyFrame(const FrameInfo *pOutputFrame, const FrameInfo *pInputFrame, RGYOpenCLQueue &queue);
 
     bool m_bInterlacedWarn;
     unique_ptr<RGYCLBuf> m_weightSpline;
     unique_ptr<RGYOpenCLProgram> m_resize;
     unique_ptr<RGYCLFrame> m_srcImage;
+    std::vector<unique_ptr<RGYFilter>> m_verifyFilters; //比較用の個別のフィルタ
+    std::vector<uint8_t> m_verifyBuf[2]; //比較用にCPUに転送したフレーム
+    int m_verifyFrames;
+    int m_verifyMismatchFrames;
+    int m_verifyMaxDiff;
 };
 
 class RGYFilterParamPad : public RGYFilterParam {
@@ -28,16 +28,12 @@
 
 #include <map>
 #include <array>
-#include <emmintrin.h>
 #include "convert_csp.h"
 #include "vce_filter_afs.h"
 #include "afs_stg.h"
 #include "vce_util.h"
 #pragma warning (push)
 
-static void afs_get_motion_count_simd(int *motion_count, const uint8_t *ptr, const AFS_SCAN_CLIP *clip, int pitch, int scan_w, int scan_h, int tb_order);
-static void afs_get_stripe_count_simd(int *stripe_count, const uint8_t *ptr, const AFS_SCAN_CLIP *clip, int pitch, int scan_w, int scan_h, int tb_order);
-
 template<typename T>
 T max3(T a, T b, T c) {
     return std::max(std::max(a, b), c);
@@ -49,6 +45,68 @@ T absdiff(T a, T b) {
     return (a >= b) ? a_b : b_a;
 }
 
+RGY_ERR afsCPUMap::map(afsCPUPlane *plane, RGYCLFrame *frame, RGY_PLANE iplane, cl_map_flags map_flags, const std::vector<RGYOpenCLEvent> &wait_events) {
+    const auto planeInfo = getPlane(&frame->frame, iplane);
+    auto bufmap = std::make_unique<RGYCLBufMap>((cl_mem)planeInfo.ptr[0]);
+    auto err = bufmap->map(map_flags, planeInfo.pitch[0] * planeInfo.height, m_queue, wait_events);
+    if (err != RGY_ERR_NONE) {
+        return err;
+    }
+    bufmap->event().wait();
+    plane->ptr    = (uint8_t *)bufmap->ptr();
+    plane->pitch  = planeInfo.pitch[0];
+    plane->width  = planeInfo.width;
+    plane->height = planeInfo.height;
+    m_maps.push_back(std::move(bufmap));
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR afsCPUMap::map(afsCPUFrame *frame, afsSourceCacheFrame *src, const std::vector<RGYOpenCLEvent> &wait_events) {
+    memset(frame, 0, sizeof(frame[0]));
+    auto err = map(&frame->y, src->y.get(), RGY_PLANE_Y, CL_MAP_READ, wait_events);
+    if (err != RGY_ERR_NONE) {
+        return err;
+    }
+    if (RGY_CSP_CHROMA_FORMAT[src->y->frame.csp] == RGY_CHROMAFMT_YUV444) {
+        if (   RGY_ERR_NONE != (err = map(&frame->u[0], src->y.get(), RGY_PLANE_U, CL_MAP_READ))
+            || RGY_ERR_NONE != (err = map(&frame->v[0], src->y.get(), RGY_PLANE_V, CL_MAP_READ))) {
+            return err;
+        }
+    } else {
+        //YUV420では、フィールド分離した色差をそれぞれマップする
+        for (int i = 0; i < 2; i++) {
+            if (   RGY_ERR_NONE != (err = map(&frame->u[i], src->cb[i].get(), RGY_PLANE_Y, CL_MAP_READ))
+                || RGY_ERR_NONE != (err = map(&frame->v[i], src->cr[i].get(), RGY_PLANE_Y, CL_MAP_READ))) {
+                return err;
+            }
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR afsCPUMap::map(afsCPUFrame *frame, RGYCLFrame *dst, cl_map_flags map_flags) {
+    memset(frame, 0, sizeof(frame[0]));
+    auto err = RGY_ERR_NONE;
+    if (   RGY_ERR_NONE != (err = map(&frame->y,    dst, RGY_PLANE_Y, map_flags))
+        || RGY_ERR_NONE != (err = map(&frame->u[0], dst, RGY_PLANE_U, map_flags))
+        || RGY_ERR_NONE != (err = map(&frame->v[0], dst, RGY_PLANE_V, map_flags))) {
+        return err;
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR afsCPUMap::unmap() {
+    auto ret = RGY_ERR_NONE;
+    for (auto& bufmap : m_maps) {
+        auto err = bufmap->unmap(m_queue);
+        if (err != RGY_ERR_NONE) {
+            ret = err;
+        }
+    }
+    m_maps.clear();
+    return ret;
+}
+
 afsSourceCache::afsSourceCache(shared_ptr<RGYOpenCLContext> cl) :
     m_cl(cl),
     m_sourceArray(),
@@ -290,6 +348,8 @@ void afsStripeCache::clear() {
     for (int i = 0; i < (int)m_stripeArray.size(); i++) {
         m_stripeArray[i].map.reset();
         m_stripeArray[i].buf_count_stripe.reset();
+        m_stripeArray[i].buf_count_stripe_sum.reset();
+        m_stripeArray[i].buf_count_stripe_partial.reset();
         m_stripeArray[i].event.reset();
         clearcache(i);
     }
@@ -506,10 +566,18 @@ RGYFilterAfs::RGYFilterAfs(shared_ptr<RGYOpenCLContext> context) :
     m_status(),
     m_streamsts(),
     m_count_motion(),
+    m_count_motion_sum(),
+    m_count_motion_partial(),
+    m_countReduceVerified(0),
+    m_countReduceMismatch(0),
+    m_backendVerified(0),
+    m_backendMismatch(0),
     m_fpTimecode(),
     m_mergeScan(),
     m_analyze(),
-    m_synthesize() {
+    m_synthesize(),
+    m_cpuFunc(nullptr),
+    m_cpuFuncRef(nullptr) {
     m_name = _T("afs");
 }
 
@@ -650,6 +718,19 @@ RGY_ERR RGYFilterAfs::init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYLog>
         return err;
     }
 
+    m_cpuFunc = nullptr;
+    m_cpuFuncRef = nullptr;
+    if (pAfsParam->afs.backend != VPP_AFS_BACKEND_GPU) {
+        m_cpuFunc = get_afs_cpu_func(true);
+        //verifyでは、SIMD版を使用する場合はC版の結果とも比較する
+        if (pAfsParam->afs.backend == VPP_AFS_BACKEND_VERIFY && m_cpuFunc != get_afs_cpu_func(false)) {
+            m_cpuFuncRef = get_afs_cpu_func(false);
+        }
+        AddMessage(RGY_LOG_DEBUG, _T("afs backend %s: using %s cpu functions%s.\n"),
+            get_chr_from_value(list_vpp_afs_backend, pAfsParam->afs.backend), (m_cpuFunc == get_afs_cpu_func(false)) ? _T("c") : _T("avx2"),
+            (m_cpuFuncRef) ? _T(", verified against c") : _T(""));
+    }
+
     m_queueAnalyze = m_cl->createQueue(m_cl->queue().devid());
     if (!m_queueAnalyze.get()) {
         AddMessage(RGY_LOG_ERROR, _T("failed to createQueue.\n"));
@@ -723,76 +804,126 @@ RGY_ERR RGYFilterAfs::scan_frame(int iframe, int force, const RGYFilterParamAfs
     sp->thre_shift = pAfsPrm->afs.thre_shift, sp->thre_deint = pAfsPrm->afs.thre_deint;
     sp->thre_Ymotion = pAfsPrm->afs.thre_Ymotion, sp->thre_Cmotion = pAfsPrm->afs.thre_Cmotion;
     sp->clip.top = sp->clip.bottom = sp->clip.left = sp->clip.right = -1;
+    if (pAfsPrm->afs.backend == VPP_AFS_BACKEND_CPU) {
+        auto err = analyze_stripe_cpu(p0, p1, sp, pAfsPrm, queue, wait_event, false);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("failed analyze_stripe_cpu: %s.\n"), get_err_mes(err));
+        }
+        return err;
+    }
     auto err = analyze_stripe(p0, p1, sp, m_count_motion, pAfsPrm, queue, wait_event, m_eventScanFrame);
     if (err != RGY_ERR_NONE) {
         AddMessage(RGY_LOG_ERROR, _T("failed analyze_stripe: %s.\n"), get_err_mes(err));
         return err;
     }
+    if (pAfsPrm->afs.count_reduce != VPP_AFS_COUNT_REDUCE_HOST) {
+        err = count_reduce(m_count_motion_sum, m_count_motion_partial, m_count_motion, queue, m_eventScanFrame);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("failed count_reduce(motion): %s.\n"), get_err_mes(err));
+            return err;
+        }
+    }
     if (STREAM_OPT) {
-        err = m_count_motion->queueMapBuffer(m_queueCopy(), CL_MAP_READ, { m_eventScanFrame });
+        auto& count_buf = (pAfsPrm->afs.count_reduce != VPP_AFS_COUNT_REDUCE_HOST) ? m_count_motion_sum : m_count_motion;
+        err = count_buf->queueMapBuffer(m_queueCopy(), CL_MAP_READ, { m_eventScanFrame });
         if (err != RGY_ERR_NONE) {
             AddMessage(RGY_LOG_ERROR, _T("failed m_count_motion.queueMapBuffer: %s.\n"), get_err_mes(err));
             return err;
         }
-        sp->event = m_count_motion->mapEvent();
+        sp->event = count_buf->mapEvent();
         sp = m_scan.get(iframe-1);
     }
 
-    err = count_motion(sp, &pAfsPrm->afs.clip, queue);
+    err = count_motion(sp, &pAfsPrm->afs.clip, pAfsPrm->afs.count_reduce, queue);
     if (err != RGY_ERR_NONE) {
         AddMessage(RGY_LOG_ERROR, _T("failed analyze_stripe: %s.\n"), get_err_mes(err));
         return err;
     }
+    if (!STREAM_OPT && pAfsPrm->afs.backend == VPP_AFS_BACKEND_VERIFY) {
+        err = analyze_stripe_cpu(p0, p1, sp, pAfsPrm, queue, {}, true);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("failed analyze_stripe_cpu: %s.\n"), get_err_mes(err));
+            return err;
+        }
+    }
     return err;
 }
 
-RGY_ERR RGYFilterAfs::count_motion(AFS_SCAN_DATA *sp, const AFS_SCAN_CLIP *clip, cl_command_queue queue) {
+//マップ済みのカウントのバッファから、2つのフィールドのカウントを取得する
+static void get_count(int &count0, int &count1, const RGYCLBuf *count_buf, bool reduced) {
+    if (reduced) {
+        //GPUで総和をとったもの
+        const int *ptrCount = (const int *)count_buf->mappedPtr();
+        count0 = ptrCount[0];
+        count1 = ptrCount[1];
+        return;
+    }
+    //ブロックごとのカウント
+    // 32               16              0
+    //  |  count_latter ||  count_first |
+    const int nSize = (int)(count_buf->size() / sizeof(uint32_t));
+    const uint32_t *ptrCount = (const uint32_t *)count_buf->mappedPtr();
+    count0 = 0;
+    count1 = 0;
+    for (int i = 0; i < nSize; i++) {
+        uint32_t count = ptrCount[i];
+        count0 += count & 0xffff;
+        count1 += count >> 16;
+    }
+}
+
+//GPUで総和をとった結果(count0, count1)を、ブロックごとのカウントからCPUで総和をとった結果と比較する
+RGY_ERR RGYFilterAfs::count_reduce_verify(const unique_ptr<RGYCLBuf> &count_block, int count0, int count1, cl_command_queue queue, const TCHAR *name, int iframe) {
+    static const int VERIFY_MAX_WARN = 8;
+    auto err = count_block->queueMapBuffer(queue, CL_MAP_READ, {});
+    if (err != RGY_ERR_NONE) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to map count buffer(%s) for verification: %s.\n"), name, get_err_mes(err));
+        return err;
+    }
+    count_block->mapEvent().wait();
+    int host0 = 0;
+    int host1 = 0;
+    get_count(host0, host1, count_block.get(), false);
+    count_block->unmapBuffer();
+    m_countReduceVerified++;
+    if (host0 != count0 || host1 != count1) {
+        m_countReduceMismatch++;
+        if (m_countReduceMismatch <= VERIFY_MAX_WARN) {
+            AddMessage(RGY_LOG_WARN, _T("verify count_reduce(%s)[%6d]: device (%6d, %6d) / host (%6d, %6d).\n"),
+                name, iframe, count0, count1, host0, host1);
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+RGY_ERR RGYFilterAfs::count_motion(AFS_SCAN_DATA *sp, const AFS_SCAN_CLIP *clip, VppAfsCountReduce count_reduce, cl_command_queue queue) {
     sp->clip = *clip;
 
     auto err = RGY_ERR_NONE;
+    const bool reduced = count_reduce != VPP_AFS_COUNT_REDUCE_HOST;
+    auto& count_buf = (reduced) ? m_count_motion_sum : m_count_motion;
     if (STREAM_OPT) {
         sp->event.wait();
     } else {
-        err = m_count_motion->queueMapBuffer(queue, CL_MAP_READ, {});
+        err = count_buf->queueMapBuffer(queue, CL_MAP_READ, {});
         if (err != RGY_ERR_NONE) {
             AddMessage(RGY_LOG_ERROR, _T("failed m_count_motion.queueMapBuffer: %s.\n"), get_err_mes(err));
             return err;
         }
-        m_count_motion->mapEvent().wait();
+        count_buf->mapEvent().wait();
     }
 
-    const int nSize = (int)(m_count_motion->size() / sizeof(uint32_t));
     int count0 = 0;
     int count1 = 0;
-    const uint32_t *ptrCount = (uint32_t *)m_count_motion->mappedPtr();
-    for (int i = 0; i < nSize; i++) {
-        uint32_t count = ptrCount[i];
-        count0 += count & 0xffff;
-        count1 += count >> 16;
-    }
+    get_count(count0, count1, count_buf.get(), reduced);
     sp->ff_motion = count0;
     sp->lf_motion = count1;
-    m_count_motion->unmapBuffer();
-    //AddMessage(RGY_LOG_INFO, _T("count_motion[%6d]: %6d - %6d (ff,lf)"), sp->frame, sp->ff_motion, sp->lf_motion);
-#if 0
-    uint8_t *ptr = nullptr;
-    if (RGY_ERR_NONE != (err = cudaMallocHost(&ptr, sp->map.frame.pitch * sp->map.frame.height))) {
-        AddMessage(RGY_LOG_ERROR, _T("failed cudaMallocHost: %s.\n"), get_err_mes(err));
-        return err;
+    count_buf->unmapBuffer();
+    //STREAM_OPTの場合は、m_count_motionは次のフレームの結果で上書きされている
+    if (!STREAM_OPT && count_reduce == VPP_AFS_COUNT_REDUCE_VERIFY) {
+        err = count_reduce_verify(m_count_motion, count0, count1, queue, _T("motion"), sp->frame);
     }
-    if (RGY_ERR_NONE != (err = cudaMemcpy2D(ptr, sp->map.frame.pitch, sp->map.frame.ptr, sp->map.frame.pitch, sp->map.frame.width, sp->map.frame.height, cudaMemcpyDeviceToHost))) {
-        AddMessage(RGY_LOG_ERROR, _T("failed cudaMemcpy2D: %s.\n"), get_err_mes(err));
-        return err;
-    }
-
-    int motion_count[2] = { 0, 0 };
-    afs_get_motion_count_simd(motion_count, ptr, &sp->clip, sp->map.frame.pitch, sp->map.frame.width, sp->map.frame.height, sp->tb_order);
-    AddMessage((count0 == motion_count[0] && count1 == motion_count[1]) ? RGY_LOG_INFO : RGY_LOG_ERROR, _T("count_motion(ret, debug) = (%6d, %6d) / (%6d, %6d)\n"), count0, motion_count[0], count1, motion_count[1]);
-    if (RGY_ERR_NONE != (err = cudaFreeHost(ptr))) {
-        AddMessage(RGY_LOG_ERROR, _T("failed cudaFreeHost: %s.\n"), get_err_mes(err));
-        return err;
-    }
-#endif
+    //AddMessage(RGY_LOG_INFO, _T("count_motion[%6d]: %6d - %6d (ff,lf)"), sp->frame, sp->ff_motion, sp->lf_motion);
     return err;
 }
 
@@ -800,7 +931,7 @@ RGY_ERR RGYFilterAfs::get_stripe_info(cl_command_queue queue, int iframe, int mo
     AFS_STRIPE_DATA *sp = m_stripe.get(iframe);
     if (sp->status > mode && sp->status < 4 && sp->frame == iframe) {
         if (sp->status == 2) {
-            auto err = count_stripe(queue, sp, &pAfsPrm->afs.clip, pAfsPrm->afs.tb_order);
+            auto err = count_stripe(queue, sp, &pAfsPrm->afs.clip, pAfsPrm->afs.tb_order, pAfsPrm->afs.count_reduce);
             if (err != RGY_ERR_NONE) {
                 AddMessage(RGY_LOG_ERROR, _T("failed count_stripe: %s.\n"), get_err_mes(err));
                 return err;
@@ -812,79 +943,189 @@ RGY_ERR RGYFilterAfs::get_stripe_info(cl_command_queue queue, int iframe, int mo
 
     AFS_SCAN_DATA *sp0 = m_scan.get(iframe);
     AFS_SCAN_DATA *sp1 = m_scan.get(iframe + 1);
+    if (pAfsPrm->afs.backend == VPP_AFS_BACKEND_CPU) {
+        auto err = merge_scan_cpu(sp, sp0, sp1, pAfsPrm, queue, false);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("failed merge_scan_cpu: %s.\n"), get_err_mes(err));
+            return err;
+        }
+        sp->status = 3;
+        sp->frame = iframe;
+        return err;
+    }
     auto err = merge_scan(sp, sp0, sp1, sp->buf_count_stripe, pAfsPrm, (STREAM_OPT) ? m_queueAnalyze() : queue, {}, m_eventMergeScan);
     if (err != RGY_ERR_NONE) {
         AddMessage(RGY_LOG_ERROR, _T("failed merge_scan: %s.\n"), get_err_mes(err));
         return err;
     }
+    if (pAfsPrm->afs.count_reduce != VPP_AFS_COUNT_REDUCE_HOST) {
+        err = count_reduce(sp->buf_count_stripe_sum, sp->buf_count_stripe_partial, sp->buf_count_stripe, (STREAM_OPT) ? m_queueAnalyze() : queue, m_eventMergeScan);
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("failed count_reduce(stripe): %s.\n"), get_err_mes(err));
+            return err;
+        }
+    }
     sp->status = 2;
     sp->frame = iframe;
 
     if (STREAM_OPT) {
-        err = sp->buf_count_stripe->queueMapBuffer(m_queueCopy(), CL_MAP_READ, { m_eventMergeScan });
+        auto& count_buf = (pAfsPrm->afs.count_reduce != VPP_AFS_COUNT_REDUCE_HOST) ? sp->buf_count_stripe_sum : sp->buf_count_stripe;
+        err = count_buf->queueMapBuffer(m_queueCopy(), CL_MAP_READ, { m_eventMergeScan });
         if (err != RGY_ERR_NONE) {
             AddMessage(RGY_LOG_ERROR, _T("failed m_count_motion.copyDtoHAsync: %s.\n"), get_err_mes(err));
             return err;
         }
-        sp->event = sp->buf_count_stripe->mapEvent();
+        sp->event = count_buf->mapEvent();
     } else {
-        if (RGY_ERR_NONE != (err = count_stripe(queue, sp, &pAfsPrm->afs.clip, pAfsPrm->afs.tb_order))) {
+        if (RGY_ERR_NONE != (err = count_stripe(queue, sp, &pAfsPrm->afs.clip, pAfsPrm->afs.tb_order, pAfsPrm->afs.count_reduce))) {
             AddMessage(RGY_LOG_ERROR, _T("failed count_stripe: %s.\n"), get_err_mes(err));
             return err;
         }
         sp->status = 3;
+        if (pAfsPrm->afs.backend == VPP_AFS_BACKEND_VERIFY) {
+            if (RGY_ERR_NONE != (err = merge_scan_cpu(sp, sp0, sp1, pAfsPrm, queue, true))) {
+                AddMessage(RGY_LOG_ERROR, _T("failed merge_scan_cpu: %s.\n"), get_err_mes(err));
+                return err;
+            }
+        }
     }
     return err;
 }
 
-RGY_ERR RGYFilterAfs::count_stripe(cl_command_queue queue, AFS_STRIPE_DATA *sp, const AFS_SCAN_CLIP *clip, int tb_order) {
+afsCPUParam RGYFilterAfs::cpu_param(const VppAfs *pAfsPrm) const {
+    afsCPUParam prm;
+    prm.tb_order    = pAfsPrm->tb_order;
+    prm.clip_top    = pAfsPrm->clip.top;
+    prm.clip_bottom = pAfsPrm->clip.bottom;
+    prm.clip_left   = pAfsPrm->clip.left;
+    prm.clip_right  = pAfsPrm->clip.right;
+    prm.thre = afs_analyze_thre(pAfsPrm->thre_shift, pAfsPrm->thre_deint, pAfsPrm->thre_Ymotion, pAfsPrm->thre_Cmotion, RGY_CSP_BIT_DEPTH[m_source.csp()]);
+    return prm;
+}
+
+RGY_ERR RGYFilterAfs::analyze_stripe_cpu(afsSourceCacheFrame *p0, afsSourceCacheFrame *p1, AFS_SCAN_DATA *sp, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, const std::vector<RGYOpenCLEvent> &wait_event, bool verify) {
+    afsCPUMap mapped(queue);
+    afsCPUFrame src0, src1;
+    afsCPUPlane dst;
     auto err = RGY_ERR_NONE;
+    if (   RGY_ERR_NONE != (err = mapped.map(&src0, p0, wait_event))
+        || RGY_ERR_NONE != (err = mapped.map(&src1, p1, {}))
+        || RGY_ERR_NONE != (err = mapped.map(&dst, sp->map.get(), RGY_PLANE_Y, (verify) ? CL_MAP_READ : CL_MAP_WRITE))) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to map buffer for analyze_stripe_cpu: %s.\n"), get_err_mes(err));
+        return err;
+    }
+    const auto prm = cpu_param(&pAfsPrm->afs);
+    int motion_count[2] = { 0, 0 };
+    if (verify) {
+        //OpenCL版の結果(sp->map, sp->ff_motion, sp->lf_motion)と比較する
+        std::vector<uint8_t> buf(dst.pitch * dst.height);
+        afsCPUPlane ref = dst;
+        ref.ptr = buf.data();
+        afs_cpu_analyze(m_cpuFunc, &ref, motion_count, &src0, &src1, m_source.csp(), &prm);
+        const int diff = afs_cpu_compare_plane(&dst, &ref, 1, 0);
+        bool match = diff == 0 && motion_count[0] == sp->ff_motion && motion_count[1] == sp->lf_motion;
+        AddMessage((match) ? RGY_LOG_DEBUG : RGY_LOG_WARN, _T("verify analyze[%6d]: diff %d pixels, motion (%6d, %6d) / cpu (%6d, %6d).\n"),
+            sp->frame, diff, sp->ff_motion, sp->lf_motion, motion_count[0], motion_count[1]);
+        if (m_cpuFuncRef) {
+            //SIMD版の結果をC版の結果と比較する
+            std::vector<uint8_t> bufC(dst.pitch * dst.height);
+            afsCPUPlane refC = dst;
+            refC.ptr = bufC.data();
+            int motion_count_c[2] = { 0, 0 };
+            afs_cpu_analyze(m_cpuFuncRef, &refC, motion_count_c, &src0, &src1, m_source.csp(), &prm);
+            const int diffC = afs_cpu_compare_plane(&ref, &refC, 1, 0);
+            const bool matchC = diffC == 0 && motion_count[0] == motion_count_c[0] && motion_count[1] == motion_count_c[1];
+            AddMessage((matchC) ? RGY_LOG_DEBUG : RGY_LOG_WARN, _T("verify analyze[%6d]: avx2/c diff %d pixels, motion (%6d, %6d) / c (%6d, %6d).\n"),
+                sp->frame, diffC, motion_count[0], motion_count[1], motion_count_c[0], motion_count_c[1]);
+            match &= matchC;
+        }
+        m_backendVerified++;
+        if (!match) {
+            m_backendMismatch++;
+        }
+    } else {
+        afs_cpu_analyze(m_cpuFunc, &dst, motion_count, &src0, &src1, m_source.csp(), &prm);
+        sp->clip = pAfsPrm->afs.clip;
+        sp->ff_motion = motion_count[0];
+        sp->lf_motion = motion_count[1];
+    }
+    return mapped.unmap();
+}
+
+RGY_ERR RGYFilterAfs::merge_scan_cpu(AFS_STRIPE_DATA *sp, AFS_SCAN_DATA *sp0, AFS_SCAN_DATA *sp1, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, bool verify) {
+    afsCPUMap mapped(queue);
+    afsCPUPlane src0, src1, dst;
+    auto err = RGY_ERR_NONE;
+    if (   RGY_ERR_NONE != (err = mapped.map(&src0, sp0->map.get(), RGY_PLANE_Y, CL_MAP_READ))
+        || RGY_ERR_NONE != (err = mapped.map(&src1, sp1->map.get(), RGY_PLANE_Y, CL_MAP_READ))
+        || RGY_ERR_NONE != (err = mapped.map(&dst, sp->map.get(), RGY_PLANE_Y, (verify) ? CL_MAP_READ : CL_MAP_WRITE))) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to map buffer for merge_scan_cpu: %s.\n"), get_err_mes(err));
+        return err;
+    }
+    const auto prm = cpu_param(&pAfsPrm->afs);
+    int stripe_count[2] = { 0, 0 };
+    if (verify) {
+        //OpenCL版の結果(sp->map, sp->count0, sp->count1)と比較する
+        std::vector<uint8_t> buf(dst.pitch * dst.height);
+        afsCPUPlane ref = dst;
+        ref.ptr = buf.data();
+        afs_cpu_merge_scan(m_cpuFunc, &ref, stripe_count, &src0, &src1, &prm);
+        const int diff = afs_cpu_compare_plane(&dst, &ref, 1, 0);
+        bool match = diff == 0 && stripe_count[0] == sp->count0 && stripe_count[1] == sp->count1;
+        AddMessage((match) ? RGY_LOG_DEBUG : RGY_LOG_WARN, _T("verify merge_scan[%6d]: diff %d pixels, stripe (%6d, %6d) / cpu (%6d, %6d).\n"),
+            sp->frame, diff, sp->count0, sp->count1, stripe_count[0], stripe_count[1]);
+        if (m_cpuFuncRef) {
+            //SIMD版の結果をC版の結果と比較する
+            std::vector<uint8_t> bufC(dst.pitch * dst.height);
+            afsCPUPlane refC = dst;
+            refC.ptr = bufC.data();
+            int stripe_count_c[2] = { 0, 0 };
+            afs_cpu_merge_scan(m_cpuFuncRef, &refC, stripe_count_c, &src0, &src1, &prm);
+            const int diffC = afs_cpu_compare_plane(&ref, &refC, 1, 0);
+            const bool matchC = diffC == 0 && stripe_count[0] == stripe_count_c[0] && stripe_count[1] == stripe_count_c[1];
+            AddMessage((matchC) ? RGY_LOG_DEBUG : RGY_LOG_WARN, _T("verify merge_scan[%6d]: avx2/c diff %d pixels, stripe (%6d, %6d) / c (%6d, %6d).\n"),
+                sp->frame, diffC, stripe_count[0], stripe_count[1], stripe_count_c[0], stripe_count_c[1]);
+            match &= matchC;
+        }
+        m_backendVerified++;
+        if (!match) {
+            m_backendMismatch++;
+        }
+    } else {
+        afs_cpu_merge_scan(m_cpuFunc, &dst, stripe_count, &src0, &src1, &prm);
+        sp->count0 = stripe_count[0];
+        sp->count1 = stripe_count[1];
+    }
+    return mapped.unmap();
+}
+
+RGY_ERR RGYFilterAfs::count_stripe(cl_command_queue queue, AFS_STRIPE_DATA *sp, const AFS_SCAN_CLIP *clip, int tb_order, VppAfsCountReduce count_reduce) {
+    auto err = RGY_ERR_NONE;
+    const bool reduced = count_reduce != VPP_AFS_COUNT_REDUCE_HOST;
+    auto& count_buf = (reduced) ? sp->buf_count_stripe_sum : sp->buf_count_stripe;
     if (STREAM_OPT) {
         sp->event.wait();
     } else {
-        err = sp->buf_count_stripe->queueMapBuffer(queue, CL_MAP_READ, {});
+        err = count_buf->queueMapBuffer(queue, CL_MAP_READ, {});
         if (err != RGY_ERR_NONE) {
             AddMessage(RGY_LOG_ERROR, _T("failed m_count_stripe.queueMapBuffer: %s.\n"), get_err_mes(err));
             return err;
         }
-        sp->buf_count_stripe->mapEvent().wait();
+        count_buf->mapEvent().wait();
     }
 
-    const int nSize = (int)(sp->buf_count_stripe->size() / sizeof(uint32_t));
     int count0 = 0;
     int count1 = 0;
-    const uint32_t *ptrCount = (uint32_t *)sp->buf_count_stripe->mappedPtr();
-    for (int i = 0; i < nSize; i++) {
-        uint32_t count = ptrCount[i];
-        count0 += count & 0xffff;
-        count1 += count >> 16;
-    }
+    get_count(count0, count1, count_buf.get(), reduced);
     sp->count0 = count0;
     sp->count1 = count1;
-    sp->buf_count_stripe->unmapBuffer();
-    //AddMessage(RGY_LOG_INFO, _T("count_stripe[%6d]: %6d - %6d"), sp->frame, count0, count1);
-#if 0
-    uint8_t *ptr = nullptr;
-    if (RGY_ERR_NONE != (err = cudaMallocHost(&ptr, sp->map.frame.pitch * sp->map.frame.height))) {
-        AddMessage(RGY_LOG_ERROR, _T("failed cudaMallocHost: %s.\n"), get_err_mes(err));
-        return err;
-    }
-    if (RGY_ERR_NONE != (err = cudaMemcpy2D(ptr, sp->map.frame.pitch, sp->map.frame.ptr, sp->map.frame.pitch, sp->map.frame.width, sp->map.frame.height, cudaMemcpyDeviceToHost))) {
-        AddMessage(RGY_LOG_ERROR, _T("failed cudaMemcpy2D: %s.\n"), get_err_mes(err));
-        return err;
-    }
-
-    int stripe_count[2] = { 0, 0 };
-    afs_get_stripe_count_simd(stripe_count, ptr, clip, sp->map.frame.pitch, sp->map.frame.width, sp->map.frame.height, tb_order);
-    AddMessage((count0 == stripe_count[0] && count1 == stripe_count[1]) ? RGY_LOG_INFO : RGY_LOG_ERROR, _T("count_stripe(ret, debug) = (%6d, %6d) / (%6d, %6d)\n"), count0, stripe_count[0], count1, stripe_count[1]);
-    if (RGY_ERR_NONE != (err = cudaFreeHost(ptr))) {
-        AddMessage(RGY_LOG_ERROR, _T("failed cudaFreeHost: %s.\n"), get_err_mes(err));
-        return err;
+    count_buf->unmapBuffer();
+    if (count_reduce == VPP_AFS_COUNT_REDUCE_VERIFY) {
+        err = count_reduce_verify(sp->buf_count_stripe, count0, count1, queue, _T("stripe"), sp->frame);
     }
-#else
+    //AddMessage(RGY_LOG_INFO, _T("count_stripe[%6d]: %6d - %6d"), sp->frame, count0, count1);
     UNREFERENCED_PARAMETER(tb_order);
     UNREFERENCED_PARAMETER(clip);
-#endif
     return err;
 }
 
@@ -1159,85 +1400,23 @@ void RGYFilterAfs::close() {
     m_scan.clear();
     m_stripe.clear();
     m_status.clear();
+    if (m_countReduceVerified > 0) {
+        AddMessage((m_countReduceMismatch > 0) ? RGY_LOG_WARN : RGY_LOG_INFO,
+            _T("verified count_reduce %d times: %d mismatches between device and host.\n"),
+            m_countReduceVerified, m_countReduceMismatch);
+    }
+    m_countReduceVerified = 0;
+    m_countReduceMismatch = 0;
+    if (m_backendVerified > 0) {
+        AddMessage((m_backendMismatch > 0) ? RGY_LOG_WARN : RGY_LOG_INFO,
+            _T("verified backend %d times: %d mismatches between device and host%s.\n"),
+            m_backendVerified, m_backendMismatch, (m_cpuFuncRef) ? _T(" (avx2 and c)") : _T(""));
+    }
+    m_backendVerified = 0;
+    m_backendMismatch = 0;
     m_count_motion.reset();
+    m_count_motion_sum.reset();
+    m_count_motion_partial.reset();
     m_fpTimecode.reset();
     AddMessage(RGY_LOG_DEBUG, _T("closed afs filter.\n"));
 }
-
-static inline BOOL is_latter_field(int pos_y, int tb_order) {
-    return ((pos_y & 1) == tb_order);
-}
-
-static void afs_get_stripe_count_simd(int *stripe_count, const uint8_t *ptr, const AFS_SCAN_CLIP *clip, int pitch, int scan_w, int scan_h, int tb_order) {
-    static const BYTE STRIPE_COUNT_CHECK_MASK[][16] = {
-        { 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50, 0x50 },
-        { 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60, 0x60 },
-    };
-    const int y_fin = scan_h - clip->bottom - ((scan_h - clip->top - clip->bottom) & 1);
-    const uint32_t check_mask[2] = { 0x50, 0x60 };
-    __m128i xZero = _mm_setzero_si128();
-    __m128i xMask, x0, x1;
-    for (int pos_y = clip->top; pos_y < y_fin; pos_y++) {
-        const uint8_t *sip = ptr + pos_y * pitch + clip->left;
-        const int first_field_flag = !is_latter_field(pos_y, tb_order);
-        xMask = _mm_loadu_si128((const __m128i*)STRIPE_COUNT_CHECK_MASK[first_field_flag]);
-        const int x_count = scan_w - clip->right - clip->left;
-        const uint8_t *sip_fin = sip + (x_count & ~31);
-        for (; sip < sip_fin; sip += 32) {
-            x0 = _mm_loadu_si128((const __m128i*)(sip +  0));
-            x1 = _mm_loadu_si128((const __m128i*)(sip + 16));
-            x0 = _mm_and_si128(x0, xMask);
-            x1 = _mm_and_si128(x1, xMask);
-            x0 = _mm_cmpeq_epi8(x0, xZero);
-            x1 = _mm_cmpeq_epi8(x1, xZero);
-            uint32_t count0 = _mm_movemask_epi8(x0);
-            uint32_t count1 = _mm_movemask_epi8(x1);
-            stripe_count[first_field_flag] += popcnt32(((count1 << 16) | count0));
-        }
-        if (x_count & 16) {
-            x0 = _mm_loadu_si128((const __m128i*)sip);
-            x0 = _mm_and_si128(x0, xMask);
-            x0 = _mm_cmpeq_epi8(x0, xZero);
-            uint32_t count0 = _mm_movemask_epi8(x0);
-            stripe_count[first_field_flag] += popcnt32(count0);
-            sip += 16;
-        }
-        sip_fin = sip + (x_count & 15);
-        for (; sip < sip_fin; sip++)
-            stripe_count[first_field_flag] += (!(*sip & check_mask[first_field_flag]));
-    }
-}
-
-static void afs_get_motion_count_simd(int *motion_count, const uint8_t *ptr, const AFS_SCAN_CLIP *clip, int pitch, int scan_w, int scan_h, int tb_order) {
-    const int y_fin = scan_h - clip->bottom - ((scan_h - clip->top - clip->bottom) & 1);
-    __m128i xMotion = _mm_set1_epi8(0x40);
-    __m128i x0, x1;
-    for (int pos_y = clip->top; pos_y < y_fin; pos_y++) {
-        const uint8_t *sip = ptr + pos_y * pitch + clip->left;
-        const int is_latter_feild = is_latter_field(pos_y, tb_order);
-        const int x_count = scan_w - clip->right - clip->left;
-        const uint8_t *sip_fin = sip + (x_count & ~31);
-        for (; sip < sip_fin; sip += 32) {
-            x0 = _mm_loadu_si128((const __m128i*)(sip +  0));
-            x1 = _mm_loadu_si128((const __m128i*)(sip + 16));
-            x0 = _mm_andnot_si128(x0, xMotion);
-            x1 = _mm_andnot_si128(x1, xMotion);
-            x0 = _mm_cmpeq_epi8(x0, xMotion);
-            x1 = _mm_cmpeq_epi8(x1, xMotion);
-            uint32_t count0 = _mm_movemask_epi8(x0);
-            uint32_t count1 = _mm_movemask_epi8(x1);
-            motion_count[is_latter_feild] += popcnt32(((count1 << 16) | count0));
-        }
-        if (x_count & 16) {
-            x0 = _mm_loadu_si128((const __m128i*)sip);
-            x0 = _mm_andnot_si128(x0, xMotion);
-            x0 = _mm_cmpeq_epi8(x0, xMotion);
-            uint32_t count0 = _mm_movemask_epi8(x0);
-            motion_count[is_latter_feild] += popcnt32(count0);
-            sip += 16;
-        }
-        sip_fin = sip + (x_count & 15);
-        for (; sip < sip_fin; sip++)
-            motion_count[is_latter_feild] += ((~*sip & 0x40) >> 6);
-    }
-}
\ No newline at end of file
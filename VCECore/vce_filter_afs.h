@@ -30,6 +30,7 @@
 
 #include "vce_filter.h"
 #include "vce_param.h"
+#include "vce_filter_afs_cpu.h"
 #include <array>
 
 static const bool STREAM_OPT = false;
@@ -90,6 +91,23 @@ struct afsSourceCacheFrame {
     FrameInfo frameinfo() const { return (y) ? y->frame : FrameInfo(); };
 };
 
+//CPU版afsで処理するため、OpenCLのフレームをホスト側にマップする
+//マップは完了を待ってから返し、unmap(またはデストラクタ)で同じキューにアンマップを投入する
+class afsCPUMap {
+public:
+    afsCPUMap(cl_command_queue queue) : m_queue(queue), m_maps() {};
+    ~afsCPUMap() { unmap(); };
+    RGY_ERR map(afsCPUPlane *plane, RGYCLFrame *frame, RGY_PLANE iplane, cl_map_flags map_flags, const std::vector<RGYOpenCLEvent> &wait_events = {});
+    RGY_ERR map(afsCPUFrame *frame, afsSourceCacheFrame *src, const std::vector<RGYOpenCLEvent> &wait_events); //読み込み用
+    RGY_ERR map(afsCPUFrame *frame, RGYCLFrame *dst, cl_map_flags map_flags);
+    RGY_ERR unmap();
+protected:
+    afsCPUMap(const afsCPUMap &) = delete;
+    void operator =(const afsCPUMap &) = delete;
+    cl_command_queue m_queue;
+    std::vector<unique_ptr<RGYCLBufMap>> m_maps;
+};
+
 class afsSourceCache {
 public:
     afsSourceCache(shared_ptr<RGYOpenCLContext> cl);
@@ -148,6 +166,8 @@ struct AFS_STRIPE_DATA {
     int status, frame, count0, count1;
     RGYOpenCLEvent event;
     unique_ptr<RGYCLBuf> buf_count_stripe;
+    unique_ptr<RGYCLBuf> buf_count_stripe_sum;
+    unique_ptr<RGYCLBuf> buf_count_stripe_partial;
 };
 
 class afsStripeCache {
@@ -255,11 +275,13 @@ protected:
     RGY_ERR analyze_stripe(afsSourceCacheFrame *p0, afsSourceCacheFrame *p1, AFS_SCAN_DATA *sp, unique_ptr<RGYCLBuf>& count_motion, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, std::vector<RGYOpenCLEvent> wait_event, RGYOpenCLEvent &event);
     bool scan_frame_result_cached(int iframe, const VppAfs *pAfsPrm);
     RGY_ERR scan_frame(int iframe, int force, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, std::vector<RGYOpenCLEvent> wait_event);
-    RGY_ERR count_motion(AFS_SCAN_DATA *sp, const AFS_SCAN_CLIP *clip, cl_command_queue queue_main);
+    RGY_ERR count_motion(AFS_SCAN_DATA *sp, const AFS_SCAN_CLIP *clip, VppAfsCountReduce count_reduce, cl_command_queue queue_main);
+    RGY_ERR count_reduce(unique_ptr<RGYCLBuf> &count_sum, unique_ptr<RGYCLBuf> &count_partial, const unique_ptr<RGYCLBuf> &count_block, cl_command_queue queue, RGYOpenCLEvent &event);
+    RGY_ERR count_reduce_verify(const unique_ptr<RGYCLBuf> &count_block, int count0, int count1, cl_command_queue queue, const TCHAR *name, int iframe);
 
     RGY_ERR build_merge_scan();
     RGY_ERR merge_scan(AFS_STRIPE_DATA *sp, AFS_SCAN_DATA *sp0, AFS_SCAN_DATA *sp1, unique_ptr<RGYCLBuf>& count_stripe, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, std::vector<RGYOpenCLEvent> wait_event, RGYOpenCLEvent &event);
-    RGY_ERR count_stripe(cl_command_queue queue, AFS_STRIPE_DATA *sp, const AFS_SCAN_CLIP *clip, int tb_order);
+    RGY_ERR count_stripe(cl_command_queue queue, AFS_STRIPE_DATA *sp, const AFS_SCAN_CLIP *clip, int tb_order, VppAfsCountReduce count_reduce);
 
     RGY_ERR get_stripe_info(cl_command_queue queue, int frame, int mode, const RGYFilterParamAfs *pAfsPrm);
     int detect_telecine_cross(int iframe, int coeff_shift);
@@ -269,6 +291,12 @@ protected:
     RGY_ERR synthesize(int iframe, RGYCLFrame *pOut, afsSourceCacheFrame *p0, afsSourceCacheFrame *p1, AFS_STRIPE_DATA *sip, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue);
     RGY_ERR copy_frame(RGYCLFrame *pOut, afsSourceCacheFrame *p0, cl_command_queue queue);
 
+    //CPU版 (verify = true のときはOpenCL版の結果と比較する)
+    afsCPUParam cpu_param(const VppAfs *pAfsPrm) const;
+    RGY_ERR analyze_stripe_cpu(afsSourceCacheFrame *p0, afsSourceCacheFrame *p1, AFS_SCAN_DATA *sp, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, const std::vector<RGYOpenCLEvent> &wait_event, bool verify);
+    RGY_ERR merge_scan_cpu(AFS_STRIPE_DATA *sp, AFS_SCAN_DATA *sp0, AFS_SCAN_DATA *sp1, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, bool verify);
+    RGY_ERR synthesize_cpu(int iframe, RGYCLFrame *pOut, afsSourceCacheFrame *p0, afsSourceCacheFrame *p1, AFS_STRIPE_DATA *sip, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, int mode, bool verify);
+
     int open_timecode(tstring tc_filename);
     void write_timecode(int64_t pts, const rgy_rational<int>& timebase);
 
@@ -289,8 +317,16 @@ protected:
     afsStatus       m_status;
     afsStreamStatus m_streamsts;
     unique_ptr<RGYCLBuf> m_count_motion;
+    unique_ptr<RGYCLBuf> m_count_motion_sum;
+    unique_ptr<RGYCLBuf> m_count_motion_partial;
+    int m_countReduceVerified; //count_reduce=verifyで比較した回数
+    int m_countReduceMismatch; //count_reduce=verifyで一致しなかった回数
+    int m_backendVerified;     //backend=verifyで比較した回数
+    int m_backendMismatch;     //backend=verifyで一致しなかった回数
     unique_ptr<FILE, fp_deleter> m_fpTimecode;
     unique_ptr<RGYOpenCLProgram> m_mergeScan;
     unique_ptr<RGYOpenCLProgram> m_analyze;
     unique_ptr<RGYOpenCLProgram> m_synthesize;
+    const afsCPUFunc *m_cpuFunc; //CPU版の関数 (backend=cpu/verify時のみ)
+    const afsCPUFunc *m_cpuFuncRef; //backend=verifyでm_cpuFuncの結果と比較するC版の関数 (m_cpuFuncがC版の場合はnullptr)
 };
@@ -369,7 +369,11 @@ __kernel void kernel_afs_analyze_12(
 
     //前の4ライン分、計算しておく
     //sharedの SHARED_Y-4 ～ SHARED_Y-1 を埋める
+    //これがないと、ブロックの先頭のラインのマスク生成で未初期化のsharedメモリを参照してしまう
     if (ly < 4) {
+        ptr_shared[shared_int_idx(0, ly-4, 0)] = CALL_ANALYZE_Y(src_p0y, src_p1y, -4);
+        ptr_shared[shared_int_idx(0, ly-4, 1)] = CALL_ANALYZE_C(src_p0u0, src_p0u1, src_p1u0, src_p1u1, -4);
+        ptr_shared[shared_int_idx(0, ly-4, 2)] = CALL_ANALYZE_C(src_p0v0, src_p0v1, src_p1v0, src_p1v1, -4);
         //正方向に4行先読みする
         ptr_shared[shared_int_idx(0, ly, 0)] = CALL_ANALYZE_Y(src_p0y, src_p1y, 0);
         ptr_shared[shared_int_idx(0, ly, 1)] = CALL_ANALYZE_C(src_p0u0, src_p0u1, src_p1u0, src_p1u1, 0);
@@ -447,3 +451,59 @@ __kernel void kernel_afs_analyze_12(
         ptr_count[gid] = ptr_reduction[0];
     }
 }
+
+//ブロックごとに集計した動き/縞のカウント(analyze/merge_scanの出力)の総和をとる
+// 32               16              0
+//  |  count_latter ||  count_first |
+//2段階で処理する
+//  kernel_afs_count_reduce_partial: 各work groupが担当分の総和をとり、count_partial[group*2+0, 1]に出力する
+//  kernel_afs_count_reduce_final:   1つのwork groupでcount_partialの総和をとり、count_result[0], [1]に出力する
+//いずれもCOUNT_REDUCE_BLOCK スレッド/work group
+void afs_count_reduce_block(__local int *shared0, __local int *shared1, int count0, int count1, __global int *restrict dst) {
+    const int lid = get_local_id(0);
+    shared0[lid] = count0;
+    shared1[lid] = count1;
+    barrier(CLK_LOCAL_MEM_FENCE);
+    for (int offset = COUNT_REDUCE_BLOCK >> 1; offset > 0; offset >>= 1) {
+        if (lid < offset) {
+            shared0[lid] += shared0[lid + offset];
+            shared1[lid] += shared1[lid + offset];
+        }
+        barrier(CLK_LOCAL_MEM_FENCE);
+    }
+    if (lid == 0) {
+        dst[0] = shared0[0];
+        dst[1] = shared1[0];
+    }
+}
+
+__kernel void kernel_afs_count_reduce_partial(
+    __global int *restrict count_partial,
+    __global const uint *restrict ptr_count,
+    const int count_num) {
+    __local int shared0[COUNT_REDUCE_BLOCK];
+    __local int shared1[COUNT_REDUCE_BLOCK];
+    int count0 = 0;
+    int count1 = 0;
+    for (int i = get_global_id(0); i < count_num; i += get_global_size(0)) {
+        const uint count = ptr_count[i];
+        count0 += count & 0xffff;
+        count1 += count >> 16;
+    }
+    afs_count_reduce_block(shared0, shared1, count0, count1, count_partial + get_group_id(0) * 2);
+}
+
+__kernel void kernel_afs_count_reduce_final(
+    __global int *restrict count_result,
+    __global const int *restrict count_partial,
+    const int partial_num) {
+    __local int shared0[COUNT_REDUCE_BLOCK];
+    __local int shared1[COUNT_REDUCE_BLOCK];
+    int count0 = 0;
+    int count1 = 0;
+    for (int i = get_local_id(0); i < partial_num; i += COUNT_REDUCE_BLOCK) {
+        count0 += count_partial[i * 2 + 0];
+        count1 += count_partial[i * 2 + 1];
+    }
+    afs_count_reduce_block(shared0, shared1, count0, count1, count_result);
+}
@@ -35,16 +35,19 @@
 #define BLOCK_Y       (8) //blockDim(y) = スレッド数/ブロック
 #define BLOCK_LOOP_Y (16) //ブロックのy方向反復数
 
+#define COUNT_REDUCE_BLOCK (256) //カウントの総和をとるwork groupのスレッド数
+#define COUNT_REDUCE_LOOP    (8) //カウントの総和の1段目で、1スレッドが最低限処理する数
+
 #define SHARED_INT_X (BLOCK_INT_X) //sharedメモリの幅
 #define SHARED_Y     (16) //sharedメモリの縦
 
 RGY_ERR RGYFilterAfs::build_analyze(const RGY_CSP csp, const bool tb_order) {
     if (!m_analyze) {
-        const auto options = strsprintf("-D BIT_DEPTH=%d -D YUV420=%d -D TB_ORDER=%d -D BLOCK_INT_X=%d -D BLOCK_Y=%d -D BLOCK_LOOP_Y=%d",
+        const auto options = strsprintf("-D BIT_DEPTH=%d -D YUV420=%d -D TB_ORDER=%d -D BLOCK_INT_X=%d -D BLOCK_Y=%d -D BLOCK_LOOP_Y=%d -D COUNT_REDUCE_BLOCK=%d",
             RGY_CSP_BIT_DEPTH[csp],
             RGY_CSP_CHROMA_FORMAT[csp] == RGY_CHROMAFMT_YUV420 ? 1 : 0,
             (tb_order) ? 1 : 0,
-            BLOCK_INT_X, BLOCK_Y, BLOCK_LOOP_Y);
+            BLOCK_INT_X, BLOCK_Y, BLOCK_LOOP_Y, COUNT_REDUCE_BLOCK);
         m_analyze = m_cl->buildResource(_T("VCE_FILTER_AFS_ANALYZE_CL"), _T("EXE_DATA"), options.c_str());
         if (!m_analyze) {
             AddMessage(RGY_LOG_ERROR, _T("failed to load VCE_FILTER_AFS_ANALYZE_CL\n"));
@@ -114,22 +117,15 @@ RGY_ERR run_analyze_stripe(uint8_t *dst,
     const uint32_t scan_top    = pAfsPrm->clip.top;
     const uint32_t scan_height = (srcHeight - pAfsPrm->clip.top - pAfsPrm->clip.bottom) & ~1;
 
-    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリングのシフト値
-    const int thre_rsft = 12 - (bit_depth - 8);
-    //8bitなら最大127まで、16bitなら最大32627まで (bitshift等を使って比較する都合)
-    const int thre_max = (1 << (sizeof(Type) * 8 - 1)) - 1;
-    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリング
-    const Type thre_shift_yuv   = (Type)clamp((pAfsPrm->thre_shift   * 219 +  383)>>thre_rsft, 0, thre_max);
-    const Type thre_deint_yuv   = (Type)clamp((pAfsPrm->thre_deint   * 219 +  383)>>thre_rsft, 0, thre_max);
-    const Type thre_Ymotion_yuv = (Type)clamp((pAfsPrm->thre_Ymotion * 219 +  383)>>thre_rsft, 0, thre_max);
-    const Type thre_Cmotion_yuv = (Type)clamp((pAfsPrm->thre_Cmotion * 224 + 2112)>>thre_rsft, 0, thre_max);
-
-    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリング
-    //色差はcudaReadModeNormalizedFloatをつ開くので、そのぶんのスケーリングも必要
-    const float thre_mul = (224.0f / (float)(4096 >> (bit_depth - 8))) * (1.0f / (1 << (sizeof(Type) * 8)));
-    const float thre_shift_yuvf   = std::max(0.0f, pAfsPrm->thre_shift * thre_mul);
-    const float thre_deint_yuvf   = std::max(0.0f, pAfsPrm->thre_deint * thre_mul);
-    const float thre_Cmotion_yuvf = std::max(0.0f, pAfsPrm->thre_Cmotion * thre_mul);
+    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリング (CPU版と共通)
+    const auto thre = afs_analyze_thre(pAfsPrm->thre_shift, pAfsPrm->thre_deint, pAfsPrm->thre_Ymotion, pAfsPrm->thre_Cmotion, bit_depth);
+    const Type thre_shift_yuv   = (Type)thre.shift;
+    const Type thre_deint_yuv   = (Type)thre.deint;
+    const Type thre_Ymotion_yuv = (Type)thre.Ymotion;
+    const Type thre_Cmotion_yuv = (Type)thre.Cmotion;
+    const float thre_shift_yuvf   = thre.shiftf;
+    const float thre_deint_yuvf   = thre.deintf;
+    const float thre_Cmotion_yuvf = thre.Cmotionf;
 
     err = analyze->kernel("kernel_afs_analyze_12").config(queue, local, global, wait_event, &event).launch(
         (cl_mem)dst, count_motion->mem(),
@@ -181,3 +177,32 @@ RGY_ERR RGYFilterAfs::analyze_stripe(afsSourceCacheFrame *p0, afsSourceCacheFram
         sp->map->frame.pitch[0],
         count_motion, &pAfsPrm->afs, queue, wait_event, event, m_analyze.get(), m_cl.get());
 }
+
+RGY_ERR RGYFilterAfs::count_reduce(unique_ptr<RGYCLBuf> &count_sum, unique_ptr<RGYCLBuf> &count_partial, const unique_ptr<RGYCLBuf> &count_block, cl_command_queue queue, RGYOpenCLEvent &event) {
+    if (!count_sum) {
+        count_sum = m_cl->createBuffer(sizeof(int) * 2, CL_MEM_READ_WRITE | CL_MEM_ALLOC_HOST_PTR);
+        if (!count_sum) {
+            return RGY_ERR_MEMORY_ALLOC;
+        }
+    }
+    if (!count_partial) {
+        count_partial = m_cl->createBuffer(sizeof(int) * 2 * COUNT_REDUCE_BLOCK, CL_MEM_READ_WRITE);
+        if (!count_partial) {
+            return RGY_ERR_MEMORY_ALLOC;
+        }
+    }
+    //1段目: 各work groupで担当分の総和をとる
+    //  work group数は2段目を1つのwork groupで処理できるCOUNT_REDUCE_BLOCK以下とする
+    //ブロックごとのカウントを出力したカーネルと同じqueueに投入するので、その完了を待つ必要はない
+    const int count_num = (int)(count_block->size() / sizeof(uint32_t));
+    const int partial_num = clamp(divCeil(count_num, COUNT_REDUCE_BLOCK * COUNT_REDUCE_LOOP), 1, COUNT_REDUCE_BLOCK);
+    const RGYWorkSize local(COUNT_REDUCE_BLOCK);
+    auto err = m_analyze->kernel("kernel_afs_count_reduce_partial").config(queue, local, RGYWorkSize(partial_num * COUNT_REDUCE_BLOCK)).launch(
+        count_partial->mem(), count_block->mem(), count_num);
+    if (err != RGY_ERR_NONE) {
+        return err;
+    }
+    //2段目: 1段目の結果の総和をとる
+    return m_analyze->kernel("kernel_afs_count_reduce_final").config(queue, local, RGYWorkSize(COUNT_REDUCE_BLOCK), &event).launch(
+        count_sum->mem(), count_partial->mem(), partial_num);
+}
@@ -0,0 +1,676 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#include <cstring>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+#include "rgy_util.h"
+#include "rgy_simd.h"
+#include "vce_filter_afs_cpu.h"
+
+//      7       6         5        4        3        2        1       0
+// | motion  |         non-shift        | motion  |          shift          |
+// |  shift  |  sign  |  shift |  deint |  flag   | sign  |  shift |  deint |
+static const uint8_t motion_flag     = 0x08u;
+static const uint8_t motion_shift    = 0x80u;
+
+static const uint8_t non_shift_sign  = 0x40u;
+static const uint8_t non_shift_shift = 0x20u;
+static const uint8_t non_shift_deint = 0x10u;
+
+static const uint8_t shift_sign      = 0x04u;
+static const uint8_t shift_shift     = 0x02u;
+static const uint8_t shift_deint     = 0x01u;
+
+static const uint8_t AFS_FLAG_SHIFT0 = 0x01;
+
+AFS_ANALYZE_THRE afs_analyze_thre(int thre_shift, int thre_deint, int thre_Ymotion, int thre_Cmotion, int bit_depth) {
+    const int data_size = (bit_depth > 8) ? 2 : 1;
+    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリングのシフト値
+    const int thre_rsft = 12 - (bit_depth - 8);
+    //8bitなら最大127まで、16bitなら最大32627まで (bitshift等を使って比較する都合)
+    const int thre_max = (1 << (data_size * 8 - 1)) - 1;
+    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリング
+    AFS_ANALYZE_THRE thre;
+    thre.shift   = clamp((thre_shift   * 219 +  383)>>thre_rsft, 0, thre_max);
+    thre.deint   = clamp((thre_deint   * 219 +  383)>>thre_rsft, 0, thre_max);
+    thre.Ymotion = clamp((thre_Ymotion * 219 +  383)>>thre_rsft, 0, thre_max);
+    thre.Cmotion = clamp((thre_Cmotion * 224 + 2112)>>thre_rsft, 0, thre_max);
+
+    //YC48 -> yuv420/yuv444(bit_depth)へのスケーリング
+    //色差は正規化された値(read_imagef)を使うので、そのぶんのスケーリングも必要
+    const float thre_mul = (224.0f / (float)(4096 >> (bit_depth - 8))) * (1.0f / (1 << (data_size * 8)));
+    thre.shiftf   = std::max(0.0f, thre_shift   * thre_mul);
+    thre.deintf   = std::max(0.0f, thre_deint   * thre_mul);
+    thre.Cmotionf = std::max(0.0f, thre_Cmotion * thre_mul);
+    return thre;
+}
+
+template<typename T>
+static T *plane_line(const afsCPUPlane *plane, int y) {
+    return (T *)(plane->ptr + plane->pitch * y);
+}
+
+static int clamp_line(int y, int height) {
+    return clamp(y, 0, height - 1);
+}
+
+template<typename Type>
+static void afs_analyze_row_c(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB,
+    int width, int thre_motion, int thre_deint, int thre_shift) {
+    const Type *p0 = (const Type *)src0;
+    const Type *p1 = (const Type *)src1;
+    const Type *p0m = (const Type *)src0m;
+    const Type *pA = (const Type *)shiftA;
+    const Type *pB = (const Type *)shiftB;
+    for (int x = 0; x < width; x++) {
+        //motion
+        int absdata = std::abs((int)p1[x] - (int)p0[x]);
+        uint8_t flag = 0;
+        if (thre_motion > absdata) flag |= motion_flag;
+        if (thre_shift  > absdata) flag |= motion_shift;
+        if (p0m) {
+            //non-shift
+            absdata = std::abs((int)p0m[x] - (int)p0[x]);
+            if (p0[x] >= p0m[x])    flag |= non_shift_sign;
+            if (absdata > thre_deint) flag |= non_shift_deint;
+            if (absdata > thre_shift) flag |= non_shift_shift;
+            //shift
+            absdata = std::abs((int)pB[x] - (int)pA[x]);
+            if (pA[x] >= pB[x])     flag |= shift_sign;
+            if (absdata > thre_deint) flag |= shift_deint;
+            if (absdata > thre_shift) flag |= shift_shift;
+        }
+        dst[x] = flag;
+    }
+}
+
+void afs_analyze_row_c_u8(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift) {
+    afs_analyze_row_c<uint8_t>(dst, src0, src1, src0m, shiftA, shiftB, width, thre_motion, thre_deint, thre_shift);
+}
+
+void afs_analyze_row_c_u16(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift) {
+    afs_analyze_row_c<uint16_t>(dst, src0, src1, src0m, shiftA, shiftB, width, thre_motion, thre_deint, thre_shift);
+}
+
+//OpenCL版ではFlag4(uchar4)で演算しているので、uint8_tで演算して桁あふれの挙動も合わせる
+static uint8_t generate_flags(uint8_t f0, uint8_t f1, uint8_t f2, uint8_t f3) {
+    //f0 = r-3行目, ... , f3 = r行目
+    uint8_t count_shift = f0 & (non_shift_shift | shift_shift);
+    uint8_t count_deint = 0;
+    { //count_flags_skip(f1, f0)
+        const uint8_t mask = (uint8_t)(((f1 ^ f0) & (non_shift_sign | shift_sign)) >> 1);
+        count_shift &= mask;
+        count_deint  = f1 & (non_shift_deint | shift_deint);
+        count_shift += f1 & (non_shift_shift | shift_shift);
+    }
+    const uint8_t dat[3][2] = { { f2, f1 }, { f3, f2 } };
+    for (int i = 0; i < 2; i++) { //count_flags(dat0, dat1)
+        uint8_t mask = (dat[i][0] ^ dat[i][1]) & (non_shift_sign | shift_sign);
+        mask |= (uint8_t)(mask << 1);
+        mask |= (uint8_t)(mask >> 2);
+        count_deint &= mask;
+        count_shift &= mask;
+        count_deint += dat[i][0] & (non_shift_deint | shift_deint);
+        count_shift += dat[i][0] & (non_shift_shift | shift_shift);
+    }
+    uint8_t flag = (f3 & (motion_flag | motion_shift)) >> 1; //motion flag / motion shift
+    if ((count_deint & 0x70u) > (2u << 4)) flag |= 0x01u; //nonshift deint
+    if ((count_shift & 0xE0u) > (3u << 5)) flag |= 0x10u; //nonshift shift
+    if ((count_deint & 0x07u) > (2u << 0)) flag |= 0x02u; //shift deint
+    if ((count_shift & 0x0Eu) > (3u << 1)) flag |= 0x20u; //shift shift
+    return flag;
+}
+
+void afs_analyze_mask_row_c(uint8_t *mask0, uint8_t *mask1, const uint8_t *const flag[3][4], int width) {
+    for (int x = 0; x < width; x++) {
+        const uint8_t masky = generate_flags(flag[0][0][x], flag[0][1][x], flag[0][2][x], flag[0][3][x]);
+        const uint8_t masku = generate_flags(flag[1][0][x], flag[1][1][x], flag[1][2][x], flag[1][3][x]);
+        const uint8_t maskv = generate_flags(flag[2][0][x], flag[2][1][x], flag[2][2][x], flag[2][3][x]);
+        const uint8_t m1 = (masky | masku | maskv) & 0x33; //shift/deint
+        mask0[x] = ((masky & masku & maskv) & 0xcc) | m1; //motion
+        mask1[x] = m1;
+    }
+}
+
+int afs_analyze_output_row_c(uint8_t *dst, const uint8_t *const mask0[4], const uint8_t *mask1, int width, int scan_x0, int scan_x1) {
+    int count = 0;
+    for (int x = 0; x < width; x++) {
+        const uint8_t out = (mask1[x] & 0x30) | ((mask0[1][x] | mask0[2][x] | mask0[3][x]) & 0x33) | mask0[0][x];
+        dst[x] = out;
+        if (scan_x0 <= x && x < scan_x1 && (out & 0x40) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+int afs_merge_scan_row_c(uint8_t *dst, const uint8_t *p0m, const uint8_t *p0c, const uint8_t *p0p, const uint8_t *p1m, const uint8_t *p1c, const uint8_t *p1p, int width, uint8_t count_mask, int scan_x0, int scan_x1) {
+    int count = 0;
+    for (int x = 0; x < width; x++) {
+        const uint8_t m4 = (p0m[x] | p0p[x] | 0xf3) & p0c[x];
+        const uint8_t m5 = (p1m[x] | p1p[x] | 0xf3) & p1c[x];
+        const uint8_t m6 = (m4 & m5 & 0x44) | (~p0c[x] & 0x33);
+        dst[x] = m6;
+        if (scan_x0 <= x && x < scan_x1 && (m6 & count_mask) == 0) {
+            count++;
+        }
+    }
+    return count;
+}
+
+template<typename Type>
+static int deint(int src1, int src3, int src4, int src5, int src7, uint8_t flag, uint8_t mask) {
+    const int tmp2 = src1 + src7;
+    const int tmp3 = src3 + src5;
+    //OpenCL版と同様に、範囲外の値は丸めずにそのまま変換する
+    const int tmp = (Type)((tmp3 - ((tmp2 - tmp3) >> 3) + 1) >> 1);
+    return ((flag & mask) == 0) ? tmp : src4;
+}
+
+static int blend(int src1, int src2, int src3, uint8_t flag, uint8_t mask) {
+    const int tmp = (src1 + src3 + src2 + src2 + 2) >> 2;
+    return ((flag & mask) == 0) ? tmp : src2;
+}
+
+static int mie_inter(int src1, int src2, int src3, int src4) {
+    return (src1 + src2 + src3 + src4 + 2) >> 2;
+}
+
+static int mie_spot(int src1, int src2, int src3, int src4, int src_spot) {
+    return (mie_inter(src1, src2, src3, src4) + src_spot + 1) >> 1;
+}
+
+template<typename Type>
+static void afs_synthesize_row_c(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field) {
+    Type *ptr_dst = (Type *)dst;
+    for (int x = 0; x < width; x++) {
+        //pin(plane, line)
+        auto pin = [&](int plane, int line) { return (int)((const Type *)((plane) ? src1 : src0)[line-1])[x]; };
+        int pout = 0;
+        if (mode == 1) {
+            if (shift) {
+                pout = (!latter_field) ? mie_inter(pin(0, 2), pin(1, 1), pin(1, 2), pin(1, 3))
+                                       : mie_spot(pin(0, 1), pin(0, 3), pin(1, 1), pin(1, 3), pin(1, 2));
+            } else {
+                pout = (latter_field) ? mie_inter(pin(0, 1), pin(0, 2), pin(0, 3), pin(1, 2))
+                                      : mie_spot(pin(0, 1), pin(0, 3), pin(1, 1), pin(1, 3), pin(0, 2));
+            }
+        } else if (mode == 2 || mode == 3) {
+            if (shift) {
+                const uint8_t mask = (mode == 2) ? 0x02 : 0x06;
+                pout = (!latter_field) ? blend(pin(1, 1), pin(0, 2), pin(1, 3), sip[x], mask)
+                                       : blend(pin(0, 1), pin(1, 2), pin(0, 3), sip[x], mask);
+            } else {
+                const uint8_t mask = (mode == 2) ? 0x01 : 0x05;
+                pout = blend(pin(0, 1), pin(0, 2), pin(0, 3), sip[x], mask);
+            }
+        } else if (mode == 4) {
+            if (shift) {
+                pout = (!latter_field) ? deint<Type>(pin(1, 1), pin(1, 3), pin(0, 4), pin(1, 5), pin(1, 7), sip[x], 0x06) : pin(1, 4);
+            } else {
+                pout = (latter_field) ? deint<Type>(pin(0, 1), pin(0, 3), pin(0, 4), pin(0, 5), pin(0, 7), sip[x], 0x05) : pin(0, 4);
+            }
+        }
+        ptr_dst[x] = (Type)pout;
+    }
+}
+
+void afs_synthesize_row_c_u8(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field) {
+    afs_synthesize_row_c<uint8_t>(dst, src0, src1, sip, width, mode, shift, latter_field);
+}
+
+void afs_synthesize_row_c_u16(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field) {
+    afs_synthesize_row_c<uint16_t>(dst, src0, src1, sip, width, mode, shift, latter_field);
+}
+
+static const afsCPUFunc AFS_CPU_FUNC_C = {
+    { afs_analyze_row_c_u8, afs_analyze_row_c_u16 },
+    afs_analyze_mask_row_c,
+    afs_analyze_output_row_c,
+    afs_merge_scan_row_c,
+    { afs_synthesize_row_c_u8, afs_synthesize_row_c_u16 }
+};
+
+static const afsCPUFunc AFS_CPU_FUNC_AVX2 = {
+    { afs_analyze_row_avx2_u8, afs_analyze_row_avx2_u16 },
+    afs_analyze_mask_row_avx2,
+    afs_analyze_output_row_avx2,
+    afs_merge_scan_row_avx2,
+    { afs_synthesize_row_avx2_u8, afs_synthesize_row_avx2_u16 }
+};
+
+const afsCPUFunc *get_afs_cpu_func(bool use_simd) {
+    if (use_simd && (get_availableSIMD() & AVX2) == AVX2) {
+        return &AFS_CPU_FUNC_AVX2;
+    }
+    return &AFS_CPU_FUNC_C;
+}
+
+//YUV420の色差をフィールドごとの色差プレーンから、テクスチャの線形補間と同じ方法で取得する
+//x: 輝度の画素位置, iy: 輝度の行
+template<typename Type>
+static float get_uv(const afsCPUPlane *plane_field, float ifx, int iy) {
+    //OpenCL版の get_uv() のテクスチャ座標
+    //  ifx    : (x >> 1) + 0.5f + (x & 1) * 0.5f
+    //  ifytex : ((iy - 2) >> 2) + 0.5f + (3.5f - (float)(iy & 3)) * 0.25f
+    //CLK_FILTER_LINEARでは、(座標 - 0.5f)の整数部と小数部で補間する
+    static const float WEIGHT[4] = { 7.0f / 8.0f, 5.0f / 8.0f, 3.0f / 8.0f, 1.0f / 8.0f };
+    const afsCPUPlane *plane = &plane_field[iy & 1];
+    const float fx = ifx - 0.5f;
+    const int ix0 = (int)std::floor(fx);
+    const float a = fx - (float)ix0;
+    const int iy0 = (iy - 2) >> 2;
+    const float b = WEIGHT[iy & 3];
+    const int x0 = clamp(ix0,     0, plane->width - 1);
+    const int x1 = clamp(ix0 + 1, 0, plane->width - 1);
+    const Type *line0 = plane_line<Type>(plane, clamp_line(iy0,     plane->height));
+    const Type *line1 = plane_line<Type>(plane, clamp_line(iy0 + 1, plane->height));
+    //テクスチャの各画素は正規化してから補間する
+    const float maxval = (float)((1 << (8 * sizeof(Type))) - 1);
+    return (1.0f - a) * (1.0f - b) * (line0[x0] / maxval) + a * (1.0f - b) * (line0[x1] / maxval)
+         + (1.0f - a) * b * (line1[x0] / maxval) + a * b * (line1[x1] / maxval);
+}
+
+//YUV420の色差の判定 (OpenCL版の analyze_c())
+template<typename Type>
+static void afs_analyze_row_yuv420_c(uint8_t *dst, const afsCPUPlane p0[2], const afsCPUPlane p1[2], int width, int iy, int tb_order,
+    float thre_motionf, float thre_deintf, float thre_shiftf) {
+    for (int x = 0; x < width; x++) {
+        const float ifx = (float)(x >> 1) + 0.5f + (float)(x & 1) * 0.5f;
+        float v0 = get_uv<Type>(p0, ifx, iy);
+        float v1 = get_uv<Type>(p1, ifx, iy);
+        //motion
+        float absdata = std::abs(v0 - v1);
+        uint8_t flag = 0;
+        if (thre_motionf > absdata) flag |= motion_flag;
+        if (thre_shiftf  > absdata) flag |= motion_shift;
+        if (iy > 0) {
+            //non-shift
+            const float v0m = get_uv<Type>(p0, ifx, iy - 1);
+            absdata = std::abs(v0m - v0);
+            if (v0 >= v0m)             flag |= non_shift_sign;
+            if (absdata > thre_deintf) flag |= non_shift_deint;
+            if (absdata > thre_shiftf) flag |= non_shift_shift;
+            //shift
+            float vA, vB;
+            if (((iy & 1) != 0) == (tb_order != 0)) {
+                vA = v0m;
+                vB = v1;
+            } else {
+                vA = get_uv<Type>(p1, ifx, iy - 1);
+                vB = v0;
+            }
+            absdata = std::abs(vB - vA);
+            if (vA >= vB)              flag |= shift_sign;
+            if (absdata > thre_deintf) flag |= shift_deint;
+            if (absdata > thre_shiftf) flag |= shift_shift;
+        }
+        dst[x] = flag;
+    }
+}
+
+//1行分の動き・縞の判定を行い、結果をdstに出力する
+static void analyze_line(const afsCPUFunc *func, uint8_t *dst, const afsCPUPlane *p0, const afsCPUPlane *p1,
+    int iy, int tb_order, int pixel_size, int width, int thre_motion, int thre_deint, int thre_shift) {
+    const int height = p0->height;
+    const uint8_t *src0  = plane_line<uint8_t>(p0, clamp_line(iy, height));
+    const uint8_t *src1  = plane_line<uint8_t>(p1, clamp_line(iy, height));
+    const uint8_t *src0m = nullptr;
+    const uint8_t *shiftA = nullptr;
+    const uint8_t *shiftB = nullptr;
+    if (iy >= 1) {
+        src0m = plane_line<uint8_t>(p0, clamp_line(iy - 1, height));
+        //フィールドシフトした場合に隣接する2行
+        if (((iy & 1) != 0) == (tb_order != 0)) {
+            shiftA = src0m;
+            shiftB = src1;
+        } else {
+            shiftA = plane_line<uint8_t>(p1, clamp_line(iy - 1, height));
+            shiftB = src0;
+        }
+    }
+    func->analyze_row[pixel_size > 1 ? 1 : 0](dst, src0, src1, src0m, shiftA, shiftB, width, thre_motion, thre_deint, thre_shift);
+}
+
+void afs_cpu_analyze(const afsCPUFunc *func, afsCPUPlane *dst, int motion_count[2],
+    const afsCPUFrame *p0, const afsCPUFrame *p1, const RGY_CSP csp, const afsCPUParam *prm) {
+    const int width = p0->y.width;
+    const int height = p0->y.height;
+    //OpenCL版と同様、4pixel単位で処理する
+    const int width_int = (width + 3) >> 2;
+    const int width4 = width_int << 2;
+    const int pixel_size = (RGY_CSP_BIT_DEPTH[csp] > 8) ? 2 : 1;
+    const bool yuv420 = RGY_CSP_CHROMA_FORMAT[csp] == RGY_CHROMAFMT_YUV420;
+    const AFS_ANALYZE_THRE *thre = &prm->thre;
+
+    //opencl版と同様、横方向は4pixel単位でスキャン範囲を決める
+    const uint32_t scan_left   = prm->clip_left >> 2;
+    const uint32_t scan_width  = (width - prm->clip_left - prm->clip_right) >> 2;
+    const uint32_t scan_top    = prm->clip_top;
+    const uint32_t scan_height = (height - prm->clip_top - prm->clip_bottom) & ~1;
+    const int scan_x0 = (int)std::min<uint32_t>(scan_left, width_int) << 2;
+    const int scan_x1 = (int)std::min<uint64_t>((uint64_t)scan_left + scan_width, width_int) << 2;
+
+    //判定結果は直近の8行分を保持する
+    std::vector<uint8_t> buf(width4 * 8 * 5);
+    auto flag_line  = [&](int plane, int iy) { return buf.data() + width4 * (plane * 8 + (iy & 7)); };
+    auto mask0_line = [&](int iy) { return buf.data() + width4 * (3 * 8 + (iy & 7)); };
+    uint8_t *mask1 = buf.data() + width4 * (4 * 8);
+
+    motion_count[0] = 0;
+    motion_count[1] = 0;
+    for (int iy = -3; iy < height + 4; iy++) {
+        //差分情報を計算
+        analyze_line(func, flag_line(0, iy), &p0->y, &p1->y, iy, prm->tb_order, pixel_size, width4, thre->Ymotion, thre->deint, thre->shift);
+        if (yuv420) {
+            if (pixel_size > 1) {
+                afs_analyze_row_yuv420_c<uint16_t>(flag_line(1, iy), p0->u, p1->u, width4, iy, prm->tb_order, thre->Cmotionf, thre->deintf, thre->shiftf);
+                afs_analyze_row_yuv420_c<uint16_t>(flag_line(2, iy), p0->v, p1->v, width4, iy, prm->tb_order, thre->Cmotionf, thre->deintf, thre->shiftf);
+            } else {
+                afs_analyze_row_yuv420_c<uint8_t>(flag_line(1, iy), p0->u, p1->u, width4, iy, prm->tb_order, thre->Cmotionf, thre->deintf, thre->shiftf);
+                afs_analyze_row_yuv420_c<uint8_t>(flag_line(2, iy), p0->v, p1->v, width4, iy, prm->tb_order, thre->Cmotionf, thre->deintf, thre->shiftf);
+            }
+        } else {
+            analyze_line(func, flag_line(1, iy), &p0->u[0], &p1->u[0], iy, prm->tb_order, pixel_size, width4, thre->Cmotion, thre->deint, thre->shift);
+            analyze_line(func, flag_line(2, iy), &p0->v[0], &p1->v[0], iy, prm->tb_order, pixel_size, width4, thre->Cmotion, thre->deint, thre->shift);
+        }
+        if (iy < 0) {
+            continue;
+        }
+        //マスク生成
+        const uint8_t *flag[3][4];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                flag[i][j] = flag_line(i, iy - 3 + j);
+            }
+        }
+        func->analyze_mask_row(mask0_line(iy), mask1, flag, width4);
+
+        //最終出力
+        const int y = iy - 4;
+        if (y < 0) {
+            continue;
+        }
+        const uint8_t *mask0[4] = { mask0_line(y), mask0_line(y+1), mask0_line(y+2), mask0_line(y+3) };
+        const bool scan = ((uint32_t)y - scan_top) < scan_height;
+        const int count = func->analyze_output_row(plane_line<uint8_t>(dst, y), mask0, mask1, width4,
+            (scan) ? scan_x0 : 0, (scan) ? scan_x1 : 0);
+        motion_count[((y & 1) == prm->tb_order) ? 1 : 0] += count;
+    }
+}
+
+void afs_cpu_merge_scan(const afsCPUFunc *func, afsCPUPlane *dst, int stripe_count[2],
+    const afsCPUPlane *sp0, const afsCPUPlane *sp1, const afsCPUParam *prm) {
+    const int width = sp1->width;
+    const int height = sp1->height;
+    const int width_int = (width + 3) >> 2;
+    const int width4 = width_int << 2;
+
+    const uint32_t scan_left   = prm->clip_left / 4;
+    const uint32_t scan_width  = (uint32_t)(width - prm->clip_left - prm->clip_right) / 4;
+    const uint32_t scan_top    = prm->clip_top;
+    const uint32_t scan_height = height - prm->clip_top - prm->clip_bottom;
+    const int scan_x0 = (int)std::min<uint32_t>(scan_left, width_int) << 2;
+    const int scan_x1 = (int)std::min<uint64_t>((uint64_t)scan_left + scan_width, width_int) << 2;
+
+    stripe_count[0] = 0;
+    stripe_count[1] = 0;
+    for (int y = 0; y < height; y++) {
+        const int ym = (y == 0) ? y : y - 1;
+        const int yp = (y >= height - 1) ? y : y + 1;
+        const int field_select = (y + prm->tb_order) & 1;
+        const bool scan = ((uint32_t)y - scan_top) < scan_height;
+        stripe_count[field_select] += func->merge_scan_row(plane_line<uint8_t>(dst, y),
+            plane_line<uint8_t>(sp0, ym), plane_line<uint8_t>(sp0, y), plane_line<uint8_t>(sp0, yp),
+            plane_line<uint8_t>(sp1, ym), plane_line<uint8_t>(sp1, y), plane_line<uint8_t>(sp1, yp),
+            width4, (field_select) ? 0x60 : 0x50,
+            (scan) ? scan_x0 : 0, (scan) ? scan_x1 : 0);
+    }
+}
+
+// 後方フィールド判定
+static bool is_latter_field(int pos_y, int tb_order) {
+    return ((pos_y + tb_order + 1) & 1) != 0;
+}
+
+//mode 1-4 の輝度(およびYUV444の色差)の合成
+static void synthesize_plane(const afsCPUFunc *func, afsCPUPlane *dst, const afsCPUPlane *p0, const afsCPUPlane *p1, const afsCPUPlane *sip,
+    int pixel_size, int mode, int tb_order, uint8_t status) {
+    const int width = p0->width;
+    const int height = p0->height;
+    for (int y_h_center = 0; y_h_center + 1 < height; y_h_center += 2) {
+        //参照する行 (OpenCL版の set_y_h_pos())
+        int y_h[8];
+        if (mode == 4) {
+            y_h[3] = y_h_center;
+            y_h[2] = y_h[3] + ((y_h_center - 1 >= 0) ? -1 : 1);
+            y_h[1] = y_h[2] + ((y_h_center - 2 >= 0) ? -1 : 1);
+            y_h[0] = y_h[1] + ((y_h_center - 3 >= 0) ? -1 : 1);
+            y_h[4] = y_h[3] + ((y_h_center < height - 1) ? 1 : -1);
+            y_h[5] = y_h[4] + ((y_h_center < height - 2) ? 1 : -1);
+            y_h[6] = y_h[5] + ((y_h_center < height - 3) ? 1 : -1);
+            y_h[7] = y_h[6] + ((y_h_center < height - 4) ? 1 : -1);
+        } else {
+            y_h[1] = y_h_center;
+            y_h[0] = y_h[1] + ((y_h_center - 1 >= 0) ? -1 : 1);
+            y_h[2] = y_h[1] + ((y_h_center < height - 1) ? 1 : -1);
+            y_h[3] = y_h[2] + ((y_h_center < height - 2) ? 1 : -1);
+            y_h[4] = y_h[5] = y_h[6] = y_h[7] = y_h[3];
+        }
+        for (int i = 0; i < 2; i++) {
+            const int y = y_h_center + i;
+            const void *src0[7], *src1[7];
+            for (int j = 0; j < 7; j++) {
+                src0[j] = plane_line<uint8_t>(p0, y_h[i + j]);
+                src1[j] = plane_line<uint8_t>(p1, y_h[i + j]);
+            }
+            func->synthesize_row[pixel_size > 1 ? 1 : 0](plane_line<uint8_t>(dst, y), src0, src1, plane_line<uint8_t>(sip, y),
+                width, mode, (status & AFS_FLAG_SHIFT0) != 0, is_latter_field(y, tb_order));
+        }
+    }
+}
+
+//mode 1-4 のYUV420の色差の合成 (OpenCL版の proc_uv())
+template<typename Type>
+static void synthesize_plane_yuv420(afsCPUPlane *dst, const afsCPUPlane p0[2], const afsCPUPlane p1[2], const afsCPUPlane *sip,
+    int mode, int tb_order, uint8_t status) {
+    const int width = dst->width;
+    const int height = sip->height; //YUV422相当の高さ
+    const bool shift = (status & AFS_FLAG_SHIFT0) != 0;
+    const float maxval = (float)((1 << (8 * sizeof(Type))) - 1);
+    std::vector<float> line422(height + 1);
+    for (int x = 0; x < width; x++) {
+        //縦方向のテクスチャ補間を使って、YUV422相当のデータを作って合成する
+        const float ifx = (float)x + 0.5f;
+        for (int iy = 0; iy <= height; iy++) {
+            auto pin = [&](int plane, int line) {
+                const int offset = (mode == 4) ? line - 4 : line - 2;
+                return get_uv<Type>((plane) ? p1 : p0, ifx, iy + offset);
+            };
+            const uint8_t sip0 = (iy < height) ? plane_line<uint8_t>(sip, iy)[x * 2] : 0;
+            const bool latter_field = is_latter_field(iy, tb_order);
+            float pout = 0.0f;
+            if (mode == 1) {
+                if (shift) {
+                    pout = (!latter_field) ? (pin(0, 2) + pin(1, 1) + pin(1, 2) + pin(1, 3)) * 0.25f
+                                           : ((pin(0, 1) + pin(0, 3) + pin(1, 1) + pin(1, 3)) * 0.25f + pin(1, 2)) * 0.5f;
+                } else {
+                    pout = (latter_field) ? (pin(0, 1) + pin(0, 2) + pin(0, 3) + pin(1, 2)) * 0.25f
+                                          : ((pin(0, 1) + pin(0, 3) + pin(1, 1) + pin(1, 3)) * 0.25f + pin(0, 2)) * 0.5f;
+                }
+            } else if (mode == 2 || mode == 3) {
+                auto blendf = [](float src1, float src2, float src3, uint8_t flag, uint8_t mask) {
+                    return ((flag & mask) == 0) ? (src1 + src3 + 2.0f * src2) * 0.25f : src2;
+                };
+                if (shift) {
+                    const uint8_t mask = (mode == 2) ? 0x02 : 0x06;
+                    pout = (!latter_field) ? blendf(pin(1, 1), pin(0, 2), pin(1, 3), sip0, mask)
+                                           : blendf(pin(0, 1), pin(1, 2), pin(0, 3), sip0, mask);
+                } else {
+                    const uint8_t mask = (mode == 2) ? 0x01 : 0x05;
+                    pout = blendf(pin(0, 1), pin(0, 2), pin(0, 3), sip0, mask);
+                }
+            } else if (mode == 4) {
+                auto deintf = [](float src1, float src3, float src4, float src5, float src7, uint8_t flag, uint8_t mask) {
+                    return ((flag & mask) == 0) ? (src3 + src5) * 0.5625f - (src1 + src7) * 0.0625f : src4;
+                };
+                if (shift) {
+                    pout = (!latter_field) ? deintf(pin(1, 1), pin(1, 3), pin(0, 4), pin(1, 5), pin(1, 7), sip0, 0x06) : pin(1, 4);
+                } else {
+                    pout = (latter_field) ? deintf(pin(0, 1), pin(0, 3), pin(0, 4), pin(0, 5), pin(0, 7), sip0, 0x05) : pin(0, 4);
+                }
+            }
+            line422[iy] = pout;
+        }
+        //YUV422->YUV420
+        for (int y = 0; y < dst->height; y++) {
+            const int sy = (y << 1) - (y & 1);
+            const float t = (y & 1) ? 0.75f : 0.25f;
+            const float v = (1.0f - t) * line422[sy] + t * line422[std::min(sy + 2, height)];
+            plane_line<Type>(dst, y)[x] = (Type)(v * maxval + 0.5f);
+        }
+    }
+}
+
+enum {
+    TUNE_COLOR_BLACK = 0,
+    TUNE_COLOR_GREY,
+    TUNE_COLOR_BLUE,
+    TUNE_COLOR_LIGHT_BLUE,
+};
+
+static int synthesize_mode_tune_select_color(const uint8_t sip, const uint8_t status) {
+    const uint8_t mask_deint = (status & AFS_FLAG_SHIFT0) ? 0x02 : 0x01;
+    if (!(sip & (mask_deint | 0x04)))
+        return TUNE_COLOR_LIGHT_BLUE;
+    else if (~sip & mask_deint)
+        return TUNE_COLOR_GREY;
+    else if (~sip & 0x04)
+        return TUNE_COLOR_BLUE;
+    return TUNE_COLOR_BLACK;
+}
+
+template<typename Type>
+static void synthesize_mode_tune(afsCPUFrame *dst, const afsCPUPlane *sip, const bool yuv420, const int bit_depth, uint8_t status) {
+    static const int YUY2_COLOR[4][3] = {
+        {  16,  128, 128 },
+        {  98,  128, 128 },
+        {  41,  240, 110 },
+        { 169,  166,  16 }
+    };
+    const int width = dst->y.width;
+    const int height = dst->y.height;
+    for (int y = 0; y + 1 < height; y += 2) {
+        const uint8_t *sip0 = plane_line<uint8_t>(sip, y);
+        const uint8_t *sip1 = plane_line<uint8_t>(sip, y + 1);
+        for (int x = 0; x + 1 < width; x += 2) {
+            const int c[4] = {
+                synthesize_mode_tune_select_color(sip0[x+0], status),
+                synthesize_mode_tune_select_color(sip0[x+1], status),
+                synthesize_mode_tune_select_color(sip1[x+0], status),
+                synthesize_mode_tune_select_color(sip1[x+1], status)
+            };
+            for (int i = 0; i < 4; i++) {
+                plane_line<Type>(&dst->y, y + (i >> 1))[x + (i & 1)] = (Type)(YUY2_COLOR[c[i]][0] << (bit_depth - 8));
+            }
+            if (yuv420) {
+                plane_line<Type>(&dst->u[0], y >> 1)[x >> 1] = (Type)(((YUY2_COLOR[c[0]][1] + YUY2_COLOR[c[1]][1] + YUY2_COLOR[c[2]][1] + YUY2_COLOR[c[3]][1] + 2) << (bit_depth - 8)) >> 2);
+                plane_line<Type>(&dst->v[0], y >> 1)[x >> 1] = (Type)(((YUY2_COLOR[c[0]][2] + YUY2_COLOR[c[1]][2] + YUY2_COLOR[c[2]][2] + YUY2_COLOR[c[3]][2] + 2) << (bit_depth - 8)) >> 2);
+            } else {
+                for (int i = 0; i < 4; i++) {
+                    plane_line<Type>(&dst->u[0], y + (i >> 1))[x + (i & 1)] = (Type)(YUY2_COLOR[c[i]][1] << (bit_depth - 8));
+                    plane_line<Type>(&dst->v[0], y + (i >> 1))[x + (i & 1)] = (Type)(YUY2_COLOR[c[i]][2] << (bit_depth - 8));
+                }
+            }
+        }
+    }
+}
+
+void afs_cpu_synthesize(const afsCPUFunc *func, afsCPUFrame *dst,
+    const afsCPUFrame *p0, const afsCPUFrame *p1, const afsCPUPlane *sip,
+    const RGY_CSP csp, int mode, int tb_order, uint8_t status) {
+    const int bit_depth = RGY_CSP_BIT_DEPTH[csp];
+    const int pixel_size = (bit_depth > 8) ? 2 : 1;
+    const bool yuv420 = RGY_CSP_CHROMA_FORMAT[csp] == RGY_CHROMAFMT_YUV420;
+    if (mode < 0) {
+        if (pixel_size > 1) {
+            synthesize_mode_tune<uint16_t>(dst, sip, yuv420, bit_depth, status);
+        } else {
+            synthesize_mode_tune<uint8_t>(dst, sip, yuv420, bit_depth, status);
+        }
+    } else if (mode == 0) {
+        const int width = p0->y.width;
+        const int height = p0->y.height;
+        for (int y = 0; y < height; y++) {
+            const afsCPUFrame *src = (is_latter_field(y, tb_order) && (status & AFS_FLAG_SHIFT0)) ? p1 : p0;
+            memcpy(plane_line<uint8_t>(&dst->y, y), plane_line<uint8_t>(&src->y, y), width * pixel_size);
+            if (!yuv420) {
+                memcpy(plane_line<uint8_t>(&dst->u[0], y), plane_line<uint8_t>(&src->u[0], y), width * pixel_size);
+                memcpy(plane_line<uint8_t>(&dst->v[0], y), plane_line<uint8_t>(&src->v[0], y), width * pixel_size);
+            }
+        }
+        if (yuv420) {
+            //OpenCL版と同様、色差はフィールド0の色差プレーンからコピーする
+            for (int y = 0; y < dst->u[0].height; y++) {
+                const afsCPUFrame *src = (is_latter_field(y, tb_order) && (status & AFS_FLAG_SHIFT0)) ? p1 : p0;
+                memcpy(plane_line<uint8_t>(&dst->u[0], y), plane_line<uint8_t>(&src->u[0], y >> 1), dst->u[0].width * pixel_size);
+                memcpy(plane_line<uint8_t>(&dst->v[0], y), plane_line<uint8_t>(&src->v[0], y >> 1), dst->v[0].width * pixel_size);
+            }
+        }
+    } else {
+        synthesize_plane(func, &dst->y, &p0->y, &p1->y, sip, pixel_size, mode, tb_order, status);
+        if (yuv420) {
+            if (pixel_size > 1) {
+                synthesize_plane_yuv420<uint16_t>(&dst->u[0], p0->u, p1->u, sip, mode, tb_order, status);
+                synthesize_plane_yuv420<uint16_t>(&dst->v[0], p0->v, p1->v, sip, mode, tb_order, status);
+            } else {
+                synthesize_plane_yuv420<uint8_t>(&dst->u[0], p0->u, p1->u, sip, mode, tb_order, status);
+                synthesize_plane_yuv420<uint8_t>(&dst->v[0], p0->v, p1->v, sip, mode, tb_order, status);
+            }
+        } else {
+            synthesize_plane(func, &dst->u[0], &p0->u[0], &p1->u[0], sip, pixel_size, mode, tb_order, status);
+            synthesize_plane(func, &dst->v[0], &p0->v[0], &p1->v[0], sip, pixel_size, mode, tb_order, status);
+        }
+    }
+}
+
+int afs_cpu_compare_plane(const afsCPUPlane *a, const afsCPUPlane *b, int pixel_size, int tolerance) {
+    int diff_count = 0;
+    for (int y = 0; y < a->height; y++) {
+        for (int x = 0; x < a->width; x++) {
+            const int va = (pixel_size > 1) ? plane_line<uint16_t>(a, y)[x] : plane_line<uint8_t>(a, y)[x];
+            const int vb = (pixel_size > 1) ? plane_line<uint16_t>(b, y)[x] : plane_line<uint8_t>(b, y)[x];
+            if (std::abs(va - vb) > tolerance) {
+                diff_count++;
+            }
+        }
+    }
+    return diff_count;
+}
@@ -0,0 +1,130 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __VCE_FILTER_AFS_CPU_H__
+#define __VCE_FILTER_AFS_CPU_H__
+
+#include <cstdint>
+#include "convert_csp.h"
+
+//afsのCPU版の実装
+//OpenCL版(vce_filter_afs_*.cl)と同じ結果を返すことを目的とし、
+//CPUでのafsの実行と、OpenCL版の結果の検証に使用する
+//ただし、YUV420の色差はOpenCL版ではテクスチャの線形補間と浮動小数点演算を使用するため、
+//ハードウェアの演算精度によってはわずかに結果が異なる場合がある
+
+//YC48基準のしきい値を、analyzeで使用するyuvのしきい値にスケーリングしたもの
+struct AFS_ANALYZE_THRE {
+    int shift, deint, Ymotion, Cmotion; //bit_depthの画素値単位
+    float shiftf, deintf, Cmotionf;     //正規化した画素値単位 (YUV420の色差用)
+};
+
+AFS_ANALYZE_THRE afs_analyze_thre(int thre_shift, int thre_deint, int thre_Ymotion, int thre_Cmotion, int bit_depth);
+
+//CPU版afsで扱うプレーン
+struct afsCPUPlane {
+    uint8_t *ptr;
+    int pitch;
+    int width;
+    int height;
+};
+
+//CPU版afsで扱うフレーム
+//YUV420: y=Y, u[0],u[1],v[0],v[1]=フィールド分離した色差 (afsSourceCacheFrameと同じ形式)
+//YUV444, 合成結果の出力先: y=Y, u[0]=U, v[0]=V
+struct afsCPUFrame {
+    afsCPUPlane y;
+    afsCPUPlane u[2];
+    afsCPUPlane v[2];
+};
+
+//CPU版analyze/merge_scanのパラメータ
+struct afsCPUParam {
+    int tb_order;
+    int clip_top, clip_bottom, clip_left, clip_right;
+    AFS_ANALYZE_THRE thre;
+};
+
+//1行分の処理を行う関数 (SIMD版で置き換える単位)
+struct afsCPUFunc {
+    //1行分の動き・縞の判定 (整数の画素値、[0]=8bit, [1]=16bit)
+    //src0m = nullptr のとき(先頭行)は動きのみ判定する
+    //shiftA, shiftB: フィールドシフトした場合に隣接する2行
+    void (*analyze_row[2])(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB,
+        int width, int thre_motion, int thre_deint, int thre_shift);
+    //Y/U/Vの4行分の判定結果(flag[plane][0-3] = r-3 ～ r行目)から、r行目のマスクを生成する
+    void (*analyze_mask_row)(uint8_t *mask0, uint8_t *mask1, const uint8_t *const flag[3][4], int width);
+    //4行分のmask0(y ～ y+3行目)とy+4行目のmask1から、y行目の判定結果を出力し、[scan_x0, scan_x1)の動きのない画素数を返す
+    int (*analyze_output_row)(uint8_t *dst, const uint8_t *const mask0[4], const uint8_t *mask1, int width, int scan_x0, int scan_x1);
+    //前後のフレームの判定結果(m:前の行, c:現在の行, p:次の行)から縞の判定結果を出力し、
+    //[scan_x0, scan_x1)の (判定結果 & count_mask) == 0 となる画素数を返す
+    int (*merge_scan_row)(uint8_t *dst, const uint8_t *p0m, const uint8_t *p0c, const uint8_t *p0p,
+        const uint8_t *p1m, const uint8_t *p1c, const uint8_t *p1p, int width, uint8_t count_mask, int scan_x0, int scan_x1);
+    //1行分の合成 (mode 1-4, [0]=8bit, [1]=16bit)
+    //src0, src1: 1-7ライン目 (mode 4以外は1-3ライン目のみ使用)
+    void (*synthesize_row[2])(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip,
+        int width, int mode, bool shift, bool latter_field);
+};
+
+//使用可能なSIMDに応じた関数を返す
+const afsCPUFunc *get_afs_cpu_func(bool use_simd);
+
+//analyze_stripeのCPU版
+void afs_cpu_analyze(const afsCPUFunc *func, afsCPUPlane *dst, int motion_count[2],
+    const afsCPUFrame *p0, const afsCPUFrame *p1, const RGY_CSP csp, const afsCPUParam *prm);
+
+//merge_scanのCPU版
+void afs_cpu_merge_scan(const afsCPUFunc *func, afsCPUPlane *dst, int stripe_count[2],
+    const afsCPUPlane *sp0, const afsCPUPlane *sp1, const afsCPUParam *prm);
+
+//synthesizeのCPU版 (mode = -1 は調整モード)
+void afs_cpu_synthesize(const afsCPUFunc *func, afsCPUFrame *dst,
+    const afsCPUFrame *p0, const afsCPUFrame *p1, const afsCPUPlane *sip,
+    const RGY_CSP csp, int mode, int tb_order, uint8_t status);
+
+//2つのプレーンを比較し、異なる画素の数を返す (tolerance: 許容する画素値の差)
+int afs_cpu_compare_plane(const afsCPUPlane *a, const afsCPUPlane *b, int pixel_size, int tolerance);
+
+void afs_analyze_row_c_u8(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift);
+void afs_analyze_row_c_u16(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift);
+void afs_analyze_mask_row_c(uint8_t *mask0, uint8_t *mask1, const uint8_t *const flag[3][4], int width);
+int afs_analyze_output_row_c(uint8_t *dst, const uint8_t *const mask0[4], const uint8_t *mask1, int width, int scan_x0, int scan_x1);
+int afs_merge_scan_row_c(uint8_t *dst, const uint8_t *p0m, const uint8_t *p0c, const uint8_t *p0p, const uint8_t *p1m, const uint8_t *p1c, const uint8_t *p1p, int width, uint8_t count_mask, int scan_x0, int scan_x1);
+void afs_synthesize_row_c_u8(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field);
+void afs_synthesize_row_c_u16(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field);
+
+void afs_analyze_row_avx2_u8(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift);
+void afs_analyze_row_avx2_u16(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift);
+void afs_analyze_mask_row_avx2(uint8_t *mask0, uint8_t *mask1, const uint8_t *const flag[3][4], int width);
+int afs_analyze_output_row_avx2(uint8_t *dst, const uint8_t *const mask0[4], const uint8_t *mask1, int width, int scan_x0, int scan_x1);
+int afs_merge_scan_row_avx2(uint8_t *dst, const uint8_t *p0m, const uint8_t *p0c, const uint8_t *p0p, const uint8_t *p1m, const uint8_t *p1c, const uint8_t *p1p, int width, uint8_t count_mask, int scan_x0, int scan_x1);
+void afs_synthesize_row_avx2_u8(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field);
+void afs_synthesize_row_avx2_u16(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field);
+
+#endif //__VCE_FILTER_AFS_CPU_H__
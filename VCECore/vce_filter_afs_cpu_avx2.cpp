@@ -0,0 +1,400 @@
+﻿// -----------------------------------------------------------------------------------------
+// NVEnc by rigaya
+// -----------------------------------------------------------------------------------------
+//
+// The MIT License
+//
+// Copyright (c) 2014-2016 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// ------------------------------------------------------------------------------------------
+
+#define USE_SSE2  1
+#define USE_SSSE3 1
+#define USE_SSE41 1
+#define USE_AVX   1
+#define USE_AVX2  1
+
+#include <immintrin.h>
+#include "rgy_simd.h"
+#include "vce_filter_afs_cpu.h"
+
+#if _MSC_VER >= 1800 && !defined(__AVX__) && !defined(_DEBUG)
+static_assert(false, "do not forget to set /arch:AVX or /arch:AVX2 for this file.");
+#endif
+
+#if defined(_MSC_VER) || defined(__AVX2__)
+
+//      7       6         5        4        3        2        1       0
+// | motion  |         non-shift        | motion  |          shift          |
+// |  shift  |  sign  |  shift |  deint |  flag   | sign  |  shift |  deint |
+
+//a > b (unsigned 8bit)
+static RGY_FORCEINLINE __m256i cmpgt_epu8(__m256i a, __m256i b) {
+    return _mm256_andnot_si256(_mm256_cmpeq_epi8(_mm256_max_epu8(b, a), b), _mm256_set1_epi8(-1));
+}
+//a >= b (unsigned 8bit)
+static RGY_FORCEINLINE __m256i cmpge_epu8(__m256i a, __m256i b) {
+    return _mm256_cmpeq_epi8(_mm256_max_epu8(a, b), a);
+}
+//a > b (unsigned 16bit)
+static RGY_FORCEINLINE __m256i cmpgt_epu16(__m256i a, __m256i b) {
+    return _mm256_andnot_si256(_mm256_cmpeq_epi16(_mm256_max_epu16(b, a), b), _mm256_set1_epi8(-1));
+}
+//a >= b (unsigned 16bit)
+static RGY_FORCEINLINE __m256i cmpge_epu16(__m256i a, __m256i b) {
+    return _mm256_cmpeq_epi16(_mm256_max_epu16(a, b), a);
+}
+static RGY_FORCEINLINE __m256i absdiff_epu8(__m256i a, __m256i b) {
+    return _mm256_or_si256(_mm256_subs_epu8(a, b), _mm256_subs_epu8(b, a));
+}
+static RGY_FORCEINLINE __m256i absdiff_epu16(__m256i a, __m256i b) {
+    return _mm256_or_si256(_mm256_subs_epu16(a, b), _mm256_subs_epu16(b, a));
+}
+//16bitのマスク2つを8bitのマスクにまとめる
+static RGY_FORCEINLINE __m256i pack_mask_epi16(__m256i a, __m256i b) {
+    return _mm256_permute4x64_epi64(_mm256_packs_epi16(a, b), _MM_SHUFFLE(3, 1, 2, 0));
+}
+
+void afs_analyze_row_avx2_u8(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift) {
+    const uint8_t *p0 = (const uint8_t *)src0;
+    const uint8_t *p1 = (const uint8_t *)src1;
+    const uint8_t *p0m = (const uint8_t *)src0m;
+    const uint8_t *pA = (const uint8_t *)shiftA;
+    const uint8_t *pB = (const uint8_t *)shiftB;
+    const __m256i yThreMotion = _mm256_set1_epi8((char)thre_motion);
+    const __m256i yThreDeint  = _mm256_set1_epi8((char)thre_deint);
+    const __m256i yThreShift  = _mm256_set1_epi8((char)thre_shift);
+    const int width32 = width & ~31;
+    for (int x = 0; x < width32; x += 32) {
+        const __m256i y0 = _mm256_loadu_si256((const __m256i *)(p0 + x));
+        const __m256i y1 = _mm256_loadu_si256((const __m256i *)(p1 + x));
+        //motion
+        __m256i yAbs = absdiff_epu8(y0, y1);
+        __m256i yFlag = _mm256_or_si256(
+            _mm256_and_si256(cmpgt_epu8(yThreMotion, yAbs), _mm256_set1_epi8(0x08)),
+            _mm256_and_si256(cmpgt_epu8(yThreShift,  yAbs), _mm256_set1_epi8((char)0x80)));
+        if (p0m) {
+            //non-shift
+            const __m256i y0m = _mm256_loadu_si256((const __m256i *)(p0m + x));
+            yAbs = absdiff_epu8(y0, y0m);
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(cmpge_epu8(y0, y0m),         _mm256_set1_epi8(0x40)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(cmpgt_epu8(yAbs, yThreDeint), _mm256_set1_epi8(0x10)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(cmpgt_epu8(yAbs, yThreShift), _mm256_set1_epi8(0x20)));
+            //shift
+            const __m256i yA = _mm256_loadu_si256((const __m256i *)(pA + x));
+            const __m256i yB = _mm256_loadu_si256((const __m256i *)(pB + x));
+            yAbs = absdiff_epu8(yA, yB);
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(cmpge_epu8(yA, yB),           _mm256_set1_epi8(0x04)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(cmpgt_epu8(yAbs, yThreDeint), _mm256_set1_epi8(0x01)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(cmpgt_epu8(yAbs, yThreShift), _mm256_set1_epi8(0x02)));
+        }
+        _mm256_storeu_si256((__m256i *)(dst + x), yFlag);
+    }
+    if (width32 < width) {
+        afs_analyze_row_c_u8(dst + width32, p0 + width32, p1 + width32,
+            (p0m) ? p0m + width32 : nullptr, (pA) ? pA + width32 : nullptr, (pB) ? pB + width32 : nullptr,
+            width - width32, thre_motion, thre_deint, thre_shift);
+    }
+}
+
+void afs_analyze_row_avx2_u16(uint8_t *dst, const void *src0, const void *src1, const void *src0m, const void *shiftA, const void *shiftB, int width, int thre_motion, int thre_deint, int thre_shift) {
+    const uint16_t *p0 = (const uint16_t *)src0;
+    const uint16_t *p1 = (const uint16_t *)src1;
+    const uint16_t *p0m = (const uint16_t *)src0m;
+    const uint16_t *pA = (const uint16_t *)shiftA;
+    const uint16_t *pB = (const uint16_t *)shiftB;
+    const __m256i yThreMotion = _mm256_set1_epi16((short)thre_motion);
+    const __m256i yThreDeint  = _mm256_set1_epi16((short)thre_deint);
+    const __m256i yThreShift  = _mm256_set1_epi16((short)thre_shift);
+    const int width32 = width & ~31;
+    for (int x = 0; x < width32; x += 32) {
+        //16pixelずつ判定して、8bitのマスクにまとめる
+        __m256i yMask[7][2];
+        for (int i = 0; i < 2; i++) {
+            const __m256i y0 = _mm256_loadu_si256((const __m256i *)(p0 + x + i * 16));
+            const __m256i y1 = _mm256_loadu_si256((const __m256i *)(p1 + x + i * 16));
+            __m256i yAbs = absdiff_epu16(y0, y1);
+            yMask[0][i] = cmpgt_epu16(yThreMotion, yAbs);
+            yMask[1][i] = cmpgt_epu16(yThreShift,  yAbs);
+            if (p0m) {
+                const __m256i y0m = _mm256_loadu_si256((const __m256i *)(p0m + x + i * 16));
+                yAbs = absdiff_epu16(y0, y0m);
+                yMask[2][i] = cmpge_epu16(y0, y0m);
+                yMask[3][i] = cmpgt_epu16(yAbs, yThreDeint);
+                yMask[4][i] = cmpgt_epu16(yAbs, yThreShift);
+                const __m256i yA = _mm256_loadu_si256((const __m256i *)(pA + x + i * 16));
+                const __m256i yB = _mm256_loadu_si256((const __m256i *)(pB + x + i * 16));
+                yAbs = absdiff_epu16(yA, yB);
+                yMask[5][i] = cmpge_epu16(yA, yB);
+                yMask[6][i] = _mm256_or_si256(
+                    _mm256_and_si256(cmpgt_epu16(yAbs, yThreDeint), _mm256_set1_epi16(0x01)),
+                    _mm256_and_si256(cmpgt_epu16(yAbs, yThreShift), _mm256_set1_epi16(0x02)));
+            }
+        }
+        __m256i yFlag = _mm256_or_si256(
+            _mm256_and_si256(pack_mask_epi16(yMask[0][0], yMask[0][1]), _mm256_set1_epi8(0x08)),
+            _mm256_and_si256(pack_mask_epi16(yMask[1][0], yMask[1][1]), _mm256_set1_epi8((char)0x80)));
+        if (p0m) {
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(pack_mask_epi16(yMask[2][0], yMask[2][1]), _mm256_set1_epi8(0x40)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(pack_mask_epi16(yMask[3][0], yMask[3][1]), _mm256_set1_epi8(0x10)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(pack_mask_epi16(yMask[4][0], yMask[4][1]), _mm256_set1_epi8(0x20)));
+            yFlag = _mm256_or_si256(yFlag, _mm256_and_si256(pack_mask_epi16(yMask[5][0], yMask[5][1]), _mm256_set1_epi8(0x04)));
+            yFlag = _mm256_or_si256(yFlag, pack_mask_epi16(yMask[6][0], yMask[6][1])); //0x01, 0x02は飽和しない
+        }
+        _mm256_storeu_si256((__m256i *)(dst + x), yFlag);
+    }
+    if (width32 < width) {
+        afs_analyze_row_c_u16(dst + width32, p0 + width32, p1 + width32,
+            (p0m) ? p0m + width32 : nullptr, (pA) ? pA + width32 : nullptr, (pB) ? pB + width32 : nullptr,
+            width - width32, thre_motion, thre_deint, thre_shift);
+    }
+}
+
+//8bit単位でのシフト (シフトで隣のバイトにはみ出すビットがないことを前提とする)
+#define srli_epi8(x, n) _mm256_srli_epi16((x), (n))
+#define slli_epi8(x, n) _mm256_slli_epi16((x), (n))
+
+static RGY_FORCEINLINE __m256i generate_flags(__m256i f0, __m256i f1, __m256i f2, __m256i f3) {
+    const __m256i y44 = _mm256_set1_epi8(0x44); //sign
+    const __m256i y11 = _mm256_set1_epi8(0x11); //deint
+    const __m256i y22 = _mm256_set1_epi8(0x22); //shift
+    __m256i count_shift = _mm256_and_si256(f0, y22);
+    //count_flags_skip(f1, f0)
+    __m256i mask = srli_epi8(_mm256_and_si256(_mm256_xor_si256(f1, f0), y44), 1);
+    count_shift = _mm256_and_si256(count_shift, mask);
+    __m256i count_deint = _mm256_and_si256(f1, y11);
+    count_shift = _mm256_add_epi8(count_shift, _mm256_and_si256(f1, y22));
+    //count_flags(f2, f1), count_flags(f3, f2)
+    const __m256i dat[3] = { f1, f2, f3 };
+    for (int i = 1; i < 3; i++) {
+        mask = _mm256_and_si256(_mm256_xor_si256(dat[i], dat[i-1]), y44);
+        mask = _mm256_or_si256(mask, slli_epi8(mask, 1));
+        mask = _mm256_or_si256(mask, srli_epi8(mask, 2));
+        count_deint = _mm256_add_epi8(_mm256_and_si256(count_deint, mask), _mm256_and_si256(dat[i], y11));
+        count_shift = _mm256_add_epi8(_mm256_and_si256(count_shift, mask), _mm256_and_si256(dat[i], y22));
+    }
+    __m256i flag = srli_epi8(_mm256_and_si256(f3, _mm256_set1_epi8((char)0x88)), 1);
+    flag = _mm256_or_si256(flag, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_and_si256(count_deint, _mm256_set1_epi8(0x70)), _mm256_set1_epi8(2 << 4)), _mm256_set1_epi8(0x01)));
+    flag = _mm256_or_si256(flag, _mm256_and_si256(cmpgt_epu8(_mm256_and_si256(count_shift, _mm256_set1_epi8((char)0xE0)), _mm256_set1_epi8(3 << 5)), _mm256_set1_epi8(0x10)));
+    flag = _mm256_or_si256(flag, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_and_si256(count_deint, _mm256_set1_epi8(0x07)), _mm256_set1_epi8(2 << 0)), _mm256_set1_epi8(0x02)));
+    flag = _mm256_or_si256(flag, _mm256_and_si256(_mm256_cmpgt_epi8(_mm256_and_si256(count_shift, _mm256_set1_epi8(0x0E)), _mm256_set1_epi8(3 << 1)), _mm256_set1_epi8(0x20)));
+    return flag;
+}
+
+#undef srli_epi8
+#undef slli_epi8
+
+void afs_analyze_mask_row_avx2(uint8_t *mask0, uint8_t *mask1, const uint8_t *const flag[3][4], int width) {
+    const int width32 = width & ~31;
+    for (int x = 0; x < width32; x += 32) {
+        __m256i yMask[3];
+        for (int i = 0; i < 3; i++) {
+            yMask[i] = generate_flags(
+                _mm256_loadu_si256((const __m256i *)(flag[i][0] + x)),
+                _mm256_loadu_si256((const __m256i *)(flag[i][1] + x)),
+                _mm256_loadu_si256((const __m256i *)(flag[i][2] + x)),
+                _mm256_loadu_si256((const __m256i *)(flag[i][3] + x)));
+        }
+        const __m256i yMask1 = _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(yMask[0], yMask[1]), yMask[2]), _mm256_set1_epi8(0x33));
+        const __m256i yMask0 = _mm256_and_si256(_mm256_and_si256(_mm256_and_si256(yMask[0], yMask[1]), yMask[2]), _mm256_set1_epi8((char)0xcc));
+        _mm256_storeu_si256((__m256i *)(mask0 + x), _mm256_or_si256(yMask0, yMask1));
+        _mm256_storeu_si256((__m256i *)(mask1 + x), yMask1);
+    }
+    if (width32 < width) {
+        const uint8_t *flag_remain[3][4];
+        for (int i = 0; i < 3; i++) {
+            for (int j = 0; j < 4; j++) {
+                flag_remain[i][j] = flag[i][j] + width32;
+            }
+        }
+        afs_analyze_mask_row_c(mask0 + width32, mask1 + width32, flag_remain, width - width32);
+    }
+}
+
+//[x, x+32)のうち、[scan_x0, scan_x1)の範囲で、yZeroが立っているバイトの数を数える
+static RGY_FORCEINLINE int count_zero_in_range(__m256i yZero, int x, int scan_x0, int scan_x1) {
+    uint32_t bits = (uint32_t)_mm256_movemask_epi8(yZero);
+    if (x < scan_x0) {
+        bits &= (scan_x0 - x >= 32) ? 0 : (0xffffffffu << (scan_x0 - x));
+    }
+    if (scan_x1 < x + 32) {
+        bits &= (scan_x1 <= x) ? 0 : (0xffffffffu >> (x + 32 - scan_x1));
+    }
+    return _mm_popcnt_u32(bits);
+}
+
+int afs_analyze_output_row_avx2(uint8_t *dst, const uint8_t *const mask0[4], const uint8_t *mask1, int width, int scan_x0, int scan_x1) {
+    const int width32 = width & ~31;
+    int count = 0;
+    for (int x = 0; x < width32; x += 32) {
+        const __m256i yMask4 = _mm256_or_si256(_mm256_or_si256(
+            _mm256_loadu_si256((const __m256i *)(mask0[1] + x)),
+            _mm256_loadu_si256((const __m256i *)(mask0[2] + x))),
+            _mm256_loadu_si256((const __m256i *)(mask0[3] + x)));
+        const __m256i yOut = _mm256_or_si256(_mm256_or_si256(
+            _mm256_and_si256(_mm256_loadu_si256((const __m256i *)(mask1 + x)), _mm256_set1_epi8(0x30)),
+            _mm256_and_si256(yMask4, _mm256_set1_epi8(0x33))),
+            _mm256_loadu_si256((const __m256i *)(mask0[0] + x)));
+        _mm256_storeu_si256((__m256i *)(dst + x), yOut);
+        if (x + 32 > scan_x0 && x < scan_x1) {
+            const __m256i yZero = _mm256_cmpeq_epi8(_mm256_and_si256(yOut, _mm256_set1_epi8(0x40)), _mm256_setzero_si256());
+            count += count_zero_in_range(yZero, x, scan_x0, scan_x1);
+        }
+    }
+    if (width32 < width) {
+        const uint8_t *mask0_remain[4] = { mask0[0] + width32, mask0[1] + width32, mask0[2] + width32, mask0[3] + width32 };
+        count += afs_analyze_output_row_c(dst + width32, mask0_remain, mask1 + width32, width - width32, scan_x0 - width32, scan_x1 - width32);
+    }
+    return count;
+}
+
+int afs_merge_scan_row_avx2(uint8_t *dst, const uint8_t *p0m, const uint8_t *p0c, const uint8_t *p0p, const uint8_t *p1m, const uint8_t *p1c, const uint8_t *p1p, int width, uint8_t count_mask, int scan_x0, int scan_x1) {
+    const int width32 = width & ~31;
+    const __m256i yF3 = _mm256_set1_epi8((char)0xf3);
+    const __m256i yCountMask = _mm256_set1_epi8((char)count_mask);
+    int count = 0;
+    for (int x = 0; x < width32; x += 32) {
+        const __m256i y0c = _mm256_loadu_si256((const __m256i *)(p0c + x));
+        const __m256i y1c = _mm256_loadu_si256((const __m256i *)(p1c + x));
+        const __m256i yM4 = _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256((const __m256i *)(p0m + x)), _mm256_loadu_si256((const __m256i *)(p0p + x))), yF3), y0c);
+        const __m256i yM5 = _mm256_and_si256(_mm256_or_si256(_mm256_or_si256(_mm256_loadu_si256((const __m256i *)(p1m + x)), _mm256_loadu_si256((const __m256i *)(p1p + x))), yF3), y1c);
+        const __m256i yM6 = _mm256_or_si256(
+            _mm256_and_si256(_mm256_and_si256(yM4, yM5), _mm256_set1_epi8(0x44)),
+            _mm256_andnot_si256(y0c, _mm256_set1_epi8(0x33)));
+        _mm256_storeu_si256((__m256i *)(dst + x), yM6);
+        if (x + 32 > scan_x0 && x < scan_x1) {
+            const __m256i yZero = _mm256_cmpeq_epi8(_mm256_and_si256(yM6, yCountMask), _mm256_setzero_si256());
+            count += count_zero_in_range(yZero, x, scan_x0, scan_x1);
+        }
+    }
+    if (width32 < width) {
+        count += afs_merge_scan_row_c(dst + width32, p0m + width32, p0c + width32, p0p + width32, p1m + width32, p1c + width32, p1p + width32,
+            width - width32, count_mask, scan_x0 - width32, scan_x1 - width32);
+    }
+    return count;
+}
+
+//合成処理は32bit整数で演算する (16bitの場合に4画素の和がオーバーフローしないように)
+//Type=uint8_t/uint16_tともに、1回に8pixel処理する
+template<typename Type>
+static RGY_FORCEINLINE __m256i load_epi32(const void *ptr, int x) {
+    if (sizeof(Type) == 1) {
+        return _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)((const uint8_t *)ptr + x)));
+    } else {
+        return _mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i *)((const uint16_t *)ptr + x)));
+    }
+}
+
+template<typename Type>
+static RGY_FORCEINLINE void store_epi32(void *ptr, int x, __m256i y) {
+    //OpenCL版と同様、範囲外の値は丸めずに下位ビットをとる
+    y = _mm256_and_si256(y, _mm256_set1_epi32((1 << (8 * sizeof(Type))) - 1));
+    __m128i x0 = _mm_packus_epi32(_mm256_castsi256_si128(y), _mm256_extracti128_si256(y, 1));
+    if (sizeof(Type) == 1) {
+        _mm_storel_epi64((__m128i *)((uint8_t *)ptr + x), _mm_packus_epi16(x0, x0));
+    } else {
+        _mm_storeu_si128((__m128i *)((uint16_t *)ptr + x), x0);
+    }
+}
+
+static RGY_FORCEINLINE __m256i mie_inter(__m256i src1, __m256i src2, __m256i src3, __m256i src4) {
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(src1, src2), _mm256_add_epi32(src3, src4)), _mm256_set1_epi32(2)), 2);
+}
+
+static RGY_FORCEINLINE __m256i mie_spot(__m256i src1, __m256i src2, __m256i src3, __m256i src4, __m256i src_spot) {
+    return _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(mie_inter(src1, src2, src3, src4), src_spot), _mm256_set1_epi32(1)), 1);
+}
+
+//(flag & mask) == 0 ? a_if_0 : b_if_1
+static RGY_FORCEINLINE __m256i select_flag(__m256i a_if_0, __m256i b_if_1, __m256i yFlag, int mask) {
+    const __m256i yIsZero = _mm256_cmpeq_epi32(_mm256_and_si256(yFlag, _mm256_set1_epi32(mask)), _mm256_setzero_si256());
+    return _mm256_blendv_epi8(b_if_1, a_if_0, yIsZero);
+}
+
+static RGY_FORCEINLINE __m256i blend(__m256i src1, __m256i src2, __m256i src3, __m256i yFlag, int mask) {
+    const __m256i tmp = _mm256_srai_epi32(_mm256_add_epi32(_mm256_add_epi32(_mm256_add_epi32(src1, src3), _mm256_add_epi32(src2, src2)), _mm256_set1_epi32(2)), 2);
+    return select_flag(tmp, src2, yFlag, mask);
+}
+
+static RGY_FORCEINLINE __m256i deint(__m256i src1, __m256i src3, __m256i src4, __m256i src5, __m256i src7, __m256i yFlag, int mask) {
+    const __m256i tmp2 = _mm256_add_epi32(src1, src7);
+    const __m256i tmp3 = _mm256_add_epi32(src3, src5);
+    const __m256i tmp = _mm256_srai_epi32(_mm256_add_epi32(_mm256_sub_epi32(tmp3, _mm256_srai_epi32(_mm256_sub_epi32(tmp2, tmp3), 3)), _mm256_set1_epi32(1)), 1);
+    return select_flag(tmp, src4, yFlag, mask);
+}
+
+template<typename Type>
+static void afs_synthesize_row_avx2(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field) {
+    const int width8 = width & ~7;
+    for (int x = 0; x < width8; x += 8) {
+#define pin(plane, line) load_epi32<Type>(((plane) ? src1 : src0)[(line)-1], x)
+        const __m256i yFlag = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i *)(sip + x)));
+        __m256i yOut = _mm256_setzero_si256();
+        if (mode == 1) {
+            if (shift) {
+                yOut = (!latter_field) ? mie_inter(pin(0, 2), pin(1, 1), pin(1, 2), pin(1, 3))
+                                       : mie_spot(pin(0, 1), pin(0, 3), pin(1, 1), pin(1, 3), pin(1, 2));
+            } else {
+                yOut = (latter_field) ? mie_inter(pin(0, 1), pin(0, 2), pin(0, 3), pin(1, 2))
+                                      : mie_spot(pin(0, 1), pin(0, 3), pin(1, 1), pin(1, 3), pin(0, 2));
+            }
+        } else if (mode == 2 || mode == 3) {
+            if (shift) {
+                const int mask = (mode == 2) ? 0x02 : 0x06;
+                yOut = (!latter_field) ? blend(pin(1, 1), pin(0, 2), pin(1, 3), yFlag, mask)
+                                       : blend(pin(0, 1), pin(1, 2), pin(0, 3), yFlag, mask);
+            } else {
+                const int mask = (mode == 2) ? 0x01 : 0x05;
+                yOut = blend(pin(0, 1), pin(0, 2), pin(0, 3), yFlag, mask);
+            }
+        } else if (mode == 4) {
+            if (shift) {
+                yOut = (!latter_field) ? deint(pin(1, 1), pin(1, 3), pin(0, 4), pin(1, 5), pin(1, 7), yFlag, 0x06) : pin(1, 4);
+            } else {
+                yOut = (latter_field) ? deint(pin(0, 1), pin(0, 3), pin(0, 4), pin(0, 5), pin(0, 7), yFlag, 0x05) : pin(0, 4);
+            }
+        }
+        store_epi32<Type>(dst, x, yOut);
+#undef pin
+    }
+    if (width8 < width) {
+        const void *src0_remain[7], *src1_remain[7];
+        for (int j = 0; j < 7; j++) {
+            src0_remain[j] = (const Type *)src0[j] + width8;
+            src1_remain[j] = (const Type *)src1[j] + width8;
+        }
+        if (sizeof(Type) == 1) {
+            afs_synthesize_row_c_u8((Type *)dst + width8, src0_remain, src1_remain, sip + width8, width - width8, mode, shift, latter_field);
+        } else {
+            afs_synthesize_row_c_u16((Type *)dst + width8, src0_remain, src1_remain, sip + width8, width - width8, mode, shift, latter_field);
+        }
+    }
+}
+
+void afs_synthesize_row_avx2_u8(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field) {
+    afs_synthesize_row_avx2<uint8_t>(dst, src0, src1, sip, width, mode, shift, latter_field);
+}
+
+void afs_synthesize_row_avx2_u16(void *dst, const void *const src0[7], const void *const src1[7], const uint8_t *sip, int width, int mode, bool shift, bool latter_field) {
+    afs_synthesize_row_avx2<uint16_t>(dst, src0, src1, sip, width, mode, shift, latter_field);
+}
+
+#endif //#if defined(_MSC_VER) || defined(__AVX2__)
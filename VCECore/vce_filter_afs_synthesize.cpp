@@ -158,10 +158,75 @@ RGY_ERR RGYFilterAfs::synthesize(int iframe, RGYCLFrame *pOut, afsSourceCacheFra
             return RGY_ERR_INVALID_COLOR_FORMAT;
         }
     }
+    if (pAfsPrm->afs.backend == VPP_AFS_BACKEND_CPU) {
+        return synthesize_cpu(iframe, pOut, p0, p1, sip, pAfsPrm, queue, mode, false);
+    }
     auto err = run_synthesize(
         pOut->frame.ptr, p0, p1, sip->map->frame.ptr[0],
         p1->frameinfo().width, p1->frameinfo().height,
         pOut->frame.pitch, sip->map->frame.pitch[0],
         pAfsPrm->afs.tb_order, m_status[iframe], pOut->frame.csp, mode, queue, m_synthesize.get(), m_cl.get());
+    if (err == RGY_ERR_NONE && pAfsPrm->afs.backend == VPP_AFS_BACKEND_VERIFY) {
+        err = synthesize_cpu(iframe, pOut, p0, p1, sip, pAfsPrm, queue, mode, true);
+    }
     return err;
 }
+
+RGY_ERR RGYFilterAfs::synthesize_cpu(int iframe, RGYCLFrame *pOut, afsSourceCacheFrame *p0, afsSourceCacheFrame *p1, AFS_STRIPE_DATA *sip, const RGYFilterParamAfs *pAfsPrm, cl_command_queue queue, int mode, bool verify) {
+    afsCPUMap mapped(queue);
+    afsCPUFrame src0, src1, dst;
+    afsCPUPlane sipPlane;
+    auto err = RGY_ERR_NONE;
+    if (   RGY_ERR_NONE != (err = mapped.map(&src0, p0, {}))
+        || RGY_ERR_NONE != (err = mapped.map(&src1, p1, {}))
+        || RGY_ERR_NONE != (err = mapped.map(&sipPlane, sip->map.get(), RGY_PLANE_Y, CL_MAP_READ))
+        || RGY_ERR_NONE != (err = mapped.map(&dst, pOut, (verify) ? CL_MAP_READ : CL_MAP_WRITE))) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to map buffer for synthesize_cpu: %s.\n"), get_err_mes(err));
+        return err;
+    }
+    if (verify) {
+        //OpenCL版の出力と比較する
+        //YUV420の色差はOpenCL版ではテクスチャの線形補間を使用するため、1の差は許容する
+        const int pixel_size = RGY_CSP_BIT_DEPTH[pOut->frame.csp] > 8 ? 2 : 1;
+        const int chroma_tolerance = (RGY_CSP_CHROMA_FORMAT[pOut->frame.csp] == RGY_CHROMAFMT_YUV420 && mode >= 1) ? 1 : 0;
+        std::array<std::vector<uint8_t>, 3> buf;
+        afsCPUFrame ref = dst;
+        afsCPUPlane *refPlanes[3] = { &ref.y, &ref.u[0], &ref.v[0] };
+        for (int i = 0; i < 3; i++) {
+            buf[i].resize(refPlanes[i]->pitch * refPlanes[i]->height);
+            refPlanes[i]->ptr = buf[i].data();
+        }
+        afs_cpu_synthesize(m_cpuFunc, &ref, &src0, &src1, &sipPlane, pOut->frame.csp, mode, pAfsPrm->afs.tb_order, m_status[iframe]);
+        const int diffY = afs_cpu_compare_plane(&dst.y,    &ref.y,    pixel_size, 0);
+        const int diffU = afs_cpu_compare_plane(&dst.u[0], &ref.u[0], pixel_size, chroma_tolerance);
+        const int diffV = afs_cpu_compare_plane(&dst.v[0], &ref.v[0], pixel_size, chroma_tolerance);
+        bool match = diffY + diffU + diffV == 0;
+        AddMessage((match) ? RGY_LOG_DEBUG : RGY_LOG_WARN, _T("verify synthesize[%6d]: diff %d, %d, %d pixels (y, u, v).\n"),
+            iframe, diffY, diffU, diffV);
+        if (m_cpuFuncRef) {
+            //SIMD版の結果をC版の結果と比較する (こちらは許容差なし)
+            std::array<std::vector<uint8_t>, 3> bufC;
+            afsCPUFrame refC = dst;
+            afsCPUPlane *refCPlanes[3] = { &refC.y, &refC.u[0], &refC.v[0] };
+            for (int i = 0; i < 3; i++) {
+                bufC[i].resize(refCPlanes[i]->pitch * refCPlanes[i]->height);
+                refCPlanes[i]->ptr = bufC[i].data();
+            }
+            afs_cpu_synthesize(m_cpuFuncRef, &refC, &src0, &src1, &sipPlane, pOut->frame.csp, mode, pAfsPrm->afs.tb_order, m_status[iframe]);
+            const int diffCY = afs_cpu_compare_plane(&ref.y,    &refC.y,    pixel_size, 0);
+            const int diffCU = afs_cpu_compare_plane(&ref.u[0], &refC.u[0], pixel_size, 0);
+            const int diffCV = afs_cpu_compare_plane(&ref.v[0], &refC.v[0], pixel_size, 0);
+            const bool matchC = diffCY + diffCU + diffCV == 0;
+            AddMessage((matchC) ? RGY_LOG_DEBUG : RGY_LOG_WARN, _T("verify synthesize[%6d]: avx2/c diff %d, %d, %d pixels (y, u, v).\n"),
+                iframe, diffCY, diffCU, diffCV);
+            match &= matchC;
+        }
+        m_backendVerified++;
+        if (!match) {
+            m_backendMismatch++;
+        }
+    } else {
+        afs_cpu_synthesize(m_cpuFunc, &dst, &src0, &src1, &sipPlane, pOut->frame.csp, mode, pAfsPrm->afs.tb_order, m_status[iframe]);
+    }
+    return mapped.unmap();
+}
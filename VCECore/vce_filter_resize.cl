@@ -2,6 +2,7 @@
 // Type
 // bit_depth
 // radius
+// IMAGE_DST
 
 #ifndef MIN3
 #define MIN3(a,b,c) (min((a), min((b), (c))))
@@ -160,4 +161,199 @@ __kernel void kernel_resize_lanczos(
         __global Type* ptr = (__global Type*)(pDst + iy * dstPitch + ix * sizeof(Type));
         ptr[0] = (Type)clamp(clr * (float)((1<<bit_depth)-1) * native_recip(weightSum), 0.0f, (1<<bit_depth) - 0.1f);
     }
+}
+
+//以下はリサイズとpad/色空間変換をまとめて1回で行うためのカーネル
+//リサイズ部分はkernel_resize_spline/kernel_resize_lanczosと同じ順序で計算し、
+//resize -> pad -> 色空間変換を順に行った場合と同じ結果となるようにする
+
+#if IMAGE_DST
+#define RESIZE_STORE(dst, ix, iy, val) write_imageui((dst), (int2)((ix), (iy)), (uint4)(val))
+#define RESIZE_STORE_UV(dst, ix, iy, val_u, val_v) write_imageui((dst), (int2)((ix), (iy)), (uint4)((val_u), (val_v), (val_v), (val_v)))
+#else
+#define RESIZE_STORE(dst, ix, iy, val) { \
+    __global Type *ptr = (__global Type *)((dst) + (iy) * dstPitch + (ix) * sizeof(Type)); \
+    ptr[0] = (val); \
+}
+#define RESIZE_STORE_UV(dst, ix, iy, val_u, val_v) { \
+    __global Type *ptr = (__global Type *)((dst) + (iy) * dstPitch + ((ix) << 1) * sizeof(Type)); \
+    ptr[0] = (val_u); \
+    ptr[1] = (val_v); \
+}
+#endif
+
+float spline_factor(__local float *psWeight, const float d) {
+    float w = psWeight[3];
+    w += d * psWeight[2];
+    const float d2 = d * d;
+    w += d2 * psWeight[1];
+    w += d2 * d * psWeight[0];
+    return w;
+}
+
+void resize_fused_store(
+#if IMAGE_DST
+    __write_only image2d_t dst0,
+    __write_only image2d_t dst1,
+#else
+    __global uchar *restrict dst0,
+    __global uchar *restrict dst1,
+#endif
+    const int dstPitch, const int dstInterleaved, const int ox, const int oy,
+    const int nch, const Type pix0, const Type pix1) {
+    if (nch == 1) {
+        RESIZE_STORE(dst0, ox, oy, pix0);
+    } else if (dstInterleaved) {
+        RESIZE_STORE_UV(dst0, ox, oy, pix0, pix1);
+    } else {
+        RESIZE_STORE(dst0, ox, oy, pix0);
+        RESIZE_STORE(dst1, ox, oy, pix1);
+    }
+}
+
+void resize_fused_plane(
+#if IMAGE_DST
+    __write_only image2d_t dst0,
+    __write_only image2d_t dst1,
+#else
+    __global uchar *restrict dst0,
+    __global uchar *restrict dst1,
+#endif
+    const int dstPitch, const int dstInterleaved, const int ox, const int oy,
+    __read_only image2d_t src0,
+    __read_only image2d_t src1,
+    const int nch, const float x, const float y,
+    const float *pWeightX, const float *pWeightY) {
+    const sampler_t sampler = CLK_NORMALIZED_COORDS_FALSE | CLK_ADDRESS_CLAMP_TO_EDGE | CLK_FILTER_NEAREST;
+    float weightSum = 0.0f;
+    float clr0 = 0.0f;
+    float clr1 = 0.0f;
+    for (int j = 0; j < radius * 2; j++) {
+        const float sy = floor(y) + j - radius + 1.0f + 0.5f;
+        const float weightY = pWeightY[j];
+        #pragma unroll
+        for (int i = 0; i < radius * 2; i++) {
+            const float sx = floor(x) + i - radius + 1.0f + 0.5f;
+            const float weightXY = pWeightX[i] * weightY;
+            clr0 += read_imagef(src0, sampler, (int2)(sx, sy)).x * weightXY;
+            if (nch > 1) {
+                clr1 += read_imagef(src1, sampler, (int2)(sx, sy)).x * weightXY;
+            }
+            weightSum += weightXY;
+        }
+    }
+    const Type pix0 = (Type)clamp(clr0 * (float)((1<<bit_depth)-1) * native_recip(weightSum), 0.0f, (1<<bit_depth) - 0.1f);
+    const Type pix1 = (Type)clamp(clr1 * (float)((1<<bit_depth)-1) * native_recip(weightSum), 0.0f, (1<<bit_depth) - 0.1f);
+    resize_fused_store(dst0, dst1, dstPitch, dstInterleaved, ox, oy, nch, pix0, pix1);
+}
+
+//nch=1: 輝度 (src0 -> dst0)
+//nch=2: 色差 (U: src0 -> dst0, V: src1 -> dst1)
+//       dstInterleaved=1ならdst0へUVを交互に書き込む(NV12)
+//dstWidth x dstHeight のうち、(padLeft, padTop)からのinnerWidth x innerHeightにリサイズ結果を、
+//それ以外にpadColorを書き込む
+__kernel void kernel_resize_fused_spline(
+#if IMAGE_DST
+    __write_only image2d_t dst0,
+    __write_only image2d_t dst1,
+#else
+    __global uchar *restrict dst0,
+    __global uchar *restrict dst1,
+#endif
+    const int dstPitch, const int dstWidth, const int dstHeight, const int dstInterleaved,
+    const int padLeft, const int padTop, const int innerWidth, const int innerHeight, const int padColor,
+    __read_only image2d_t src0,
+    __read_only image2d_t src1,
+    const int nch,
+    const float ratioX, const float ratioY,
+    const float ratioDistX, const float ratioDistY,
+    __global const float *restrict pgFactor) {
+    const int ox = get_global_id(0);
+    const int oy = get_global_id(1);
+    const int threadIdX = get_local_id(0);
+    const int threadIdY = get_local_id(1);
+
+    //重みをsharedメモリにコピー
+    __local float psCopyFactor[radius][4];
+    if (threadIdY == 0 && threadIdX < radius * 4) {
+        ((__local float *)psCopyFactor[0])[threadIdX] = pgFactor[threadIdX];
+    }
+    barrier(CLK_LOCAL_MEM_FENCE);
+
+    if (ox < dstWidth && oy < dstHeight) {
+        const int ix = ox - padLeft;
+        const int iy = oy - padTop;
+        if (ix < 0 || innerWidth <= ix || iy < 0 || innerHeight <= iy) {
+            resize_fused_store(dst0, dst1, dstPitch, dstInterleaved, ox, oy, nch, (Type)padColor, (Type)padColor);
+            return;
+        }
+        //ピクセルの中心を算出してからスケール
+        const float x = ((float)ix + 0.5f) * ratioX;
+        const float y = ((float)iy + 0.5f) * ratioY;
+
+        float pWeightX[radius * 2];
+        float pWeightY[radius * 2];
+
+        #pragma unroll
+        for (int i = 0; i < radius * 2; i++) {
+            //+0.5fはピクセル中心とするため
+            const float sx = floor(x) + i - radius + 1.0f + 0.5f;
+            const float sy = floor(y) + i - radius + 1.0f + 0.5f;
+            //拡大ならratioDistXは1.0f、縮小ならratioの逆数(縮小側の距離に変換)
+            const float dx = fabs(sx - x) * ratioDistX;
+            const float dy = fabs(sy - y) * ratioDistY;
+            pWeightX[i] = spline_factor(psCopyFactor[min((int)dx, radius-1)], dx);
+            pWeightY[i] = spline_factor(psCopyFactor[min((int)dy, radius-1)], dy);
+        }
+        resize_fused_plane(dst0, dst1, dstPitch, dstInterleaved, ox, oy,
+            src0, src1, nch, x, y, pWeightX, pWeightY);
+    }
+}
+
+__kernel void kernel_resize_fused_lanczos(
+#if IMAGE_DST
+    __write_only image2d_t dst0,
+    __write_only image2d_t dst1,
+#else
+    __global uchar *restrict dst0,
+    __global uchar *restrict dst1,
+#endif
+    const int dstPitch, const int dstWidth, const int dstHeight, const int dstInterleaved,
+    const int padLeft, const int padTop, const int innerWidth, const int innerHeight, const int padColor,
+    __read_only image2d_t src0,
+    __read_only image2d_t src1,
+    const int nch,
+    const float ratioX, const float ratioY,
+    const float ratioDistX, const float ratioDistY) {
+    const int ox = get_global_id(0);
+    const int oy = get_global_id(1);
+
+    if (ox < dstWidth && oy < dstHeight) {
+        const int ix = ox - padLeft;
+        const int iy = oy - padTop;
+        if (ix < 0 || innerWidth <= ix || iy < 0 || innerHeight <= iy) {
+            resize_fused_store(dst0, dst1, dstPitch, dstInterleaved, ox, oy, nch, (Type)padColor, (Type)padColor);
+            return;
+        }
+        //ピクセルの中心を算出してからスケール
+        const float x = ((float)ix + 0.5f) * ratioX;
+        const float y = ((float)iy + 0.5f) * ratioY;
+
+        float pWeightX[radius * 2];
+        float pWeightY[radius * 2];
+
+        #pragma unroll
+        for (int i = 0; i < radius * 2; i++) {
+            //+0.5fはピクセル中心とするため
+            const float sx = floor(x) + i - radius + 1.0f + 0.5f;
+            const float sy = floor(y) + i - radius + 1.0f + 0.5f;
+            //拡大ならratioDistXは1.0f、縮小ならratioの逆数(縮小側の距離に変換)
+            const float dx = fabs(sx - x) * ratioDistX;
+            const float dy = fabs(sy - y) * ratioDistY;
+            pWeightX[i] = lanczos_factor(dx);
+            pWeightY[i] = lanczos_factor(dy);
+        }
+        resize_fused_plane(dst0, dst1, dstPitch, dstInterleaved, ox, oy,
+            src0, src1, nch, x, y, pWeightX, pWeightY);
+    }
 }
\ No newline at end of file
@@ -107,7 +107,196 @@ RGY_ERR RGYFilterResize::resizeFrame(FrameInfo *pOutputFrame, const FrameInfo *p
     return RGY_ERR_NONE;
 }
 
-RGYFilterResize::RGYFilterResize(shared_ptr<RGYOpenCLContext> context) : RGYFilter(context), m_bInterlacedWarn(false), m_weightSpline(), m_resize(), m_srcImage() {
+RGY_ERR RGYFilterResize::resizeFrameFused(FrameInfo *pOutputFrame, const FrameInfo *pInputFrame, RGYOpenCLQueue &queue, const std::vector<RGYOpenCLEvent> &wait_events, RGYOpenCLEvent *event) {
+    auto pResizeParam = std::dynamic_pointer_cast<RGYFilterParamResize>(m_param);
+    if (!pResizeParam) {
+        AddMessage(RGY_LOG_ERROR, _T("Invalid parameter type.\n"));
+        return RGY_ERR_INVALID_PARAM;
+    }
+    //IMAGE_DSTの設定とあっている必要がある
+    if ((pOutputFrame->mem_type == RGY_MEM_TYPE_GPU_IMAGE) != (pResizeParam->frameOut.mem_type == RGY_MEM_TYPE_GPU_IMAGE)) {
+        AddMessage(RGY_LOG_ERROR, _T("output memory type does not match.\n"));
+        return RGY_ERR_UNSUPPORTED;
+    }
+    m_srcImage = m_cl->createImageFromFrameBuffer(*pInputFrame, true, CL_MEM_READ_ONLY);
+    if (!m_srcImage || m_srcImage->frame.ptr[0] == nullptr) {
+        AddMessage(RGY_LOG_ERROR, _T("failed to create image for input frame.\n"));
+        return RGY_ERR_NULL_PTR;
+    }
+    bool useSpline = true;
+    switch (pResizeParam->interp) {
+    case RGY_VPP_RESIZE_LANCZOS2:
+    case RGY_VPP_RESIZE_LANCZOS3:
+    case RGY_VPP_RESIZE_LANCZOS4:
+        useSpline = false;
+        break;
+    default:
+        break;
+    }
+    const char *kernel_name = (useSpline) ? "kernel_resize_fused_spline" : "kernel_resize_fused_lanczos";
+    const bool dstNV12 = pOutputFrame->csp == RGY_CSP_NV12;
+    const auto &pad = pResizeParam->pad;
+    const int padLR = (pad.enable) ? pad.left + pad.right : 0;
+    const int padTB = (pad.enable) ? pad.top + pad.bottom : 0;
+    const int bitDepth = RGY_CSP_BIT_DEPTH[pResizeParam->frameIn.csp];
+    //輝度と色差(U,Vをまとめて処理)の2回に分けて処理する
+    for (int iplane = 0; iplane < 2; iplane++) {
+        const int shift = (iplane == 0) ? 0 : 1; //yuv420のみ
+        const int nch = (iplane == 0) ? 1 : 2;
+        const auto planeDst0 = getPlane(pOutputFrame,       (iplane == 0) ? RGY_PLANE_Y : ((dstNV12) ? RGY_PLANE_C : RGY_PLANE_U));
+        const auto planeDst1 = getPlane(pOutputFrame,       (iplane == 0) ? RGY_PLANE_Y : ((dstNV12) ? RGY_PLANE_C : RGY_PLANE_V));
+        const auto planeSrc0 = getPlane(&m_srcImage->frame, (iplane == 0) ? RGY_PLANE_Y : RGY_PLANE_U);
+        const auto planeSrc1 = getPlane(&m_srcImage->frame, (iplane == 0) ? RGY_PLANE_Y : RGY_PLANE_V);
+        const int dstInterleaved = (iplane > 0 && dstNV12) ? 1 : 0;
+        const int dstWidth  = pOutputFrame->width >> shift;
+        const int dstHeight = pOutputFrame->height >> shift;
+        const int padLeft   = (pad.enable) ? pad.left >> shift : 0;
+        const int padTop    = (pad.enable) ? pad.top >> shift : 0;
+        const int innerWidth  = (pOutputFrame->width - padLR) >> shift;
+        const int innerHeight = (pOutputFrame->height - padTB) >> shift;
+        const int padColor  = ((iplane == 0) ? 16 : 128) << (bitDepth - 8);
+        const int srcWidth  = pInputFrame->width >> shift;
+        const int srcHeight = pInputFrame->height >> shift;
+        const float ratioX = srcWidth / (float)(innerWidth);
+        const float ratioY = srcHeight / (float)(innerHeight);
+        const float ratioDistX = (srcWidth <= innerWidth) ? 1.0f : innerWidth / (float)(srcWidth);
+        const float ratioDistY = (srcHeight <= innerHeight) ? 1.0f : innerHeight / (float)(srcHeight);
+
+        const std::vector<RGYOpenCLEvent> &plane_wait_event = (iplane == 0) ? wait_events : std::vector<RGYOpenCLEvent>();
+        RGYOpenCLEvent *plane_event = (iplane == 1) ? event : nullptr;
+        RGYWorkSize local(32, 8);
+        RGYWorkSize global(dstWidth, dstHeight);
+        RGY_ERR err = RGY_ERR_NONE;
+        if (useSpline) {
+            err = m_resize->kernel(kernel_name).config(queue.get(), local, global, plane_wait_event, plane_event).launch(
+                (cl_mem)planeDst0.ptr[0], (cl_mem)planeDst1.ptr[0], planeDst0.pitch[0], dstWidth, dstHeight, dstInterleaved,
+                padLeft, padTop, innerWidth, innerHeight, padColor,
+                (cl_mem)planeSrc0.ptr[0], (cl_mem)planeSrc1.ptr[0],
+                nch, ratioX, ratioY, ratioDistX, ratioDistY,
+                (cl_mem)m_weightSpline->mem());
+        } else {
+            err = m_resize->kernel(kernel_name).config(queue.get(), local, global, plane_wait_event, plane_event).launch(
+                (cl_mem)planeDst0.ptr[0], (cl_mem)planeDst1.ptr[0], planeDst0.pitch[0], dstWidth, dstHeight, dstInterleaved,
+                padLeft, padTop, innerWidth, innerHeight, padColor,
+                (cl_mem)planeSrc0.ptr[0], (cl_mem)planeSrc1.ptr[0],
+                nch, ratioX, ratioY, ratioDistX, ratioDistY);
+        }
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("error at %s (resizeFrameFused(%s -> %s)): %s.\n"),
+                char_to_tstring(kernel_name).c_str(), RGY_CSP_NAMES[pInputFrame->csp], RGY_CSP_NAMES[pOutputFrame->csp], get_err_mes(err));
+            return err;
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+//まとめて処理した結果と、個別のフィルタで処理した結果をCPUに転送して比較する
+RGY_ERR RGYFilterResize::verifyFrame(const FrameInfo *pOutputFrame, const FrameInfo *pInputFrame, RGYOpenCLQueue &queue) {
+    static const int VERIFY_MAX_WARN_FRAMES = 8;
+    FrameInfo *pRefFrame = const_cast<FrameInfo *>(pInputFrame);
+    for (auto& filter : m_verifyFilters) {
+        int nOutFrames = 0;
+        FrameInfo *outInfo[1] = { nullptr };
+        auto sts = filter->filter(pRefFrame, (FrameInfo **)&outInfo, &nOutFrames, queue);
+        if (sts != RGY_ERR_NONE || nOutFrames != 1) {
+            AddMessage(RGY_LOG_ERROR, _T("error while running %s for verification: %s.\n"), filter->name().c_str(), get_err_mes(sts));
+            return (sts != RGY_ERR_NONE) ? sts : RGY_ERR_UNKNOWN;
+        }
+        pRefFrame = outInfo[0];
+    }
+    if (pRefFrame->csp != pOutputFrame->csp
+        || pRefFrame->width != pOutputFrame->width
+        || pRefFrame->height != pOutputFrame->height) {
+        AddMessage(RGY_LOG_ERROR, _T("frame info for verification does not match.\n"));
+        return RGY_ERR_INVALID_FORMAT;
+    }
+    const int pixel_size = RGY_CSP_BIT_DEPTH[pOutputFrame->csp] > 8 ? 2 : 1;
+    FrameInfo hostFrame[2];
+    const FrameInfo *devFrame[2] = { pOutputFrame, pRefFrame };
+    for (int i = 0; i < 2; i++) {
+        hostFrame[i] = *pOutputFrame;
+        hostFrame[i].mem_type = RGY_MEM_TYPE_CPU;
+        size_t frameSize = 0;
+        for (int iplane = 0; iplane < RGY_CSP_PLANES[pOutputFrame->csp]; iplane++) {
+            const auto plane = getPlane(pOutputFrame, (RGY_PLANE)iplane);
+            frameSize += (size_t)plane.width * pixel_size * plane.height;
+        }
+        m_verifyBuf[i].resize(frameSize);
+        uint8_t *ptr = m_verifyBuf[i].data();
+        for (int iplane = 0; iplane < RGY_CSP_PLANES[pOutputFrame->csp]; iplane++) {
+            const auto plane = getPlane(pOutputFrame, (RGY_PLANE)iplane);
+            hostFrame[i].ptr[iplane] = ptr;
+            hostFrame[i].pitch[iplane] = plane.width * pixel_size;
+            ptr += (size_t)plane.width * pixel_size * plane.height;
+        }
+        auto err = m_cl->copyFrame(&hostFrame[i], devFrame[i], nullptr, queue.get());
+        if (err != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("failed to copy frame for verification: %s.\n"), get_err_mes(err));
+            return err;
+        }
+    }
+    queue.finish();
+
+    m_verifyFrames++;
+    int maxDiff = 0, diffPlane = -1, diffX = 0, diffY = 0;
+    for (int iplane = 0; iplane < RGY_CSP_PLANES[pOutputFrame->csp]; iplane++) {
+        const auto plane0 = getPlane(&hostFrame[0], (RGY_PLANE)iplane);
+        const auto plane1 = getPlane(&hostFrame[1], (RGY_PLANE)iplane);
+        for (int y = 0; y < plane0.height; y++) {
+            const uint8_t *ptr0 = plane0.ptr[0] + y * plane0.pitch[0];
+            const uint8_t *ptr1 = plane1.ptr[0] + y * plane1.pitch[0];
+            for (int x = 0; x < plane0.width; x++) {
+                const int diff = (pixel_size > 1)
+                    ? std::abs((int)((const uint16_t *)ptr0)[x] - (int)((const uint16_t *)ptr1)[x])
+                    : std::abs((int)ptr0[x] - (int)ptr1[x]);
+                if (diff > maxDiff) {
+                    maxDiff = diff;
+                    diffPlane = iplane;
+                    diffX = x;
+                    diffY = y;
+                }
+            }
+        }
+    }
+    if (maxDiff > 0) {
+        m_verifyMismatchFrames++;
+        m_verifyMaxDiff = (std::max)(m_verifyMaxDiff, maxDiff);
+        if (m_verifyMismatchFrames <= VERIFY_MAX_WARN_FRAMES) {
+            AddMessage(RGY_LOG_WARN, _T("frame %d: result differs from separate filters, max diff %d at plane %d (%d, %d).\n"),
+                pInputFrame->inputFrameId, maxDiff, diffPlane, diffX, diffY);
+        }
+    }
+    return RGY_ERR_NONE;
+}
+
+void RGYFilterResize::setVerifyFilters(std::vector<unique_ptr<RGYFilter>> &&filters) {
+    m_verifyFilters = std::move(filters);
+    m_verifyFrames = 0;
+    m_verifyMismatchFrames = 0;
+    m_verifyMaxDiff = 0;
+}
+
+bool RGYFilterResize::fusable(RGY_CSP cspIn, RGY_CSP cspOut, RGY_VPP_RESIZE_ALGO interp) {
+    //bilinearはimageの線形補間を使用しており、まとめて処理するカーネルは用意していない
+    if (interp == RGY_VPP_RESIZE_BILINEAR) {
+        return false;
+    }
+    //ビット深度の変換を伴うものは対象外
+    static const auto supportedCspIn  = make_array<RGY_CSP>(RGY_CSP_YV12, RGY_CSP_YV12_09, RGY_CSP_YV12_10, RGY_CSP_YV12_12, RGY_CSP_YV12_14, RGY_CSP_YV12_16);
+    static const auto supportedCspOut = make_array<RGY_CSP>(RGY_CSP_NV12, RGY_CSP_YV12, RGY_CSP_YV12_09, RGY_CSP_YV12_10, RGY_CSP_YV12_12, RGY_CSP_YV12_14, RGY_CSP_YV12_16);
+    return std::find(supportedCspIn.begin(), supportedCspIn.end(), cspIn) != supportedCspIn.end()
+        && std::find(supportedCspOut.begin(), supportedCspOut.end(), cspOut) != supportedCspOut.end()
+        && RGY_CSP_BIT_DEPTH[cspIn] == RGY_CSP_BIT_DEPTH[cspOut];
+}
+
+bool RGYFilterResize::fused(const RGYFilterParamResize *prm) {
+    return prm->pad.enable
+        || prm->frameIn.csp != prm->frameOut.csp
+        || prm->frameOut.mem_type == RGY_MEM_TYPE_GPU_IMAGE;
+}
+
+RGYFilterResize::RGYFilterResize(shared_ptr<RGYOpenCLContext> context) : RGYFilter(context), m_bInterlacedWarn(false), m_weightSpline(), m_resize(), m_srcImage(),
+    m_verifyFilters(), m_verifyBuf(), m_verifyFrames(0), m_verifyMismatchFrames(0), m_verifyMaxDiff(0) {
     m_name = _T("resize");
 }
 
@@ -128,6 +317,27 @@ RGY_ERR RGYFilterResize::init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYL
         AddMessage(RGY_LOG_ERROR, _T("Invalid parameter.\n"));
         return RGY_ERR_INVALID_PARAM;
     }
+    const bool fusedResize = fused(pResizeParam.get());
+    if (fusedResize) {
+        if (!fusable(pResizeParam->frameIn.csp, pResizeParam->frameOut.csp, pResizeParam->interp)) {
+            AddMessage(RGY_LOG_ERROR, _T("unsupported csp conversion with resize(%s): %s -> %s.\n"),
+                get_chr_from_value(list_vpp_resize, pResizeParam->interp),
+                RGY_CSP_NAMES[pResizeParam->frameIn.csp], RGY_CSP_NAMES[pResizeParam->frameOut.csp]);
+            return RGY_ERR_UNSUPPORTED;
+        }
+        const auto& pad = pResizeParam->pad;
+        if (pad.enable
+            && (pad.left % 2 != 0 || pad.top % 2 != 0 || pad.right % 2 != 0 || pad.bottom % 2 != 0)) {
+            AddMessage(RGY_LOG_ERROR, _T("pad should be divided by 2.\n"));
+            return RGY_ERR_INVALID_PARAM;
+        }
+        if (pad.enable
+            && (pResizeParam->frameOut.width - pad.left - pad.right <= 0
+                || pResizeParam->frameOut.height - pad.top - pad.bottom <= 0)) {
+            AddMessage(RGY_LOG_ERROR, _T("pad size is too big.\n"));
+            return RGY_ERR_INVALID_PARAM;
+        }
+    }
 
     auto err = AllocFrameBuf(pResizeParam->frameOut, 1);
     if (err != RGY_ERR_NONE) {
@@ -138,7 +348,8 @@ RGY_ERR RGYFilterResize::init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYL
         pResizeParam->frameOut.pitch[i] = m_frameBuf[0]->frame.pitch[i];
     }
     if (!m_resize
-        || std::dynamic_pointer_cast<RGYFilterParamResize>(m_param)->interp != pResizeParam->interp) {
+        || std::dynamic_pointer_cast<RGYFilterParamResize>(m_param)->interp != pResizeParam->interp
+        || std::dynamic_pointer_cast<RGYFilterParamResize>(m_param)->frameOut.mem_type != pResizeParam->frameOut.mem_type) {
         int radius = 1;
         switch (pResizeParam->interp) {
         case RGY_VPP_RESIZE_LANCZOS2:
@@ -157,10 +368,11 @@ RGY_ERR RGYFilterResize::init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYL
         default:
             break;
         }
-        const auto options = strsprintf("-D Type=%s -D bit_depth=%d -D radius=%d",
+        const auto options = strsprintf("-D Type=%s -D bit_depth=%d -D radius=%d -D IMAGE_DST=%d",
             RGY_CSP_BIT_DEPTH[pResizeParam->frameOut.csp] > 8 ? "ushort" : "uchar",
             RGY_CSP_BIT_DEPTH[pResizeParam->frameOut.csp],
-            radius);
+            radius,
+            pResizeParam->frameOut.mem_type == RGY_MEM_TYPE_GPU_IMAGE ? 1 : 0);
         m_resize = m_cl->buildResource(_T("VCE_FILTER_RESIZE_CL"), _T("EXE_DATA"), options.c_str());
         if (!m_resize) {
             AddMessage(RGY_LOG_ERROR, _T("failed to load VCE_FILTER_CL(m_crop)\n"));
@@ -205,10 +417,21 @@ RGY_ERR RGYFilterResize::init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYL
         m_srcImage.reset();
     }
 
+    m_name = _T("resize");
+    const int padLR = (pResizeParam->pad.enable) ? pResizeParam->pad.left + pResizeParam->pad.right : 0;
+    const int padTB = (pResizeParam->pad.enable) ? pResizeParam->pad.top + pResizeParam->pad.bottom : 0;
     m_infoStr = strsprintf(_T("resize(%s): %dx%d -> %dx%d"),
         get_chr_from_value(list_vpp_resize, pResizeParam->interp),
         pResizeParam->frameIn.width, pResizeParam->frameIn.height,
-        pResizeParam->frameOut.width, pResizeParam->frameOut.height);
+        pResizeParam->frameOut.width - padLR, pResizeParam->frameOut.height - padTB);
+    if (pResizeParam->pad.enable) {
+        m_name += _T("/pad");
+        m_infoStr += _T("/pad") + pResizeParam->pad.print();
+    }
+    if (pResizeParam->frameOut.csp != pResizeParam->frameIn.csp) {
+        m_name += _T("/cspconv");
+        m_infoStr += strsprintf(_T("/cspconv(%s -> %s)"), RGY_CSP_NAMES[pResizeParam->frameIn.csp], RGY_CSP_NAMES[pResizeParam->frameOut.csp]);
+    }
 
     //コピーを保存
     m_param = pResizeParam;
@@ -235,10 +458,6 @@ RGY_ERR RGYFilterResize::run_filter(const FrameInfo *pInputFrame, FrameInfo **pp
         AddMessage(RGY_LOG_ERROR, _T("only supported on device memory.\n"));
         return RGY_ERR_UNSUPPORTED;
     }
-    if (m_param->frameOut.csp != m_param->frameIn.csp) {
-        AddMessage(RGY_LOG_ERROR, _T("csp does not match.\n"));
-        return RGY_ERR_UNSUPPORTED;
-    }
     static const auto supportedCspYV12   = make_array<RGY_CSP>(RGY_CSP_YV12, RGY_CSP_YV12_09, RGY_CSP_YV12_10, RGY_CSP_YV12_12, RGY_CSP_YV12_14, RGY_CSP_YV12_16);
     static const auto supportedCspYUV444 = make_array<RGY_CSP>(RGY_CSP_YUV444, RGY_CSP_YUV444_09, RGY_CSP_YUV444_10, RGY_CSP_YUV444_12, RGY_CSP_YUV444_14, RGY_CSP_YUV444_16);
 
@@ -247,6 +466,23 @@ RGY_ERR RGYFilterResize::run_filter(const FrameInfo *pInputFrame, FrameInfo **pp
         AddMessage(RGY_LOG_ERROR, _T("Invalid parameter type.\n"));
         return RGY_ERR_INVALID_PARAM;
     }
+    if (fused(pResizeParam.get())) {
+        //pad/色空間変換とまとめて処理
+        sts = resizeFrameFused(ppOutputFrames[0], pInputFrame, queue, wait_events, event);
+        if (sts != RGY_ERR_NONE) {
+            AddMessage(RGY_LOG_ERROR, _T("error at resizeFrameFused (%s -> %s): %s.\n"),
+                RGY_CSP_NAMES[pInputFrame->csp], RGY_CSP_NAMES[ppOutputFrames[0]->csp], get_err_mes(sts));
+            return sts;
+        }
+        if (m_verifyFilters.size() > 0) {
+            sts = verifyFrame(ppOutputFrames[0], pInputFrame, queue);
+        }
+        return sts;
+    }
+    if (m_param->frameOut.csp != m_param->frameIn.csp) {
+        AddMessage(RGY_LOG_ERROR, _T("csp does not match.\n"));
+        return RGY_ERR_UNSUPPORTED;
+    }
 
     sts = resizeFrame(ppOutputFrames[0], pInputFrame, queue, wait_events, event);
     if (sts != RGY_ERR_NONE) {
@@ -259,6 +495,15 @@ RGY_ERR RGYFilterResize::run_filter(const FrameInfo *pInputFrame, FrameInfo **pp
 }
 
 void RGYFilterResize::close() {
+    if (m_verifyFilters.size() > 0 && m_verifyFrames > 0) {
+        AddMessage((m_verifyMismatchFrames > 0) ? RGY_LOG_WARN : RGY_LOG_INFO,
+            _T("verified %d frames against separate filters: %d frames differ (max diff %d).\n"),
+            m_verifyFrames, m_verifyMismatchFrames, m_verifyMaxDiff);
+    }
+    m_verifyFilters.clear();
+    m_verifyFrames = 0;
+    m_verifyMismatchFrames = 0;
+    m_verifyMaxDiff = 0;
     m_srcImage.reset();
     m_frameBuf.clear();
     m_resize.reset();
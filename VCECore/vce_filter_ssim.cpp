@@ -57,9 +57,16 @@ RGYFilterSsim::RGYFilterSsim(shared_ptr<RGYOpenCLContext> context) :
     m_deviceId(0),
     m_thread(),
     m_mtx(),
+    m_cvUnused(),
     m_abort(false),
+    m_threadFinished(false),
+    m_waitDecInput(),
+    m_waitDecOutput(),
     m_input(),
     m_unused(),
+    m_inputAllocated(0),
+    m_inputMax(SSIM_INPUT_QUEUE_MAX),
+    m_inputReturned(false),
     m_decoder(),
     m_cropOrg(),
     m_cropDec(),
@@ -76,6 +83,7 @@ RGYFilterSsim::RGYFilterSsim(shared_ptr<RGYOpenCLContext> context) :
     m_psnrTotalPlane(),
     m_psnrTotal(0.0),
     m_frames(0),
+    m_fpLog(),
     m_kernel(),
     RGYFilter(context) {
     m_name = _T("ssim/psnr");
@@ -158,6 +166,30 @@ RGY_ERR RGYFilterSsim::init(shared_ptr<RGYFilterParam> pParam, shared_ptr<RGYLog
         m_psnrTotalPlane[i] = 0.0;
     }
     m_psnrTotal = 0.0;
+    m_frames = 0;
+    m_inputAllocated = 0;
+    m_inputMax = SSIM_INPUT_QUEUE_MAX;
+    m_inputReturned = false;
+    m_threadFinished = false;
+    m_waitDecInput  = createWaiter(RGY_WAIT_MODE_ADAPTIVE, 1);
+    m_waitDecOutput = createWaiter(RGY_WAIT_MODE_ADAPTIVE, 1);
+
+    m_fpLog.reset();
+    if (prm->qualityLog.length() > 0) {
+        FILE *fp = NULL;
+        if (_tfopen_s(&fp, prm->qualityLog.c_str(), _T("w")) || fp == NULL) {
+            AddMessage(RGY_LOG_ERROR, _T("failed to open quality log file \"%s\".\n"), prm->qualityLog.c_str());
+            return RGY_ERR_FILE_OPEN;
+        }
+        m_fpLog = unique_ptr<FILE, fp_deleter>(fp, fp_deleter());
+        //フレームごとに書き出すので、行単位ではなくある程度まとめて書き出す
+        setvbuf(m_fpLog.get(), nullptr, _IOFBF, 64 * 1024);
+        fprintf(m_fpLog.get(), "frame");
+        if (prm->ssim) fprintf(m_fpLog.get(), ",ssim_y,ssim_u,ssim_v,ssim_all");
+        if (prm->psnr) fprintf(m_fpLog.get(), ",psnr_y,psnr_u,psnr_v,psnr_all");
+        fprintf(m_fpLog.get(), "\n");
+        AddMessage(RGY_LOG_DEBUG, _T("opened quality log file \"%s\".\n"), prm->qualityLog.c_str());
+    }
     m_context = prm->context;
     m_factory = prm->factory;
     m_trace = prm->trace;
@@ -342,6 +374,7 @@ void RGYFilterSsim::close_cl_resources() {
 RGY_ERR RGYFilterSsim::addBitstream(const RGYBitstream *bitstream) {
     if (bitstream == nullptr) {
         m_decoder->Drain();
+        m_waitDecOutput->notify();
         return RGY_ERR_NONE;
     }
     amf::AMFBufferPtr pictureBuffer;
@@ -363,13 +396,16 @@ RGY_ERR RGYFilterSsim::addBitstream(const RGYBitstream *bitstream) {
             AddMessage(RGY_LOG_ERROR, _T("ERROR: Resolution changed during decoding.\n"));
             break;
         } else if (ar == AMF_INPUT_FULL || ar == AMF_DECODER_NO_FREE_SURFACES) {
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            //比較スレッドがデコーダの出力を取り出すまで待機する
+            m_waitDecInput->wait();
         } else if (ar == AMF_REPEAT) {
             pictureBuffer = nullptr;
         } else {
             break;
         }
     }
+    m_waitDecInput->done();
+    m_waitDecOutput->notify(); //比較スレッドを起床させる
     if (ar != AMF_OK) {
         return err_to_rgy(ar);
     }
@@ -381,10 +417,33 @@ RGY_ERR RGYFilterSsim::run_filter(const FrameInfo *pInputFrame, FrameInfo **ppOu
     UNREFERENCED_PARAMETER(pOutputFrameNum);
     RGY_ERR sts = RGY_ERR_NONE;
 
-    std::lock_guard<std::mutex> lock(m_mtx); //ロックを忘れないこと
+    std::unique_lock<std::mutex> lock(m_mtx); //ロックを忘れないこと
+    if (m_unused.size() == 0 && m_inputAllocated >= m_inputMax && m_decodeStarted) {
+        //上限に達している場合は、比較スレッドがフレームバッファを返却するまで待機する
+        const auto returned = [this]() { return m_unused.size() > 0 || m_threadFinished; };
+        //一度でも返却があれば、エンコーダ/デコーダの遅延は上限内に収まっているはずなので、長めに待機する
+        const int timeout_ms = (m_inputReturned || m_inputMax >= SSIM_INPUT_QUEUE_HARD_MAX) ? SSIM_INPUT_WAIT_MAX_MS : SSIM_INPUT_WAIT_TIMEOUT_MS;
+        if (!m_cvUnused.wait_for(lock, std::chrono::milliseconds(timeout_ms), returned)) {
+            if (m_inputMax < SSIM_INPUT_QUEUE_HARD_MAX) {
+                //エンコーダ/デコーダの遅延が上限を超えていて返却されないので、上限を増やす
+                m_inputMax++;
+                AddMessage((m_inputReturned) ? RGY_LOG_WARN : RGY_LOG_DEBUG, _T("increased max frame buffers to %d.\n"), m_inputMax);
+            } else {
+                //上限まで増やしても返却されない場合は、比較スレッドが停止しているので、待機し続けずにエラーとする
+                AddMessage(RGY_LOG_ERROR, _T("timeout: no frame buffer returned from compare thread in %d ms (%d buffers allocated).\n"),
+                    timeout_ms, m_inputAllocated);
+                return RGY_ERR_UNKNOWN;
+            }
+        }
+    }
+    if (m_threadFinished) {
+        //比較スレッドが終了している場合は、比較されることがないのでコピーしない
+        return sts;
+    }
     if (m_unused.size() == 0) {
         //待機中のフレームバッファがなければ新たに作成する
         m_unused.push_back(m_cl->createFrameBuffer((m_cropOrg) ? m_cropOrg->GetFilterParam()->frameOut : *pInputFrame));
+        m_inputAllocated++;
     }
     auto &copyFrame = m_unused.front();
     if (m_cropOrg) {
@@ -445,6 +504,14 @@ RGY_ERR RGYFilterSsim::thread_func() {
     m_decodeStarted = true;
     auto ret = compare_frames(true);
     AddMessage(RGY_LOG_DEBUG, _T("Finishing ssim/psnr calculation thread: %s.\n"), get_err_mes(ret));
+    AddMessage(RGY_LOG_DEBUG, _T("frame buffers: %d, decoder output wait %llu, block %llu.\n"),
+        m_inputAllocated, (unsigned long long)m_waitDecOutput->waitCount(), (unsigned long long)m_waitDecOutput->blockCount());
+    {
+        //run_filterで待機している場合に備え、終了を通知する
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_threadFinished = true;
+    }
+    m_cvUnused.notify_all();
     close_cl_resources();
     return ret;
 }
@@ -472,6 +539,8 @@ RGY_ERR RGYFilterSsim::compare_frames(bool flush) {
             }
             if (ar == AMF_OK && data != nullptr) {
                 surf = amf::AMFSurfacePtr(data);
+                m_waitDecOutput->done();
+                m_waitDecInput->notify(); //デコーダの出力を取り出したので、addBitstreamを起床させる
                 break;
             }
             if (ar != AMF_OK || m_abort) break;
@@ -481,7 +550,7 @@ RGY_ERR RGYFilterSsim::compare_frames(bool flush) {
             //    ar = AMF_FAIL;
             //    break;
             //}
-            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            m_waitDecOutput->wait();
         }
         if (ar == AMF_EOF || m_abort) {
             break;
@@ -531,15 +600,28 @@ RGY_ERR RGYFilterSsim::compare_frames(bool flush) {
             }
 
             //比較用のキューの先頭に積まれているものから順次比較していく
-            std::lock_guard<std::mutex> lock(m_mtx); //ロックを忘れないこと
-            auto &originalFrame = m_input.front();
+            //比較中はm_inputの先頭のフレームを取り出しておき、run_filterをブロックしないようにする
+            std::unique_ptr<RGYCLFrame> originalFrame;
+            {
+                std::lock_guard<std::mutex> lock(m_mtx); //ロックを忘れないこと
+                if (m_input.size() == 0) {
+                    AddMessage(RGY_LOG_ERROR, _T("No original frame for decoded frame #%d.\n"), m_frames);
+                    return RGY_ERR_UNKNOWN;
+                }
+                originalFrame = std::move(m_input.front());
+                m_input.pop_front();
+            }
             sts_filter = calc_ssim_psnr(&originalFrame->frame, &m_decFrameCopy->frame);
             if (sts_filter != RGY_ERR_NONE) {
                 return sts_filter;
             }
-            //フレームをm_inputからm_unusedに移す
-            m_unused.push_back(std::move(originalFrame));
-            m_input.pop_front();
+            //フレームをm_unusedに返却し、待機中のrun_filterを起床させる
+            {
+                std::lock_guard<std::mutex> lock(m_mtx);
+                m_unused.push_back(std::move(originalFrame));
+                m_inputReturned = true;
+            }
+            m_cvUnused.notify_one();
             m_frames++;
         }
     }
@@ -666,8 +748,11 @@ RGY_ERR RGYFilterSsim::calc_ssim_psnr(const FrameInfo *p0, const FrameInfo *p1)
         }
     }
 
+    std::array<double, 3> ssimFrame = { 0.0, 0.0, 0.0 };
+    std::array<double, 3> psnrFrame = { 0.0, 0.0, 0.0 };
+    double ssimv = 0.0;
+    double psnrv = 0.0;
     if (prm->ssim) {
-        double ssimv = 0.0;
         for (int i = 0; i < RGY_CSP_PLANES[p0->csp]; i++) {
             amf::AMFContext::AMFOpenCLLocker locker(m_context);
             m_tmpSsim[i]->mapEvent().wait();
@@ -682,6 +767,7 @@ RGY_ERR RGYFilterSsim::calc_ssim_psnr(const FrameInfo *p0, const FrameInfo *p1)
             const auto plane0 = getPlane(p0, (RGY_PLANE)i);
             ssimPlane /= (double)(((plane0.width >> 2) - 1) *((plane0.height >> 2) - 1));
             m_ssimTotalPlane[i] += ssimPlane;
+            ssimFrame[i] = ssimPlane;
             ssimv += ssimPlane * m_planeCoef[i];
             AddMessage(RGY_LOG_TRACE, _T("ssimPlane = %.16e, m_ssimTotalPlane[i] = %.16e"), ssimPlane, m_ssimTotalPlane[i]);
             m_tmpSsim[i]->unmapBuffer();
@@ -690,7 +776,6 @@ RGY_ERR RGYFilterSsim::calc_ssim_psnr(const FrameInfo *p0, const FrameInfo *p1)
     }
 
     if (prm->psnr) {
-        double psnrv = 0.0;
         for (int i = 0; i < RGY_CSP_PLANES[p0->csp]; i++) {
             amf::AMFContext::AMFOpenCLLocker locker(m_context);
             m_tmpPsnr[i]->mapEvent().wait();
@@ -704,23 +789,51 @@ RGY_ERR RGYFilterSsim::calc_ssim_psnr(const FrameInfo *p0, const FrameInfo *p1)
             const auto plane0 = getPlane(p0, (RGY_PLANE)i);
             double psnrPlaneF = psnrPlane / (double)(plane0.width * plane0.height);
             m_psnrTotalPlane[i] += psnrPlaneF;
+            psnrFrame[i] = psnrPlaneF;
             psnrv += psnrPlaneF * m_planeCoef[i];
             AddMessage(RGY_LOG_TRACE, _T("psnrPlane = %.16e, m_psnrTotalPlane[i] = %.16e"), psnrPlane, m_psnrTotalPlane[i]);
             m_tmpPsnr[i]->unmapBuffer();
         }
         m_psnrTotal += psnrv;
     }
+    if (m_fpLog) {
+        write_quality_log(ssimFrame, ssimv, psnrFrame, psnrv);
+    }
     return RGY_ERR_NONE;
 }
 
+void RGYFilterSsim::write_quality_log(const std::array<double, 3>& ssimPlane, double ssim, const std::array<double, 3>& msePlane, double mse) {
+    auto prm = std::dynamic_pointer_cast<RGYFilterParamSsim>(m_param);
+    fprintf(m_fpLog.get(), "%d", m_frames);
+    if (prm->ssim) {
+        fprintf(m_fpLog.get(), ",%.6f,%.6f,%.6f,%.6f", ssimPlane[0], ssimPlane[1], ssimPlane[2], ssim);
+    }
+    if (prm->psnr) {
+        //psnrは1フレーム分のmseから計算する (mse = 0 のときはinf)
+        const int maxval = (1 << RGY_CSP_BIT_DEPTH[prm->frameOut.csp]) - 1;
+        for (const auto psnrMse : { msePlane[0], msePlane[1], msePlane[2], mse }) {
+            if (psnrMse > 0.0) {
+                fprintf(m_fpLog.get(), ",%.4f", get_psnr(psnrMse, 1, maxval));
+            } else {
+                fprintf(m_fpLog.get(), ",inf");
+            }
+        }
+    }
+    fprintf(m_fpLog.get(), "\n");
+}
+
 
 void RGYFilterSsim::close() {
     if (m_thread.joinable()) {
         AddMessage(RGY_LOG_DEBUG, _T("Waiting for ssim/psnr calculation thread to finish.\n"));
         m_abort = true;
+        if (m_waitDecOutput) {
+            m_waitDecOutput->notify();
+        }
         m_thread.join();
     }
     close_cl_resources();
+    m_fpLog.reset();
     m_cropOrg.reset();
     m_cropDec.reset();
     AddMessage(RGY_LOG_DEBUG, _T("closed ssim/psnr filter.\n"));
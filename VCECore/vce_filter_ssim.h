@@ -31,17 +31,35 @@
 #include "vce_filter.h"
 #include "vce_param.h"
 #include "vce_util.h"
+#include "rgy_waiter.h"
 #include "Factory.h"
 #include "Trace.h"
 #include <array>
 #include <thread>
 #include <deque>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+//比較待ちのオリジナルフレームのバッファ数の初期上限
+//上限に達した場合、run_filterは比較スレッドがバッファを返却するまで待機する
+static const int SSIM_INPUT_QUEUE_MAX = 16;
+//上限に達した場合の最大待機時間
+//エンコーダ/デコーダの遅延が上限を超える場合は待機しても返却されないので、
+//比較スレッドがまだ1フレームも返却していなければ、待機を打ち切り、上限を1つ増やす
+static const int SSIM_INPUT_WAIT_TIMEOUT_MS = 100;
+//上限を増やす場合の最大値
+static const int SSIM_INPUT_QUEUE_HARD_MAX = 64;
+//一度でも返却があった場合、もしくは上限がSSIM_INPUT_QUEUE_HARD_MAXに達した場合の最大待機時間
+//これを超えても返却されない場合、上限がSSIM_INPUT_QUEUE_HARD_MAX未満なら上限を1つ増やし、
+//SSIM_INPUT_QUEUE_HARD_MAXに達していれば比較スレッドが停止しているとみなしてエラーとする
+static const int SSIM_INPUT_WAIT_MAX_MS = 10000;
 
 class RGYFilterParamSsim : public RGYFilterParam {
 public:
     bool ssim;
     bool psnr;
+    tstring qualityLog; //フレームごとの評価結果を出力するcsvファイル
     int deviceId;
     VideoInfo input;
     rgy_rational<int> streamtimebase;
@@ -49,7 +67,7 @@ public:
     amf::AMFTrace *trace;
     amf::AMFContextPtr context;
 
-    RGYFilterParamSsim() : ssim(true), psnr(false), deviceId(0), input(), streamtimebase(), factory(nullptr), trace(nullptr), context() {
+    RGYFilterParamSsim() : ssim(true), psnr(false), qualityLog(), deviceId(0), input(), streamtimebase(), factory(nullptr), trace(nullptr), context() {
 
     };
     virtual ~RGYFilterParamSsim() {};
@@ -79,14 +97,19 @@ protected:
     RGY_ERR calc_psnr_plane(const FrameInfo *p0, const FrameInfo *p1, std::unique_ptr<RGYCLBuf> &tmp, RGYOpenCLQueue *queue, const std::vector<RGYOpenCLEvent> &wait_events);
     RGY_ERR calc_psnr_frame(const FrameInfo *p0, const FrameInfo *p1);
     RGY_ERR calc_ssim_psnr(const FrameInfo *p0, const FrameInfo *p1);
+    void write_quality_log(const std::array<double, 3>& ssimPlane, double ssim, const std::array<double, 3>& msePlane, double mse);
 
-    bool m_decodeStarted; //デコードが開始したか
+    std::atomic<bool> m_decodeStarted; //デコードが開始したか
     int m_deviceId;       //SSIM計算で使用するCUDA device ID
 
     //スレッド関連
     std::thread m_thread; //スレッド本体
     std::mutex m_mtx;     //m_input, m_unused操作用のロック
+    std::condition_variable m_cvUnused; //m_unusedにフレームが返却されたことを通知する
     bool m_abort;         //スレッド中断用
+    bool m_threadFinished; //比較スレッドが終了したか (m_mtxで保護)
+    unique_ptr<RGYWaiter> m_waitDecInput;  //デコーダの入力に空きができるのを待機 (比較スレッドから通知)
+    unique_ptr<RGYWaiter> m_waitDecOutput; //デコーダの出力を待機 (addBitstreamから通知)
 
     amf::AMFTrace *m_trace;
     amf::AMFFactory *m_factory;
@@ -95,6 +118,9 @@ protected:
 
     std::deque<std::unique_ptr<RGYCLFrame>> m_input;  //使用中のフレームバッファ(オリジナルフレーム格納用)
     std::deque<std::unique_ptr<RGYCLFrame>> m_unused; //使っていないフレームバッファ(オリジナルフレーム格納用)
+    int m_inputAllocated;                              //確保したフレームバッファ(オリジナルフレーム格納用)の数
+    int m_inputMax;                                    //確保するフレームバッファ(オリジナルフレーム格納用)の上限
+    bool m_inputReturned;                              //比較スレッドがフレームバッファを返却したことがあるか (m_mtxで保護)
     unique_ptr<RGYFilterCspCrop> m_cropOrg;      // NV12->YV12変換用
     unique_ptr<RGYFilterCspCrop> m_cropDec;      // NV12->YV12変換用
     std::unique_ptr<RGYCLFrame> m_decFrameCopy; //デコード後にcrop(NV12->YV12変換)したフレームの格納場所
@@ -110,6 +136,7 @@ protected:
     std::array<double, 3> m_psnrTotalPlane; // 評価結果の累積値 YUV
     double m_psnrTotal;                     // 評価結果の累積値 All
     int m_frames;                           // 評価したフレーム数
+    unique_ptr<FILE, fp_deleter> m_fpLog;   // フレームごとの評価結果の出力先
 
     unique_ptr<RGYOpenCLProgram> m_kernel;
 };
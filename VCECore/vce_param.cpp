@@ -48,7 +48,9 @@ VppAfs::VppAfs() :
     tune(FILTER_DEFAULT_AFS_TUNE),
     rff(FILTER_DEFAULT_AFS_RFF),
     timecode(FILTER_DEFAULT_AFS_TIMECODE),
-    log(FILTER_DEFAULT_AFS_LOG) {
+    log(FILTER_DEFAULT_AFS_LOG),
+    backend((VppAfsBackend)FILTER_DEFAULT_AFS_BACKEND),
+    count_reduce((VppAfsCountReduce)FILTER_DEFAULT_AFS_COUNT_REDUCE) {
     check();
 }
 
@@ -73,7 +75,9 @@ bool VppAfs::operator==(const VppAfs &x) const {
         && tune == x.tune
         && rff == x.rff
         && timecode == x.timecode
-        && log == x.log;
+        && log == x.log
+        && backend == x.backend
+        && count_reduce == x.count_reduce;
 }
 bool VppAfs::operator!=(const VppAfs &x) const {
     return !(*this == x);
@@ -250,12 +254,14 @@ tstring VppAfs::print() const {
         _T("afs: clip(T %d, B %d, L %d, R %d), switch %d, coeff_shift %d\n")
         _T("                    thre(shift %d, deint %d, Ymotion %d, Cmotion %d)\n")
         _T("                    level %d, shift %s, drop %s, smooth %s, force24 %s\n")
-        _T("                    tune %s, tb_order %d(%s), rff %s, timecode %s, log %s"),
+        _T("                    tune %s, tb_order %d(%s), rff %s, timecode %s, log %s, backend %s, count_reduce %s"),
         clip.top, clip.bottom, clip.left, clip.right,
         method_switch, coeff_shift,
         thre_shift, thre_deint, thre_Ymotion, thre_Cmotion,
         analyze, ON_OFF(shift), ON_OFF(drop), ON_OFF(smooth), ON_OFF(force24),
-        ON_OFF(tune), tb_order, tb_order ? _T("tff") : _T("bff"), ON_OFF(rff), ON_OFF(timecode), ON_OFF(log));
+        ON_OFF(tune), tb_order, tb_order ? _T("tff") : _T("bff"), ON_OFF(rff), ON_OFF(timecode), ON_OFF(log),
+        get_chr_from_value(list_vpp_afs_backend, backend),
+        get_chr_from_value(list_vpp_afs_count_reduce, count_reduce));
 #undef ON_OFF
 }
 
@@ -565,6 +571,7 @@ tstring VppDeband::print() const {
 
 VCEVppParam::VCEVppParam() :
     resize(RGY_VPP_RESIZE_AUTO),
+    resizeFuse(RGY_VPP_RESIZE_FUSE_OFF),
     afs(),
     nnedi(),
     pad(),
@@ -635,6 +642,7 @@ VCEParam::VCEParam() :
     bVBAQ(false),
     ssim(false),
     psnr(false),
+    qualityLog(),
     vpp() {
     codecParam[RGY_CODEC_H264].nLevel   = 0;
     codecParam[RGY_CODEC_H264].nProfile = list_avc_profile[2].value;
@@ -66,6 +66,8 @@ static const bool  FILTER_DEFAULT_AFS_TUNE = false;
 static const bool  FILTER_DEFAULT_AFS_RFF = false;
 static const bool  FILTER_DEFAULT_AFS_TIMECODE = false;
 static const bool  FILTER_DEFAULT_AFS_LOG = false;
+static const int   FILTER_DEFAULT_AFS_BACKEND = 0;
+static const int   FILTER_DEFAULT_AFS_COUNT_REDUCE = 0;
 
 static const int   FILTER_DEFAULT_KNN_RADIUS = 3;
 static const float FILTER_DEFAULT_KNN_STRENGTH = 0.08f;
@@ -286,6 +288,19 @@ const CX_DESC list_vpp_resize[] = {
     { NULL, NULL }
 };
 
+enum RGY_VPP_RESIZE_FUSE {
+    RGY_VPP_RESIZE_FUSE_OFF,
+    RGY_VPP_RESIZE_FUSE_ON,
+    RGY_VPP_RESIZE_FUSE_VERIFY, //まとめた処理と個別の処理の結果を毎フレーム比較する
+};
+
+const CX_DESC list_vpp_resize_fuse[] = {
+    { _T("off"),    RGY_VPP_RESIZE_FUSE_OFF },
+    { _T("on"),     RGY_VPP_RESIZE_FUSE_ON },
+    { _T("verify"), RGY_VPP_RESIZE_FUSE_VERIFY },
+    { NULL, NULL }
+};
+
 enum VppFpPrecision {
     VPP_FP_PRECISION_UNKNOWN = -1,
 
@@ -577,6 +592,32 @@ const CX_DESC list_afs_preset[] = {
     { NULL, NULL }
 };
 
+enum VppAfsBackend {
+    VPP_AFS_BACKEND_GPU = 0, //OpenCLで処理する
+    VPP_AFS_BACKEND_CPU,     //analyze/merge_scan/synthesizeをCPUで処理する
+    VPP_AFS_BACKEND_VERIFY,  //OpenCLで処理し、CPU版の結果と比較する
+};
+
+const CX_DESC list_vpp_afs_backend[] = {
+    { _T("gpu"),    VPP_AFS_BACKEND_GPU },
+    { _T("cpu"),    VPP_AFS_BACKEND_CPU },
+    { _T("verify"), VPP_AFS_BACKEND_VERIFY },
+    { NULL, NULL }
+};
+
+enum VppAfsCountReduce {
+    VPP_AFS_COUNT_REDUCE_DEVICE = 0, //動き/縞のカウントの総和をGPUでとり、2つの値だけを転送する
+    VPP_AFS_COUNT_REDUCE_HOST,       //ブロックごとのカウントをすべて転送してCPUで総和をとる
+    VPP_AFS_COUNT_REDUCE_VERIFY,     //両方で総和をとって比較する
+};
+
+const CX_DESC list_vpp_afs_count_reduce[] = {
+    { _T("device"), VPP_AFS_COUNT_REDUCE_DEVICE },
+    { _T("host"),   VPP_AFS_COUNT_REDUCE_HOST },
+    { _T("verify"), VPP_AFS_COUNT_REDUCE_VERIFY },
+    { NULL, NULL }
+};
+
 typedef struct {
     int top, bottom, left, right;
 } AFS_SCAN_CLIP;
@@ -609,6 +650,8 @@ struct VppAfs {
     bool rff;              //rffフラグを認識して調整
     bool timecode;         //timecode出力
     bool log;              //log出力
+    VppAfsBackend backend; //処理に使用するデバイス
+    VppAfsCountReduce count_reduce; //動き/縞のカウントの総和をとる方法
 
     VppAfs();
     void set_preset(int preset);
@@ -749,6 +792,7 @@ struct VppDeband {
 
 struct VCEVppParam {
     RGY_VPP_RESIZE_ALGO resize;
+    RGY_VPP_RESIZE_FUSE resizeFuse;
     VppAfs afs;
     VppNnedi nnedi;
     VppPad pad;
@@ -831,6 +875,7 @@ struct VCEParam {
 
     bool        ssim;
     bool        psnr;
+    tstring     qualityLog;
 
     VCEVppParam vpp;
 
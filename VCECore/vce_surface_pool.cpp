@@ -0,0 +1,173 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#include <thread>
+#include <chrono>
+#include "vce_surface_pool.h"
+
+//空きを待つ最大時間 これを超えたら、上限を超えてでも新たに確保する
+//released()の直後にAMF内部の参照が外れるのを待つ程度の短い時間とし、
+//エンコーダが入力を保持し続けている場合は、待たずに上限を超えて確保する (確保したsurfaceは以降再利用される)
+static const int SURFACE_POOL_WAIT_TIMEOUT_MS = 4;
+//AMF内部での参照の解放は、released()による通知よりも後になることがあるため、
+//通知がなくてもこの間隔で空きを確認しなおす
+static const int SURFACE_POOL_RECHECK_MS = 1;
+
+VCESurfacePool::VCESurfacePool(amf::AMFContextPtr context, int maxSurfaces, std::shared_ptr<RGYLog> log) :
+    m_context(context),
+    m_maxSurfaces(maxSurfaces),
+    m_pool(),
+    m_log(log),
+    m_hit(0),
+    m_miss(0),
+    m_wait(0),
+    m_overCap(0),
+    m_mtxRelease(),
+    m_cvRelease(),
+    m_releaseCount(0) {
+}
+
+VCESurfacePool::~VCESurfacePool() {
+    clear();
+    m_context = nullptr;
+    m_log.reset();
+}
+
+void VCESurfacePool::PrintMes(int log_level, const TCHAR *format, ...) {
+    if (m_log.get() == nullptr || log_level < m_log->getLogLevel()) {
+        return;
+    }
+
+    va_list args;
+    va_start(args, format);
+    int len = _vsctprintf(format, args) + 1; // _vscprintf doesn't count terminating '\0'
+    vector<TCHAR> buffer(len, 0);
+    _vstprintf_s(buffer.data(), len, format, args);
+    va_end(args);
+    m_log->write(log_level, (tstring(_T("surfpool: ")) + buffer.data()).c_str());
+}
+
+void VCESurfacePool::clear() {
+    m_pool.clear();
+}
+
+void VCESurfacePool::released() {
+    {
+        std::lock_guard<std::mutex> lock(m_mtxRelease);
+        m_releaseCount++;
+    }
+    m_cvRelease.notify_all();
+}
+
+bool VCESurfacePool::isFree(amf::AMFSurfacePtr& surface) {
+    //Releaseの返り値は解放後の参照カウント
+    //プールの持つ参照のみなら1が返る
+    surface->Acquire();
+    return surface->Release() == 1;
+}
+
+VCESurfacePool::PoolEntry *VCESurfacePool::getEntry(amf::AMF_MEMORY_TYPE memType, amf::AMF_SURFACE_FORMAT format, int width, int height) {
+    for (auto& entry : m_pool) {
+        if (entry.memType == memType && entry.format == format
+            && entry.width == width && entry.height == height) {
+            return &entry;
+        }
+    }
+    PoolEntry entry;
+    entry.memType = memType;
+    entry.format = format;
+    entry.width = width;
+    entry.height = height;
+    m_pool.push_back(entry);
+    PrintMes(RGY_LOG_DEBUG, _T("new pool: mem %d, format %d, %dx%d.\n"), (int)memType, (int)format, width, height);
+    return &m_pool.back();
+}
+
+amf::AMFSurfacePtr VCESurfacePool::findFree(PoolEntry *entry) {
+    for (auto& surf : entry->surfaces) {
+        if (isFree(surf)) {
+            return surf;
+        }
+    }
+    return amf::AMFSurfacePtr();
+}
+
+amf::AMFSurfacePtr VCESurfacePool::waitFree(PoolEntry *entry) {
+    const auto timeout = std::chrono::steady_clock::now() + std::chrono::milliseconds(SURFACE_POOL_WAIT_TIMEOUT_MS);
+    std::unique_lock<std::mutex> lock(m_mtxRelease);
+    for (;;) {
+        //空きの確認より前に通知回数を記録しておき、確認中の通知を取りこぼさないようにする
+        const auto releaseCount = m_releaseCount;
+        lock.unlock();
+        auto surf = findFree(entry);
+        if (surf) {
+            return surf;
+        }
+        lock.lock();
+        const auto now = std::chrono::steady_clock::now();
+        if (now >= timeout) {
+            return amf::AMFSurfacePtr();
+        }
+        const auto recheck = (std::min)(timeout, now + std::chrono::milliseconds(SURFACE_POOL_RECHECK_MS));
+        m_cvRelease.wait_until(lock, recheck, [this, releaseCount]() { return m_releaseCount != releaseCount; });
+    }
+}
+
+RGY_ERR VCESurfacePool::get(amf::AMFSurfacePtr& surface, amf::AMF_MEMORY_TYPE memType, amf::AMF_SURFACE_FORMAT format, int width, int height) {
+    surface = nullptr;
+    auto entry = getEntry(memType, format, width, height);
+    auto surf = findFree(entry);
+    if (!surf && (int)entry->surfaces.size() >= m_maxSurfaces) {
+        //上限まで確保済みなので、エンコーダ等が使用済みのsurfaceを解放するまで待機する
+        m_wait++;
+        surf = waitFree(entry);
+        if (!surf) {
+            //上限はソフトな制限とし、デッドロックするよりは上限を超えて確保する
+            if (m_overCap == 0) {
+                PrintMes(RGY_LOG_WARN, _T("no free surface after %d ms, allocating over soft limit %d (mem %d, format %d, %dx%d).\n"),
+                    SURFACE_POOL_WAIT_TIMEOUT_MS, m_maxSurfaces, (int)memType, (int)format, width, height);
+            }
+            m_overCap++;
+        }
+    }
+    if (surf) {
+        m_hit++;
+        //前回使用時のプロパティを残さないようにする
+        surf->Clear();
+        surface = surf;
+        return RGY_ERR_NONE;
+    }
+    m_miss++;
+    auto ar = m_context->AllocSurface(memType, format, width, height, &surf);
+    if (ar != AMF_OK) {
+        PrintMes(RGY_LOG_ERROR, _T("Failed to allocate surface: %s.\n"), get_err_mes(err_to_rgy(ar)));
+        return err_to_rgy(ar);
+    }
+    entry->surfaces.push_back(surf);
+    surface = surf;
+    return RGY_ERR_NONE;
+}
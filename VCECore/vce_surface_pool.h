@@ -0,0 +1,95 @@
+﻿// -----------------------------------------------------------------------------------------
+//     VCEEnc by rigaya
+// -----------------------------------------------------------------------------------------
+// The MIT License
+//
+// Copyright (c) 2020 rigaya
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in
+// all copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN
+// THE SOFTWARE.
+//
+// --------------------------------------------------------------------------------------------
+
+#pragma once
+#ifndef __VCE_SURFACE_POOL_H__
+#define __VCE_SURFACE_POOL_H__
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#pragma warning(push)
+#pragma warning(disable:4100)
+#include "Context.h"
+#include "Surface.h"
+#pragma warning(pop)
+#include "rgy_util.h"
+#include "rgy_err.h"
+#include "rgy_log.h"
+
+//AMFSurfaceを使いまわすためのプール
+//(メモリタイプ, フォーマット, 幅, 高さ) ごとに最大maxSurfaces枚までのsurfaceを保持し、
+//プール以外から参照されなくなった(エンコーダなどが解放した)surfaceを再利用する
+//すべて使用中の場合は、released()による通知があるまで待機する
+//maxSurfacesはソフトな上限で、一定時間待機しても空きができない場合は上限を超えて確保し、overCap()として記録する
+class VCESurfacePool {
+public:
+    VCESurfacePool(amf::AMFContextPtr context, int maxSurfaces, std::shared_ptr<RGYLog> log);
+    virtual ~VCESurfacePool();
+
+    //surfaceを取得する
+    RGY_ERR get(amf::AMFSurfacePtr& surface, amf::AMF_MEMORY_TYPE memType, amf::AMF_SURFACE_FORMAT format, int width, int height);
+    //プールのsurfaceをすべて破棄する
+    void clear();
+    //surfaceを使用していた側(エンコーダの出力スレッドなど)から、surfaceを解放した可能性があることを通知する
+    void released();
+
+    uint64_t hit() const { return m_hit; }         //再利用できた回数
+    uint64_t miss() const { return m_miss; }       //新たに確保した回数
+    uint64_t wait() const { return m_wait; }       //空きがなく待機した回数
+    uint64_t overCap() const { return m_overCap; } //待機しても空きができず、上限を超えて確保した回数
+protected:
+    void PrintMes(int log_level, const TCHAR *format, ...);
+    //プール以外から参照されていないかを確認する
+    static bool isFree(amf::AMFSurfacePtr& surface);
+
+    struct PoolEntry {
+        amf::AMF_MEMORY_TYPE memType;
+        amf::AMF_SURFACE_FORMAT format;
+        int width;
+        int height;
+        std::vector<amf::AMFSurfacePtr> surfaces;
+    };
+    PoolEntry *getEntry(amf::AMF_MEMORY_TYPE memType, amf::AMF_SURFACE_FORMAT format, int width, int height);
+    amf::AMFSurfacePtr findFree(PoolEntry *entry);
+    //released()による通知を待って空きを探す
+    amf::AMFSurfacePtr waitFree(PoolEntry *entry);
+
+    amf::AMFContextPtr m_context;
+    int m_maxSurfaces;       //1つのキーあたりの最大保持数
+    std::vector<PoolEntry> m_pool;
+    std::shared_ptr<RGYLog> m_log;
+    uint64_t m_hit;
+    uint64_t m_miss;
+    uint64_t m_wait;
+    uint64_t m_overCap;
+    std::mutex m_mtxRelease;
+    std::condition_variable m_cvRelease;
+    uint64_t m_releaseCount; //released()が呼ばれた回数
+};
+
+#endif //__VCE_SURFACE_POOL_H__
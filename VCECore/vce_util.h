@@ -70,6 +70,7 @@ private:
     int64_t dataDuration;
     RGYFrameData **frameDataList;
     int frameDataNum;
+    amf::AMFBuffer *amfbuffer; //ref(amf::AMFBuffer*)で参照しているAMFのバッファ (参照カウントを1つ保持する)
 
 public:
     uint8_t *bufptr() const {
@@ -181,6 +182,10 @@ public:
         if (dataptr && maxLength) {
             _aligned_free(dataptr);
         }
+        if (amfbuffer) {
+            amfbuffer->Release();
+            amfbuffer = nullptr;
+        }
         dataptr = nullptr;
         dataLength = 0;
         dataOffset = 0;
@@ -265,6 +270,32 @@ public:
         return RGY_ERR_NONE;
     }
 
+    //AMFのバッファをコピーせずに参照する
+    //バッファの参照カウントを保持するので、不要になったらclear()で解放すること
+    RGY_ERR ref(amf::AMFBuffer *buffer, int64_t pts, int64_t dts, int64_t duration) {
+        auto sts = ref((uint8_t *)buffer->GetNative(), buffer->GetSize(), pts, dts, duration);
+        if (sts != RGY_ERR_NONE) {
+            return sts;
+        }
+        buffer->Acquire();
+        amfbuffer = buffer;
+        return RGY_ERR_NONE;
+    }
+
+    //参照先のバッファを保持しており、clear()で解放が必要か
+    bool hasRefOwner() const {
+        return amfbuffer != nullptr;
+    }
+
+    //保持しているバッファを別のRGYBitstreamに(コピーで)渡した後に呼び、解放せずに手放す
+    void detach() {
+        dataptr = nullptr;
+        dataLength = 0;
+        dataOffset = 0;
+        maxLength = 0;
+        amfbuffer = nullptr;
+    }
+
     RGY_ERR copy(const RGYBitstream *pBitstream) {
         auto sts = copy(pBitstream->data(), pBitstream->size());
         if (sts != RGY_ERR_NONE) {
@@ -339,12 +370,13 @@ private:
     const wchar_t *PROP_FLAGS = L"RGYFrameFlags";
     amf::AMFSurfacePtr amfptr;
     unique_ptr<RGYCLFrame> clbuf;
+    RGYOpenCLEvent clevent; //このフレームへのOpenCLでの書き込みの完了を示すイベント
     std::vector<std::shared_ptr<RGYFrameData>> dummy;
 public:
-    RGYFrame() : amfptr(), clbuf() {};
-    RGYFrame(const amf::AMFSurfacePtr &pSurface) : amfptr(std::move(pSurface)), clbuf(), dummy() {
+    RGYFrame() : amfptr(), clbuf(), clevent() {};
+    RGYFrame(const amf::AMFSurfacePtr &pSurface) : amfptr(std::move(pSurface)), clbuf(), clevent(), dummy() {
     }
-    RGYFrame(unique_ptr<RGYCLFrame> clframe) : amfptr(), clbuf(std::move(clframe)) {
+    RGYFrame(unique_ptr<RGYCLFrame> clframe) : amfptr(), clbuf(std::move(clframe)), clevent() {
     }
     ~RGYFrame() {
         clbuf.reset();
@@ -372,6 +404,16 @@ public:
     unique_ptr<RGYCLFrame> detachCLFrame() {
         return std::move(clbuf);
     }
+    void setCLEvent(const RGYOpenCLEvent &event) {
+        clevent = event;
+    }
+    //OpenCLでの書き込みの完了を待機する
+    void waitCLEvent() {
+        if (clevent() != nullptr) {
+            clevent.wait();
+            clevent.reset();
+        }
+    }
     unique_ptr<RGYFrame> createCopy() {
         if (amfptr) {
             return createCopyAMF();
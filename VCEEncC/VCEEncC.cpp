@@ -37,6 +37,7 @@
 #include "vce_cmd.h"
 #include "rgy_util.h"
 #include "rgy_avutil.h"
+#include "rgy_ssim.h"
 
 static void show_version() {
     _ftprintf(stdout, _T("%s\n"), GetVCEEncVersion().c_str());
@@ -214,6 +215,66 @@ int vce_run(VCEParam *pParams) {
     return 0;
 }
 
+//--compare <file0> <file1>
+//エンコードは行わず、2つのy4m/rawファイルのssim/psnrをCPUで計算する
+static int compare_run(int argc, TCHAR **argv) {
+    RGYSsimCompareFilePrm prm;
+    bool ssim = false, psnr = false;
+    for (int iarg = 1; iarg < argc; iarg++) {
+        const TCHAR *option_name = (argv[iarg][0] == _T('-') && argv[iarg][1] == _T('-')) ? &argv[iarg][2] : nullptr;
+        if (option_name == nullptr) {
+            _ftprintf(stderr, _T("Unknown argument for --compare: %s\n"), argv[iarg]);
+            return 1;
+        }
+#define IS_OPTION(x) (0 == _tcscmp(option_name, _T(x)))
+        if (IS_OPTION("compare")) {
+            if (iarg + 2 >= argc) {
+                _ftprintf(stderr, _T("--compare requires 2 files.\n"));
+                return 1;
+            }
+            prm.file[0] = argv[++iarg];
+            prm.file[1] = argv[++iarg];
+        } else if (IS_OPTION("input-res") && iarg + 1 < argc) {
+            iarg++;
+            if (   2 != _stscanf_s(argv[iarg], _T("%dx%d"), &prm.width, &prm.height)
+                && 2 != _stscanf_s(argv[iarg], _T("%d:%d"), &prm.width, &prm.height)
+                && 2 != _stscanf_s(argv[iarg], _T("%d,%d"), &prm.width, &prm.height)) {
+                print_cmd_error_invalid_value(option_name, argv[iarg]);
+                return 1;
+            }
+        } else if (IS_OPTION("input-csp") && iarg + 1 < argc) {
+            iarg++;
+            int value = 0;
+            if (!get_list_value(list_rgy_csp, argv[iarg], &value)) {
+                print_cmd_error_invalid_value(option_name, argv[iarg], list_rgy_csp);
+                return 1;
+            }
+            prm.csp = (RGY_CSP)value;
+        } else if (IS_OPTION("compare-threads") && iarg + 1 < argc) {
+            iarg++;
+            if (1 != _stscanf_s(argv[iarg], _T("%d"), &prm.threads) || prm.threads < 0) {
+                print_cmd_error_invalid_value(option_name, argv[iarg]);
+                return 1;
+            }
+        } else if (IS_OPTION("quality-log") && iarg + 1 < argc) {
+            iarg++;
+            prm.qualityLog = argv[iarg];
+        } else if (IS_OPTION("ssim")) {
+            ssim = true;
+        } else if (IS_OPTION("psnr")) {
+            psnr = true;
+        } else {
+            _ftprintf(stderr, _T("Unknown option for --compare: %s\n"), argv[iarg]);
+            return 1;
+        }
+#undef IS_OPTION
+    }
+    //どちらも指定されていなければ両方計算する
+    prm.ssim = ssim || !psnr;
+    prm.psnr = psnr || !ssim;
+    return rgy_compare_files(&prm);
+}
+
 int _tmain(int argc, TCHAR **argv) {
 #if defined(_WIN32) || defined(_WIN64)
     if (check_locale_is_ja()) {
@@ -227,6 +288,12 @@ int _tmain(int argc, TCHAR **argv) {
         return 1;
     }
 
+    for (int iarg = 1; iarg < argc; iarg++) {
+        if (0 == _tcscmp(argv[iarg], _T("--compare"))) {
+            return compare_run(argc, argv);
+        }
+    }
+
     for (int iarg = 1; iarg < argc; iarg++) {
         const TCHAR *option_name = nullptr;
         if (argv[iarg][0] == _T('-')) {